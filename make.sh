@@ -76,6 +76,9 @@ if [ -n "$GCC_VERSION" ] && [ $GCC_VERSION -ge 7 ]; then
   CFLAGS="$CFLAGS -Wformat-truncation=0 -Wformat-overflow=0"
 fi
 CFLAGS="$CFLAGS -D_FILE_OFFSET_BITS=64 -D_GNU_SOURCE"
+if [ "$(uname -m)" = "x86_64" ]; then
+  CFLAGS="$CFLAGS -mcx16"
+fi
 if [ "$DEBUG_FLAG" = "1" ]; then
   CFLAGS="$CFLAGS -g -DDEBUG_FLAG"
 else
@@ -92,9 +95,13 @@ uname=`uname`
 
 HAVE_VMMETER_H=0
 HAVE_USER_H=0
+IOEVENT_HAVE_URING=0
 if [ "$uname" = "Linux" ]; then
   OS_NAME=OS_LINUX
   IOEVENT_USE=IOEVENT_USE_EPOLL
+  if [ -f /usr/include/linux/io_uring.h ]; then
+     IOEVENT_HAVE_URING=1
+  fi
 elif [ "$uname" = "FreeBSD" ] || [ "$uname" = "Darwin" ]; then
   OS_NAME=OS_FREEBSD 
   IOEVENT_USE=IOEVENT_USE_KQUEUE
@@ -181,6 +188,10 @@ cat <<EOF > src/_os_define.h
 #define HAVE_USER_H $HAVE_USER_H
 #endif
 
+#ifndef IOEVENT_HAVE_URING
+#define IOEVENT_HAVE_URING $IOEVENT_HAVE_URING
+#endif
+
 $(cat $tmp_filename && /bin/rm -f $tmp_filename)
 
 #endif
@@ -52,24 +52,30 @@ int array_allocator_init_ex(ArrayAllocatorContext *ctx,
             0.9999, reclaim_interval, need_lock);
 }
 
-VoidArray *array_allocator_alloc(ArrayAllocatorContext *ctx,
-        const int target_count)
+static inline int array_allocator_calc_bytes(ArrayAllocatorContext *ctx,
+        const int target_count, int *alloc)
 {
-    int alloc;
-    int bytes;
-
     if (target_count <= ctx->min_count) {
-        alloc = ctx->min_count;
+        *alloc = ctx->min_count;
     } else if (is_power2(target_count)) {
-        alloc = target_count;
+        *alloc = target_count;
     } else {
-        alloc = ctx->min_count;
-        while (alloc < target_count) {
-            alloc *= 2;
+        *alloc = ctx->min_count;
+        while (*alloc < target_count) {
+            *alloc *= 2;
         }
     }
 
-    bytes = sizeof(VoidArray) + alloc * ctx->element_size;
+    return sizeof(VoidArray) + (*alloc) * ctx->element_size;
+}
+
+VoidArray *array_allocator_alloc(ArrayAllocatorContext *ctx,
+        const int target_count)
+{
+    int alloc;
+    int bytes;
+
+    bytes = array_allocator_calc_bytes(ctx, target_count, &alloc);
     return (VoidArray *)fast_allocator_alloc(&ctx->allocator, bytes);
 }
 
@@ -77,6 +83,8 @@ VoidArray *array_allocator_realloc(ArrayAllocatorContext *ctx,
         VoidArray *old_array, const int target_count)
 {
     VoidArray *new_array;
+    int alloc;
+    int bytes;
 
     if (old_array == NULL) {
         return array_allocator_alloc(ctx, target_count);
@@ -86,11 +94,19 @@ VoidArray *array_allocator_realloc(ArrayAllocatorContext *ctx,
         return old_array;
     }
 
-    if ((new_array=array_allocator_alloc(ctx, target_count)) != NULL) {
+    /* not fast_allocator_realloc: the alloc count is power of 2 and
+       one size class per power of 2, so the grow always changes the
+       class and fast_allocator_realloc would alloc, copy the whole old
+       slot (alloc elements) and free. copy the used elements only */
+    bytes = array_allocator_calc_bytes(ctx, target_count, &alloc);
+    if ((new_array=(VoidArray *)fast_allocator_alloc(
+                    &ctx->allocator, bytes)) != NULL)
+    {
         if (old_array->count > 0) {
             memcpy(new_array->elts, old_array->elts, ctx->
                     element_size * old_array->count);
         }
+        new_array->alloc = alloc;
         new_array->count = old_array->count;
     }
 
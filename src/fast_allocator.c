@@ -17,14 +17,19 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <pthread.h>
 #include "logger.h"
 #include "shared_func.h"
+#include "pthread_func.h"
 #include "sched_thread.h"
 #include "fast_allocator.h"
 
 #define BYTES_ALIGN(x, pad_mask)  (((x) + pad_mask) & (~pad_mask))
 
+//flush the alloc bytes delta of the thread when exceeds
+#define FAST_ALLOCATOR_THREAD_DELTA_THRESHOLD  (64 * 1024)
+
 struct allocator_wrapper {
 	int alloc_bytes;
 	short allocator_index;
@@ -371,11 +376,286 @@ int fast_allocator_init(struct fast_allocator_context *acontext,
             reclaim_interval, need_lock);
 }
 
+int fast_allocator_set_trunk_backing(struct fast_allocator_context *acontext,
+        const int backing, const bool prefault)
+{
+	int result;
+	int i;
+
+	for (i=0; i<acontext->allocator_array.count; i++)
+	{
+		if (!acontext->allocator_array.allocators[i]->pooled)
+		{
+			continue;
+		}
+
+		if ((result=fast_mblock_set_trunk_backing(&acontext->
+						allocator_array.allocators[i]->mblock,
+						backing, prefault)) != 0)
+		{
+			return result;
+		}
+	}
+
+	return 0;
+}
+
+/* the stat of the last used context for skipping pthread_getspecific,
+   the serial avoids matching a destroyed context of the same address */
+static __thread struct {
+	struct fast_allocator_context *acontext;
+	int64_t serial;
+	struct fast_allocator_thread_stat *stat;
+} last_thread_stat = {NULL, 0, NULL};
+
+static volatile int64_t thread_cache_serial = 0;
+
+static void thread_stat_destroy(void *ptr)
+{
+	struct fast_allocator_thread_stat *stat;
+	struct fast_allocator_context *acontext;
+	int i;
+
+	stat = (struct fast_allocator_thread_stat *)ptr;
+	acontext = stat->acontext;
+	for (i=0; i<acontext->allocator_array.count; i++)
+	{
+		fast_mblock_detach_thread_cache(stat->caches + i);
+	}
+
+	PTHREAD_MUTEX_LOCK(&acontext->thread_cache.lock);
+	if (stat->delta != 0)
+	{
+		__sync_add_and_fetch(&acontext->alloc_bytes, stat->delta);
+	}
+	stat->prev->next = stat->next;
+	stat->next->prev = stat->prev;
+	PTHREAD_MUTEX_UNLOCK(&acontext->thread_cache.lock);
+
+	free(stat);
+}
+
+static struct fast_allocator_thread_stat *new_thread_stat(
+		struct fast_allocator_context *acontext)
+{
+	struct fast_allocator_thread_stat *stat;
+	int bytes;
+
+	bytes = sizeof(struct fast_allocator_thread_stat) +
+		sizeof(struct fast_mblock_thread_cache) *
+		acontext->allocator_array.count;
+	stat = (struct fast_allocator_thread_stat *)fc_calloc(1, bytes);
+	if (stat == NULL)
+	{
+		return NULL;
+	}
+	stat->acontext = acontext;
+	if (pthread_setspecific(acontext->thread_cache.key, stat) != 0)
+	{
+		free(stat);
+		return NULL;
+	}
+
+	PTHREAD_MUTEX_LOCK(&acontext->thread_cache.lock);
+	stat->next = &acontext->thread_cache.head;
+	stat->prev = acontext->thread_cache.head.prev;
+	acontext->thread_cache.head.prev->next = stat;
+	acontext->thread_cache.head.prev = stat;
+	PTHREAD_MUTEX_UNLOCK(&acontext->thread_cache.lock);
+
+	return stat;
+}
+
+static struct fast_allocator_thread_stat *get_thread_stat(
+		struct fast_allocator_context *acontext)
+{
+	struct fast_allocator_thread_stat *stat;
+
+	if (last_thread_stat.acontext == acontext && last_thread_stat.serial ==
+			acontext->thread_cache.serial)
+	{
+		return last_thread_stat.stat;
+	}
+
+	stat = (struct fast_allocator_thread_stat *)pthread_getspecific(
+			acontext->thread_cache.key);
+	if (stat == NULL)
+	{
+		if ((stat=new_thread_stat(acontext)) == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	last_thread_stat.acontext = acontext;
+	last_thread_stat.serial = acontext->thread_cache.serial;
+	last_thread_stat.stat = stat;
+	return stat;
+}
+
+static struct fast_mblock_thread_cache *get_thread_cache(
+		struct fast_mblock_man *mblock, void *args)
+{
+	struct fast_allocator_thread_stat *stat;
+	struct fast_allocator_info *allocator_info;
+
+	if ((stat=get_thread_stat((struct fast_allocator_context *)
+					args)) == NULL)
+	{
+		return NULL;
+	}
+
+	allocator_info = (struct fast_allocator_info *)((char *)mblock -
+			offsetof(struct fast_allocator_info, mblock));
+	return stat->caches + allocator_info->index;
+}
+
+int fast_allocator_set_thread_cache(struct fast_allocator_context *acontext,
+        const int max_cached_bytes)
+{
+	struct fast_mblock_man *mblock;
+	int capacity;
+	int result;
+	int i;
+
+	if (!acontext->need_lock)
+	{
+		logError("file: "__FILE__", line: %d, "
+				"need_lock: %d != 1", __LINE__, acontext->need_lock);
+		return EINVAL;
+	}
+
+	if (acontext->thread_cache.enabled)
+	{
+		return EEXIST;
+	}
+
+	if ((result=init_pthread_lock(&acontext->thread_cache.lock)) != 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+				"init_pthread_lock fail, errno: %d, error info: %s",
+				__LINE__, result, STRERROR(result));
+		return result;
+	}
+
+	if ((result=pthread_key_create(&acontext->thread_cache.key,
+					thread_stat_destroy)) != 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+				"call pthread_key_create fail, "
+				"errno: %d, error info: %s",
+				__LINE__, result, STRERROR(result));
+		pthread_mutex_destroy(&acontext->thread_cache.lock);
+		return result;
+	}
+
+	for (i=0; i<acontext->allocator_array.count; i++)
+	{
+		if (!acontext->allocator_array.allocators[i]->pooled)
+		{
+			continue;
+		}
+
+		mblock = &acontext->allocator_array.allocators[i]->mblock;
+		capacity = max_cached_bytes / mblock->info.element_size;
+		if (capacity < 2)
+		{
+			capacity = 2;
+		}
+		if ((result=fast_mblock_set_thread_cache_ex(mblock, capacity,
+						get_thread_cache, acontext)) != 0)
+		{
+			break;
+		}
+	}
+
+	if (result != 0)
+	{
+		while (--i >= 0)
+		{
+			fast_mblock_unset_thread_cache(&acontext->
+					allocator_array.allocators[i]->mblock);
+		}
+		pthread_key_delete(acontext->thread_cache.key);
+		pthread_mutex_destroy(&acontext->thread_cache.lock);
+		return result;
+	}
+
+	acontext->thread_cache.head.prev = acontext->thread_cache.head.next =
+		&acontext->thread_cache.head;
+	acontext->thread_cache.serial = __sync_add_and_fetch(
+			&thread_cache_serial, 1);
+	acontext->thread_cache.enabled = true;
+	return 0;
+}
+
+static inline void fast_allocator_change_alloc_bytes(
+		struct fast_allocator_context *acontext, const int64_t bytes)
+{
+	struct fast_allocator_thread_stat *stat;
+
+	//the limit check needs the exact alloc bytes
+	if (acontext->thread_cache.enabled && acontext->alloc_bytes_limit == 0 &&
+			(stat=get_thread_stat(acontext)) != NULL)
+	{
+		stat->delta += bytes;
+		if (stat->delta >= FAST_ALLOCATOR_THREAD_DELTA_THRESHOLD ||
+				stat->delta <= -FAST_ALLOCATOR_THREAD_DELTA_THRESHOLD)
+		{
+			__sync_add_and_fetch(&acontext->alloc_bytes, stat->delta);
+			stat->delta = 0;
+		}
+	}
+	else
+	{
+		__sync_add_and_fetch(&acontext->alloc_bytes, bytes);
+	}
+}
+
+int64_t fast_allocator_alloc_bytes(struct fast_allocator_context *acontext)
+{
+	struct fast_allocator_thread_stat *stat;
+	int64_t alloc_bytes;
+
+	alloc_bytes = __sync_add_and_fetch(&acontext->alloc_bytes, 0);
+	if (!acontext->thread_cache.enabled)
+	{
+		return alloc_bytes;
+	}
+
+	PTHREAD_MUTEX_LOCK(&acontext->thread_cache.lock);
+	stat = acontext->thread_cache.head.next;
+	while (stat != &acontext->thread_cache.head)
+	{
+		alloc_bytes += stat->delta;
+		stat = stat->next;
+	}
+	PTHREAD_MUTEX_UNLOCK(&acontext->thread_cache.lock);
+
+	return alloc_bytes;
+}
+
 void fast_allocator_destroy(struct fast_allocator_context *acontext)
 {
 	struct fast_region_info *pRegion;
 	struct fast_region_info *region_end;
 
+	if (acontext->thread_cache.enabled)
+	{
+		struct fast_allocator_thread_stat *stat;
+		struct fast_allocator_thread_stat *deleted;
+
+		pthread_key_delete(acontext->thread_cache.key);
+		stat = acontext->thread_cache.head.next;
+		while (stat != &acontext->thread_cache.head)
+		{
+			deleted = stat;
+			stat = stat->next;
+			free(deleted);
+		}
+		pthread_mutex_destroy(&acontext->thread_cache.lock);
+	}
+
 	if (acontext->regions != NULL)
 	{
 		region_end = acontext->regions + acontext->region_count;
@@ -439,7 +719,7 @@ int fast_allocator_retry_reclaim(struct fast_allocator_context *acontext,
         (double)acontext->alloc_bytes / (double)malloc_bytes);
         */
 
-	if (malloc_bytes == 0 || (double)acontext->alloc_bytes /
+	if (malloc_bytes == 0 || (double)fast_allocator_alloc_bytes(acontext) /
 		(double)malloc_bytes >= acontext->allocator_array.expect_usage_ratio)
 	{
 		return EAGAIN;
@@ -518,29 +798,23 @@ void *fast_allocator_alloc(struct fast_allocator_context *acontext,
 	((struct allocator_wrapper *)ptr)->magic_number = allocator_info->magic_number;
 	((struct allocator_wrapper *)ptr)->alloc_bytes = alloc_bytes;
 
-	__sync_add_and_fetch(&acontext->alloc_bytes, alloc_bytes);
+	fast_allocator_change_alloc_bytes(acontext, alloc_bytes);
 	return (char *)ptr + sizeof(struct allocator_wrapper);
 }
 
-void fast_allocator_free(struct fast_allocator_context *acontext, void *ptr)
+static struct fast_allocator_info *get_wrapper_allocator(
+        struct fast_allocator_context *acontext,
+        struct allocator_wrapper *pWrapper)
 {
-	struct allocator_wrapper *pWrapper;
 	struct fast_allocator_info *allocator_info;
-	void *obj;
-	if (ptr == NULL)
-	{
-		return;
-	}
 
-	obj = (char *)ptr - sizeof(struct allocator_wrapper);
-	pWrapper = (struct allocator_wrapper *)obj;
 	if (pWrapper->allocator_index < 0 || pWrapper->allocator_index >=
 		acontext->allocator_array.count)
 	{
 		logError("file: "__FILE__", line: %d, "
 				"invalid allocator index: %d",
 				__LINE__, pWrapper->allocator_index);
-		return;
+		return NULL;
 	}
 
 	allocator_info = acontext->allocator_array.
@@ -551,10 +825,30 @@ void fast_allocator_free(struct fast_allocator_context *acontext, void *ptr)
 				"invalid magic number: %d != %d",
 				__LINE__, pWrapper->magic_number,
 				allocator_info->magic_number);
+		return NULL;
+	}
+
+	return allocator_info;
+}
+
+void fast_allocator_free(struct fast_allocator_context *acontext, void *ptr)
+{
+	struct allocator_wrapper *pWrapper;
+	struct fast_allocator_info *allocator_info;
+	void *obj;
+	if (ptr == NULL)
+	{
 		return;
 	}
 
-	__sync_sub_and_fetch(&acontext->alloc_bytes, pWrapper->alloc_bytes);
+	obj = (char *)ptr - sizeof(struct allocator_wrapper);
+	pWrapper = (struct allocator_wrapper *)obj;
+	if ((allocator_info=get_wrapper_allocator(acontext, pWrapper)) == NULL)
+	{
+		return;
+	}
+
+	fast_allocator_change_alloc_bytes(acontext, -1 * pWrapper->alloc_bytes);
 	pWrapper->allocator_index = -1;
 	pWrapper->magic_number = 0;
 	if (allocator_info->pooled)
@@ -569,6 +863,77 @@ void fast_allocator_free(struct fast_allocator_context *acontext, void *ptr)
     }
 }
 
+void *fast_allocator_realloc(struct fast_allocator_context *acontext,
+	void *ptr, const int bytes)
+{
+	struct allocator_wrapper *pWrapper;
+	struct fast_allocator_info *old_allocator;
+	struct fast_allocator_info *new_allocator;
+	int alloc_bytes;
+	int delta;
+	void *obj;
+	void *new_ptr;
+
+	if (ptr == NULL)
+	{
+		return fast_allocator_alloc(acontext, bytes);
+	}
+	if (bytes < 0)
+	{
+		return NULL;
+	}
+
+	obj = (char *)ptr - sizeof(struct allocator_wrapper);
+	pWrapper = (struct allocator_wrapper *)obj;
+	if ((old_allocator=get_wrapper_allocator(acontext, pWrapper)) == NULL)
+	{
+		return NULL;
+	}
+
+	alloc_bytes = sizeof(struct allocator_wrapper) + bytes;
+	new_allocator = get_allocator(acontext, &alloc_bytes);
+	if (new_allocator == old_allocator)
+	{
+		if (old_allocator->pooled)  //the same slot class, keep in place
+		{
+			return ptr;
+		}
+
+		/* both are malloced, let the libc realloc grow or shrink in place */
+		delta = alloc_bytes - pWrapper->alloc_bytes;
+		if (delta == 0)
+		{
+			return ptr;
+		}
+		if (delta > 0 && fast_allocator_malloc_trunk_check(
+					delta, acontext) != 0)
+		{
+			return NULL;
+		}
+		if ((new_ptr=realloc(obj, alloc_bytes)) == NULL)
+		{
+			logError("file: "__FILE__", line: %d, "
+					"realloc %d bytes fail", __LINE__, alloc_bytes);
+			return NULL;
+		}
+
+		fast_allocator_malloc_trunk_notify_func(delta, acontext);
+		fast_allocator_change_alloc_bytes(acontext, delta);
+		((struct allocator_wrapper *)new_ptr)->alloc_bytes = alloc_bytes;
+		return (char *)new_ptr + sizeof(struct allocator_wrapper);
+	}
+
+	if ((new_ptr=fast_allocator_alloc(acontext, bytes)) == NULL)
+	{
+		return NULL;
+	}
+
+	memcpy(new_ptr, ptr, FC_MIN(bytes, pWrapper->alloc_bytes -
+				(int)sizeof(struct allocator_wrapper)));
+	fast_allocator_free(acontext, ptr);
+	return new_ptr;
+}
+
 char *fast_allocator_memdup(struct fast_allocator_context *acontext,
         const char *src, const int len)
 {
@@ -56,6 +56,19 @@ struct fast_allocator_array
 	struct fast_allocator_info **allocators;
 };
 
+struct fast_allocator_context;
+
+/* the thread local of the context: the alloc bytes delta flushed to
+   the context in batch, and the magazines indexed by the allocator index */
+struct fast_allocator_thread_stat
+{
+	struct fast_allocator_context *acontext;
+	volatile int64_t delta;
+	struct fast_allocator_thread_stat *prev;
+	struct fast_allocator_thread_stat *next;
+	struct fast_mblock_thread_cache caches[0];
+};
+
 struct fast_allocator_context
 {
 	struct fast_region_info *regions;
@@ -66,6 +79,14 @@ struct fast_allocator_context
 	int64_t alloc_bytes_limit;       //water mark bytes for alloc
 	volatile int64_t alloc_bytes;    //total alloc bytes
 	bool need_lock;     //if need mutex lock for acontext
+
+	struct {
+		bool enabled;
+		int64_t serial;  //the unique serial for the thread local stat
+		pthread_key_t key;     //one key for all size classes
+		pthread_mutex_t lock;  //for the stat chain
+		struct fast_allocator_thread_stat head;
+	} thread_cache;
 };
 
 #define FAST_ALLOCATOR_INIT_REGION(region, _start, _end, _step, _alloc_once) \
@@ -114,6 +135,38 @@ int fast_allocator_init_ex(struct fast_allocator_context *acontext,
         const double expect_usage_ratio, const int reclaim_interval,
         const bool need_lock);
 
+/**
+set the memory backing of the trunks for all region allocators,
+should be called after init and before alloc
+parameters:
+	acontext: the context pointer
+    backing: FAST_MBLOCK_TRUNK_BACKING_xxx
+    prefault: if populate (prefault) the pages when mmap
+return error no, 0 for success, != 0 fail
+*/
+int fast_allocator_set_trunk_backing(struct fast_allocator_context *acontext,
+        const int backing, const bool prefault);
+
+/**
+enable per thread cache of each size class and batch the accounting
+of the alloc bytes by per thread delta, should be called after init
+and before alloc. the accounting is exact when alloc_bytes_limit > 0
+parameters:
+	acontext: the context pointer, need_lock must be true
+	max_cached_bytes: the max cached bytes per size class per thread
+return error no, 0 for success, != 0 fail
+*/
+int fast_allocator_set_thread_cache(struct fast_allocator_context *acontext,
+        const int max_cached_bytes);
+
+/**
+get the alloc bytes including the deltas of the threads
+parameters:
+	acontext: the context pointer
+return the alloc bytes
+*/
+int64_t fast_allocator_alloc_bytes(struct fast_allocator_context *acontext);
+
 /**
 allocator destroy
 parameters:
@@ -140,6 +193,18 @@ return none
 */
 void fast_allocator_free(struct fast_allocator_context *acontext, void *ptr);
 
+/**
+realloc memory from the context, the pointer is kept when the new size
+fits the current slot class, the content is copied only when the class changes
+parameters:
+	acontext: the context pointer
+	ptr: the old pointer, NULL for alloc
+	bytes: the new alloc bytes
+return the realloced pointer, return NULL if fail (the old pointer is kept)
+*/
+void *fast_allocator_realloc(struct fast_allocator_context *acontext,
+	void *ptr, const int bytes);
+
 /**
 retry reclaim free trunks
 parameters:
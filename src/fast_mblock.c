@@ -17,13 +17,20 @@
 
 #include <errno.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
 #include <pthread.h>
 #include "shared_func.h"
 #include "pthread_func.h"
 #include "sched_thread.h"
 #include "pthread_func.h"
+#include "system_info.h"
 #include "fast_mblock.h"
 
+#ifdef OS_LINUX
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
 struct _fast_mblock_manager
 {
     bool initialized;
@@ -42,9 +49,33 @@ struct _fast_mblock_manager
 
 static struct _fast_mblock_manager mblock_manager = {false, 0};
 
+static uint32_t reclaimer_entry_id = 0;  //the schedule entry id
+
+#ifdef OS_LINUX
+/* the NUMA node of each CPU for routing */
+static struct {
+    pthread_once_t once;
+    int cpu_count;
+    int *cpu_nodes;
+} numa_cpu_map = {PTHREAD_ONCE_INIT, 0, NULL};
+#endif
+
+static int64_t fast_mblock_own_cached_count(struct fast_mblock_man *mblock);
+
 #define fast_mblock_get_trunk_size(mblock, block_size, element_count) \
     (sizeof(struct fast_mblock_malloc) + block_size * element_count)
 
+#if (defined(__SIZEOF_INT128__) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)) \
+    || (!defined(__SIZEOF_INT128__) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+#define FAST_MBLOCK_LOCK_FREE_SUPPORTED  1
+#define FAST_MBLOCK_TAGGED_PTR_CAS(ptr, old_ptr, new_ptr) \
+    __sync_bool_compare_and_swap(&(ptr)->value, \
+            (old_ptr).value, (new_ptr).value)
+#else
+#define FAST_MBLOCK_TAGGED_PTR_CAS(ptr, old_ptr, new_ptr) \
+    ((void)(new_ptr), false)
+#endif
+
 int fast_mblock_manager_init()
 {
     int result;
@@ -131,17 +162,24 @@ static void delete_from_mblock_list(struct fast_mblock_man *mblock)
 
 #define STAT_DUP(pStat, current, copy_name) \
     do { \
+        int64_t used_count; \
         if (copy_name) { \
             strcpy(pStat->name, current->info.name);          \
             pStat->trunk_size = current->info.trunk_size;     \
             pStat->block_size = current->info.block_size;     \
             pStat->element_size = current->info.element_size; \
+            pStat->trunk_backing = current->info.trunk_backing; \
         } \
         pStat->element_total_count += current->info.element_total_count;  \
-        pStat->element_used_count += current->info.element_used_count;    \
+        used_count = current->info.element_used_count -   \
+            fast_mblock_own_cached_count(current);  \
+        if (used_count > 0) { /* approximate, see the cached count */ \
+            pStat->element_used_count += used_count;  \
+        } \
         pStat->delay_free_elements += current->info.delay_free_elements;  \
         pStat->trunk_total_count += current->info.trunk_total_count;  \
         pStat->trunk_used_count += current->info.trunk_used_count;    \
+        pStat->returned_bytes += current->info.returned_bytes;    \
         pStat->instance_count += current->info.instance_count;  \
         /* logInfo("name: %s, element_size: %d, total_count: %d, "  \
            "used_count: %d", pStat->name, pStat->element_size, \
@@ -288,11 +326,13 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
         int64_t used_mem;
         int64_t amem;
         int64_t delay_free_mem;
+        int64_t returned_mem;
         int name_len;
         char *size_caption;
         char alloc_mem_str[32];
         char used_mem_str[32];
         char delay_free_mem_str[32];
+        char returned_mem_str[32];
 
         if (order_by == FAST_MBLOCK_ORDER_BY_ELEMENT_SIZE)
         {
@@ -317,13 +357,15 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
         alloc_mem = 0;
         used_mem = 0;
         delay_free_mem = 0;
-        logInfo("%20s %10s %8s %12s %11s %10s %10s %10s %10s %12s",
+        returned_mem = 0;
+        logInfo("%20s %10s %8s %12s %11s %10s %10s %10s %10s %12s %8s",
                 "name", size_caption, "instance", "alloc_bytes",
                 "trunc_alloc", "trunk_used", "el_alloc",
-                "el_used", "delay_free", "used_ratio");
+                "el_used", "delay_free", "used_ratio", "backing");
         stat_end = stats + count;
         for (pStat=stats; pStat<stat_end; pStat++)
         {
+            returned_mem += pStat->returned_bytes;
             if (pStat->trunk_total_count > 0)
             {
                 amem = (int64_t)pStat->trunk_size * pStat->trunk_total_count;
@@ -347,13 +389,15 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
                 name_len = 20;
             }
             logInfo("%20.*s %10d %8d %12"PRId64" %11"PRId64" %10"PRId64
-                    " %10"PRId64" %10"PRId64" %10"PRId64" %11.2f%%", name_len,
-                    pStat->name, order_by == FAST_MBLOCK_ORDER_BY_ELEMENT_SIZE ?
+                    " %10"PRId64" %10"PRId64" %10"PRId64" %11.2f%% %8s",
+                    name_len, pStat->name, order_by ==
+                    FAST_MBLOCK_ORDER_BY_ELEMENT_SIZE ?
                     pStat->element_size : pStat->trunk_size,
                     pStat->instance_count, amem, pStat->trunk_total_count,
                     pStat->trunk_used_count, pStat->element_total_count,
                     pStat->element_used_count, pStat->delay_free_elements,
-                    CALC_USED_RATIO(pStat));
+                    CALC_USED_RATIO(pStat), fast_mblock_get_trunk_backing_caption(
+                        pStat->trunk_backing));
             ++output_count;
         }
 
@@ -362,6 +406,7 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
             sprintf(alloc_mem_str, "%"PRId64" bytes", alloc_mem);
             sprintf(used_mem_str, "%"PRId64" bytes", used_mem);
             sprintf(delay_free_mem_str, "%"PRId64" bytes", delay_free_mem);
+            sprintf(returned_mem_str, "%"PRId64" bytes", returned_mem);
         }
         else if (alloc_mem < 1024 * 1024)
         {
@@ -369,6 +414,8 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
             sprintf(used_mem_str, "%.3f KB", (double)used_mem / 1024);
             sprintf(delay_free_mem_str, "%.3f KB",
                     (double)delay_free_mem / 1024);
+            sprintf(returned_mem_str, "%.3f KB",
+                    (double)returned_mem / 1024);
         }
         else if (alloc_mem < 1024 * 1024 * 1024)
         {
@@ -378,6 +425,8 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
                     (double)used_mem / (1024 * 1024));
             sprintf(delay_free_mem_str, "%.3f MB",
                     (double)delay_free_mem / (1024 * 1024));
+            sprintf(returned_mem_str, "%.3f MB",
+                    (double)returned_mem / (1024 * 1024));
         }
         else
         {
@@ -387,14 +436,17 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
                     (double)used_mem / (1024 * 1024 * 1024));
             sprintf(delay_free_mem_str, "%.3f GB",
                     (double)delay_free_mem / (1024 * 1024 * 1024));
+            sprintf(returned_mem_str, "%.3f GB",
+                    (double)returned_mem / (1024 * 1024 * 1024));
         }
 
         logInfo("mblock count: %d, output count: %d, memory stat => "
-                "{alloc : %s, used: %s (%.2f%%), delay free: %s (%.2f%%) }",
-                mblock_manager.count, output_count, alloc_mem_str, used_mem_str,
-                alloc_mem > 0 ?  100.00 * (double)used_mem / alloc_mem : 0.00,
-                delay_free_mem_str, alloc_mem > 0 ? 100.00 *
-                    (double)delay_free_mem / alloc_mem : 0.00);
+                "{alloc : %s, used: %s (%.2f%%), delay free: %s (%.2f%%), "
+                "returned: %s }", mblock_manager.count, output_count,
+                alloc_mem_str, used_mem_str, alloc_mem > 0 ?  100.00 *
+                (double)used_mem / alloc_mem : 0.00, delay_free_mem_str,
+                alloc_mem > 0 ? 100.00 * (double)delay_free_mem /
+                alloc_mem : 0.00, returned_mem_str);
     }
 
     if (stats != NULL) free(stats);
@@ -463,6 +515,7 @@ int fast_mblock_init_ex2(struct fast_mblock_man *mblock, const char *name,
     mblock->delay_free_chain.tail = NULL;
     mblock->info.element_total_count = 0;
     mblock->info.element_used_count = 0;
+    mblock->info.returned_bytes = 0;
     mblock->info.instance_count = 1;
     mblock->info.trunk_size = fast_mblock_get_trunk_size(mblock,
             mblock->info.block_size, mblock->alloc_elements.once);
@@ -470,6 +523,24 @@ int fast_mblock_init_ex2(struct fast_mblock_man *mblock, const char *name,
     mblock->alloc_elements.need_wait = false;
     mblock->alloc_elements.pcontinue_flag = NULL;
     mblock->alloc_elements.exceed_log_level = LOG_ERR;
+    mblock->trunk_backing.type = FAST_MBLOCK_TRUNK_BACKING_MALLOC;
+    mblock->trunk_backing.prefault = false;
+    mblock->info.trunk_backing = FAST_MBLOCK_TRUNK_BACKING_MALLOC;
+    mblock->lock_free.enabled = false;
+    mblock->lock_free.head.s.node = NULL;
+    mblock->lock_free.head.s.tag = 0;
+    mblock->thread_cache.enabled = false;
+    mblock->thread_cache.capacity = 0;
+    mblock->thread_cache.batch_count = 0;
+    mblock->thread_cache.get_cache_func = NULL;
+    mblock->thread_cache.get_cache_args = NULL;
+    INIT_HEAD(&mblock->thread_cache.head);
+    mblock->reclaim.enabled = false;
+    memset(&mblock->reclaim.options, 0, sizeof(mblock->reclaim.options));
+    mblock->numa.node = -1;
+    mblock->numa.count = 0;
+    mblock->numa.mblocks = NULL;
+    mblock->telemetry = NULL;
 
     if (trunk_callbacks == NULL)
     {
@@ -495,6 +566,234 @@ int fast_mblock_init_ex2(struct fast_mblock_man *mblock, const char *name,
     return 0;
 }
 
+const char *fast_mblock_get_trunk_backing_caption(const int backing)
+{
+    switch (backing)
+    {
+        case FAST_MBLOCK_TRUNK_BACKING_MMAP:
+            return "mmap";
+        case FAST_MBLOCK_TRUNK_BACKING_HUGETLB:
+            return "hugetlb";
+        case FAST_MBLOCK_TRUNK_BACKING_THP:
+            return "thp";
+        default:
+            return "malloc";
+    }
+}
+
+static inline int fast_mblock_get_page_size(const int backing)
+{
+    if (backing == FAST_MBLOCK_TRUNK_BACKING_HUGETLB ||
+            backing == FAST_MBLOCK_TRUNK_BACKING_THP)
+    {
+        return FAST_MBLOCK_HUGE_PAGE_SIZE;
+    }
+    else
+    {
+        return getpagesize();
+    }
+}
+
+#define FAST_MBLOCK_GET_MAP_SIZE(trunk_size, backing) \
+    MEM_ALIGN_CEIL((size_t)trunk_size, fast_mblock_get_page_size(backing))
+
+int fast_mblock_set_trunk_backing(struct fast_mblock_man *mblock,
+        const int backing, const bool prefault)
+{
+    int64_t map_size;
+    int once;
+
+    if (!(backing >= FAST_MBLOCK_TRUNK_BACKING_MALLOC &&
+                backing <= FAST_MBLOCK_TRUNK_BACKING_THP))
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, invalid trunk backing: %d",
+                __LINE__, mblock->info.name, backing);
+        return EINVAL;
+    }
+
+    if (mblock->info.trunk_total_count > 0 || mblock->numa.count > 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, should be called before alloc "
+                "and set NUMA aware", __LINE__, mblock->info.name);
+        return EBUSY;
+    }
+
+    mblock->trunk_backing.type = backing;
+    mblock->trunk_backing.prefault = prefault;
+    if (backing == FAST_MBLOCK_TRUNK_BACKING_MALLOC)
+    {
+        return 0;
+    }
+
+    //make full use of the mapped pages
+    map_size = FAST_MBLOCK_GET_MAP_SIZE(mblock->info.trunk_size, backing);
+    once = (map_size - sizeof(struct fast_mblock_malloc)) /
+        mblock->info.block_size;
+    if (mblock->alloc_elements.limit > 0 && once >
+            mblock->alloc_elements.limit)
+    {
+        once = mblock->alloc_elements.limit;
+    }
+    mblock->alloc_elements.once = once;
+    mblock->info.trunk_size = fast_mblock_get_trunk_size(mblock,
+            mblock->info.block_size, mblock->alloc_elements.once);
+    return 0;
+}
+
+#if defined(OS_LINUX) && defined(SYS_mbind)
+#define FAST_MBLOCK_MPOL_PREFERRED  1
+
+/* prefer rather than bind to the node for avoiding OOM */
+static void fast_mblock_bind_numa_node(struct fast_mblock_man *mblock,
+        char *start, const size_t size)
+{
+    unsigned long nodemask[FAST_MBLOCK_NUMA_MAX_NODES /
+        (8 * sizeof(unsigned long))];
+    const int bits = 8 * sizeof(unsigned long);
+
+    memset(nodemask, 0, sizeof(nodemask));
+    nodemask[mblock->numa.node / bits] |= 1UL <<
+        (mblock->numa.node % bits);
+    if (syscall(SYS_mbind, start, size, FAST_MBLOCK_MPOL_PREFERRED,
+                nodemask, 8 * sizeof(nodemask) + 1, 0) != 0)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "mblock %s, mbind to NUMA node %d fail, "
+                "errno: %d, error info: %s", __LINE__,
+                mblock->info.name, mblock->numa.node,
+                errno, STRERROR(errno));
+    }
+}
+#else
+#define fast_mblock_bind_numa_node(mblock, start, size)
+#endif
+
+static char *fast_mblock_mmap_trunk(struct fast_mblock_man *mblock,
+        const int trunk_size, const int backing)
+{
+    char *pNew;
+    char *start;
+    size_t map_size;
+    size_t extra_size;
+    int flags;
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+    flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    /* the pages of the NUMA bound trunk are touched by prealloc after mbind */
+    if (mblock->trunk_backing.prefault && mblock->numa.node < 0)
+    {
+        flags |= MAP_POPULATE;
+    }
+#endif
+
+    map_size = FAST_MBLOCK_GET_MAP_SIZE(trunk_size, backing);
+    if (backing == FAST_MBLOCK_TRUNK_BACKING_HUGETLB)
+    {
+#ifdef MAP_HUGETLB
+        flags |= MAP_HUGETLB;
+#else
+        errno = EOPNOTSUPP;
+        return NULL;
+#endif
+    }
+
+    //the transparent huge pages need the address aligned by huge page
+    extra_size = (backing == FAST_MBLOCK_TRUNK_BACKING_THP) ?
+        FAST_MBLOCK_HUGE_PAGE_SIZE : 0;
+    pNew = (char *)mmap(NULL, map_size + extra_size,
+            PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (pNew == (char *)MAP_FAILED)
+    {
+        return NULL;
+    }
+    if (extra_size == 0)
+    {
+        if (mblock->numa.node >= 0)
+        {
+            fast_mblock_bind_numa_node(mblock, pNew, map_size);
+        }
+        return pNew;
+    }
+
+    start = (char *)MEM_ALIGN_CEIL((size_t)pNew, FAST_MBLOCK_HUGE_PAGE_SIZE);
+    if (start > pNew)
+    {
+        munmap(pNew, start - pNew);
+    }
+    if (pNew + extra_size > start)
+    {
+        munmap(start + map_size, (pNew + extra_size) - start);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (madvise(start, map_size, MADV_HUGEPAGE) != 0)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "mblock %s, madvise MADV_HUGEPAGE fail, "
+                "errno: %d, error info: %s", __LINE__,
+                mblock->info.name, errno, STRERROR(errno));
+    }
+#endif
+
+    if (mblock->numa.node >= 0)
+    {
+        fast_mblock_bind_numa_node(mblock, start, map_size);
+    }
+    return start;
+}
+
+static char *fast_mblock_malloc_trunk(struct fast_mblock_man *mblock,
+        const int trunk_size, int *backing)
+{
+    char *pNew;
+
+    *backing = mblock->trunk_backing.type;
+    if (*backing != FAST_MBLOCK_TRUNK_BACKING_MALLOC)
+    {
+        if ((pNew=fast_mblock_mmap_trunk(mblock,
+                        trunk_size, *backing)) != NULL)
+        {
+            return pNew;
+        }
+
+        //fall back to malloc and never retry
+        logWarning("file: "__FILE__", line: %d, "
+                "mblock %s, mmap %d bytes for %s trunk fail, "
+                "errno: %d, error info: %s, fall back to malloc",
+                __LINE__, mblock->info.name, trunk_size,
+                fast_mblock_get_trunk_backing_caption(*backing),
+                errno, STRERROR(errno));
+        mblock->trunk_backing.type = FAST_MBLOCK_TRUNK_BACKING_MALLOC;
+        *backing = FAST_MBLOCK_TRUNK_BACKING_MALLOC;
+    }
+
+    pNew = (char *)fc_malloc(trunk_size);
+    if (pNew != NULL)
+    {
+        memset(pNew, 0, trunk_size);
+    }
+    return pNew;
+}
+
+static void fast_mblock_release_trunk(struct fast_mblock_malloc *trunk)
+{
+    if (trunk->backing == FAST_MBLOCK_TRUNK_BACKING_MALLOC)
+    {
+        free(trunk);
+    }
+    else
+    {
+        munmap(trunk, FAST_MBLOCK_GET_MAP_SIZE(
+                    trunk->trunk_size, trunk->backing));
+    }
+}
+
 static int fast_mblock_prealloc(struct fast_mblock_man *mblock)
 {
 	struct fast_mblock_node *pNode;
@@ -506,6 +805,7 @@ static int fast_mblock_prealloc(struct fast_mblock_man *mblock)
 	int result;
     int trunk_size;
     int alloc_count;
+    int backing;
 
     if (mblock->alloc_elements.limit > 0)
     {
@@ -542,14 +842,16 @@ static int fast_mblock_prealloc(struct fast_mblock_man *mblock)
 		return ENOMEM;
 	}
 
-	pNew = (char *)fc_malloc(trunk_size);
+	pNew = fast_mblock_malloc_trunk(mblock, trunk_size, &backing);
 	if (pNew == NULL)
 	{
 		return ENOMEM;
 	}
-	memset(pNew, 0, trunk_size);
 
 	pMallocNode = (struct fast_mblock_malloc *)pNew;
+    pMallocNode->trunk_size = trunk_size;
+    pMallocNode->backing = backing;
+    pMallocNode->numa_node = mblock->numa.node;
 	pTrunkStart = pNew + sizeof(struct fast_mblock_malloc);
 	pLast = pNew + (trunk_size - mblock->info.block_size);
 	for (p=pTrunkStart; p<=pLast; p += mblock->info.block_size)
@@ -560,7 +862,7 @@ static int fast_mblock_prealloc(struct fast_mblock_man *mblock)
             if ((result=mblock->object_callbacks.init_func(pNode->data,
                             mblock->object_callbacks.args)) != 0)
             {
-                free(pNew);
+                fast_mblock_release_trunk(pMallocNode);
                 return result;
             }
         }
@@ -579,7 +881,6 @@ static int fast_mblock_prealloc(struct fast_mblock_man *mblock)
 
     pMallocNode->ref_count = 0;
     pMallocNode->alloc_count = alloc_count;
-    pMallocNode->trunk_size = trunk_size;
     pMallocNode->prev = mblock->trunks.head.prev;
 	pMallocNode->next = &mblock->trunks.head;
     mblock->trunks.head.prev->next = pMallocNode;
@@ -587,6 +888,7 @@ static int fast_mblock_prealloc(struct fast_mblock_man *mblock)
 
     mblock->info.trunk_total_count++;
     mblock->info.element_total_count += alloc_count;
+    mblock->info.trunk_backing = backing;
     if (mblock->trunk_callbacks.notify_func != NULL)
     {
         mblock->trunk_callbacks.notify_func(trunk_size,
@@ -612,13 +914,50 @@ static inline void fast_mblock_remove_trunk(struct fast_mblock_man *mblock,
 }
 
 #define FAST_MBLOCK_GET_TRUNK(pNode) \
-    (struct fast_mblock_malloc *)((char *)pNode - pNode->offset)
+    ((struct fast_mblock_malloc *)((char *)pNode - pNode->offset))
+
+/* the NUMA node mblock which the node belongs to, NULL for the mblock self */
+#define FAST_MBLOCK_NUMA_OWNER(mblock, pNode) \
+    ((mblock)->numa.count > 0 && FAST_MBLOCK_GET_TRUNK(pNode)->numa_node >= 0 \
+     ? (mblock)->numa.mblocks + FAST_MBLOCK_GET_TRUNK(pNode)->numa_node : NULL)
 
+/* change the used element count and the reference count of the trunk */
 static inline void fast_mblock_ref_counter_op(struct fast_mblock_man *mblock,
         struct fast_mblock_node *pNode, const bool is_inc)
 {
 	struct fast_mblock_malloc *pMallocNode;
 
+    if (mblock->lock_free.enabled)
+    {
+        pMallocNode = FAST_MBLOCK_GET_TRUNK(pNode);
+        if (is_inc)
+        {
+            __sync_add_and_fetch(&mblock->info.element_used_count, 1);
+            if (__sync_add_and_fetch(&pMallocNode->ref_count, 1) == 1)
+            {
+                __sync_add_and_fetch(&mblock->info.trunk_used_count, 1);
+            }
+        }
+        else
+        {
+            __sync_sub_and_fetch(&mblock->info.element_used_count, 1);
+            if (__sync_sub_and_fetch(&pMallocNode->ref_count, 1) == 0)
+            {
+                __sync_sub_and_fetch(&mblock->info.trunk_used_count, 1);
+            }
+        }
+        return;
+    }
+
+    if (is_inc)
+    {
+        mblock->info.element_used_count++;
+    }
+    else
+    {
+        mblock->info.element_used_count--;
+    }
+
 #ifdef FAST_MBLOCK_MAGIC_CHECK
     int calc_offset;
 
@@ -662,8 +1001,36 @@ static inline void fast_mblock_ref_counter_op(struct fast_mblock_man *mblock,
 #define fast_mblock_ref_counter_dec(mblock, pNode) \
     fast_mblock_ref_counter_op(mblock, pNode, false)
 
-static void fast_mblock_free_trunk(struct fast_mblock_man *mblock,
+/* return the pages of the trunk to the OS before release */
+static int64_t fast_mblock_return_trunk_pages(
         struct fast_mblock_malloc *trunk)
+{
+    char *start;
+    char *end;
+    int page_size;
+
+    if (trunk->backing != FAST_MBLOCK_TRUNK_BACKING_MALLOC)
+    {
+        return FAST_MBLOCK_GET_MAP_SIZE(trunk->trunk_size, trunk->backing);
+    }
+
+#ifdef MADV_DONTNEED
+    //the freed chunk maybe kept by the heap, so release its inner pages
+    page_size = getpagesize();
+    start = (char *)MEM_ALIGN_CEIL((size_t)(trunk + 1), page_size);
+    end = (char *)MEM_ALIGN_FLOOR((size_t)trunk + trunk->trunk_size,
+            (size_t)page_size);
+    if (end > start && madvise(start, end - start, MADV_DONTNEED) == 0)
+    {
+        return end - start;
+    }
+#endif
+
+    return 0;
+}
+
+static void fast_mblock_free_trunk(struct fast_mblock_man *mblock,
+        struct fast_mblock_malloc *trunk, int64_t *returned_bytes)
 {
 	char *start;
 	char *p;
@@ -681,101 +1048,831 @@ static void fast_mblock_free_trunk(struct fast_mblock_man *mblock,
         }
     }
 
-    free(trunk);
+    if (returned_bytes != NULL)
+    {
+        *returned_bytes += fast_mblock_return_trunk_pages(trunk);
+    }
+    fast_mblock_release_trunk(trunk);
 }
 
-void fast_mblock_destroy(struct fast_mblock_man *mblock)
+/* the mark of the sampled node which is allocated */
+#define FAST_MBLOCK_SAMPLED_NODE_MARK  -2
+
+#define FAST_MBLOCK_TELEMETRY_SITE_TABLE_SIZE \
+    (2 * FAST_MBLOCK_TELEMETRY_MAX_SITES)
+
+struct fast_mblock_telemetry_sample
 {
-	struct fast_mblock_malloc *pMallocNode;
-	struct fast_mblock_malloc *pMallocTmp;
+    struct fast_mblock_node *node;  //NULL for empty slot
+    void *caller;
+    int64_t alloc_time;  //in ms
+};
 
-	if (!IS_EMPTY(&mblock->trunks.head))
-    {
-        pMallocNode = mblock->trunks.head.next;
-        while (pMallocNode != &mblock->trunks.head)
-        {
-            pMallocTmp = pMallocNode;
-            pMallocNode = pMallocNode->next;
+struct fast_mblock_telemetry_site
+{
+    void *caller;  //NULL for empty slot
+    int64_t alloc_count;     //sampled alloc count
+    int64_t free_count;      //sampled free count
+    int64_t total_lifetime;  //the lifetime of the freed samples in ms
+};
 
-            fast_mblock_free_trunk(mblock, pMallocTmp);
-        }
+struct fast_mblock_telemetry_window
+{
+    volatile int64_t start_time;
+    volatile int64_t high_water;  //the max used elements
+};
 
-        INIT_HEAD(&mblock->trunks.head);
-        mblock->info.trunk_total_count = 0;
-        mblock->info.trunk_used_count = 0;
-        mblock->free_chain_head = NULL;
-        mblock->info.element_used_count = 0;
-        mblock->info.delay_free_elements = 0;
-        mblock->info.element_total_count = 0;
-    }
+struct fast_mblock_telemetry
+{
+    struct fast_mblock_man *mblock;  //the owner mblock
+    struct fast_mblock_telemetry_options options;
+    pthread_mutex_t lock;
+
+    /* the allocations to skip before the next sample, per mblock for
+       the sample rate of each mblock even when the allocations of many
+       mblocks interleave in a thread */
+    volatile int sample_countdown;
+
+    struct {
+        int mask;   //the hash table size - 1
+        int count;
+        int64_t total_count;    //the total sampled count
+        int64_t dropped_count;  //dropped for exceed max samples
+        struct fast_mblock_telemetry_sample *entries;
+    } samples;
+
+    struct {
+        int count;
+        int64_t dropped_count;  //dropped for exceed max sites
+        struct fast_mblock_telemetry_site entries[
+            FAST_MBLOCK_TELEMETRY_SITE_TABLE_SIZE];
+    } sites;
+
+    struct {
+        volatile int index;
+        volatile int64_t high_water;  //the max used elements of all time
+        struct fast_mblock_telemetry_window *entries;
+    } windows;
+
+    int64_t lifetime_histogram[FAST_MBLOCK_TELEMETRY_HISTOGRAM_SIZE];
+};
 
-    if (mblock->need_lock) destroy_pthread_lock_cond_pair(&(mblock->lcp));
-    delete_from_mblock_list(mblock);
+static __thread unsigned int telemetry_sample_seed = 0;
+
+//the random interval with the mean of the sample rate
+static inline int fast_mblock_telemetry_sample_interval(const int sample_rate)
+{
+    if (telemetry_sample_seed == 0)
+    {
+        telemetry_sample_seed = (unsigned int)(size_t)pthread_self();
+    }
+    return 1 + rand_r(&telemetry_sample_seed) % (2 * sample_rate - 1);
 }
 
-static inline struct fast_mblock_node *alloc_node(
-        struct fast_mblock_man *mblock)
+int fast_mblock_set_telemetry(struct fast_mblock_man *mblock,
+        const struct fast_mblock_telemetry_options *options)
 {
-	struct fast_mblock_node *pNode;
-	int result;
+    struct fast_mblock_telemetry *telemetry;
+    int capacity;
+    int bytes;
+    int result;
 
-    while (1)
+    if (mblock->telemetry != NULL)
     {
-        if (mblock->free_chain_head != NULL)
-        {
-            pNode = mblock->free_chain_head;
-            mblock->free_chain_head = pNode->next;
-            break;
-        }
+        return EEXIST;
+    }
 
-        if (mblock->delay_free_chain.head != NULL &&
-                mblock->delay_free_chain.head->
-                recycle_timestamp <= get_current_time())
-        {
-            pNode = mblock->delay_free_chain.head;
-            mblock->delay_free_chain.head = pNode->next;
-            if (mblock->delay_free_chain.tail == pNode)
-            {
-                mblock->delay_free_chain.tail = NULL;
-            }
+    if (mblock->numa.count > 0 || mblock->numa.node >= 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, should be called before set NUMA aware",
+                __LINE__, mblock->info.name);
+        return EBUSY;
+    }
 
-            mblock->info.delay_free_elements--;
-            break;
-        }
+    if (options->sample_rate < 0 || options->max_samples < 0 ||
+            options->window_seconds < 0 || options->window_count < 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, invalid telemetry options", __LINE__,
+                mblock->info.name);
+        return EINVAL;
+    }
 
-        if ((result=fast_mblock_prealloc(mblock)) == 0)
+    telemetry = (struct fast_mblock_telemetry *)fc_malloc(
+            sizeof(struct fast_mblock_telemetry));
+    if (telemetry == NULL)
+    {
+        return ENOMEM;
+    }
+    memset(telemetry, 0, sizeof(struct fast_mblock_telemetry));
+
+    telemetry->mblock = mblock;
+    telemetry->options = *options;
+    if (telemetry->options.max_samples == 0)
+    {
+        telemetry->options.max_samples = 4096;
+    }
+    if (telemetry->options.window_seconds == 0)
+    {
+        telemetry->options.window_seconds = 60;
+    }
+    if (telemetry->options.window_count == 0)
+    {
+        telemetry->options.window_count = 60;
+    }
+
+    if ((result=init_pthread_lock(&telemetry->lock)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "init_pthread_lock fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        free(telemetry);
+        return result;
+    }
+
+    capacity = 2;
+    if (telemetry->options.sample_rate > 0)
+    {
+        telemetry->sample_countdown = fast_mblock_telemetry_sample_interval(
+                telemetry->options.sample_rate);
+        while (capacity < 2 * telemetry->options.max_samples)
         {
-            pNode = mblock->free_chain_head;
-            mblock->free_chain_head = pNode->next;
-            break;
+            capacity *= 2;
         }
-
-        if (!mblock->alloc_elements.need_wait)
+    }
+    bytes = sizeof(struct fast_mblock_telemetry_sample) * capacity;
+    telemetry->samples.entries = (struct fast_mblock_telemetry_sample *)
+        fc_malloc(bytes);
+    bytes = sizeof(struct fast_mblock_telemetry_window) *
+        telemetry->options.window_count;
+    telemetry->windows.entries = (struct fast_mblock_telemetry_window *)
+        fc_malloc(bytes);
+    if (telemetry->samples.entries == NULL ||
+            telemetry->windows.entries == NULL)
+    {
+        if (telemetry->samples.entries != NULL)
         {
-            pNode = NULL;
-            break;
+            free(telemetry->samples.entries);
         }
-
-        pthread_cond_wait(&mblock->lcp.cond, &mblock->lcp.lock);
-        if (!*(mblock->alloc_elements.pcontinue_flag))
+        if (telemetry->windows.entries != NULL)
         {
-            pNode = NULL;
-            break;
+            free(telemetry->windows.entries);
         }
+        pthread_mutex_destroy(&telemetry->lock);
+        free(telemetry);
+        return ENOMEM;
     }
 
-    if (pNode != NULL)
+    memset(telemetry->samples.entries, 0, sizeof(struct
+                fast_mblock_telemetry_sample) * capacity);
+    memset(telemetry->windows.entries, 0, bytes);
+    telemetry->samples.mask = capacity - 1;
+    telemetry->windows.entries[0].start_time = get_current_time();
+
+    mblock->telemetry = telemetry;
+    return 0;
+}
+
+static void fast_mblock_telemetry_destroy(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_telemetry *telemetry;
+
+    telemetry = mblock->telemetry;
+    mblock->telemetry = NULL;
+    if (telemetry->mblock != mblock)  //shared by the NUMA node mblock
     {
-        mblock->info.element_used_count++;
-        fast_mblock_ref_counter_inc(mblock, pNode);
+        return;
     }
 
-	return pNode;
+    free(telemetry->samples.entries);
+    free(telemetry->windows.entries);
+    pthread_mutex_destroy(&telemetry->lock);
+    free(telemetry);
 }
 
-struct fast_mblock_node *fast_mblock_alloc(struct fast_mblock_man *mblock)
+static inline int64_t fast_mblock_used_count(struct fast_mblock_man *mblock)
 {
-	struct fast_mblock_node *pNode;
+    int64_t used_count;
+    int i;
+
+    used_count = mblock->info.element_used_count;
+    for (i=0; i<mblock->numa.count; i++)
+    {
+        used_count += mblock->numa.mblocks[i].info.element_used_count;
+    }
+    return used_count;
+}
+
+static void fast_mblock_telemetry_update_window(
+        struct fast_mblock_telemetry *telemetry)
+{
+    struct fast_mblock_telemetry_window *window;
+    int64_t used_count;
+    time_t current_time;
+
+    //the count is read without lock, it is just a statistic
+    used_count = fast_mblock_used_count(telemetry->mblock);
+    current_time = get_current_time();
+    window = telemetry->windows.entries + telemetry->windows.index;
+    if (current_time - window->start_time >=
+            telemetry->options.window_seconds)
+    {
+        PTHREAD_MUTEX_LOCK(&telemetry->lock);
+        window = telemetry->windows.entries + telemetry->windows.index;
+        if (current_time - window->start_time >=
+                telemetry->options.window_seconds)
+        {
+            telemetry->windows.index = (telemetry->windows.index + 1) %
+                telemetry->options.window_count;
+            window = telemetry->windows.entries + telemetry->windows.index;
+            window->high_water = 0;
+            window->start_time = current_time - current_time %
+                telemetry->options.window_seconds;
+        }
+        PTHREAD_MUTEX_UNLOCK(&telemetry->lock);
+    }
+
+    if (used_count > window->high_water)
+    {
+        window->high_water = used_count;
+    }
+    if (used_count > telemetry->windows.high_water)
+    {
+        telemetry->windows.high_water = used_count;
+    }
+}
+
+#define FAST_MBLOCK_TELEMETRY_SAMPLE_INDEX(telemetry, node) \
+    ((int)((((uint64_t)(size_t)(node)) >> 4) * 11400714819323198485ULL >> \
+           32) & (telemetry)->samples.mask)
+
+#define FAST_MBLOCK_TELEMETRY_SITE_INDEX(caller) \
+    ((int)((((uint64_t)(size_t)(caller)) * 11400714819323198485ULL) >> 32) \
+     & (FAST_MBLOCK_TELEMETRY_SITE_TABLE_SIZE - 1))
+
+static struct fast_mblock_telemetry_site *fast_mblock_telemetry_get_site(
+        struct fast_mblock_telemetry *telemetry, void *caller,
+        const bool create)
+{
+    struct fast_mblock_telemetry_site *site;
+    int index;
+
+    index = FAST_MBLOCK_TELEMETRY_SITE_INDEX(caller);
+    while (1)
+    {
+        site = telemetry->sites.entries + index;
+        if (site->caller == caller)
+        {
+            return site;
+        }
+        if (site->caller == NULL)
+        {
+            break;
+        }
+        index = (index + 1) & (FAST_MBLOCK_TELEMETRY_SITE_TABLE_SIZE - 1);
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+    if (telemetry->sites.count >= FAST_MBLOCK_TELEMETRY_MAX_SITES)
+    {
+        telemetry->sites.dropped_count++;
+        return NULL;
+    }
+
+    site->caller = caller;
+    telemetry->sites.count++;
+    return site;
+}
+
+static struct fast_mblock_telemetry_sample *fast_mblock_telemetry_find_sample(
+        struct fast_mblock_telemetry *telemetry,
+        struct fast_mblock_node *pNode)
+{
+    struct fast_mblock_telemetry_sample *sample;
+    int index;
+
+    index = FAST_MBLOCK_TELEMETRY_SAMPLE_INDEX(telemetry, pNode);
+    while (1)
+    {
+        sample = telemetry->samples.entries + index;
+        if (sample->node == pNode || sample->node == NULL)
+        {
+            return sample;
+        }
+        index = (index + 1) & telemetry->samples.mask;
+    }
+}
+
+/* remove by backward shift for linear probing */
+static void fast_mblock_telemetry_remove_sample(
+        struct fast_mblock_telemetry *telemetry,
+        struct fast_mblock_telemetry_sample *sample)
+{
+    struct fast_mblock_telemetry_sample *entries;
+    int hole;
+    int index;
+    int home;
+
+    entries = telemetry->samples.entries;
+    hole = sample - entries;
+    index = hole;
+    while (1)
+    {
+        index = (index + 1) & telemetry->samples.mask;
+        if (entries[index].node == NULL)
+        {
+            break;
+        }
+
+        home = FAST_MBLOCK_TELEMETRY_SAMPLE_INDEX(
+                telemetry, entries[index].node);
+        //move when the home is not in (hole, index] cyclically
+        if (((index - home) & telemetry->samples.mask) >=
+                ((index - hole) & telemetry->samples.mask))
+        {
+            entries[hole] = entries[index];
+            hole = index;
+        }
+    }
+
+    entries[hole].node = NULL;
+    telemetry->samples.count--;
+}
+
+static void fast_mblock_telemetry_sample(
+        struct fast_mblock_telemetry *telemetry,
+        struct fast_mblock_node *pNode, void *caller)
+{
+    struct fast_mblock_telemetry_sample *sample;
+    struct fast_mblock_telemetry_site *site;
+    int64_t current_time;
+
+    current_time = get_current_time_ms();
+    PTHREAD_MUTEX_LOCK(&telemetry->lock);
+    telemetry->samples.total_count++;
+    if (telemetry->samples.count >= telemetry->options.max_samples)
+    {
+        telemetry->samples.dropped_count++;
+    }
+    else
+    {
+        sample = fast_mblock_telemetry_find_sample(telemetry, pNode);
+        if (sample->node == NULL)
+        {
+            telemetry->samples.count++;
+        }
+        sample->node = pNode;
+        sample->caller = caller;
+        sample->alloc_time = current_time;
+        pNode->recycle_timestamp = FAST_MBLOCK_SAMPLED_NODE_MARK;
+
+        if ((site=fast_mblock_telemetry_get_site(telemetry,
+                        caller, true)) != NULL)
+        {
+            site->alloc_count++;
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&telemetry->lock);
+}
+
+static void fast_mblock_telemetry_on_alloc(struct fast_mblock_man *mblock,
+        struct fast_mblock_node *pNode, void *caller)
+{
+    struct fast_mblock_telemetry *telemetry;
+    int sample_rate;
+
+    telemetry = mblock->telemetry;
+    if (telemetry->mblock != mblock)  //the NUMA node mblock
+    {
+        return;
+    }
+
+    fast_mblock_telemetry_update_window(telemetry);
+    if ((sample_rate=telemetry->options.sample_rate) == 0 ||
+            __sync_sub_and_fetch(&telemetry->sample_countdown, 1) != 0)
+    {
+        return;
+    }
+
+    /* only one thread reaches 0, add the interval (not set) to keep the
+       allocations counted by the other threads meanwhile, and they
+       may exceed a short interval */
+    while (__sync_add_and_fetch(&telemetry->sample_countdown,
+                fast_mblock_telemetry_sample_interval(sample_rate)) <= 0)
+    {
+    }
+    fast_mblock_telemetry_sample(telemetry, pNode, caller);
+}
+
+static inline int fast_mblock_telemetry_bucket(const int64_t lifetime)
+{
+    int bucket;
+
+    if (lifetime <= 0)
+    {
+        return 0;
+    }
+
+    bucket = 64 - __builtin_clzll(lifetime);
+    return bucket < FAST_MBLOCK_TELEMETRY_HISTOGRAM_SIZE ? bucket :
+        FAST_MBLOCK_TELEMETRY_HISTOGRAM_SIZE - 1;
+}
+
+static void fast_mblock_telemetry_do_free(struct fast_mblock_man *mblock,
+        struct fast_mblock_node *pNode)
+{
+    struct fast_mblock_telemetry *telemetry;
+    struct fast_mblock_telemetry_sample *sample;
+    struct fast_mblock_telemetry_site *site;
+    int64_t lifetime;
+
+    telemetry = mblock->telemetry;
+    pNode->recycle_timestamp = 0;
+    lifetime = get_current_time_ms();
+    PTHREAD_MUTEX_LOCK(&telemetry->lock);
+    sample = fast_mblock_telemetry_find_sample(telemetry, pNode);
+    if (sample->node != NULL)
+    {
+        lifetime -= sample->alloc_time;
+        telemetry->lifetime_histogram[
+            fast_mblock_telemetry_bucket(lifetime)]++;
+        if ((site=fast_mblock_telemetry_get_site(telemetry,
+                        sample->caller, false)) != NULL)
+        {
+            site->free_count++;
+            site->total_lifetime += lifetime;
+        }
+        fast_mblock_telemetry_remove_sample(telemetry, sample);
+    }
+    PTHREAD_MUTEX_UNLOCK(&telemetry->lock);
+}
+
+static inline void fast_mblock_telemetry_on_free(
+        struct fast_mblock_man *mblock, struct fast_mblock_node *pNode)
+{
+    if (pNode->recycle_timestamp == FAST_MBLOCK_SAMPLED_NODE_MARK)
+    {
+        fast_mblock_telemetry_do_free(mblock, pNode);
+    }
+}
+
+/* the sampled object is moved by shrink */
+static void fast_mblock_telemetry_on_move(struct fast_mblock_man *mblock,
+        struct fast_mblock_node *src, struct fast_mblock_node *dest)
+{
+    struct fast_mblock_telemetry *telemetry;
+    struct fast_mblock_telemetry_sample *sample;
+    struct fast_mblock_telemetry_sample moved;
+
+    telemetry = mblock->telemetry;
+    PTHREAD_MUTEX_LOCK(&telemetry->lock);
+    sample = fast_mblock_telemetry_find_sample(telemetry, src);
+    if (sample->node != NULL)
+    {
+        moved = *sample;
+        fast_mblock_telemetry_remove_sample(telemetry, sample);
+        moved.node = dest;
+        *fast_mblock_telemetry_find_sample(telemetry, dest) = moved;
+        telemetry->samples.count++;
+        dest->recycle_timestamp = FAST_MBLOCK_SAMPLED_NODE_MARK;
+    }
+    PTHREAD_MUTEX_UNLOCK(&telemetry->lock);
+}
+
+static int fast_mblock_telemetry_dump_histogram(FastBuffer *buffer,
+        const char *name, const int64_t *histogram)
+{
+    int result;
+    int i;
+
+    if ((result=fast_buffer_append(buffer, "\"%s\": [", name)) != 0)
+    {
+        return result;
+    }
+    for (i=0; i<FAST_MBLOCK_TELEMETRY_HISTOGRAM_SIZE; i++)
+    {
+        if ((result=fast_buffer_append(buffer, "%s%"PRId64,
+                        i > 0 ? ", " : "", histogram[i])) != 0)
+        {
+            return result;
+        }
+    }
+    return fast_buffer_append(buffer, "]");
+}
+
+int fast_mblock_telemetry_dump(struct fast_mblock_man *mblock,
+        FastBuffer *buffer)
+{
+    struct fast_mblock_telemetry *telemetry;
+    struct fast_mblock_telemetry_sample *sample;
+    struct fast_mblock_telemetry_sample *sample_end;
+    struct fast_mblock_telemetry_site *site;
+    struct fast_mblock_telemetry_site *site_end;
+    struct fast_mblock_telemetry_window *window;
+    int64_t age_histogram[FAST_MBLOCK_TELEMETRY_HISTOGRAM_SIZE];
+    int64_t current_time;
+    int64_t total_count;
+    int64_t used_count;
+    int result;
+    int count;
+    int index;
+    int i;
+
+    if ((telemetry=mblock->telemetry) == NULL)
+    {
+        return ENOENT;
+    }
+
+    total_count = mblock->info.element_total_count;
+    used_count = fast_mblock_used_count(mblock);
+    for (i=0; i<mblock->numa.count; i++)
+    {
+        total_count += mblock->numa.mblocks[i].info.element_total_count;
+    }
+
+    memset(age_histogram, 0, sizeof(age_histogram));
+    current_time = get_current_time_ms();
+    PTHREAD_MUTEX_LOCK(&telemetry->lock);
+    sample_end = telemetry->samples.entries + telemetry->samples.mask + 1;
+    for (sample=telemetry->samples.entries; sample<sample_end; sample++)
+    {
+        if (sample->node != NULL)
+        {
+            age_histogram[fast_mblock_telemetry_bucket(
+                    current_time - sample->alloc_time)]++;
+        }
+    }
+
+    do {
+        if ((result=fast_buffer_append(buffer, "{\"name\": \"%s\", "
+                        "\"element_size\": %d, \"trunk_size\": %d, "
+                        "\"alloc_elements_once\": %d, "
+                        "\"element_total_count\": %"PRId64", "
+                        "\"element_used_count\": %"PRId64", "
+                        "\"sample_rate\": %d, \"sample_count\": %"PRId64", "
+                        "\"live_samples\": %d, \"dropped_samples\": %"PRId64", "
+                        "\"dropped_sites\": %"PRId64", ",
+                        mblock->info.name, mblock->info.element_size,
+                        mblock->info.trunk_size, mblock->alloc_elements.once,
+                        total_count, used_count,
+                        telemetry->options.sample_rate,
+                        telemetry->samples.total_count,
+                        telemetry->samples.count,
+                        telemetry->samples.dropped_count,
+                        telemetry->sites.dropped_count)) != 0)
+        {
+            break;
+        }
+
+        if ((result=fast_mblock_telemetry_dump_histogram(buffer,
+                        "lifetime_histogram", telemetry->
+                        lifetime_histogram)) != 0)
+        {
+            break;
+        }
+        if ((result=fast_buffer_append(buffer, ", ")) != 0)
+        {
+            break;
+        }
+        if ((result=fast_mblock_telemetry_dump_histogram(buffer,
+                        "live_age_histogram", age_histogram)) != 0)
+        {
+            break;
+        }
+
+        //the windows from the oldest to the newest
+        if ((result=fast_buffer_append(buffer, ", \"high_water\": "
+                        "{\"all_time\": %"PRId64", \"window_seconds\": %d, "
+                        "\"windows\": [", telemetry->windows.high_water,
+                        telemetry->options.window_seconds)) != 0)
+        {
+            break;
+        }
+        count = 0;
+        index = telemetry->windows.index;
+        for (i=0; i<telemetry->options.window_count; i++)
+        {
+            index = (index + 1) % telemetry->options.window_count;
+            window = telemetry->windows.entries + index;
+            if (window->start_time == 0)
+            {
+                continue;
+            }
+            if ((result=fast_buffer_append(buffer, "%s{\"start_time\": "
+                            "%"PRId64", \"high_water\": %"PRId64"}",
+                            count++ > 0 ? ", " : "", window->start_time,
+                            window->high_water)) != 0)
+            {
+                break;
+            }
+        }
+        if (result != 0 || (result=fast_buffer_append(
+                        buffer, "]}, \"sites\": [")) != 0)
+        {
+            break;
+        }
+
+        count = 0;
+        site_end = telemetry->sites.entries +
+            FAST_MBLOCK_TELEMETRY_SITE_TABLE_SIZE;
+        for (site=telemetry->sites.entries; site<site_end; site++)
+        {
+            if (site->caller == NULL)
+            {
+                continue;
+            }
+            if ((result=fast_buffer_append(buffer, "%s{\"caller\": "
+                            "\"%p\", \"alloc_count\": %"PRId64", "
+                            "\"free_count\": %"PRId64", "
+                            "\"avg_lifetime\": %"PRId64"}",
+                            count++ > 0 ? ", " : "", site->caller,
+                            site->alloc_count, site->free_count,
+                            site->free_count > 0 ? site->total_lifetime /
+                            site->free_count : 0)) != 0)
+            {
+                break;
+            }
+        }
+        if (result != 0)
+        {
+            break;
+        }
+        result = fast_buffer_append(buffer, "]}");
+    } while (0);
+    PTHREAD_MUTEX_UNLOCK(&telemetry->lock);
+
+    return result;
+}
+
+int fast_mblock_manager_telemetry_dump(FastBuffer *buffer)
+{
+    struct fast_mblock_man *current;
+    struct fast_mblock_man *owner;
+    int result;
+    int count;
+
+    if (!mblock_manager.initialized)
+    {
+        return EFAULT;
+    }
+
+    if ((result=fast_buffer_append(buffer, "{\"mblocks\": [")) != 0)
+    {
+        return result;
+    }
+
+    count = 0;
+    pthread_mutex_lock(&(mblock_manager.lock));
+    current = mblock_manager.head.next;
+    while (current != &mblock_manager.head)
+    {
+        if (current->telemetry != NULL)
+        {
+            /* the NUMA aware mblock is dumped once by itself, or by the
+               first NUMA node mblock when it is not in the list */
+            owner = current->telemetry->mblock;
+            if (owner == current || (current->numa.node == 0 &&
+                        IS_EMPTY(owner)))
+            {
+                if ((count++ > 0 && (result=fast_buffer_append(
+                                    buffer, ", ")) != 0) ||
+                        (result=fast_mblock_telemetry_dump(
+                            owner, buffer)) != 0)
+                {
+                    break;
+                }
+            }
+        }
+        current = current->next;
+    }
+    pthread_mutex_unlock(&(mblock_manager.lock));
+
+    if (result != 0)
+    {
+        return result;
+    }
+    return fast_buffer_append(buffer, "]}");
+}
+
+void fast_mblock_destroy(struct fast_mblock_man *mblock)
+{
+	struct fast_mblock_malloc *pMallocNode;
+	struct fast_mblock_malloc *pMallocTmp;
+
+    if (mblock->numa.count > 0)
+    {
+        int i;
+        for (i=0; i<mblock->numa.count; i++)
+        {
+            fast_mblock_destroy(mblock->numa.mblocks + i);
+        }
+        free(mblock->numa.mblocks);
+        mblock->numa.mblocks = NULL;
+        mblock->numa.count = 0;
+    }
+
+	if (!IS_EMPTY(&mblock->trunks.head))
+    {
+        pMallocNode = mblock->trunks.head.next;
+        while (pMallocNode != &mblock->trunks.head)
+        {
+            pMallocTmp = pMallocNode;
+            pMallocNode = pMallocNode->next;
+
+            fast_mblock_free_trunk(mblock, pMallocTmp, NULL);
+        }
+
+        INIT_HEAD(&mblock->trunks.head);
+        mblock->info.trunk_total_count = 0;
+        mblock->info.trunk_used_count = 0;
+        mblock->free_chain_head = NULL;
+        mblock->lock_free.head.s.node = NULL;
+        mblock->info.element_used_count = 0;
+        mblock->info.delay_free_elements = 0;
+        mblock->info.element_total_count = 0;
+    }
+
+    if (mblock->thread_cache.enabled)
+    {
+        fast_mblock_unset_thread_cache(mblock);
+    }
+
+    if (mblock->telemetry != NULL)
+    {
+        fast_mblock_telemetry_destroy(mblock);
+    }
+
+    if (mblock->need_lock) destroy_pthread_lock_cond_pair(&(mblock->lcp));
+    delete_from_mblock_list(mblock);
+}
+
+static inline struct fast_mblock_node *alloc_node(
+        struct fast_mblock_man *mblock)
+{
+	struct fast_mblock_node *pNode;
+	int result;
+
+    while (1)
+    {
+        if (mblock->free_chain_head != NULL)
+        {
+            pNode = mblock->free_chain_head;
+            mblock->free_chain_head = pNode->next;
+            break;
+        }
+
+        if (mblock->delay_free_chain.head != NULL &&
+                mblock->delay_free_chain.head->
+                recycle_timestamp <= get_current_time())
+        {
+            pNode = mblock->delay_free_chain.head;
+            mblock->delay_free_chain.head = pNode->next;
+            if (mblock->delay_free_chain.tail == pNode)
+            {
+                mblock->delay_free_chain.tail = NULL;
+            }
+
+            mblock->info.delay_free_elements--;
+            break;
+        }
+
+        if ((result=fast_mblock_prealloc(mblock)) == 0)
+        {
+            pNode = mblock->free_chain_head;
+            mblock->free_chain_head = pNode->next;
+            break;
+        }
+
+        if (!mblock->alloc_elements.need_wait)
+        {
+            pNode = NULL;
+            break;
+        }
+
+        pthread_cond_wait(&mblock->lcp.cond, &mblock->lcp.lock);
+        if (!*(mblock->alloc_elements.pcontinue_flag))
+        {
+            pNode = NULL;
+            break;
+        }
+    }
+
+    if (pNode != NULL)
+    {
+        fast_mblock_ref_counter_inc(mblock, pNode);
+    }
+
+	return pNode;
+}
+
+static struct fast_mblock_node *fast_mblock_do_alloc(
+        struct fast_mblock_man *mblock)
+{
+	struct fast_mblock_node *pNode;
 	int result;
 
 	if (mblock->need_lock && (result=pthread_mutex_lock(
@@ -802,7 +1899,7 @@ struct fast_mblock_node *fast_mblock_alloc(struct fast_mblock_man *mblock)
 	return pNode;
 }
 
-int fast_mblock_free(struct fast_mblock_man *mblock,
+static int fast_mblock_do_free(struct fast_mblock_man *mblock,
 		     struct fast_mblock_node *pNode)
 {
 	int result;
@@ -821,7 +1918,6 @@ int fast_mblock_free(struct fast_mblock_man *mblock,
     notify = (mblock->free_chain_head == NULL);
 	pNode->next = mblock->free_chain_head;
 	mblock->free_chain_head = pNode;
-    mblock->info.element_used_count--;
     fast_mblock_ref_counter_dec(mblock, pNode);
 
     if (mblock->alloc_elements.need_wait && notify)
@@ -850,7 +1946,6 @@ static inline void batch_free(struct fast_mblock_man *mblock,
     pNode = chain->head;
     while (pNode != NULL)
     {
-        mblock->info.element_used_count--;
         fast_mblock_ref_counter_dec(mblock, pNode);
         pNode = pNode->next;
     }
@@ -864,6 +1959,392 @@ static inline void batch_free(struct fast_mblock_man *mblock,
     }
 }
 
+static inline struct fast_mblock_node *lock_free_pop(
+        struct fast_mblock_man *mblock)
+{
+    fast_mblock_tagged_ptr_t old_head;
+    fast_mblock_tagged_ptr_t new_head;
+
+    do {
+        old_head.s.tag = mblock->lock_free.head.s.tag;
+        old_head.s.node = mblock->lock_free.head.s.node;
+        if (old_head.s.node == NULL)
+        {
+            return NULL;
+        }
+
+        new_head.s.node = old_head.s.node->next;
+        new_head.s.tag = old_head.s.tag + 1;
+    } while (!FAST_MBLOCK_TAGGED_PTR_CAS(&mblock->lock_free.head,
+                old_head, new_head));
+
+    return old_head.s.node;
+}
+
+static inline void lock_free_push(struct fast_mblock_man *mblock,
+        struct fast_mblock_node *head, struct fast_mblock_node *tail)
+{
+    fast_mblock_tagged_ptr_t old_head;
+    fast_mblock_tagged_ptr_t new_head;
+
+    new_head.s.node = head;
+    do {
+        old_head.s.tag = mblock->lock_free.head.s.tag;
+        old_head.s.node = mblock->lock_free.head.s.node;
+        tail->next = old_head.s.node;
+        new_head.s.tag = old_head.s.tag + 1;
+    } while (!FAST_MBLOCK_TAGGED_PTR_CAS(&mblock->lock_free.head,
+                old_head, new_head));
+}
+
+int fast_mblock_set_lock_free(struct fast_mblock_man *mblock)
+{
+#ifdef FAST_MBLOCK_LOCK_FREE_SUPPORTED
+    if (!mblock->need_lock || mblock->alloc_elements.need_wait ||
+            mblock->thread_cache.enabled)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, need_lock: %d != 1 or need_wait: %d != 0 "
+                "or thread cache enabled", __LINE__, mblock->info.name,
+                mblock->need_lock, mblock->alloc_elements.need_wait);
+        return EINVAL;
+    }
+
+    if (mblock->info.trunk_total_count > 0 || mblock->numa.count > 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, should be called before alloc "
+                "and set NUMA aware", __LINE__, mblock->info.name);
+        return EBUSY;
+    }
+
+    mblock->lock_free.enabled = true;
+    return 0;
+#else
+    logError("file: "__FILE__", line: %d, "
+            "lock free mode not supported, CAS of the tagged pointer "
+            "is unavailable", __LINE__);
+    return EOPNOTSUPP;
+#endif
+}
+
+static struct fast_mblock_node *lock_free_alloc(
+        struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_node *pNode;
+    struct fast_mblock_node *tail;
+
+    if ((pNode=lock_free_pop(mblock)) != NULL)
+    {
+        fast_mblock_ref_counter_inc(mblock, pNode);
+        return pNode;
+    }
+
+    PTHREAD_MUTEX_LOCK(&mblock->lcp.lock);
+    if ((pNode=lock_free_pop(mblock)) != NULL)
+    {
+        fast_mblock_ref_counter_inc(mblock, pNode);
+    }
+    else if ((pNode=alloc_node(mblock)) != NULL &&
+            mblock->free_chain_head != NULL)
+    {
+        //move the nodes of the new trunk to the lock free chain
+        tail = mblock->free_chain_head;
+        while (tail->next != NULL)
+        {
+            tail = tail->next;
+        }
+        lock_free_push(mblock, mblock->free_chain_head, tail);
+        mblock->free_chain_head = NULL;
+    }
+    PTHREAD_MUTEX_UNLOCK(&mblock->lcp.lock);
+
+    return pNode;
+}
+
+static inline void lock_free_batch_free(struct fast_mblock_man *mblock,
+        struct fast_mblock_chain *chain)
+{
+    struct fast_mblock_node *pNode;
+
+    pNode = chain->head;
+    while (pNode != NULL)
+    {
+        fast_mblock_ref_counter_dec(mblock, pNode);
+        pNode = pNode->next;
+    }
+    lock_free_push(mblock, chain->head, chain->tail);
+}
+
+static int lock_free_batch_alloc(struct fast_mblock_man *mblock,
+        const int count, struct fast_mblock_chain *chain)
+{
+	struct fast_mblock_node *pNode;
+    int i;
+
+    chain->head = chain->tail = NULL;
+    for (i=0; i<count; i++)
+    {
+        if ((pNode=lock_free_alloc(mblock)) == NULL)
+        {
+            break;
+        }
+
+        if (chain->head == NULL)
+        {
+            chain->head = pNode;
+        }
+        else
+        {
+            chain->tail->next = pNode;
+        }
+        chain->tail = pNode;
+    }
+
+    if (chain->tail != NULL)
+    {
+        chain->tail->next = NULL;
+    }
+    if (i == count)
+    {
+        return 0;
+    }
+
+    if (chain->head != NULL)
+    {
+        lock_free_batch_free(mblock, chain);
+        chain->head = chain->tail = NULL;
+    }
+    return ENOMEM;
+}
+
+#ifdef OS_LINUX
+static void numa_cpu_map_init()
+{
+    int cpu_count;
+    int *cpu_nodes;
+
+    if ((cpu_count=sysconf(_SC_NPROCESSORS_CONF)) <= 0)
+    {
+        return;
+    }
+
+    cpu_nodes = (int *)fc_malloc(sizeof(int) * cpu_count);
+    if (cpu_nodes == NULL)
+    {
+        return;
+    }
+    if (get_cpu_numa_nodes(cpu_nodes, cpu_count) != 0)
+    {
+        free(cpu_nodes);
+        return;
+    }
+
+    numa_cpu_map.cpu_nodes = cpu_nodes;
+    numa_cpu_map.cpu_count = cpu_count;
+}
+
+static inline int fast_mblock_current_numa_node(
+        struct fast_mblock_man *mblock)
+{
+    int cpu;
+
+    cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= numa_cpu_map.cpu_count)
+    {
+        return 0;
+    }
+    return numa_cpu_map.cpu_nodes[cpu] % mblock->numa.count;
+}
+#else
+#define fast_mblock_current_numa_node(mblock) 0
+#endif
+
+int fast_mblock_set_numa_aware(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_man *node_mblock;
+    int node_count;
+    int bytes;
+    int backing;
+    int result;
+    int i;
+
+    if (mblock->numa.count > 0)
+    {
+        return EEXIST;
+    }
+
+    if (mblock->alloc_elements.need_wait || mblock->numa.node >= 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, need_wait: %d != 0 or is a NUMA node mblock",
+                __LINE__, mblock->info.name,
+                mblock->alloc_elements.need_wait);
+        return EINVAL;
+    }
+
+    if (mblock->thread_cache.get_cache_func != NULL)
+    {
+        //one magazine per thread can't be shared by the node mblocks
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, the thread cache magazines are owned by "
+                "the caller", __LINE__, mblock->info.name);
+        return EINVAL;
+    }
+
+#ifdef OS_LINUX
+    node_count = get_numa_node_count();
+#else
+    node_count = 1;
+#endif
+    if (node_count <= 1)
+    {
+        logDebug("file: "__FILE__", line: %d, "
+                "mblock %s, NUMA node count: %d, ignore NUMA aware",
+                __LINE__, mblock->info.name, node_count);
+        return 0;
+    }
+    if (node_count > FAST_MBLOCK_NUMA_MAX_NODES)
+    {
+        node_count = FAST_MBLOCK_NUMA_MAX_NODES;
+    }
+
+#ifdef OS_LINUX
+    pthread_once(&numa_cpu_map.once, numa_cpu_map_init);
+#endif
+
+    bytes = sizeof(struct fast_mblock_man) * node_count;
+    mblock->numa.mblocks = (struct fast_mblock_man *)fc_malloc(bytes);
+    if (mblock->numa.mblocks == NULL)
+    {
+        return ENOMEM;
+    }
+    memset(mblock->numa.mblocks, 0, bytes);
+
+    //the trunk must be mmaped for binding to the NUMA node
+    backing = (mblock->trunk_backing.type ==
+            FAST_MBLOCK_TRUNK_BACKING_MALLOC) ?
+        FAST_MBLOCK_TRUNK_BACKING_MMAP : mblock->trunk_backing.type;
+    for (i=0; i<node_count; i++)
+    {
+        node_mblock = mblock->numa.mblocks + i;
+        if ((result=fast_mblock_init_ex2(node_mblock, mblock->info.name,
+                        mblock->info.element_size, mblock->alloc_elements.
+                        once, (mblock->alloc_elements.limit > 0 ? (mblock->
+                                alloc_elements.limit + node_count - 1) /
+                            node_count : 0), &mblock->object_callbacks,
+                        mblock->need_lock, &mblock->trunk_callbacks)) != 0)
+        {
+            break;
+        }
+
+        node_mblock->numa.node = i;
+        node_mblock->info.instance_count = 0;  //count the owner only
+        node_mblock->reclaim = mblock->reclaim;
+        node_mblock->telemetry = mblock->telemetry;
+        if (mblock->alloc_elements.limit > 0)
+        {
+            //try the other nodes when exceed the limit
+            node_mblock->alloc_elements.exceed_log_level = LOG_NOTHING;
+        }
+        else
+        {
+            node_mblock->alloc_elements.exceed_log_level =
+                mblock->alloc_elements.exceed_log_level;
+        }
+
+        if ((result=fast_mblock_set_trunk_backing(node_mblock, backing,
+                        mblock->trunk_backing.prefault)) != 0)
+        {
+            fast_mblock_destroy(node_mblock);
+            break;
+        }
+        if (mblock->thread_cache.enabled)
+        {
+            result = fast_mblock_set_thread_cache(node_mblock,
+                    mblock->thread_cache.capacity);
+        }
+        else if (mblock->lock_free.enabled)
+        {
+            result = fast_mblock_set_lock_free(node_mblock);
+        }
+        if (result != 0)
+        {
+            fast_mblock_destroy(node_mblock);
+            break;
+        }
+    }
+
+    if (result != 0)
+    {
+        while (--i >= 0)
+        {
+            fast_mblock_destroy(mblock->numa.mblocks + i);
+        }
+        free(mblock->numa.mblocks);
+        mblock->numa.mblocks = NULL;
+        return result;
+    }
+
+    mblock->numa.count = node_count;
+    if (mblock->info.trunk_total_count == 0)
+    {
+        //stat by the NUMA node mblocks instead
+        delete_from_mblock_list(mblock);
+        mblock->numa.mblocks[0].info.instance_count = 1;
+    }
+    return 0;
+}
+
+static struct fast_mblock_node *numa_alloc(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_node *pNode;
+    int node;
+    int i;
+
+    node = fast_mblock_current_numa_node(mblock);
+    for (i=0; i<mblock->numa.count; i++)
+    {
+        if ((pNode=fast_mblock_alloc(mblock->numa.mblocks + node)) != NULL)
+        {
+            return pNode;
+        }
+        node = (node + 1) % mblock->numa.count;
+    }
+
+    if (mblock->alloc_elements.limit > 0 &&
+            FC_LOG_BY_LEVEL(mblock->alloc_elements.exceed_log_level))
+    {
+        log_it_ex(&g_log_context, mblock->alloc_elements.
+                exceed_log_level, "file: "__FILE__", line: %d, "
+                "mblock %s, allocated elements exceed limit: %"PRId64,
+                __LINE__, mblock->info.name, mblock->alloc_elements.limit);
+    }
+    return NULL;
+}
+
+static int numa_batch_alloc(struct fast_mblock_man *mblock,
+        const int count, struct fast_mblock_chain *chain)
+{
+    int node;
+    int result;
+    int i;
+
+    result = ENOMEM;
+    node = fast_mblock_current_numa_node(mblock);
+    for (i=0; i<mblock->numa.count; i++)
+    {
+        if ((result=fast_mblock_batch_alloc(mblock->numa.mblocks +
+                        node, count, chain)) == 0)
+        {
+            break;
+        }
+        node = (node + 1) % mblock->numa.count;
+    }
+
+    return result;
+}
+
 int fast_mblock_batch_alloc(struct fast_mblock_man *mblock,
         const int count, struct fast_mblock_chain *chain)
 {
@@ -871,6 +2352,21 @@ int fast_mblock_batch_alloc(struct fast_mblock_man *mblock,
     int i;
 	int result;
 
+    if (unlikely(mblock->telemetry != NULL) &&
+            mblock->telemetry->mblock == mblock)
+    {
+        fast_mblock_telemetry_update_window(mblock->telemetry);
+    }
+
+    if (mblock->numa.count > 0)
+    {
+        return numa_batch_alloc(mblock, count, chain);
+    }
+    else if (mblock->lock_free.enabled)
+    {
+        return lock_free_batch_alloc(mblock, count, chain);
+    }
+
 	if (mblock->need_lock && (result=pthread_mutex_lock(
                     &mblock->lcp.lock)) != 0)
 	{
@@ -905,19 +2401,15 @@ int fast_mblock_batch_alloc(struct fast_mblock_man *mblock,
         result = ENOMEM;
     }
 
-	if (mblock->need_lock && (result=pthread_mutex_unlock(
-                    &mblock->lcp.lock)) != 0)
+	if (mblock->need_lock)
     {
-        logError("file: "__FILE__", line: %d, " \
-                "call pthread_mutex_unlock fail, " \
-                "errno: %d, error info: %s", \
-                __LINE__, result, STRERROR(result));
+        PTHREAD_MUTEX_UNLOCK(&mblock->lcp.lock);
     }
 
 	return result;
 }
 
-int fast_mblock_batch_free(struct fast_mblock_man *mblock,
+static int fast_mblock_do_batch_free(struct fast_mblock_man *mblock,
         struct fast_mblock_chain *chain)
 {
 	int result;
@@ -926,6 +2418,12 @@ int fast_mblock_batch_free(struct fast_mblock_man *mblock,
         return ENOENT;
     }
 
+    if (mblock->lock_free.enabled)
+    {
+        lock_free_batch_free(mblock, chain);
+        return 0;
+    }
+
 	if (mblock->need_lock && (result=pthread_mutex_lock(
                     &mblock->lcp.lock)) != 0)
 	{
@@ -950,6 +2448,419 @@ int fast_mblock_batch_free(struct fast_mblock_man *mblock,
 	return 0;
 }
 
+/* free the nodes to the NUMA node mblocks by runs of the same owner */
+static int numa_batch_free(struct fast_mblock_man *mblock,
+        struct fast_mblock_chain *chain)
+{
+    struct fast_mblock_chain run;
+    struct fast_mblock_man *owner;
+    struct fast_mblock_node *next;
+    int result;
+    int r;
+
+    result = 0;
+    run.head = chain->head;
+    while (run.head != NULL)
+    {
+        owner = FAST_MBLOCK_NUMA_OWNER(mblock, run.head);
+        run.tail = run.head;
+        while (run.tail->next != NULL && FAST_MBLOCK_NUMA_OWNER(
+                    mblock, run.tail->next) == owner)
+        {
+            run.tail = run.tail->next;
+        }
+
+        next = run.tail->next;
+        run.tail->next = NULL;
+        if ((r=fast_mblock_do_batch_free(owner != NULL ? owner :
+                        mblock, &run)) != 0)
+        {
+            result = r;
+        }
+        run.head = next;
+    }
+
+    return result;
+}
+
+int fast_mblock_batch_free(struct fast_mblock_man *mblock,
+        struct fast_mblock_chain *chain)
+{
+    struct fast_mblock_node *pNode;
+
+    if (unlikely(mblock->telemetry != NULL))
+    {
+        for (pNode=chain->head; pNode!=NULL; pNode=pNode->next)
+        {
+            fast_mblock_telemetry_on_free(mblock, pNode);
+        }
+    }
+
+    if (mblock->numa.count > 0 && chain->head != NULL)
+    {
+        return numa_batch_free(mblock, chain);
+    }
+    else
+    {
+        return fast_mblock_do_batch_free(mblock, chain);
+    }
+}
+
+void fast_mblock_detach_thread_cache(struct fast_mblock_thread_cache *cache)
+{
+    struct fast_mblock_man *mblock;
+    struct fast_mblock_chain chain;
+
+    if ((mblock=cache->mblock) == NULL)
+    {
+        return;
+    }
+
+    PTHREAD_MUTEX_LOCK(&mblock->lcp.lock);
+    if (cache->head != NULL)
+    {
+        chain.head = chain.tail = cache->head;
+        while (chain.tail->next != NULL)
+        {
+            chain.tail = chain.tail->next;
+        }
+        batch_free(mblock, &chain);
+    }
+
+    cache->prev->next = cache->next;
+    cache->next->prev = cache->prev;
+    PTHREAD_MUTEX_UNLOCK(&mblock->lcp.lock);
+
+    cache->mblock = NULL;
+    cache->head = NULL;
+    cache->count = 0;
+}
+
+static void thread_cache_destroy(void *ptr)
+{
+    fast_mblock_detach_thread_cache((struct fast_mblock_thread_cache *)ptr);
+    free(ptr);
+}
+
+int fast_mblock_set_thread_cache_ex(struct fast_mblock_man *mblock,
+        const int capacity, fast_mblock_get_thread_cache_func
+        get_cache_func, void *get_cache_args)
+{
+    int result;
+
+    if (!mblock->need_lock || mblock->alloc_elements.need_wait ||
+            mblock->lock_free.enabled)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, need_lock: %d != 1 or need_wait: %d != 0 "
+                "or lock free enabled", __LINE__, mblock->info.name,
+                mblock->need_lock, mblock->alloc_elements.need_wait);
+        return EINVAL;
+    }
+
+    if (capacity < 2)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, invalid capacity: %d < 2",
+                __LINE__, mblock->info.name, capacity);
+        return EINVAL;
+    }
+
+    if (mblock->thread_cache.enabled)
+    {
+        return EEXIST;
+    }
+
+    if (mblock->numa.count > 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock %s, should be called before set NUMA aware",
+                __LINE__, mblock->info.name);
+        return EBUSY;
+    }
+
+    if (get_cache_func == NULL && (result=pthread_key_create(
+                    &mblock->thread_cache.key, thread_cache_destroy)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "call pthread_key_create fail, "
+                "errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    mblock->thread_cache.capacity = capacity;
+    mblock->thread_cache.batch_count = capacity / 2;
+    mblock->thread_cache.get_cache_func = get_cache_func;
+    mblock->thread_cache.get_cache_args = get_cache_args;
+    mblock->thread_cache.enabled = true;
+    return 0;
+}
+
+void fast_mblock_unset_thread_cache(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_thread_cache *cache;
+    struct fast_mblock_thread_cache *deleted;
+
+    if (!mblock->thread_cache.enabled)
+    {
+        return;
+    }
+
+    if (mblock->thread_cache.get_cache_func == NULL)
+    {
+        pthread_key_delete(mblock->thread_cache.key);
+        cache = mblock->thread_cache.head.next;
+        while (cache != &mblock->thread_cache.head)
+        {
+            deleted = cache;
+            cache = cache->next;
+            free(deleted);
+        }
+    }  //else the magazines are freed by the owner
+
+    INIT_HEAD(&mblock->thread_cache.head);
+    mblock->thread_cache.capacity = 0;
+    mblock->thread_cache.batch_count = 0;
+    mblock->thread_cache.get_cache_func = NULL;
+    mblock->thread_cache.get_cache_args = NULL;
+    mblock->thread_cache.enabled = false;
+}
+
+/* the magazines are changed by their threads without the lock, so the
+   count is approximate when the threads are running */
+static int64_t fast_mblock_own_cached_count(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_thread_cache *cache;
+    int64_t count;
+
+    if (!mblock->thread_cache.enabled)
+    {
+        return 0;
+    }
+
+    count = 0;
+    PTHREAD_MUTEX_LOCK(&mblock->lcp.lock);
+    cache = mblock->thread_cache.head.next;
+    while (cache != &mblock->thread_cache.head)
+    {
+        //changed by the owner thread without lock
+        count += __sync_add_and_fetch(&cache->count, 0);
+        cache = cache->next;
+    }
+    PTHREAD_MUTEX_UNLOCK(&mblock->lcp.lock);
+
+    return count;
+}
+
+int64_t fast_mblock_thread_cached_count(struct fast_mblock_man *mblock)
+{
+    int64_t count;
+    int i;
+
+    count = fast_mblock_own_cached_count(mblock);
+    for (i=0; i<mblock->numa.count; i++)
+    {
+        count += fast_mblock_own_cached_count(mblock->numa.mblocks + i);
+    }
+    return count;
+}
+
+static struct fast_mblock_thread_cache *get_thread_cache(
+        struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_thread_cache *cache;
+    int result;
+
+    if (mblock->thread_cache.get_cache_func != NULL)
+    {
+        cache = mblock->thread_cache.get_cache_func(mblock,
+                mblock->thread_cache.get_cache_args);
+        if (cache == NULL || cache->mblock != NULL)
+        {
+            return cache;
+        }
+
+        cache->mblock = mblock;
+        cache->head = NULL;
+        cache->count = 0;
+        PTHREAD_MUTEX_LOCK(&mblock->lcp.lock);
+        cache->next = &mblock->thread_cache.head;
+        cache->prev = mblock->thread_cache.head.prev;
+        mblock->thread_cache.head.prev->next = cache;
+        mblock->thread_cache.head.prev = cache;
+        PTHREAD_MUTEX_UNLOCK(&mblock->lcp.lock);
+        return cache;
+    }
+
+    cache = (struct fast_mblock_thread_cache *)pthread_getspecific(
+            mblock->thread_cache.key);
+    if (cache != NULL)
+    {
+        return cache;
+    }
+
+    cache = (struct fast_mblock_thread_cache *)fc_malloc(
+            sizeof(struct fast_mblock_thread_cache));
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    cache->mblock = mblock;
+    cache->head = NULL;
+    cache->count = 0;
+
+    if ((result=pthread_setspecific(mblock->thread_cache.key, cache)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "call pthread_setspecific fail, "
+                "errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        free(cache);
+        return NULL;
+    }
+
+    PTHREAD_MUTEX_LOCK(&mblock->lcp.lock);
+    cache->next = &mblock->thread_cache.head;
+    cache->prev = mblock->thread_cache.head.prev;
+    mblock->thread_cache.head.prev->next = cache;
+    mblock->thread_cache.head.prev = cache;
+    PTHREAD_MUTEX_UNLOCK(&mblock->lcp.lock);
+
+    return cache;
+}
+
+static struct fast_mblock_node *thread_cache_alloc(
+        struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_thread_cache *cache;
+    struct fast_mblock_node *pNode;
+    struct fast_mblock_chain chain;
+    int count;
+
+    if ((cache=get_thread_cache(mblock)) == NULL)
+    {
+        return fast_mblock_do_alloc(mblock);
+    }
+
+    if (cache->head == NULL)
+    {
+        if (fast_mblock_batch_alloc(mblock, mblock->thread_cache.
+                    batch_count, &chain) != 0)
+        {
+            //maybe exceed the limit, try alloc one node
+            return fast_mblock_do_alloc(mblock);
+        }
+
+        count = 0;
+        pNode = chain.head;
+        while (pNode != NULL)
+        {
+            count++;
+            pNode = pNode->next;
+        }
+        cache->head = chain.head;
+        cache->count = count;
+    }
+
+    pNode = cache->head;
+    cache->head = pNode->next;
+    cache->count--;
+    return pNode;
+}
+
+static int thread_cache_free(struct fast_mblock_man *mblock,
+        struct fast_mblock_node *pNode)
+{
+    struct fast_mblock_thread_cache *cache;
+    struct fast_mblock_chain chain;
+    int i;
+
+    if ((cache=get_thread_cache(mblock)) == NULL)
+    {
+        return fast_mblock_do_free(mblock, pNode);
+    }
+
+    pNode->next = cache->head;
+    cache->head = pNode;
+    cache->count++;
+    if (cache->count <= mblock->thread_cache.capacity)
+    {
+        return 0;
+    }
+
+    //return a batch to the shared free chain
+    chain.head = chain.tail = cache->head;
+    for (i=1; i<mblock->thread_cache.batch_count; i++)
+    {
+        chain.tail = chain.tail->next;
+    }
+    cache->head = chain.tail->next;
+    chain.tail->next = NULL;
+    cache->count -= mblock->thread_cache.batch_count;
+
+    return fast_mblock_batch_free(mblock, &chain);
+}
+
+struct fast_mblock_node *fast_mblock_alloc(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_node *pNode;
+
+    if (mblock->numa.count > 0)
+    {
+        pNode = numa_alloc(mblock);
+    }
+    else if (mblock->lock_free.enabled)
+    {
+        pNode = lock_free_alloc(mblock);
+    }
+    else if (mblock->thread_cache.enabled)
+    {
+        pNode = thread_cache_alloc(mblock);
+    }
+    else
+    {
+        pNode = fast_mblock_do_alloc(mblock);
+    }
+
+    if (unlikely(mblock->telemetry != NULL) && pNode != NULL)
+    {
+        fast_mblock_telemetry_on_alloc(mblock, pNode,
+                __builtin_return_address(0));
+    }
+    return pNode;
+}
+
+int fast_mblock_free(struct fast_mblock_man *mblock,
+		     struct fast_mblock_node *pNode)
+{
+    struct fast_mblock_man *owner;
+
+    if (unlikely(mblock->telemetry != NULL))
+    {
+        fast_mblock_telemetry_on_free(mblock, pNode);
+    }
+
+    if ((owner=FAST_MBLOCK_NUMA_OWNER(mblock, pNode)) != NULL)
+    {
+        return fast_mblock_free(owner, pNode);
+    }
+    else if (mblock->lock_free.enabled)
+    {
+        fast_mblock_ref_counter_dec(mblock, pNode);
+        lock_free_push(mblock, pNode, pNode);
+        return 0;
+    }
+    else if (mblock->thread_cache.enabled)
+    {
+        return thread_cache_free(mblock, pNode);
+    }
+    else
+    {
+        return fast_mblock_do_free(mblock, pNode);
+    }
+}
+
 void fast_mblock_free_objects(struct fast_mblock_man *mblock,
         void **objs, const int count)
 {
@@ -980,6 +2891,17 @@ int fast_mblock_delay_free(struct fast_mblock_man *mblock,
 		     struct fast_mblock_node *pNode, const int deley)
 {
 	int result;
+    struct fast_mblock_man *owner;
+
+    if (unlikely(mblock->telemetry != NULL))
+    {
+        fast_mblock_telemetry_on_free(mblock, pNode);
+    }
+
+    if ((owner=FAST_MBLOCK_NUMA_OWNER(mblock, pNode)) != NULL)
+    {
+        return fast_mblock_delay_free(owner, pNode, deley);
+    }
 
 	if (mblock->need_lock && (result=pthread_mutex_lock(
                     &mblock->lcp.lock)) != 0)
@@ -1003,7 +2925,6 @@ int fast_mblock_delay_free(struct fast_mblock_man *mblock,
     mblock->delay_free_chain.tail = pNode;
     pNode->next = NULL;
 
-    mblock->info.element_used_count--;
     mblock->info.delay_free_elements++;
     fast_mblock_ref_counter_dec(mblock, pNode);
 
@@ -1058,12 +2979,37 @@ static int fast_mblock_chain_count(struct fast_mblock_man *mblock,
 
 int fast_mblock_free_count(struct fast_mblock_man *mblock)
 {
-    return fast_mblock_chain_count(mblock, mblock->free_chain_head);
+    int count;
+    int i;
+
+    if (mblock->lock_free.enabled)
+    {
+        count = fast_mblock_chain_count(mblock,
+                mblock->lock_free.head.s.node);
+    }
+    else
+    {
+        count = fast_mblock_chain_count(mblock, mblock->free_chain_head);
+    }
+
+    for (i=0; i<mblock->numa.count && count >= 0; i++)
+    {
+        count += fast_mblock_free_count(mblock->numa.mblocks + i);
+    }
+    return count;
 }
 
 int fast_mblock_delay_free_count(struct fast_mblock_man *mblock)
 {
-    return fast_mblock_chain_count(mblock, mblock->delay_free_chain.head);
+    int count;
+    int i;
+
+    count = fast_mblock_chain_count(mblock, mblock->delay_free_chain.head);
+    for (i=0; i<mblock->numa.count && count >= 0; i++)
+    {
+        count += fast_mblock_delay_free_count(mblock->numa.mblocks + i);
+    }
+    return count;
 }
 
 static int fast_mblock_do_reclaim(struct fast_mblock_man *mblock,
@@ -1173,18 +3119,69 @@ void fast_mblock_free_trunks(struct fast_mblock_man *mblock,
 {
     struct fast_mblock_malloc *pDeleted;
     int count;
-    count = 0;
-    while (freelist != NULL)
+    count = 0;
+    while (freelist != NULL)
+    {
+        pDeleted = freelist;
+        freelist = freelist->next;
+
+        fast_mblock_free_trunk(mblock, pDeleted, NULL);
+        count++;
+    }
+    logDebug("file: "__FILE__", line: %d, "
+            "free_trunks for %p, free trunks: %d", __LINE__,
+            mblock, count);
+}
+
+/* reclaim the trunks of the NUMA node mblocks */
+static int numa_reclaim(struct fast_mblock_man *mblock,
+        const int reclaim_target, int *reclaim_count,
+        fast_mblock_free_trunks_func free_trunks_func)
+{
+    struct fast_mblock_man *node_mblock;
+    int64_t avail_count;
+    int target;
+    int count;
+    int result;
+    int i;
+
+    result = ENOENT;
+    *reclaim_count = 0;
+    for (i=0; i<mblock->numa.count; i++)
     {
-        pDeleted = freelist;
-        freelist = freelist->next;
+        node_mblock = mblock->numa.mblocks + i;
+        avail_count = node_mblock->info.trunk_total_count -
+            node_mblock->info.trunk_used_count;
+        if (avail_count <= 0)
+        {
+            continue;
+        }
 
-        fast_mblock_free_trunk(mblock, pDeleted);
-        count++;
+        if (reclaim_target == 0)
+        {
+            target = 0;
+        }
+        else
+        {
+            target = reclaim_target - *reclaim_count;
+            if (target > avail_count)
+            {
+                target = avail_count;
+            }
+        }
+        if (fast_mblock_reclaim(node_mblock, target, &count,
+                    free_trunks_func) == 0 && count > 0)
+        {
+            *reclaim_count += count;
+            result = 0;
+            if (reclaim_target > 0 && *reclaim_count >= reclaim_target)
+            {
+                break;
+            }
+        }
     }
-    logDebug("file: "__FILE__", line: %d, "
-            "free_trunks for %p, free trunks: %d", __LINE__,
-            mblock, count);
+
+    return result;
 }
 
 int fast_mblock_reclaim(struct fast_mblock_man *mblock,
@@ -1194,6 +3191,12 @@ int fast_mblock_reclaim(struct fast_mblock_man *mblock,
     int result;
     struct fast_mblock_malloc *freelist;
 
+    if (mblock->numa.count > 0)
+    {
+        return numa_reclaim(mblock, reclaim_target,
+                reclaim_count, free_trunks_func);
+    }
+
     if (reclaim_target < 0 || mblock->info.trunk_total_count -
 		mblock->info.trunk_used_count <= 0)
     {
@@ -1201,6 +3204,13 @@ int fast_mblock_reclaim(struct fast_mblock_man *mblock,
         return EINVAL;
     }
 
+    if (mblock->lock_free.enabled)
+    {
+        //the popping threads may access the nodes of the freed trunks
+        *reclaim_count = 0;
+        return EOPNOTSUPP;
+    }
+
 	if (mblock->need_lock && (result=pthread_mutex_lock(
                     &mblock->lcp.lock)) != 0)
     {
@@ -1249,3 +3259,443 @@ int fast_mblock_reclaim(struct fast_mblock_man *mblock,
     return result;
 }
 
+
+int fast_mblock_set_reclaim(struct fast_mblock_man *mblock,
+        const struct fast_mblock_reclaim_options *options)
+{
+    int result;
+    int i;
+
+    if (options == NULL)
+    {
+        mblock->reclaim.enabled = false;
+    }
+    else
+    {
+        if (!mblock->need_lock || mblock->lock_free.enabled)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "mblock %s, need_lock: %d != 1 or lock free enabled",
+                    __LINE__, mblock->info.name, mblock->need_lock);
+            return EINVAL;
+        }
+
+        if (options->keep_free_trunks < 0 ||
+                options->trigger_free_ratio < 0.00 ||
+                options->trigger_free_ratio > 1.00 ||
+                options->sparse_used_ratio < 0.00 ||
+                options->sparse_used_ratio >= 1.00)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "mblock %s, invalid reclaim options, keep_free_trunks: "
+                    "%d, trigger_free_ratio: %.2f, sparse_used_ratio: %.2f",
+                    __LINE__, mblock->info.name, options->keep_free_trunks,
+                    options->trigger_free_ratio, options->sparse_used_ratio);
+            return EINVAL;
+        }
+
+        mblock->reclaim.options = *options;
+        mblock->reclaim.enabled = true;
+    }
+
+    for (i=0; i<mblock->numa.count; i++)
+    {
+        if ((result=fast_mblock_set_reclaim(mblock->
+                        numa.mblocks + i, options)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+/* the mark of the free node in the sparse trunk, only used by shrink */
+#define FAST_MBLOCK_FREE_NODE_MARK  -1
+
+static int fast_mblock_trunk_cmp_by_ref_count(const void *p1, const void *p2)
+{
+    int64_t sub;
+
+    sub = (*((struct fast_mblock_malloc **)p1))->ref_count -
+        (*((struct fast_mblock_malloc **)p2))->ref_count;
+    return sub < 0 ? -1 : (sub > 0 ? 1 : 0);
+}
+
+/* move the live objects out of the sparse trunks, the sparse trunk is
+   marked by negative reference count (-1 * ref_count - 1) during moving */
+static int fast_mblock_move_objects(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_malloc **sparse_trunks;
+    struct fast_mblock_malloc *trunk;
+    struct fast_mblock_node *pNode;
+    struct fast_mblock_node *pPrevious;
+    struct fast_mblock_node *next;
+    struct fast_mblock_node *dest;
+    struct fast_mblock_node *removed;
+    char *p;
+    char *last;
+    int64_t avail_count;
+    int64_t live_count;
+    int sparse_count;
+    int moved_count;
+    int i;
+
+    sparse_trunks = (struct fast_mblock_malloc **)fc_malloc(sizeof(
+                struct fast_mblock_malloc *) * mblock->info.trunk_total_count);
+    if (sparse_trunks == NULL)
+    {
+        return 0;
+    }
+
+    sparse_count = 0;
+    trunk = mblock->trunks.head.next;
+    while (trunk != &mblock->trunks.head)
+    {
+        if (trunk->ref_count > 0 && trunk->ref_count <= trunk->alloc_count *
+                mblock->reclaim.options.sparse_used_ratio)
+        {
+            sparse_trunks[sparse_count++] = trunk;
+        }
+        trunk = trunk->next;
+    }
+
+    //the sparsest first, and the free nodes of other trunks must be enough
+    qsort(sparse_trunks, sparse_count, sizeof(struct fast_mblock_malloc *),
+            fast_mblock_trunk_cmp_by_ref_count);
+    avail_count = mblock->info.element_total_count - mblock->info.
+        element_used_count - mblock->info.delay_free_elements;
+    live_count = 0;
+    for (i=0; i<sparse_count; i++)
+    {
+        trunk = sparse_trunks[i];
+        if (live_count + trunk->ref_count > avail_count -
+                (trunk->alloc_count - trunk->ref_count))
+        {
+            break;
+        }
+        live_count += trunk->ref_count;
+        avail_count -= trunk->alloc_count - trunk->ref_count;
+
+        trunk->ref_count = -1 * trunk->ref_count - 1;
+        last = (char *)trunk + (trunk->trunk_size - mblock->info.block_size);
+        for (p=(char *)(trunk + 1); p<=last; p+=mblock->info.block_size)
+        {
+            if (((struct fast_mblock_node *)p)->recycle_timestamp !=
+                    FAST_MBLOCK_SAMPLED_NODE_MARK)
+            {
+                ((struct fast_mblock_node *)p)->recycle_timestamp = 0;
+            }
+        }
+    }
+    sparse_count = i;
+    free(sparse_trunks);
+
+    if (sparse_count == 0)
+    {
+        return 0;
+    }
+
+    //take the free nodes of the sparse trunks out of the free chain
+    removed = NULL;
+    pPrevious = NULL;
+    pNode = mblock->free_chain_head;
+    while (pNode != NULL)
+    {
+        next = pNode->next;
+        if (FAST_MBLOCK_GET_TRUNK(pNode)->ref_count < 0)
+        {
+            if (pPrevious == NULL)
+            {
+                mblock->free_chain_head = next;
+            }
+            else
+            {
+                pPrevious->next = next;
+            }
+
+            pNode->recycle_timestamp = FAST_MBLOCK_FREE_NODE_MARK;
+            pNode->next = removed;
+            removed = pNode;
+        }
+        else
+        {
+            pPrevious = pNode;
+        }
+        pNode = next;
+    }
+
+    moved_count = 0;
+    trunk = mblock->trunks.head.next;
+    while (trunk != &mblock->trunks.head)
+    {
+        if (trunk->ref_count >= 0)
+        {
+            trunk = trunk->next;
+            continue;
+        }
+
+        last = (char *)trunk + (trunk->trunk_size - mblock->info.block_size);
+        for (p=(char *)(trunk + 1); p<=last && trunk->ref_count < -1 &&
+                mblock->free_chain_head != NULL; p+=mblock->info.block_size)
+        {
+            pNode = (struct fast_mblock_node *)p;
+            if (pNode->recycle_timestamp == FAST_MBLOCK_FREE_NODE_MARK)
+            {
+                continue;
+            }
+
+            dest = mblock->free_chain_head;
+            if (mblock->reclaim.options.move_func(dest->data, pNode->data,
+                        mblock->reclaim.options.args) != 0)
+            {
+                continue;
+            }
+
+            mblock->free_chain_head = dest->next;
+            if (pNode->recycle_timestamp == FAST_MBLOCK_SAMPLED_NODE_MARK)
+            {
+                fast_mblock_telemetry_on_move(mblock, pNode, dest);
+            }
+            fast_mblock_ref_counter_inc(mblock, dest);
+            mblock->info.element_used_count--;
+            if (++trunk->ref_count == -1)
+            {
+                mblock->info.trunk_used_count--;
+            }
+
+            pNode->recycle_timestamp = FAST_MBLOCK_FREE_NODE_MARK;
+            pNode->next = removed;
+            removed = pNode;
+            moved_count++;
+        }
+
+        trunk->ref_count = -1 * trunk->ref_count - 1;
+        trunk = trunk->next;
+    }
+
+    //give back the free nodes, the empty trunks will be reclaimed later
+    while (removed != NULL)
+    {
+        pNode = removed;
+        removed = removed->next;
+        pNode->next = mblock->free_chain_head;
+        mblock->free_chain_head = pNode;
+    }
+
+    return moved_count;
+}
+
+/* the trunks of the delay free nodes are pinned by increasing their
+   reference count with the alloc count */
+static inline void fast_mblock_pin_delay_free_trunks(
+        struct fast_mblock_man *mblock, const bool pin)
+{
+    struct fast_mblock_node *pNode;
+    struct fast_mblock_malloc *trunk;
+
+    pNode = mblock->delay_free_chain.head;
+    while (pNode != NULL)
+    {
+        trunk = FAST_MBLOCK_GET_TRUNK(pNode);
+        if (pin)
+        {
+            trunk->ref_count += trunk->alloc_count;
+        }
+        else
+        {
+            trunk->ref_count -= trunk->alloc_count;
+        }
+        pNode = pNode->next;
+    }
+}
+
+static int fast_mblock_do_shrink(struct fast_mblock_man *mblock,
+        int *moved_count, int64_t *returned_bytes)
+{
+    struct fast_mblock_malloc *freelist;
+    struct fast_mblock_malloc *deleted;
+    int64_t total_count;
+    int64_t reclaim_target;
+    int reclaim_count;
+
+    *moved_count = 0;
+    *returned_bytes = 0;
+    if (mblock->lock_free.enabled)
+    {
+        return EOPNOTSUPP;
+    }
+
+    total_count = mblock->info.element_total_count;
+    if (total_count == 0 || (double)(total_count - mblock->info.
+                element_used_count) / (double)total_count <
+            mblock->reclaim.options.trigger_free_ratio)
+    {
+        return 0;
+    }
+
+    if (mblock->need_lock)
+    {
+        PTHREAD_MUTEX_LOCK(&mblock->lcp.lock);
+    }
+
+    fast_mblock_pin_delay_free_trunks(mblock, true);
+    if (mblock->reclaim.options.move_func != NULL &&
+            mblock->reclaim.options.sparse_used_ratio > 0.00 &&
+            !mblock->thread_cache.enabled)
+    {
+        *moved_count = fast_mblock_move_objects(mblock);
+    }
+
+    freelist = NULL;
+    reclaim_target = (mblock->info.trunk_total_count - mblock->info.
+            trunk_used_count) - mblock->reclaim.options.keep_free_trunks;
+    if (reclaim_target > 0)
+    {
+        fast_mblock_do_reclaim(mblock, reclaim_target,
+                &reclaim_count, &freelist);
+    }
+    fast_mblock_pin_delay_free_trunks(mblock, false);
+
+    if (mblock->need_lock)
+    {
+        PTHREAD_MUTEX_UNLOCK(&mblock->lcp.lock);
+    }
+
+    while (freelist != NULL)
+    {
+        deleted = freelist;
+        freelist = freelist->next;
+        fast_mblock_free_trunk(mblock, deleted, returned_bytes);
+    }
+
+    if (*returned_bytes > 0)
+    {
+        __sync_add_and_fetch(&mblock->info.returned_bytes, *returned_bytes);
+    }
+    if (*moved_count > 0 || *returned_bytes > 0)
+    {
+        logDebug("file: "__FILE__", line: %d, "
+                "shrink mblock %s, moved objects: %d, "
+                "returned bytes: %"PRId64, __LINE__,
+                mblock->info.name, *moved_count, *returned_bytes);
+    }
+    return 0;
+}
+
+int fast_mblock_shrink(struct fast_mblock_man *mblock,
+        int *moved_count, int64_t *returned_bytes)
+{
+    int64_t bytes;
+    int count;
+    int result;
+    int i;
+
+    if ((result=fast_mblock_do_shrink(mblock, moved_count,
+                    returned_bytes)) != 0)
+    {
+        return result;
+    }
+
+    for (i=0; i<mblock->numa.count; i++)
+    {
+        if (fast_mblock_do_shrink(mblock->numa.mblocks + i,
+                    &count, &bytes) == 0)
+        {
+            *moved_count += count;
+            *returned_bytes += bytes;
+        }
+    }
+
+    return 0;
+}
+
+static int fast_mblock_reclaimer_func(void *args)
+{
+    struct fast_mblock_man *current;
+    int64_t returned_bytes;
+    int64_t total_returned;
+    int moved_count;
+    int total_moved;
+
+    total_moved = 0;
+    total_returned = 0;
+    pthread_mutex_lock(&(mblock_manager.lock));
+    current = mblock_manager.head.next;
+    while (current != &mblock_manager.head)
+    {
+        if (current->reclaim.enabled && fast_mblock_do_shrink(current,
+                    &moved_count, &returned_bytes) == 0)
+        {
+            total_moved += moved_count;
+            total_returned += returned_bytes;
+        }
+        current = current->next;
+    }
+    pthread_mutex_unlock(&(mblock_manager.lock));
+
+    if (total_moved > 0 || total_returned > 0)
+    {
+        logInfo("file: "__FILE__", line: %d, "
+                "mblock reclaimer, moved objects: %d, "
+                "returned bytes: %"PRId64, __LINE__,
+                total_moved, total_returned);
+    }
+    return 0;
+}
+
+int fast_mblock_reclaimer_start(const int interval)
+{
+    ScheduleArray scheduleArray;
+    ScheduleEntry scheduleEntry;
+    int result;
+
+    if (!mblock_manager.initialized)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "mblock manager not initialized", __LINE__);
+        return EFAULT;
+    }
+
+    if (interval <= 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "invalid reclaim interval: %d", __LINE__, interval);
+        return EINVAL;
+    }
+
+    if (reclaimer_entry_id != 0)
+    {
+        return EEXIST;
+    }
+
+    memset(&scheduleEntry, 0, sizeof(scheduleEntry));
+    INIT_SCHEDULE_ENTRY1(scheduleEntry, sched_generate_next_id(),
+            TIME_NONE, TIME_NONE, TIME_NONE, interval,
+            fast_mblock_reclaimer_func, NULL, true);
+    scheduleArray.entries = &scheduleEntry;
+    scheduleArray.count = 1;
+    if ((result=sched_add_entries(&scheduleArray)) != 0)
+    {
+        return result;
+    }
+
+    reclaimer_entry_id = scheduleEntry.id;
+    return 0;
+}
+
+int fast_mblock_reclaimer_stop()
+{
+    int result;
+
+    if (reclaimer_entry_id == 0)
+    {
+        return ENOENT;
+    }
+
+    if ((result=sched_del_entry(reclaimer_entry_id)) == 0)
+    {
+        reclaimer_entry_id = 0;
+    }
+    return result;
+}
@@ -25,6 +25,7 @@
 #include "common_define.h"
 #include "fc_memory.h"
 #include "logger.h"
+#include "fast_buffer.h"
 
 /* following two macros for debug only */
 /*
@@ -39,6 +40,21 @@
 #define FAST_MBLOCK_ORDER_BY_ELEMENT_SIZE   2
 #define FAST_MBLOCK_ORDER_BY_USED_RATIO     3
 
+/* the memory backing of the trunks */
+#define FAST_MBLOCK_TRUNK_BACKING_MALLOC    0
+#define FAST_MBLOCK_TRUNK_BACKING_MMAP      1  //anonymous mmap
+#define FAST_MBLOCK_TRUNK_BACKING_HUGETLB   2  //mmap with MAP_HUGETLB
+#define FAST_MBLOCK_TRUNK_BACKING_THP       3  //madvise MADV_HUGEPAGE
+
+#define FAST_MBLOCK_HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+
+#define FAST_MBLOCK_NUMA_MAX_NODES  64
+
+/* the lifetime histogram buckets, the upper bound of bucket i
+   is 2^i ms, the last bucket has no upper bound */
+#define FAST_MBLOCK_TELEMETRY_HISTOGRAM_SIZE  24
+#define FAST_MBLOCK_TELEMETRY_MAX_SITES      256  //max allocation sites
+
 /* free node chain */ 
 struct fast_mblock_node
 {
@@ -58,6 +74,8 @@ struct fast_mblock_malloc
     int64_t ref_count; //refference count
     int alloc_count;   //allocated element count
     int trunk_size;    //trunk bytes
+    int backing;       //the memory backing of this trunk
+    int numa_node;     //the NUMA node of the owner mblock, -1 for none
     struct fast_mblock_malloc *prev;
     struct fast_mblock_malloc *next;
 };
@@ -67,6 +85,38 @@ struct fast_mblock_chain {
 	struct fast_mblock_node *tail;
 };
 
+#ifdef __SIZEOF_INT128__
+typedef unsigned __int128 fast_mblock_tagged_value_t;
+#else
+typedef uint64_t fast_mblock_tagged_value_t;
+#endif
+
+/* tagged pointer of the lock free node chain for ABA safe */
+typedef union fast_mblock_tagged_ptr
+{
+    struct {
+        struct fast_mblock_node *node;
+        size_t tag;   //increased by every change
+    } s;
+    fast_mblock_tagged_value_t value;
+} __attribute__((aligned(sizeof(fast_mblock_tagged_value_t))))
+fast_mblock_tagged_ptr_t;
+
+/* per thread free node cache (magazine) */
+struct fast_mblock_thread_cache
+{
+    struct fast_mblock_man *mblock;
+    struct fast_mblock_node *head;   //cached free nodes
+    volatile int count;              //cached node count
+    struct fast_mblock_thread_cache *prev;
+    struct fast_mblock_thread_cache *next;
+};
+
+/* get the magazine of the calling thread, which should be zero initialized
+   when returned for the first time, return NULL for no thread cache */
+typedef struct fast_mblock_thread_cache *(*fast_mblock_get_thread_cache_func)(
+        struct fast_mblock_man *mblock, void *args);
+
 /* call by alloc trunk */
 typedef int (*fast_mblock_object_init_func)(void *element, void *args);
 
@@ -79,6 +129,37 @@ typedef int (*fast_mblock_malloc_trunk_check_func)(
 typedef void (*fast_mblock_malloc_trunk_notify_func)(
 	const int alloc_bytes, void *args);
 
+/* call by shrink to move the live object out of the sparse trunk,
+   should copy the object to dest (a free object) and update all the
+   references of the object. return 0 for moved, != 0 for can't be moved.
+   it is called with the mblock lock held (and the mblock manager lock
+   when called by the background reclaimer), so it MUST NOT alloc or free
+   the objects of this mblock nor call the mblock manager functions, and
+   it should skip (return != 0) the object which is in use by others
+   instead of waiting for it */
+typedef int (*fast_mblock_object_move_func)(void *dest,
+        void *src, void *args);
+
+struct fast_mblock_reclaim_options
+{
+    int keep_free_trunks;       //the empty trunks to keep for reuse
+    double trigger_free_ratio;  //shrink when free elements ratio >= this
+    double sparse_used_ratio;   //move the objects out of the trunks which
+                                //used ratio <= this, 0 for no moving
+    fast_mblock_object_move_func move_func;  //NULL for no moving
+    void *args;  //the args of move_func
+};
+
+struct fast_mblock_telemetry_options
+{
+    int sample_rate;     //sample 1 in N allocations, 0 for no sampling
+    int max_samples;     //max live sampled objects, 0 for 4096
+    int window_seconds;  //the time window of high water mark, 0 for 60
+    int window_count;    //the kept windows of high water mark, 0 for 60
+};
+
+struct fast_mblock_telemetry;
+
 struct fast_mblock_info
 {
     char name[FAST_MBLOCK_NAME_SIZE];
@@ -86,11 +167,13 @@ struct fast_mblock_info
     int trunk_size;           //trunk size
     int instance_count;       //instance count
     int block_size;
+    int trunk_backing;        //the memory backing of the last trunk
     int64_t element_total_count;  //total element count
     int64_t element_used_count;   //used element count
     int64_t delay_free_elements;  //delay free element count
     int64_t trunk_total_count;    //total trunk count
     int64_t trunk_used_count;     //used trunk count
+    int64_t returned_bytes;       //memory bytes returned to the OS by shrink
 };
 
 struct fast_mblock_trunks
@@ -128,6 +211,39 @@ struct fast_mblock_man
     struct fast_mblock_object_callbacks object_callbacks;
     struct fast_mblock_trunk_callbacks trunk_callbacks;
 
+    struct {
+        int type;       //expected backing, FAST_MBLOCK_TRUNK_BACKING_xxx
+        bool prefault;  //if populate the pages when mmap
+    } trunk_backing;
+
+    struct {
+        bool enabled;
+        int capacity;     //max cached nodes per thread
+        int batch_count;  //nodes exchanged with free chain once
+        pthread_key_t key;  //unused when get_cache_func is set
+        fast_mblock_get_thread_cache_func get_cache_func;
+        void *get_cache_args;
+        struct fast_mblock_thread_cache head;  //cache chain for stat
+    } thread_cache;
+
+    struct {
+        bool enabled;
+        volatile fast_mblock_tagged_ptr_t head;  //lock free node chain
+    } lock_free;
+
+    struct {
+        bool enabled;   //if shrink by the background reclaimer
+        struct fast_mblock_reclaim_options options;
+    } reclaim;
+
+    struct {
+        int node;    //the NUMA node of this mblock, -1 for none
+        int count;   //the NUMA node count, > 0 for NUMA aware
+        struct fast_mblock_man *mblocks;  //the mblock per NUMA node
+    } numa;
+
+    struct fast_mblock_telemetry *telemetry;  //NULL for disabled
+
     bool need_lock;         //if need mutex lock
     pthread_lock_cond_pair_t lcp;  //for read / write free node chain
     struct fast_mblock_man *prev;  //for stat manager
@@ -241,6 +357,15 @@ static inline int fast_mblock_set_need_wait(struct fast_mblock_man *mblock,
         return EINVAL;
     }
 
+    if (mblock->thread_cache.enabled || mblock->lock_free.enabled ||
+            mblock->numa.count > 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "need_wait can't be used with thread cache, lock free "
+                "or NUMA aware mode", __LINE__);
+        return EINVAL;
+    }
+
     mblock->alloc_elements.need_wait = need_wait;
     mblock->alloc_elements.pcontinue_flag = pcontinue_flag;
     if (need_wait)
@@ -259,6 +384,134 @@ static inline void fast_mblock_set_exceed_log_level(
 #define fast_mblock_set_exceed_silence(mblock)  \
     fast_mblock_set_exceed_log_level(mblock, LOG_NOTHING)
 
+/**
+enable per thread node cache, should be called after init and before alloc
+the nodes are exchanged with the shared free chain in batch, so most of
+alloc / free calls needn't the mutex lock
+parameters:
+	mblock: the mblock pointer
+    capacity: the max cached node count per thread, must >= 2
+return error no, 0 for success, != 0 fail
+*/
+#define fast_mblock_set_thread_cache(mblock, capacity) \
+    fast_mblock_set_thread_cache_ex(mblock, capacity, NULL, NULL)
+
+/**
+enable per thread node cache as fast_mblock_set_thread_cache, and the
+magazines are owned by the caller when get_cache_func is not NULL, so
+many mblocks can share one thread key of the caller.
+the caller should detach the magazine by fast_mblock_detach_thread_cache
+before free it (such as on thread exit)
+parameters:
+	mblock: the mblock pointer
+    capacity: the max cached node count per thread, must >= 2
+    get_cache_func: the function to get the magazine of the calling thread,
+                    NULL for the magazines managed by the mblock
+    get_cache_args: the args of get_cache_func
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_set_thread_cache_ex(struct fast_mblock_man *mblock,
+        const int capacity, fast_mblock_get_thread_cache_func
+        get_cache_func, void *get_cache_args);
+
+/**
+disable per thread node cache, should be called before alloc or on destroy
+parameters:
+	mblock: the mblock pointer
+return none
+*/
+void fast_mblock_unset_thread_cache(struct fast_mblock_man *mblock);
+
+/**
+return the cached nodes of the magazine to the mblock and detach it,
+for the magazine returned by get_cache_func only
+parameters:
+	cache: the magazine pointer
+return none
+*/
+void fast_mblock_detach_thread_cache(struct fast_mblock_thread_cache *cache);
+
+/**
+enable lock free mode, should be called after init and before alloc
+the free node chain is a tagged pointer stack changed by CAS (ABA safe),
+the mutex lock is used only when a new trunk must be allocated
+parameters:
+	mblock: the mblock pointer, need_lock must be true
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_set_lock_free(struct fast_mblock_man *mblock);
+
+/**
+set the memory backing of the trunks, should be called after init and
+before alloc. the trunk size is rounded up to the page size (huge page
+size for HUGETLB and THP). when the huge pages are not available, the
+trunks will be allocated by malloc
+parameters:
+	mblock: the mblock pointer
+    backing: FAST_MBLOCK_TRUNK_BACKING_xxx
+    prefault: if populate (prefault) the pages when mmap
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_set_trunk_backing(struct fast_mblock_man *mblock,
+        const int backing, const bool prefault);
+
+/**
+enable NUMA aware mode, should be called after the other setters such as
+fast_mblock_set_thread_cache and fast_mblock_set_trunk_backing.
+one mblock is created per NUMA node, the trunks of which are mmaped and
+bound to the node. the node is allocated from the mblock of the NUMA node
+which the calling thread runs on, and freed to the mblock of its trunk.
+nothing to do when the NUMA nodes less than 2
+parameters:
+	mblock: the mblock pointer
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_set_numa_aware(struct fast_mblock_man *mblock);
+
+/**
+enable the telemetry, should be called after init and before alloc
+(and before fast_mblock_set_numa_aware). the telemetry includes:
+  * the high water marks of the used elements over the time windows
+  * the sampled allocations (1 in N) with the caller address, the lifetime
+    histogram of the freed samples and the age histogram of the live samples
+the batch allocations are not sampled. nothing to do for the allocation
+and free when the telemetry is disabled
+parameters:
+	mblock: the mblock pointer
+    options: the telemetry options
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_set_telemetry(struct fast_mblock_man *mblock,
+        const struct fast_mblock_telemetry_options *options);
+
+/**
+dump the telemetry of the mblock as a JSON object
+parameters:
+	mblock: the mblock pointer
+    buffer: the buffer to append
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_telemetry_dump(struct fast_mblock_man *mblock,
+        FastBuffer *buffer);
+
+/**
+get the caption of the trunk backing
+parameters:
+    backing: FAST_MBLOCK_TRUNK_BACKING_xxx
+return the caption
+*/
+const char *fast_mblock_get_trunk_backing_caption(const int backing);
+
+/**
+get the element count cached by the threads. the magazines are changed
+by their threads without the lock, so the count is approximate (for the
+stats) when the threads are running, and exact when they are quiescent
+parameters:
+	mblock: the mblock pointer
+return the cached element count
+*/
+int64_t fast_mblock_thread_cached_count(struct fast_mblock_man *mblock);
+
 /**
 alloc a node from the mblock
 parameters:
@@ -431,6 +684,15 @@ int fast_mblock_manager_stat_print_ex(const bool hide_empty, const int order_by)
 #define fast_mblock_manager_stat_print(hide_empty) \
         fast_mblock_manager_stat_print_ex(hide_empty, FAST_MBLOCK_ORDER_BY_ALLOC_BYTES)
 
+/**
+dump the telemetry of the telemetry enabled mblocks as a JSON object
+such as {"mblocks": [...]}
+parameters:
+    buffer: the buffer to append
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_manager_telemetry_dump(FastBuffer *buffer);
+
 typedef void (*fast_mblock_free_trunks_func)(struct fast_mblock_man *mblock,
         struct fast_mblock_malloc *freelist);
 
@@ -457,6 +719,48 @@ int fast_mblock_reclaim(struct fast_mblock_man *mblock,
         const int reclaim_target, int *reclaim_count,
         fast_mblock_free_trunks_func free_trunks_func);
 
+/**
+set the reclaim options, the mblock will be shrunk by the background
+reclaimer when the options is not NULL. the objects are moved only
+when thread cache is disabled
+parameters:
+    mblock: the mblock pointer, need_lock must be true
+    options: the reclaim options, NULL for disable
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_set_reclaim(struct fast_mblock_man *mblock,
+        const struct fast_mblock_reclaim_options *options);
+
+/**
+shrink the mblock: move the live objects out of the sparse trunks
+with the move_func of the reclaim options, then free the empty trunks
+exceed keep_free_trunks and return their pages to the OS
+parameters:
+    mblock: the mblock pointer
+    moved_count: return the moved object count
+    returned_bytes: return the memory bytes returned to the OS
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_shrink(struct fast_mblock_man *mblock,
+        int *moved_count, int64_t *returned_bytes);
+
+/**
+start the background reclaimer which shrinks the reclaim enabled mblocks
+periodically, should be called after fast_mblock_manager_init and
+sched_start
+parameters:
+    interval: the reclaim interval in seconds
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_reclaimer_start(const int interval);
+
+/**
+stop the background reclaimer
+parameters:
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_reclaimer_stop();
+
 #ifdef __cplusplus
 }
 #endif
@@ -48,6 +48,7 @@ int fast_mpool_init(struct fast_mpool_man *mpool,
 
 	mpool->malloc_chain_head = NULL;
 	mpool->free_chain_head = NULL;
+	mpool->keep_blocks = 0;
 	mpool->alloc_count = 0;
 	mpool->alloc_bytes = 0;
 	mpool->reset.count = 0;
@@ -200,6 +201,156 @@ void *fast_mpool_memdup(struct fast_mpool_man *mpool,
     return dest;
 }
 
+int fast_mpool_mark(struct fast_mpool_man *mpool,
+        struct fast_mpool_mark *mark)
+{
+    struct fast_mpool_malloc *pMallocNode;
+    char *ptr;
+    int count;
+
+    count = 0;
+    pMallocNode = mpool->malloc_chain_head;
+    while (pMallocNode != NULL)
+    {
+        count++;
+        pMallocNode = pMallocNode->malloc_next;
+    }
+
+    /* one more for the block may be created by this alloc */
+    ptr = (char *)fast_mpool_alloc(mpool, sizeof(char *) *
+            (count + 1) + sizeof(char *) - 1);
+    if (ptr == NULL)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "alloc mark from mpool fail", __LINE__);
+        return ENOMEM;
+    }
+
+    /* the mark self is before the checkpoint and kept by the rollback,
+       so the mark can be rolled back to again */
+    mark->free_ptrs = (char **)MEM_ALIGN_CEIL((long)ptr, sizeof(char *));
+    mark->malloc_chain_head = mpool->malloc_chain_head;
+    mark->block_count = 0;
+    pMallocNode = mpool->malloc_chain_head;
+    while (pMallocNode != NULL)
+    {
+        mark->free_ptrs[mark->block_count++] = pMallocNode->free_ptr;
+        pMallocNode = pMallocNode->malloc_next;
+    }
+    mark->alloc_count = mpool->alloc_count;
+    mark->alloc_bytes = mpool->alloc_bytes;
+
+    return 0;
+}
+
+static void fast_mpool_rebuild_free_chain(struct fast_mpool_man *mpool)
+{
+    struct fast_mpool_malloc *pMallocNode;
+
+    mpool->free_chain_head = NULL;
+    pMallocNode = mpool->malloc_chain_head;
+    while (pMallocNode != NULL)
+    {
+        if ((int)(pMallocNode->end_ptr - pMallocNode->free_ptr) >
+                mpool->discard_size)
+        {
+            pMallocNode->free_next = mpool->free_chain_head;
+            mpool->free_chain_head = pMallocNode;
+        }
+
+        pMallocNode = pMallocNode->malloc_next;
+    }
+}
+
+int fast_mpool_rollback_to(struct fast_mpool_man *mpool,
+        const struct fast_mpool_mark *mark)
+{
+    struct fast_mpool_malloc *pMallocNode;
+    int count;
+
+    pMallocNode = mpool->malloc_chain_head;
+    while (pMallocNode != NULL && pMallocNode != mark->malloc_chain_head)
+    {
+        pMallocNode = pMallocNode->malloc_next;
+    }
+
+    count = 0;
+    while (pMallocNode != NULL)
+    {
+        count++;
+        pMallocNode = pMallocNode->malloc_next;
+    }
+    if (count != mark->block_count)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "invalid mark, block count: %d != %d",
+                __LINE__, count, mark->block_count);
+        return EINVAL;
+    }
+
+    /* the blocks created after the mark */
+    pMallocNode = mpool->malloc_chain_head;
+    while (pMallocNode != mark->malloc_chain_head)
+    {
+        pMallocNode->free_ptr = pMallocNode->base_ptr;
+        pMallocNode = pMallocNode->malloc_next;
+    }
+
+    count = 0;
+    while (pMallocNode != NULL)
+    {
+        pMallocNode->free_ptr = mark->free_ptrs[count++];
+        pMallocNode = pMallocNode->malloc_next;
+    }
+
+    mpool->alloc_count = mark->alloc_count;
+    mpool->alloc_bytes = mark->alloc_bytes;
+    fast_mpool_rebuild_free_chain(mpool);
+    return 0;
+}
+
+/* keep the largest blocks and free the others */
+static void fast_mpool_trim_blocks(struct fast_mpool_man *mpool)
+{
+    struct fast_mpool_malloc *pMallocNode;
+    struct fast_mpool_malloc *current;
+    struct fast_mpool_malloc **pp;
+    struct fast_mpool_malloc *kept_head;
+    int kept_count;
+
+    kept_head = NULL;
+    kept_count = 0;
+    pMallocNode = mpool->malloc_chain_head;
+    while (pMallocNode != NULL)
+    {
+        current = pMallocNode;
+        pMallocNode = pMallocNode->malloc_next;
+
+        /* insert into the kept chain ordered by alloc size desc */
+        pp = &kept_head;
+        while (*pp != NULL && (*pp)->alloc_size >= current->alloc_size)
+        {
+            pp = &(*pp)->malloc_next;
+        }
+        current->malloc_next = *pp;
+        *pp = current;
+
+        if (++kept_count > mpool->keep_blocks)
+        {
+            pp = &kept_head;
+            while ((*pp)->malloc_next != NULL)
+            {
+                pp = &(*pp)->malloc_next;
+            }
+            free(*pp);
+            *pp = NULL;
+            kept_count--;
+        }
+    }
+
+    mpool->malloc_chain_head = kept_head;
+}
+
 void fast_mpool_reset(struct fast_mpool_man *mpool)
 {
     struct fast_mpool_malloc *pMallocNode;
@@ -211,6 +362,11 @@ void fast_mpool_reset(struct fast_mpool_man *mpool)
     }
 
     mpool->reset.last_alloc_count = mpool->alloc_count;
+    if (mpool->keep_blocks > 0)
+    {
+        fast_mpool_trim_blocks(mpool);
+    }
+
     mpool->free_chain_head = NULL;
     pMallocNode = mpool->malloc_chain_head;
     while (pMallocNode != NULL)
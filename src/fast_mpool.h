@@ -41,6 +41,7 @@ struct fast_mpool_man
     struct fast_mpool_malloc *free_chain_head;   //free node chain
     int alloc_size_once;  //alloc size once, default: 1MB
     int discard_size;     //discard size, default: 64 bytes
+    int keep_blocks;      //keep the largest blocks when reset, 0 for all
     int64_t alloc_count;
     int64_t alloc_bytes;
     struct {
@@ -49,6 +50,16 @@ struct fast_mpool_man
     } reset;
 };
 
+/* the checkpoint for rollback */
+struct fast_mpool_mark
+{
+    struct fast_mpool_malloc *malloc_chain_head; //the head when marked
+    char **free_ptrs;  //the free ptrs of the blocks, alloced before the mark
+    int block_count;   //the block count from the head when marked
+    int64_t alloc_count;  //the alloc count when marked
+    int64_t alloc_bytes;  //the alloc bytes when marked
+};
+
 struct fast_mpool_stats
 {
     int64_t total_bytes;
@@ -86,6 +97,46 @@ parameters:
 */
 void fast_mpool_reset(struct fast_mpool_man *mpool);
 
+/**
+set the block count to keep when reset, the largest blocks are kept
+and the others are freed
+parameters:
+	mpool: the mpool pointer
+	keep_blocks: the block count to keep, 0 for keep all (default)
+return none
+*/
+static inline void fast_mpool_set_keep_blocks(struct fast_mpool_man *mpool,
+        const int keep_blocks)
+{
+    mpool->keep_blocks = (keep_blocks > 0) ? keep_blocks : 0;
+}
+
+/**
+mark a checkpoint, the memory alloced after the checkpoint
+can be released by fast_mpool_rollback_to
+the mark self is alloced from the mpool before the checkpoint, so it can
+be rolled back to many times. the marks can be nested, and a mark becomes
+invalid after rollback to an outer mark or reset
+parameters:
+	mpool: the mpool pointer
+	mark: return the checkpoint
+return error no, 0 for success, != 0 fail
+*/
+int fast_mpool_mark(struct fast_mpool_man *mpool,
+        struct fast_mpool_mark *mark);
+
+/**
+rollback to the checkpoint, the memory alloced after the mark is
+released for reuse and the memory alloced before is kept,
+the alloc_count and alloc_bytes are restored too
+parameters:
+	mpool: the mpool pointer
+	mark: the checkpoint returned by fast_mpool_mark
+return error no, 0 for success, != 0 fail
+*/
+int fast_mpool_rollback_to(struct fast_mpool_man *mpool,
+        const struct fast_mpool_mark *mark);
+
 /**
 alloc a node from the mpool
 parameters:
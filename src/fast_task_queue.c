@@ -113,6 +113,7 @@ static struct mpool_node *malloc_mpool(const int total_alloc_size)
 				return NULL;
 			}
 		}
+		pTask->inline_data = pTask->data;
 
         if (g_free_queue.init_callback != NULL)
         {
@@ -137,6 +138,212 @@ static struct mpool_node *malloc_mpool(const int total_alloc_size)
 	return mpool;
 }
 
+static inline struct fast_mblock_man *task_buffer_get_allocator(
+        const int size, int *class_size)
+{
+    int index;
+
+    if (size >= g_free_queue.max_buff_size)
+    {
+        *class_size = g_free_queue.max_buff_size;
+        index = g_free_queue.buffer_pool.count - 1;
+    }
+    else
+    {
+        index = 0;
+        *class_size = g_free_queue.min_buff_size * 2;
+        while (*class_size < size)
+        {
+            *class_size *= 2;
+            index++;
+        }
+
+        //the last class is max_buff_size, not the power of 2
+        if (index == g_free_queue.buffer_pool.count - 1)
+        {
+            *class_size = g_free_queue.max_buff_size;
+        }
+    }
+
+    return g_free_queue.buffer_pool.allocators + index;
+}
+
+static char *task_buffer_lease(struct fast_task_info *pTask, int *size)
+{
+    struct fast_mblock_man *allocator;
+    char *buff;
+    int64_t leased_bytes;
+    int64_t peak_bytes;
+
+    if (*size <= g_free_queue.min_buff_size)
+    {
+        *size = g_free_queue.min_buff_size;
+        return pTask->inline_data;
+    }
+
+    if (*size > g_free_queue.max_buff_size)
+    {
+        buff = (char *)fc_malloc(*size);
+    }
+    else
+    {
+        allocator = task_buffer_get_allocator(*size, size);
+        buff = (char *)fast_mblock_alloc_object(allocator);
+    }
+    if (buff == NULL)
+    {
+        return NULL;
+    }
+
+    leased_bytes = __sync_add_and_fetch(&g_free_queue.
+            buffer_pool.leased_bytes, *size);
+    while ((peak_bytes=g_free_queue.buffer_pool.peak_bytes) < leased_bytes)
+    {
+        if (__sync_bool_compare_and_swap(&g_free_queue.buffer_pool.
+                    peak_bytes, peak_bytes, leased_bytes))
+        {
+            break;
+        }
+    }
+    return buff;
+}
+
+static void task_buffer_return(struct fast_task_info *pTask,
+        char *buff, const int size)
+{
+    int class_size;
+
+    if (buff == pTask->inline_data)
+    {
+        return;
+    }
+
+    if (size > g_free_queue.max_buff_size)
+    {
+        free(buff);
+    }
+    else
+    {
+        fast_mblock_free_object(task_buffer_get_allocator(
+                    size, &class_size), buff);
+    }
+    __sync_sub_and_fetch(&g_free_queue.buffer_pool.leased_bytes, size);
+}
+
+int free_queue_set_buffer_pool()
+{
+    struct fast_mblock_reclaim_options reclaim_options;
+    struct fast_mblock_man *allocator;
+    int class_size;
+    int alloc_once;
+    int count;
+    int result;
+    int i;
+
+    if (g_free_queue.buffer_pool.enabled)
+    {
+        return EEXIST;
+    }
+
+    if (g_free_queue.malloc_whole_block || g_free_queue.min_buff_size >=
+            g_free_queue.max_buff_size)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "can't enable buffer pool because min buffer size: %d "
+                ">= max buffer size: %d", __LINE__, g_free_queue.
+                min_buff_size, g_free_queue.max_buff_size);
+        return EOPNOTSUPP;
+    }
+
+    count = 1;  //the max buffer size
+    class_size = g_free_queue.min_buff_size * 2;
+    while (class_size < g_free_queue.max_buff_size)
+    {
+        class_size *= 2;
+        count++;
+    }
+
+    g_free_queue.buffer_pool.allocators = (struct fast_mblock_man *)
+        fc_malloc(sizeof(struct fast_mblock_man) * count);
+    if (g_free_queue.buffer_pool.allocators == NULL)
+    {
+        return ENOMEM;
+    }
+
+    //return the idle trunks when the background reclaimer started
+    memset(&reclaim_options, 0, sizeof(reclaim_options));
+    reclaim_options.keep_free_trunks = 1;
+    reclaim_options.trigger_free_ratio = 0.50;
+
+    result = 0;
+    class_size = g_free_queue.min_buff_size * 2;
+    for (i=0; i<count; i++)
+    {
+        if (i == count - 1)
+        {
+            class_size = g_free_queue.max_buff_size;
+        }
+
+        allocator = g_free_queue.buffer_pool.allocators + i;
+        alloc_once = (1024 * 1024) / class_size;
+        if ((result=fast_mblock_init_ex1(allocator, "task-buffer",
+                        class_size, (alloc_once > 0 ? alloc_once : 1),
+                        0, NULL, NULL, true)) != 0)
+        {
+            break;
+        }
+        if ((result=fast_mblock_set_reclaim(allocator,
+                        &reclaim_options)) != 0)
+        {
+            fast_mblock_destroy(allocator);
+            break;
+        }
+        class_size *= 2;
+    }
+
+    if (result != 0)
+    {
+        while (--i >= 0)
+        {
+            fast_mblock_destroy(g_free_queue.buffer_pool.allocators + i);
+        }
+        free(g_free_queue.buffer_pool.allocators);
+        g_free_queue.buffer_pool.allocators = NULL;
+        return result;
+    }
+
+    g_free_queue.buffer_pool.count = count;
+    g_free_queue.buffer_pool.leased_bytes = 0;
+    g_free_queue.buffer_pool.peak_bytes = 0;
+    g_free_queue.buffer_pool.enabled = true;
+    return 0;
+}
+
+void free_queue_buffer_stat(struct fast_task_buffer_stat *stat)
+{
+    struct fast_mblock_man *allocator;
+    struct fast_mblock_man *end;
+
+    stat->inline_bytes = (int64_t)g_free_queue.alloc_connections *
+        g_free_queue.min_buff_size;
+    stat->leased_bytes = __sync_add_and_fetch(&g_free_queue.
+            buffer_pool.leased_bytes, 0);
+    stat->peak_bytes = __sync_add_and_fetch(&g_free_queue.
+            buffer_pool.peak_bytes, 0);
+    stat->pooled_bytes = 0;
+    if (g_free_queue.buffer_pool.enabled)
+    {
+        end = g_free_queue.buffer_pool.allocators +
+            g_free_queue.buffer_pool.count;
+        for (allocator=g_free_queue.buffer_pool.allocators;
+                allocator<end; allocator++)
+        {
+            stat->pooled_bytes += allocator->info.trunk_total_count *
+                allocator->info.trunk_size;
+        }
+    }
+}
+
 int free_queue_init_ex2(const int max_connections, const int init_connections,
         const int alloc_task_once, const int min_buff_size,
         const int max_buff_size, const int arg_size,
@@ -329,6 +536,12 @@ void free_queue_destroy()
             for (p=(char *)mpool->blocks; p<pCharEnd; p += g_free_queue.block_size)
             {
                 pTask = (struct fast_task_info *)p;
+                if (g_free_queue.buffer_pool.enabled &&
+                        pTask->data != pTask->inline_data)
+                {
+                    task_buffer_return(pTask, pTask->data, pTask->size);
+                    pTask->data = pTask->inline_data;
+                }
                 if (pTask->data != NULL)
                 {
                     free(pTask->data);
@@ -350,6 +563,18 @@ void free_queue_destroy()
 	}
 	g_mpool.head = g_mpool.tail = NULL;
 
+    if (g_free_queue.buffer_pool.enabled)
+    {
+        int i;
+        for (i=0; i<g_free_queue.buffer_pool.count; i++)
+        {
+            fast_mblock_destroy(g_free_queue.buffer_pool.allocators + i);
+        }
+        free(g_free_queue.buffer_pool.allocators);
+        g_free_queue.buffer_pool.allocators = NULL;
+        g_free_queue.buffer_pool.enabled = false;
+    }
+
 	pthread_mutex_destroy(&(g_free_queue.lock));
 }
 
@@ -463,18 +688,40 @@ static int _realloc_buffer(struct fast_task_info *pTask, const int new_size,
         const bool copy_data)
 {
 	char *new_buff;
-    new_buff = (char *)fc_malloc(new_size);
+    int size;
+
+    size = new_size;
+    if (g_free_queue.buffer_pool.enabled)
+    {
+        new_buff = task_buffer_lease(pTask, &size);
+    }
+    else
+    {
+        new_buff = (char *)fc_malloc(new_size);
+    }
     if (new_buff == NULL)
     {
         return ENOMEM;
     }
+    else if (new_buff == pTask->data)
+    {
+        pTask->size = size;
+        return 0;
+    }
     else
     {
         if (copy_data && pTask->offset > 0) {
             memcpy(new_buff, pTask->data, pTask->offset);
         }
-        free(pTask->data);
-        pTask->size = new_size;
+        if (g_free_queue.buffer_pool.enabled)
+        {
+            task_buffer_return(pTask, pTask->data, pTask->size);
+        }
+        else
+        {
+            free(pTask->data);
+        }
+        pTask->size = size;
         pTask->data = new_buff;
         return 0;
     }
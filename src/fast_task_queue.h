@@ -25,6 +25,8 @@
 #include "common_define.h"
 #include "ioevent.h"
 #include "fast_timer.h"
+#include "fast_mblock.h"
+#include "fc_mpsc_queue.h"
 
 #define FC_NOTIFY_READ_FD(tdata)  (tdata)->pipe_fds[0]
 #define FC_NOTIFY_WRITE_FD(tdata) (tdata)->pipe_fds[1]
@@ -55,7 +57,7 @@ struct nio_thread_data
 {
 	struct ioevent_puller ev_puller;
 	struct fast_timer timer;
-	int pipe_fds[2];   //for notify
+	int pipe_fds[2];   //for notify, the same eventfd for read and write
 	struct fast_task_info *deleted_list;   //tasks for cleanup
 	ThreadLoopCallback thread_loop_callback;
 	void *arg;   //extra argument pointer
@@ -65,9 +67,12 @@ struct nio_thread_data
         pthread_mutex_t lock;
     } waiting_queue;  //task queue
 
+    //lock free task queue linked by fast_task_info.next
+    struct fc_mpsc_queue task_queue;
+
     struct {
         bool enabled;
-        volatile int64_t counter;
+        volatile int64_t counter;  //the wakeup pending flag for coalescing
     } notify;  //for thread notify
 };
 
@@ -75,6 +80,7 @@ struct ioevent_notify_entry
 {
     IOEventEntry event;  //must first
     struct nio_thread_data *thread_data;
+    IOEventCallback callback;  //the recv notify callback of the caller
 };
 
 struct fast_task_info
@@ -86,6 +92,7 @@ struct fast_task_info
     };
 	void *arg;  //extra argument pointer
 	char *data; //buffer for write or read
+	char *inline_data; //the own buffer of min_buff_size for buffer pool
 
     struct {
         struct iovec *iovs;
@@ -126,6 +133,22 @@ struct fast_task_queue
 	int block_size;
 	bool malloc_whole_block;
     TaskInitCallback init_callback;
+
+    struct {
+        bool enabled;
+        int count;   //size class count
+        struct fast_mblock_man *allocators;  //one per size class
+        volatile int64_t leased_bytes; //current bytes leased by the tasks
+        volatile int64_t peak_bytes;   //peak bytes leased by the tasks
+    } buffer_pool;  //the buffers larger than min_buff_size
+};
+
+struct fast_task_buffer_stat
+{
+    int64_t inline_bytes;  //the own buffers of the tasks
+    int64_t leased_bytes;  //current bytes leased from the buffer pool
+    int64_t peak_bytes;    //peak bytes leased from the buffer pool
+    int64_t pooled_bytes;  //the memory bytes of the buffer pool
 };
 
 #ifdef __cplusplus
@@ -154,6 +177,24 @@ static inline int free_queue_init(const int max_connections,
 
 void free_queue_destroy();
 
+/**
+enable the buffer pool, should be called after free_queue_init and before
+free_queue_pop. the task keeps its own buffer of min_buff_size only, the
+larger buffers are leased from the power of two size class pools and
+returned when the task is pushed to the free queue
+parameters:
+return error no, 0 for success, != 0 fail
+*/
+int free_queue_set_buffer_pool();
+
+/**
+get the buffer memory stat
+parameters:
+    stat: return the buffer stat
+return none
+*/
+void free_queue_buffer_stat(struct fast_task_buffer_stat *stat);
+
 int free_queue_push(struct fast_task_info *pTask);
 struct fast_task_info *free_queue_pop();
 int free_queue_count();
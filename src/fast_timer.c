@@ -35,6 +35,8 @@ int fast_timer_init(FastTimer *timer, const int slot_count,
     timer->slot_count = slot_count;
     timer->base_time = current_time; //base time for slot 0
     timer->current_time = current_time;
+    timer->tick = 0;
+    timer->current_tick = 0;
     bytes = sizeof(FastTimerSlot) * slot_count;
     timer->slots = (FastTimerSlot *)fc_malloc(bytes);
     if (timer->slots == NULL) {
@@ -45,6 +47,27 @@ int fast_timer_init(FastTimer *timer, const int slot_count,
     return 0;
 }
 
+int fast_timer_init_hierarchy(FastTimer *timer, const int tick,
+    const int64_t current_time)
+{
+    int result;
+
+    if (tick <= 0) {
+        return EINVAL;
+    }
+
+    if ((result=fast_timer_init(timer, (1 << FAST_TIMER_WHEEL_LEVEL0_BITS) +
+                    (FAST_TIMER_WHEEL_LEVEL_COUNT - 1) *
+                    (1 << FAST_TIMER_WHEEL_LEVELN_BITS), current_time)) != 0)
+    {
+        return result;
+    }
+
+    timer->tick = tick;
+    timer->current_tick = 0;
+    return 0;
+}
+
 void fast_timer_destroy(FastTimer *timer)
 {
     if (timer->slots != NULL) {
@@ -74,6 +97,132 @@ static inline void add_entry(FastTimer *timer, FastTimerSlot *slot,
     entry->rehash = false;
 }
 
+#define WHEEL_LEVEL0_SLOTS  (1 << FAST_TIMER_WHEEL_LEVEL0_BITS)
+#define WHEEL_LEVELN_SLOTS  (1 << FAST_TIMER_WHEEL_LEVELN_BITS)
+#define WHEEL_LEVELN_MASK   (WHEEL_LEVELN_SLOTS - 1)
+
+#define WHEEL_LEVEL_SHIFT(level) (FAST_TIMER_WHEEL_LEVEL0_BITS + \
+        ((level) - 1) * FAST_TIMER_WHEEL_LEVELN_BITS)
+
+#define WHEEL_LEVEL_SLOT_START(level) (WHEEL_LEVEL0_SLOTS + \
+        ((level) - 1) * WHEEL_LEVELN_SLOTS)
+
+#define WHEEL_MAX_TICKS  (((int64_t)1 << WHEEL_LEVEL_SHIFT( \
+                FAST_TIMER_WHEEL_LEVEL_COUNT)) - 1)
+
+/* the entry of level N (N > 0) is cascaded to the lower level when the
+   ticks of the lower levels are all zero, such as the carry of a number */
+static inline int wheel_get_slot_index(FastTimer *timer,
+        const int64_t expires)
+{
+    int64_t tick;
+    int64_t delta;
+    int level;
+
+    tick = (expires - timer->base_time) / timer->tick;
+    if (tick < timer->current_tick) {
+        tick = timer->current_tick;
+    }
+
+    delta = tick - timer->current_tick;
+    if (delta < WHEEL_LEVEL0_SLOTS) {
+        return tick & (WHEEL_LEVEL0_SLOTS - 1);
+    }
+
+    if (delta > WHEEL_MAX_TICKS) {  //cascaded again after the max ticks
+        tick = timer->current_tick + WHEEL_MAX_TICKS;
+        delta = WHEEL_MAX_TICKS;
+    }
+    for (level=2; level<FAST_TIMER_WHEEL_LEVEL_COUNT; level++) {
+        if (delta < ((int64_t)1 << WHEEL_LEVEL_SHIFT(level))) {
+            break;
+        }
+    }
+    --level;
+
+    return WHEEL_LEVEL_SLOT_START(level) + ((tick >>
+                WHEEL_LEVEL_SHIFT(level)) & WHEEL_LEVELN_MASK);
+}
+
+static inline void wheel_add_entry(FastTimer *timer, FastTimerEntry *entry)
+{
+    FastTimerSlot *slot;
+
+    entry->slot_index = wheel_get_slot_index(timer, entry->expires);
+    slot = timer->slots + entry->slot_index;
+    entry->next = slot->head.next;
+    if (slot->head.next != NULL) {
+        slot->head.next->prev = entry;
+    }
+    entry->prev = &slot->head;
+    slot->head.next = entry;
+    entry->rehash = false;
+}
+
+static void wheel_cascade(FastTimer *timer, FastTimerSlot *slot)
+{
+    FastTimerEntry *entry;
+    FastTimerEntry *next;
+
+    entry = slot->head.next;
+    slot->head.next = NULL;
+    while (entry != NULL) {
+        next = entry->next;
+        wheel_add_entry(timer, entry);
+        entry = next;
+    }
+}
+
+static int wheel_timeouts_get(FastTimer *timer, const int64_t current_time,
+        FastTimerEntry *head)
+{
+    FastTimerSlot *slot;
+    FastTimerEntry *entry;
+    FastTimerEntry *tail;
+    int64_t end_tick;
+    int64_t mask;
+    int level;
+    int count;
+
+    head->prev = NULL;
+    head->next = NULL;
+    timer->current_time = current_time;
+
+    //the tick is expired when its end time <= the current time
+    end_tick = (current_time - timer->base_time) / timer->tick;
+    tail = head;
+    count = 0;
+    while (timer->current_tick < end_tick) {
+        for (level=FAST_TIMER_WHEEL_LEVEL_COUNT - 1; level>0; level--) {
+            mask = ((int64_t)1 << WHEEL_LEVEL_SHIFT(level)) - 1;
+            if ((timer->current_tick & mask) == 0) {
+                wheel_cascade(timer, timer->slots +
+                        WHEEL_LEVEL_SLOT_START(level) + ((timer->current_tick
+                                >> WHEEL_LEVEL_SHIFT(level)) &
+                            WHEEL_LEVELN_MASK));
+            }
+        }
+
+        slot = timer->slots + (timer->current_tick &
+                (WHEEL_LEVEL0_SLOTS - 1));
+        timer->current_tick++;
+        if ((entry=slot->head.next) == NULL) {
+            continue;
+        }
+
+        tail->next = entry;
+        entry->prev = tail;
+        do {
+            count++;
+            tail = entry;
+            entry = entry->next;
+        } while (entry != NULL);
+        slot->head.next = NULL;
+    }
+
+    return count;
+}
+
 void fast_timer_add_ex(FastTimer *timer, FastTimerEntry *entry,
         const int64_t expires, const bool set_expires)
 {
@@ -81,6 +230,14 @@ void fast_timer_add_ex(FastTimer *timer, FastTimerEntry *entry,
     int64_t new_expires;
     bool new_set_expires;
 
+    if (timer->tick > 0) {
+        if (set_expires) {
+            entry->expires = expires;
+        }
+        wheel_add_entry(timer, entry);
+        return;
+    }
+
     if (expires > timer->current_time) {
         new_expires = expires;
         new_set_expires = set_expires;
@@ -97,6 +254,17 @@ int fast_timer_modify(FastTimer *timer, FastTimerEntry *entry,
 {
     int result;
 
+    if (timer->tick > 0) {
+        if (new_expires != entry->expires) {
+            if ((result=fast_timer_remove(timer, entry)) != 0) {
+                return result;
+            }
+            entry->expires = new_expires;
+            wheel_add_entry(timer, entry);
+        }
+        return 0;
+    }
+
     if (new_expires > entry->expires) {
         entry->rehash = TIMER_GET_SLOT_INDEX(timer, new_expires) !=
             TIMER_GET_SLOT_INDEX(timer, entry->expires);
@@ -148,6 +316,10 @@ int fast_timer_timeouts_get(FastTimer *timer, const int64_t current_time,
     FastTimerEntry *tail;
     int count;
 
+    if (timer->tick > 0) {
+        return wheel_timeouts_get(timer, current_time, head);
+    }
+
     head->prev = NULL;
     head->next = NULL;
     if (timer->current_time >= current_time) {
@@ -33,11 +33,18 @@ typedef struct fast_timer_slot {
     struct fast_timer_entry head;
 } FastTimerSlot;
 
+//the hierarchical time wheel: 256 slots for level 0, 64 slots for others
+#define FAST_TIMER_WHEEL_LEVEL_COUNT  5
+#define FAST_TIMER_WHEEL_LEVEL0_BITS  8
+#define FAST_TIMER_WHEEL_LEVELN_BITS  6
+
 typedef struct fast_timer {
     int slot_count;    //time wheel slot count
     int64_t base_time; //base time for slot 0
     volatile int64_t current_time;
     FastTimerSlot *slots;
+    int tick;  //time of one tick for hierarchical wheel, 0 for single level
+    int64_t current_tick;  //the next tick to deal for hierarchical wheel
 } FastTimer;
 
 #ifdef __cplusplus
@@ -49,6 +56,22 @@ extern "C" {
 
 int fast_timer_init(FastTimer *timer, const int slot_count,
     const int64_t current_time);
+
+/** init the hierarchical (multi-level) time wheel with cascading,
+ *  add, remove and modify are O(1) without lazy move
+ *  parameters:
+ *      timer: the timer
+ *      tick: the time of one tick, such as 10 for 10 ms
+ *      current_time: the current time, such as get_current_time_ms()
+ *  return: error no, 0 success, != 0 fail
+*/
+int fast_timer_init_hierarchy(FastTimer *timer, const int tick,
+    const int64_t current_time);
+
+static inline bool fast_timer_is_hierarchy(FastTimer *timer)
+{
+    return timer->tick > 0;
+}
 void fast_timer_destroy(FastTimer *timer);
 
 void fast_timer_add_ex(FastTimer *timer, FastTimerEntry *entry,
@@ -57,6 +80,7 @@ int fast_timer_remove(FastTimer *timer, FastTimerEntry *entry);
 int fast_timer_modify(FastTimer *timer, FastTimerEntry *entry,
     const int64_t new_expires);
 
+//for single level wheel only
 FastTimerSlot *fast_timer_slot_get(FastTimer *timer, const int64_t current_time);
 int fast_timer_timeouts_get(FastTimer *timer, const int64_t current_time,
    FastTimerEntry *head);
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fc_mpsc_queue.h
+
+/* intrusive lock free queue for multi producers and single consumer.
+   the producers push to a LIFO stack with CAS, the consumer swaps out
+   the whole stack in one atomic operation and reverses it to FIFO order,
+   so there is no ABA problem */
+
+#ifndef _FC_MPSC_QUEUE_H
+#define _FC_MPSC_QUEUE_H
+
+#include "common_define.h"
+#include "fc_queue.h"
+
+struct fc_mpsc_queue
+{
+    void * volatile head;  //the last pushed element
+    int next_ptr_offset;
+};
+
+#define FC_MPSC_QUEUE_NEXT_PTR(queue, data) \
+    *((void **)(((char *)data) + (queue)->next_ptr_offset))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline void fc_mpsc_queue_init(struct fc_mpsc_queue *queue,
+        const int next_ptr_offset)
+{
+    queue->head = NULL;
+    queue->next_ptr_offset = next_ptr_offset;
+}
+
+/** push the chain of the elements, the head of the chain is the first
+ *  to pop. called by any thread
+ *  parameters:
+ *      queue: the queue
+ *      head: the first element of the chain
+ *      tail: the last element of the chain
+ *  return: true if the queue is empty before push for the caller to notify
+*/
+static inline bool fc_mpsc_queue_push_chain(struct fc_mpsc_queue *queue,
+        void *head, void *tail)
+{
+    void *current;
+    void *previous;
+    void *next;
+    void *old;
+
+    //reverse the chain because the stack is in LIFO order
+    previous = NULL;
+    current = head;
+    while (current != tail) {
+        next = FC_MPSC_QUEUE_NEXT_PTR(queue, current);
+        FC_MPSC_QUEUE_NEXT_PTR(queue, current) = previous;
+        previous = current;
+        current = next;
+    }
+    FC_MPSC_QUEUE_NEXT_PTR(queue, tail) = previous;
+
+    do {
+        old = queue->head;
+        FC_MPSC_QUEUE_NEXT_PTR(queue, head) = old;
+    } while (!__sync_bool_compare_and_swap(&queue->head, old, tail));
+
+    return (old == NULL);
+}
+
+static inline bool fc_mpsc_queue_push(struct fc_mpsc_queue *queue,
+        void *data)
+{
+    void *old;
+
+    do {
+        old = queue->head;
+        FC_MPSC_QUEUE_NEXT_PTR(queue, data) = old;
+    } while (!__sync_bool_compare_and_swap(&queue->head, old, data));
+
+    return (old == NULL);
+}
+
+static inline bool fc_mpsc_queue_push_queue(struct fc_mpsc_queue *queue,
+        struct fc_queue_info *qinfo)
+{
+    if (qinfo->head == NULL) {
+        return false;
+    }
+    return fc_mpsc_queue_push_chain(queue, qinfo->head, qinfo->tail);
+}
+
+/** pop all elements in FIFO order, only called by the consumer thread
+ *  parameters:
+ *      queue: the queue
+ *      qinfo: return the head and the tail of the elements chain
+ *  return: none
+*/
+static inline void fc_mpsc_queue_pop_to_queue(struct fc_mpsc_queue *queue,
+        struct fc_queue_info *qinfo)
+{
+    void *current;
+    void *previous;
+    void *next;
+
+    if (queue->head == NULL) {
+        qinfo->head = qinfo->tail = NULL;
+        return;
+    }
+
+    current = __sync_lock_test_and_set(&queue->head, NULL);
+    qinfo->tail = current;
+    previous = NULL;
+    while (current != NULL) {
+        next = FC_MPSC_QUEUE_NEXT_PTR(queue, current);
+        FC_MPSC_QUEUE_NEXT_PTR(queue, current) = previous;
+        previous = current;
+        current = next;
+    }
+    qinfo->head = previous;
+}
+
+//pop all elements in FIFO order, return the head of the chain
+static inline void *fc_mpsc_queue_pop_all(struct fc_mpsc_queue *queue)
+{
+    struct fc_queue_info qinfo;
+
+    fc_mpsc_queue_pop_to_queue(queue, &qinfo);
+    return qinfo.head;
+}
+
+static inline bool fc_mpsc_queue_empty(struct fc_mpsc_queue *queue)
+{
+    return (queue->head == NULL);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "logger.h"
+#include "fc_memory.h"
+#include "flat_hash.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define FLAT_HASH_DEFAULT_LOAD_FACTOR  0.875
+
+//the high 7 bits for the control byte, the low bits for the group
+#define FLAT_HASH_H2(hash_code)  ((signed char)((hash_code) >> 25))
+
+#define FLAT_HASH_SLOT(table, index) \
+    ((table)->slots + (index) * (table)->slot_size)
+
+#define FLAT_HASH_SLOT_KEY(slot) \
+    ((char *)(slot) + sizeof(FCFlatHashSlotHeader))
+
+#define FLAT_HASH_SLOT_VALUE(table, slot) \
+    ((char *)(slot) + (table)->value_offset)
+
+//return the bit mask of the slots whose control byte equals to ctrl
+static inline unsigned int flat_hash_group_match(
+        const signed char *group, const signed char ctrl)
+{
+#ifdef __SSE2__
+    __m128i ctrls;
+    ctrls = _mm_loadu_si128((const __m128i *)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(ctrl), ctrls));
+#else
+    unsigned int mask;
+    int i;
+
+    mask = 0;
+    for (i=0; i<FC_FLAT_HASH_GROUP_SIZE; i++) {
+        if (group[i] == ctrl) {
+            mask |= (1 << i);
+        }
+    }
+    return mask;
+#endif
+}
+
+//the bit mask of the EMPTY or DELETED slots (the sign bit is set)
+static inline unsigned int flat_hash_group_match_free(
+        const signed char *group)
+{
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    unsigned int mask;
+    int i;
+
+    mask = 0;
+    for (i=0; i<FC_FLAT_HASH_GROUP_SIZE; i++) {
+        if (group[i] < 0) {
+            mask |= (1 << i);
+        }
+    }
+    return mask;
+#endif
+}
+
+/* mix the hash code with the murmur3 finalizer, because the control
+   byte and the group index need the well distributed bits */
+static inline unsigned int flat_hash_get_code(FCFlatHashTable *table,
+        const void *key, const int key_len)
+{
+    unsigned int h;
+
+    h = (unsigned int)table->hash_func(key, key_len);
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+static int64_t flat_hash_find_index(FCFlatHashTable *table,
+        const void *key, const int key_len, const unsigned int hash_code)
+{
+    const signed char *group;
+    FCFlatHashSlotHeader *header;
+    signed char h2;
+    unsigned int mask;
+    int64_t group_index;
+    int64_t index;
+    int64_t step;
+
+    h2 = FLAT_HASH_H2(hash_code);
+    group_index = hash_code & table->group_mask;
+    for (step=0; step<=table->group_mask; step++) {
+        group = table->ctrls + group_index * FC_FLAT_HASH_GROUP_SIZE;
+        mask = flat_hash_group_match(group, h2);
+        while (mask != 0) {
+            index = group_index * FC_FLAT_HASH_GROUP_SIZE +
+                __builtin_ctz(mask);
+            header = (FCFlatHashSlotHeader *)FLAT_HASH_SLOT(table, index);
+            if (header->key_len == key_len && memcmp(FLAT_HASH_SLOT_KEY(
+                            header), key, key_len) == 0)
+            {
+                return index;
+            }
+            mask &= mask - 1;
+        }
+
+        //the probe stops at the group which has any EMPTY slot
+        if (flat_hash_group_match(group, FC_FLAT_HASH_CTRL_EMPTY) != 0) {
+            return -1;
+        }
+
+        //triangular probing visits all groups
+        group_index = (group_index + step + 1) & table->group_mask;
+    }
+
+    return -1;
+}
+
+static int64_t flat_hash_find_free_index(FCFlatHashTable *table,
+        const unsigned int hash_code)
+{
+    unsigned int mask;
+    int64_t group_index;
+    int64_t step;
+
+    group_index = hash_code & table->group_mask;
+    for (step=0; step<=table->group_mask; step++) {
+        mask = flat_hash_group_match_free(table->ctrls +
+                group_index * FC_FLAT_HASH_GROUP_SIZE);
+        if (mask != 0) {
+            return group_index * FC_FLAT_HASH_GROUP_SIZE +
+                __builtin_ctz(mask);
+        }
+        group_index = (group_index + step + 1) & table->group_mask;
+    }
+
+    return -1;
+}
+
+static inline void flat_hash_set_slot(FCFlatHashTable *table,
+        const int64_t index, const signed char h2, const void *key,
+        const int key_len, const void *value, const int value_len)
+{
+    FCFlatHashSlotHeader *header;
+
+    table->ctrls[index] = h2;
+    header = (FCFlatHashSlotHeader *)FLAT_HASH_SLOT(table, index);
+    header->key_len = key_len;
+    header->value_len = value_len;
+    memcpy(FLAT_HASH_SLOT_KEY(header), key, key_len);
+    if (value_len > 0) {
+        memcpy(FLAT_HASH_SLOT_VALUE(table, header), value, value_len);
+    }
+}
+
+static int flat_hash_alloc(FCFlatHashTable *table, const int64_t capacity)
+{
+    int64_t group_count;
+    int64_t min_groups;
+
+    min_groups = ((int64_t)(capacity / table->load_factor) +
+            FC_FLAT_HASH_GROUP_SIZE - 1) / FC_FLAT_HASH_GROUP_SIZE;
+    group_count = 1;
+    while (group_count < min_groups) {
+        group_count *= 2;
+    }
+
+    table->capacity = group_count * FC_FLAT_HASH_GROUP_SIZE;
+    table->ctrls = (signed char *)fc_malloc(table->capacity);
+    if (table->ctrls == NULL) {
+        return ENOMEM;
+    }
+    table->slots = (char *)fc_malloc(table->capacity * table->slot_size);
+    if (table->slots == NULL) {
+        free(table->ctrls);
+        table->ctrls = NULL;
+        return ENOMEM;
+    }
+
+    memset(table->ctrls, FC_FLAT_HASH_CTRL_EMPTY, table->capacity);
+    table->group_mask = group_count - 1;
+    table->item_count = 0;
+    table->deleted_count = 0;
+    table->growth_left = (int64_t)(table->capacity * table->load_factor);
+    return 0;
+}
+
+int fc_flat_hash_init_ex(FCFlatHashTable *table, HashFunc hash_func,
+        const int key_size, const int value_size, const int64_t capacity,
+        const double load_factor)
+{
+    if (key_size <= 0 || value_size < 0) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid key size: %d or value size: %d",
+                __LINE__, key_size, value_size);
+        return EINVAL;
+    }
+
+    memset(table, 0, sizeof(FCFlatHashTable));
+    table->hash_func = hash_func;
+    table->key_size = key_size;
+    table->value_size = value_size;
+    table->value_offset = sizeof(FCFlatHashSlotHeader) + MEM_ALIGN(key_size);
+    table->slot_size = table->value_offset + MEM_ALIGN(value_size);
+    if (load_factor > 0.00 && load_factor < 1.00) {
+        table->load_factor = load_factor;
+    } else {
+        table->load_factor = FLAT_HASH_DEFAULT_LOAD_FACTOR;
+    }
+
+    return flat_hash_alloc(table, capacity > 0 ? capacity : 1);
+}
+
+void fc_flat_hash_destroy(FCFlatHashTable *table)
+{
+    if (table->ctrls != NULL) {
+        free(table->ctrls);
+        table->ctrls = NULL;
+    }
+    if (table->slots != NULL) {
+        free(table->slots);
+        table->slots = NULL;
+    }
+    table->capacity = 0;
+    table->item_count = 0;
+}
+
+void fc_flat_hash_clear(FCFlatHashTable *table)
+{
+    memset(table->ctrls, FC_FLAT_HASH_CTRL_EMPTY, table->capacity);
+    table->item_count = 0;
+    table->deleted_count = 0;
+    table->growth_left = (int64_t)(table->capacity * table->load_factor);
+}
+
+/* rebuild the table to drop the DELETED slots, the capacity is doubled
+   unless the most of the used slots are DELETED */
+static int flat_hash_rehash(FCFlatHashTable *table)
+{
+    FCFlatHashTable old;
+    FCFlatHashSlotHeader *header;
+    unsigned int hash_code;
+    int64_t new_capacity;
+    int64_t index;
+    int64_t i;
+    int result;
+
+    old = *table;
+    if (table->item_count < table->deleted_count) {
+        new_capacity = table->item_count + 1;
+    } else {
+        new_capacity = (table->item_count + 1) * 2;
+    }
+    if ((result=flat_hash_alloc(table, new_capacity)) != 0) {
+        *table = old;
+        return result;
+    }
+
+    for (i=0; i<old.capacity; i++) {
+        if (old.ctrls[i] < 0) {
+            continue;
+        }
+
+        header = (FCFlatHashSlotHeader *)FLAT_HASH_SLOT(&old, i);
+        hash_code = flat_hash_get_code(table, FLAT_HASH_SLOT_KEY(
+                    header), header->key_len);
+        index = flat_hash_find_free_index(table, hash_code);
+        table->ctrls[index] = old.ctrls[i];
+        memcpy(FLAT_HASH_SLOT(table, index), header, table->slot_size);
+    }
+    table->item_count = old.item_count;
+    table->growth_left -= old.item_count;
+
+    free(old.ctrls);
+    free(old.slots);
+    return 0;
+}
+
+int fc_flat_hash_insert_ex(FCFlatHashTable *table, const void *key,
+        const int key_len, const void *value, const int value_len)
+{
+    FCFlatHashSlotHeader *header;
+    unsigned int hash_code;
+    int64_t index;
+    int result;
+
+    if (key_len <= 0 || key_len > table->key_size ||
+            value_len < 0 || value_len > table->value_size)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "invalid key length: %d or value length: %d, "
+                "key size: %d, value size: %d", __LINE__, key_len,
+                value_len, table->key_size, table->value_size);
+        return -EINVAL;
+    }
+
+    hash_code = flat_hash_get_code(table, key, key_len);
+    if ((index=flat_hash_find_index(table, key,
+                    key_len, hash_code)) >= 0)
+    {
+        header = (FCFlatHashSlotHeader *)FLAT_HASH_SLOT(table, index);
+        header->value_len = value_len;
+        if (value_len > 0) {
+            memcpy(FLAT_HASH_SLOT_VALUE(table, header), value, value_len);
+        }
+        return 0;
+    }
+
+    index = flat_hash_find_free_index(table, hash_code);
+    if (index < 0 || (table->growth_left == 0 &&
+                table->ctrls[index] == FC_FLAT_HASH_CTRL_EMPTY))
+    {
+        if ((result=flat_hash_rehash(table)) != 0) {
+            return -1 * result;
+        }
+        index = flat_hash_find_free_index(table, hash_code);
+    }
+
+    if (table->ctrls[index] == FC_FLAT_HASH_CTRL_DELETED) {
+        table->deleted_count--;
+    } else {
+        table->growth_left--;
+    }
+    flat_hash_set_slot(table, index, FLAT_HASH_H2(hash_code),
+            key, key_len, value, value_len);
+    table->item_count++;
+    return 1;
+}
+
+void *fc_flat_hash_find(FCFlatHashTable *table,
+        const void *key, const int key_len)
+{
+    int64_t index;
+
+    if (key_len > table->key_size) {
+        return NULL;
+    }
+
+    index = flat_hash_find_index(table, key, key_len,
+            flat_hash_get_code(table, key, key_len));
+    if (index < 0) {
+        return NULL;
+    }
+    return FLAT_HASH_SLOT_VALUE(table, FLAT_HASH_SLOT(table, index));
+}
+
+int fc_flat_hash_get(FCFlatHashTable *table, const void *key,
+        const int key_len, void *value, int *value_len)
+{
+    FCFlatHashSlotHeader *header;
+    int64_t index;
+
+    if (key_len > table->key_size) {
+        return ENOENT;
+    }
+
+    index = flat_hash_find_index(table, key, key_len,
+            flat_hash_get_code(table, key, key_len));
+    if (index < 0) {
+        return ENOENT;
+    }
+
+    header = (FCFlatHashSlotHeader *)FLAT_HASH_SLOT(table, index);
+    if (*value_len < header->value_len) {
+        return ENOSPC;
+    }
+
+    *value_len = header->value_len;
+    memcpy(value, FLAT_HASH_SLOT_VALUE(table, header), header->value_len);
+    return 0;
+}
+
+int fc_flat_hash_delete(FCFlatHashTable *table,
+        const void *key, const int key_len)
+{
+    int64_t index;
+    int64_t group_start;
+
+    if (key_len > table->key_size) {
+        return ENOENT;
+    }
+
+    index = flat_hash_find_index(table, key, key_len,
+            flat_hash_get_code(table, key, key_len));
+    if (index < 0) {
+        return ENOENT;
+    }
+
+    /* the group with an EMPTY slot was never full, so no probe passed
+       through it and the slot can be EMPTY again */
+    group_start = index - (index % FC_FLAT_HASH_GROUP_SIZE);
+    if (flat_hash_group_match(table->ctrls + group_start,
+                FC_FLAT_HASH_CTRL_EMPTY) != 0)
+    {
+        table->ctrls[index] = FC_FLAT_HASH_CTRL_EMPTY;
+        table->growth_left++;
+    } else {
+        table->ctrls[index] = FC_FLAT_HASH_CTRL_DELETED;
+        table->deleted_count++;
+    }
+    table->item_count--;
+    return 0;
+}
+
+int fc_flat_hash_walk(FCFlatHashTable *table,
+        FlatHashWalkFunc walkFunc, void *args)
+{
+    FCFlatHashSlotHeader *header;
+    int64_t index;
+    int64_t i;
+    int result;
+
+    index = 0;
+    for (i=0; i<table->capacity; i++) {
+        if (table->ctrls[i] < 0) {
+            continue;
+        }
+
+        header = (FCFlatHashSlotHeader *)FLAT_HASH_SLOT(table, i);
+        if ((result=walkFunc(index++, FLAT_HASH_SLOT_KEY(header),
+                        header->key_len, FLAT_HASH_SLOT_VALUE(table, header),
+                        header->value_len, args)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
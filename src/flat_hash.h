@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//flat_hash.h
+
+/* open addressing hash table with SwissTable style control bytes.
+   the slots are grouped by 16, every slot has one control byte which is
+   EMPTY, DELETED or the low 7 bits of the hash code, so one SSE2 compare
+   filters the whole group. the keys and the values are stored inline
+   in the slots with the fixed max sizes */
+
+#ifndef _FLAT_HASH_H_
+#define _FLAT_HASH_H_
+
+#include "common_define.h"
+#include "hash.h"
+
+#define FC_FLAT_HASH_GROUP_SIZE  16
+
+#define FC_FLAT_HASH_CTRL_EMPTY    ((signed char)-128)  //0x80
+#define FC_FLAT_HASH_CTRL_DELETED  ((signed char)-2)    //0xFE
+
+typedef struct fc_flat_hash_slot_header
+{
+    int key_len;
+    int value_len;
+} FCFlatHashSlotHeader;
+
+typedef struct fc_flat_hash_table
+{
+    signed char *ctrls;  //the control bytes, one per slot
+    char *slots;
+    HashFunc hash_func;
+    int key_size;     //the max key length
+    int value_size;   //the max value length
+    int value_offset; //the offset of the value in the slot
+    int slot_size;
+    int64_t capacity;  //the slot count, multiple of the group size
+    int64_t group_mask;
+    int64_t item_count;
+    int64_t deleted_count;
+    int64_t growth_left;  //the count can insert before rehash
+    double load_factor;
+} FCFlatHashTable;
+
+/**
+ * flat hash walk function
+ * parameters:
+ *         index: item index based 0
+ *         key: the key
+ *         key_len: the key length
+ *         value: the value
+ *         value_len: the value length
+ *         args: passed by fc_flat_hash_walk function
+ * return 0 for success, != 0 for error
+*/
+typedef int (*FlatHashWalkFunc)(const int64_t index, const void *key,
+        const int key_len, void *value, const int value_len, void *args);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define fc_flat_hash_init(table, hash_func, key_size, value_size, capacity) \
+    fc_flat_hash_init_ex(table, hash_func, key_size, value_size, capacity, 0)
+
+/**
+ * flat hash init function
+ * parameters:
+ *         table: the hash table
+ *         hash_func: hash function
+ *         key_size: the max key length
+ *         value_size: the max value length
+ *         capacity: init capacity
+ *         load_factor: the max load factor, 0 for default 0.875
+ * return 0 for success, != 0 for error
+*/
+int fc_flat_hash_init_ex(FCFlatHashTable *table, HashFunc hash_func,
+        const int key_size, const int value_size, const int64_t capacity,
+        const double load_factor);
+
+/**
+ * flat hash destroy function
+ * parameters:
+ *         table: the hash table
+ * return none
+*/
+void fc_flat_hash_destroy(FCFlatHashTable *table);
+
+/**
+ * remove all items
+ * parameters:
+ *         table: the hash table
+ * return none
+*/
+void fc_flat_hash_clear(FCFlatHashTable *table);
+
+/**
+ * flat hash insert key, the value is copied into the slot
+ * parameters:
+ *         table: the hash table
+ *         key: the key to insert
+ *         key_len: length of th key, <= key_size
+ *         value: the value
+ *         value_len: length of the value, <= value_size
+ * return >= 0 for success, 0 for key already exist (update),
+ *        1 for new key (insert), < 0 for error
+*/
+int fc_flat_hash_insert_ex(FCFlatHashTable *table, const void *key,
+        const int key_len, const void *value, const int value_len);
+
+/**
+ * flat hash find key
+ * parameters:
+ *         table: the hash table
+ *         key: the key to find
+ *         key_len: length of th key
+ * return the value in the slot, return NULL when the key not exist
+*/
+void *fc_flat_hash_find(FCFlatHashTable *table,
+        const void *key, const int key_len);
+
+/**
+ * flat hash get the value of the key
+ * parameters:
+ *         table: the hash table
+ *         key: the key to find
+ *         key_len: length of th key
+ *         value: store the value
+ *         value_len: input for the max size of the value
+ *                    output for the length fo the value
+ * return 0 for success, != 0 fail (errno)
+*/
+int fc_flat_hash_get(FCFlatHashTable *table, const void *key,
+        const int key_len, void *value, int *value_len);
+
+/**
+ * flat hash delete key
+ * parameters:
+ *         table: the hash table
+ *         key: the key to delete
+ *         key_len: length of th key
+ * return 0 for success, != 0 fail (errno)
+*/
+int fc_flat_hash_delete(FCFlatHashTable *table,
+        const void *key, const int key_len);
+
+/**
+ * flat hash walk (iterator)
+ * parameters:
+ *         table: the hash table
+ *         walkFunc: walk (interator) function
+ *         args: extra args which will be passed to walkFunc
+ * return 0 for success, != 0 fail (errno)
+*/
+int fc_flat_hash_walk(FCFlatHashTable *table,
+        FlatHashWalkFunc walkFunc, void *args);
+
+static inline int64_t fc_flat_hash_count(FCFlatHashTable *table)
+{
+    return table->item_count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,6 +20,7 @@
 #include <inttypes.h>
 #include "pthread_func.h"
 #include "fc_memory.h"
+#include "sched_thread.h"
 #include "hash.h"
 
 static unsigned int prime_array[] = {
@@ -146,7 +147,7 @@ int fc_hash_set_locks(HashArray *pHash, const int lock_count)
 	}
 
     //do NOT support rehash
-	if (pHash->load_factor >= 0.10)
+	if (pHash->load_factor >= 0.10 || pHash->rehash.step > 0)
 	{
 		return EINVAL;
 	}
@@ -168,20 +169,16 @@ int fc_hash_set_locks(HashArray *pHash, const int lock_count)
 	return 0;
 }
 
-void fc_hash_destroy(HashArray *pHash)
+static void _hash_free_buckets(HashData **buckets,
+		const unsigned int capacity)
 {
 	HashData **ppBucket;
 	HashData **bucket_end;
 	HashData *pNode;
 	HashData *pDelete;
 
-	if (pHash == NULL || pHash->buckets == NULL)
-	{
-		return;
-	}
-
-	bucket_end = pHash->buckets + (*pHash->capacity);
-	for (ppBucket=pHash->buckets; ppBucket<bucket_end; ppBucket++)
+	bucket_end = buckets + capacity;
+	for (ppBucket=buckets; ppBucket<bucket_end; ppBucket++)
 	{
 		pNode = *ppBucket;
 		while (pNode != NULL)
@@ -192,14 +189,48 @@ void fc_hash_destroy(HashArray *pHash)
 		}
 	}
 
-	free(pHash->buckets);
+	free(buckets);
+}
+
+void fc_hash_destroy(HashArray *pHash)
+{
+	if (pHash == NULL || pHash->buckets == NULL)
+	{
+		return;
+	}
+
+	_hash_free_buckets(pHash->buckets, *pHash->capacity);
 	pHash->buckets = NULL;
+	if (pHash->rehash.old_buckets != NULL)
+	{
+		_hash_free_buckets(pHash->rehash.old_buckets,
+				pHash->rehash.old_capacity);
+		pHash->rehash.old_buckets = NULL;
+		pHash->rehash.old_capacity = 0;
+		pHash->rehash.index = 0;
+	}
 	if (pHash->is_malloc_capacity)
 	{
 		free(pHash->capacity);
 		pHash->capacity = NULL;
 		pHash->is_malloc_capacity = false;
 	}
+	if (pHash->locks != NULL)
+	{
+		unsigned int i;
+		for (i=0; i<pHash->lock_count; i++)
+		{
+			pthread_mutex_destroy(pHash->locks + i);
+		}
+		free(pHash->locks);
+		pHash->locks = NULL;
+		pHash->lock_count = 0;
+	}
+	if (pHash->cache.enabled)
+	{
+		pthread_mutex_destroy(&pHash->cache.lock);
+		pHash->cache.enabled = false;
+	}
 
 	pHash->item_count = 0;
 	pHash->bytes_used = 0;
@@ -237,24 +268,101 @@ void fc_hash_destroy(HashArray *pHash)
 		pthread_mutex_unlock(pHash->locks + (index) % pHash->lock_count); \
 	}
 
+#define HASH_REHASH_STEP(pHash) \
+	if (pHash->rehash.old_buckets != NULL) \
+	{ \
+		_rehash_migrate(pHash, pHash->rehash.step); \
+	}
 
-int fc_hash_stat(HashArray *pHash, HashStat *pStat, \
-		int *stat_by_lens, const int stat_size)
+/* move the chains of the old buckets to the new buckets, at most
+   bucket_count non-empty buckets and 10 * bucket_count empty buckets */
+static void _rehash_migrate(HashArray *pHash, const int bucket_count)
+{
+	HashData **ppBucket;
+	HashData **ppNewBucket;
+	HashData *hash_data;
+	HashData *pNext;
+	int64_t empty_visits;
+	int count;
+
+	count = bucket_count;
+	empty_visits = 10 * (int64_t)bucket_count;
+	while (count > 0 && pHash->rehash.index < pHash->rehash.old_capacity)
+	{
+		ppBucket = pHash->rehash.old_buckets + pHash->rehash.index++;
+		if (*ppBucket == NULL)
+		{
+			if (--empty_visits == 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		hash_data = *ppBucket;
+		while (hash_data != NULL)
+		{
+			pNext = hash_data->next;
+			ppNewBucket = pHash->buckets + (HASH_CODE(pHash,
+						hash_data) % (*pHash->capacity));
+			hash_data->next = *ppNewBucket;
+			*ppNewBucket = hash_data;
+			hash_data = pNext;
+		}
+		*ppBucket = NULL;
+		count--;
+	}
+
+	if (pHash->rehash.index >= pHash->rehash.old_capacity)
+	{
+		free(pHash->rehash.old_buckets);
+		pHash->bytes_used -= sizeof(HashData *) *
+			pHash->rehash.old_capacity;
+		pHash->rehash.old_buckets = NULL;
+		pHash->rehash.old_capacity = 0;
+		pHash->rehash.index = 0;
+	}
+}
+
+static inline void _rehash_finish(HashArray *pHash)
+{
+	if (pHash->rehash.old_buckets != NULL)
+	{
+		_rehash_migrate(pHash, pHash->rehash.old_capacity);
+	}
+}
+
+/* the not migrated old bucket when rehashing, otherwise the new bucket.
+   index: return the bucket index in its own bucket array for the lock */
+static inline HashData **_hash_get_bucket(HashArray *pHash,
+		const unsigned int hash_code, unsigned int *index)
+{
+	if (pHash->rehash.old_buckets != NULL)
+	{
+		*index = hash_code % pHash->rehash.old_capacity;
+		if (*index >= pHash->rehash.index)
+		{
+			return pHash->rehash.old_buckets + *index;
+		}
+	}
+
+	*index = hash_code % (*pHash->capacity);
+	return pHash->buckets + *index;
+}
+
+
+static int _hash_stat_buckets(HashData **buckets, const unsigned int capacity,
+		HashStat *pStat, int *stat_by_lens, const int stat_size)
 {
 	HashData **ppBucket;
 	HashData **bucket_end;
 	HashData *hash_data;
-	int totalLength;
 	int last;
 	int count;
-	int i;
 
-	memset(stat_by_lens, 0, sizeof(int) * stat_size);
-	pStat->bucket_max_length = 0;
-	pStat->bucket_used = 0;
 	last = stat_size - 1;
-	bucket_end = pHash->buckets + (*pHash->capacity);
-	for (ppBucket=pHash->buckets; ppBucket<bucket_end; ppBucket++)
+	bucket_end = buckets + capacity;
+	for (ppBucket=buckets; ppBucket<bucket_end; ppBucket++)
 	{
 		if (*ppBucket == NULL)
 		{
@@ -282,6 +390,43 @@ int fc_hash_stat(HashArray *pHash, HashStat *pStat, \
 		}
 	}
 
+	return 0;
+}
+
+int fc_hash_stat(HashArray *pHash, HashStat *pStat, \
+		int *stat_by_lens, const int stat_size)
+{
+	int totalLength;
+	int result;
+	int i;
+
+	memset(stat_by_lens, 0, sizeof(int) * stat_size);
+	pStat->bucket_max_length = 0;
+	pStat->bucket_used = 0;
+	if ((result=_hash_stat_buckets(pHash->buckets, *pHash->capacity,
+					pStat, stat_by_lens, stat_size)) != 0)
+	{
+		return result;
+	}
+
+	if (pHash->rehash.old_buckets != NULL)
+	{
+		//the migrated old buckets are empty
+		if ((result=_hash_stat_buckets(pHash->rehash.old_buckets,
+						pHash->rehash.old_capacity, pStat,
+						stat_by_lens, stat_size)) != 0)
+		{
+			return result;
+		}
+		pStat->rehash_old_capacity = pHash->rehash.old_capacity;
+		pStat->rehash_migrated = pHash->rehash.index;
+	}
+	else
+	{
+		pStat->rehash_old_capacity = 0;
+		pStat->rehash_migrated = 0;
+	}
+
 	totalLength = 0;
 	for (i=0; i<=pStat->bucket_max_length; i++)
 	{
@@ -325,6 +470,13 @@ void fc_hash_stat_print(HashArray *pHash)
 		hs.capacity, hs.item_count, hs.bucket_used,
 		hs.bucket_avg_length, hs.bucket_max_length, 
 		(double)hs.bucket_used*100.00/(double)hs.capacity);
+	if (hs.rehash_old_capacity > 0)
+	{
+		printf("rehashing, old capacity: %u, migrated: %u (%.2f%%)\n",
+			hs.rehash_old_capacity, hs.rehash_migrated,
+			(double)hs.rehash_migrated * 100.00 /
+			(double)hs.rehash_old_capacity);
+	}
 }
 
 static int _rehash1(HashArray *pHash, const int old_capacity, \
@@ -407,6 +559,89 @@ static int _rehash(HashArray *pHash)
 	return result;
 }
 
+/* alloc the new buckets and keep the old buckets for migration */
+static int _rehash_start(HashArray *pHash)
+{
+	int result;
+	unsigned int *pOldCapacity;
+	HashData **old_buckets;
+
+	_rehash_finish(pHash);
+	pOldCapacity = pHash->capacity;
+	if (pHash->is_malloc_capacity)
+	{
+		pHash->capacity = fc_hash_get_prime_capacity(*pOldCapacity);
+	}
+	else if (pHash->capacity + 1 < prime_array + PRIME_ARRAY_SIZE)
+	{
+		pHash->capacity++;
+	}
+	else
+	{
+		pHash->capacity = NULL;
+	}
+	if (pHash->capacity == NULL)
+	{
+		pHash->capacity = pOldCapacity;
+		return ENOSPC;
+	}
+
+	old_buckets = pHash->buckets;
+	if ((result=_hash_alloc_buckets(pHash, 0)) != 0)
+	{
+		pHash->buckets = old_buckets;
+		pHash->capacity = pOldCapacity;  //rollback
+		return result;
+	}
+
+	pHash->rehash.old_buckets = old_buckets;
+	pHash->rehash.old_capacity = *pOldCapacity;
+	pHash->rehash.index = 0;
+	if (pHash->is_malloc_capacity)
+	{
+		free(pOldCapacity);
+		pHash->is_malloc_capacity = false;
+	}
+
+	_rehash_migrate(pHash, pHash->rehash.step);
+	return 0;
+}
+
+int fc_hash_set_incremental_rehash(HashArray *pHash, const int step)
+{
+	if (step < 0)
+	{
+		return EINVAL;
+	}
+
+	//the migration moves the chains without the bucket locks
+	if (step > 0 && pHash->lock_count > 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"can't set incremental rehash with the locks, "
+			"lock count: %u", __LINE__, pHash->lock_count);
+		return EOPNOTSUPP;
+	}
+
+	pHash->rehash.step = step;
+	if (step == 0)
+	{
+		_rehash_finish(pHash);
+	}
+	return 0;
+}
+
+bool fc_hash_rehash_step(HashArray *pHash, const int bucket_count)
+{
+	if (pHash->rehash.old_buckets == NULL)
+	{
+		return false;
+	}
+
+	_rehash_migrate(pHash, bucket_count);
+	return pHash->rehash.old_buckets != NULL;
+}
+
 static int _hash_conflict_count(HashArray *pHash)
 {
 	HashData **ppBucket;
@@ -463,6 +698,7 @@ int fc_hash_best_op(HashArray *pHash, const int suggest_capacity)
 	unsigned int *new_capacity;
 	int result;
 
+	_rehash_finish(pHash);
 	if ((conflict_count=_hash_conflict_count(pHash)) == 0)
 	{
 		return 0;
@@ -537,18 +773,224 @@ static HashData *_chain_find_entry(HashData **ppBucket, const void *key, \
 	return NULL;
 }
 
+#define HASH_CACHE_NOW(pHash) \
+	((int64_t)(get_current_time() - pHash->cache.base_time))
+
+/* cache mode: the expired item is treated as not exist,
+   set the reference bit of CLOCK and count the hits and the misses */
+static inline HashData *_hash_cache_access(HashArray *pHash,
+		HashData *hash_data)
+{
+	if (!pHash->cache.enabled)
+	{
+		return hash_data;
+	}
+
+	if (hash_data != NULL && hash_data->expires != 0 &&
+		HASH_CACHE_NOW(pHash) >= hash_data->expires)
+	{
+		hash_data = NULL;
+	}
+
+	if (hash_data != NULL)
+	{
+		if (!hash_data->referenced)
+		{
+			hash_data->referenced = 1;
+		}
+		__sync_add_and_fetch(&pHash->cache.stat.hits, 1);
+	}
+	else
+	{
+		__sync_add_and_fetch(&pHash->cache.stat.misses, 1);
+	}
+
+	return hash_data;
+}
+
+/* the expires is 31 bits, the too large TTL is clamped to the max */
+static inline unsigned int _hash_cache_expires(HashArray *pHash,
+		const int ttl)
+{
+	int64_t expires;
+
+	if (!pHash->cache.enabled || ttl <= 0)
+	{
+		return 0;
+	}
+
+	expires = HASH_CACHE_NOW(pHash) + ttl;
+	return (expires < FC_HASH_CACHE_MAX_EXPIRES ? expires :
+			FC_HASH_CACHE_MAX_EXPIRES);
+}
+
+/* the bucket of the CLOCK hand, the not migrated old buckets
+   follow the new buckets when rehashing.
+   index: return the bucket index in its own bucket array for the lock */
+static inline HashData **_hash_cache_hand_bucket(HashArray *pHash,
+		const unsigned int hand, unsigned int *index)
+{
+	if (hand < *pHash->capacity)
+	{
+		*index = hand;
+		return pHash->buckets + hand;
+	}
+
+	*index = hand - *pHash->capacity;
+	if (pHash->rehash.old_buckets != NULL && *index >=
+			pHash->rehash.index && *index <
+			pHash->rehash.old_capacity)
+	{
+		return pHash->rehash.old_buckets + *index;
+	}
+	return NULL;
+}
+
+/* evict the items by CLOCK until the need bytes available,
+   the busy buckets are skipped to avoid dead lock */
+static int _hash_cache_evict(HashArray *pHash, const int need_bytes)
+{
+	HashData **ppBucket;
+	HashData *hash_data;
+	HashData *previous;
+	HashData *pNext;
+	int64_t now;
+	int64_t visits;
+	int64_t max_visits;
+	unsigned int ring_size;
+	unsigned int hand;
+	unsigned int bucket_index;
+	int reason;
+	bool locked;
+
+	if (pHash->lock_count > 0)
+	{
+		pthread_mutex_lock(&pHash->cache.lock);
+	}
+
+	now = HASH_CACHE_NOW(pHash);
+	ring_size = *pHash->capacity;
+	if (pHash->rehash.old_buckets != NULL)
+	{
+		ring_size += pHash->rehash.old_capacity;
+	}
+
+	//the reference bits are cleared in the first round
+	max_visits = 2 * (int64_t)ring_size;
+	for (visits=0; visits<max_visits && pHash->bytes_used +
+			need_bytes > pHash->max_bytes; visits++)
+	{
+		hand = pHash->cache.hand++ % ring_size;
+		if ((ppBucket=_hash_cache_hand_bucket(pHash, hand,
+						&bucket_index)) == NULL ||
+				*ppBucket == NULL)
+		{
+			continue;
+		}
+
+		locked = false;
+		if (pHash->lock_count > 0)
+		{
+			if (pthread_mutex_trylock(pHash->locks +
+					bucket_index % pHash->lock_count) != 0)
+			{
+				continue;
+			}
+			locked = true;
+		}
+
+		previous = NULL;
+		hash_data = *ppBucket;
+		while (hash_data != NULL)
+		{
+			pNext = hash_data->next;
+			if (hash_data->expires != 0 && now >= hash_data->expires)
+			{
+				reason = FC_HASH_EVICT_REASON_EXPIRED;
+				__sync_add_and_fetch(&pHash->cache.stat.expirations, 1);
+			}
+			else if (hash_data->referenced)
+			{
+				hash_data->referenced = 0;
+				previous = hash_data;
+				hash_data = pNext;
+				continue;
+			}
+			else
+			{
+				reason = FC_HASH_EVICT_REASON_CAPACITY;
+				__sync_add_and_fetch(&pHash->cache.stat.evictions, 1);
+			}
+
+			if (pHash->cache.evict_func != NULL)
+			{
+				pHash->cache.evict_func(hash_data, reason,
+						pHash->cache.evict_args);
+			}
+			DELETE_FROM_BUCKET(pHash, ppBucket, previous, hash_data)
+			hash_data = pNext;
+		}
+
+		if (locked)
+		{
+			pthread_mutex_unlock(pHash->locks +
+					bucket_index % pHash->lock_count);
+		}
+	}
+
+	if (pHash->lock_count > 0)
+	{
+		pthread_mutex_unlock(&pHash->cache.lock);
+	}
+
+	return (pHash->bytes_used + need_bytes > pHash->max_bytes) ? ENOSPC : 0;
+}
+
+int fc_hash_set_cache_mode(HashArray *pHash, const int default_ttl,
+		HashEvictFunc evict_func, void *evict_args)
+{
+	int result;
+
+	if (pHash->max_bytes <= 0 || default_ttl < 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"invalid max_bytes: %"PRId64" or default_ttl: %d",
+			__LINE__, pHash->max_bytes, default_ttl);
+		return EINVAL;
+	}
+
+	if (!pHash->cache.enabled)
+	{
+		if ((result=init_pthread_lock(&pHash->cache.lock)) != 0)
+		{
+			return result;
+		}
+		//the relative time starts from 1, 0 of expires for never
+		pHash->cache.base_time = get_current_time() - 1;
+		pHash->cache.enabled = true;
+	}
+
+	pHash->cache.default_ttl = default_ttl;
+	pHash->cache.evict_func = evict_func;
+	pHash->cache.evict_args = evict_args;
+	return 0;
+}
+
 HashData *fc_hash_find_ex(HashArray *pHash, const void *key, const int key_len)
 {
 	unsigned int hash_code;
 	HashData **ppBucket;
+	unsigned int bucket_index;
 	HashData *hash_data;
 
+	HASH_REHASH_STEP(pHash)
 	hash_code = pHash->hash_func(key, key_len);
-	ppBucket = pHash->buckets + (hash_code % (*pHash->capacity));
+	ppBucket = _hash_get_bucket(pHash, hash_code, &bucket_index);
 
-	HASH_LOCK(pHash, ppBucket - pHash->buckets)
-	hash_data = _chain_find_entry(ppBucket, key, key_len, hash_code);
-	HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+	HASH_LOCK(pHash, bucket_index)
+	hash_data = _hash_cache_access(pHash, _chain_find_entry(
+				ppBucket, key, key_len, hash_code));
+	HASH_UNLOCK(pHash, bucket_index)
 
 	return hash_data;
 }
@@ -557,14 +999,17 @@ void *fc_hash_find(HashArray *pHash, const void *key, const int key_len)
 {
 	unsigned int hash_code;
 	HashData **ppBucket;
+	unsigned int bucket_index;
 	HashData *hash_data;
 
+	HASH_REHASH_STEP(pHash)
 	hash_code = pHash->hash_func(key, key_len);
-	ppBucket = pHash->buckets + (hash_code % (*pHash->capacity));
+	ppBucket = _hash_get_bucket(pHash, hash_code, &bucket_index);
 
-	HASH_LOCK(pHash, ppBucket - pHash->buckets)
-	hash_data = _chain_find_entry(ppBucket, key, key_len, hash_code);
-	HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+	HASH_LOCK(pHash, bucket_index)
+	hash_data = _hash_cache_access(pHash, _chain_find_entry(
+				ppBucket, key, key_len, hash_code));
+	HASH_UNLOCK(pHash, bucket_index)
 
 	if (hash_data != NULL)
 	{
@@ -600,13 +1045,16 @@ int fc_hash_get(HashArray *pHash, const void *key, const int key_len,
 	unsigned int hash_code;
 	int result;
 	HashData **ppBucket;
+	unsigned int bucket_index;
 	HashData *hash_data;
 
+	HASH_REHASH_STEP(pHash)
 	hash_code = pHash->hash_func(key, key_len);
-	ppBucket = pHash->buckets + (hash_code % (*pHash->capacity));
+	ppBucket = _hash_get_bucket(pHash, hash_code, &bucket_index);
 
-	HASH_LOCK(pHash, ppBucket - pHash->buckets)
-	hash_data = _chain_find_entry(ppBucket, key, key_len, hash_code);
+	HASH_LOCK(pHash, bucket_index)
+	hash_data = _hash_cache_access(pHash, _chain_find_entry(
+				ppBucket, key, key_len, hash_code));
 	if (hash_data != NULL)
 	{
 		if (hash_data->value_len <= *value_len)
@@ -624,29 +1072,46 @@ int fc_hash_get(HashArray *pHash, const void *key, const int key_len,
 	{
 		result = ENOENT;
 	}
-	HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+	HASH_UNLOCK(pHash, bucket_index)
 	return result;
 }
 
 int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 		void *value, const int value_len, const bool needLock)
+{
+	return fc_hash_insert_with_ttl(pHash, key, key_len, value, value_len,
+			needLock, pHash->cache.default_ttl);
+}
+
+int fc_hash_insert_with_ttl(HashArray *pHash, const void *key,
+		const int key_len, void *value, const int value_len,
+		const bool needLock, const int ttl)
 {
 	unsigned int hash_code;
 	HashData **ppBucket;
+	unsigned int bucket_index;
 	HashData *hash_data;
 	HashData *previous;
 	char *pBuff;
 	int bytes;
 	int malloc_value_size;
 
+	if (ttl < 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"invalid ttl: %d < 0", __LINE__, ttl);
+		return -EINVAL;
+	}
+
+	HASH_REHASH_STEP(pHash)
 	hash_code = pHash->hash_func(key, key_len);
-	ppBucket = pHash->buckets + (hash_code % (*pHash->capacity));
+	ppBucket = _hash_get_bucket(pHash, hash_code, &bucket_index);
 
 	previous = NULL;
 
 	if (needLock)
 	{
-		HASH_LOCK(pHash, ppBucket - pHash->buckets)
+		HASH_LOCK(pHash, bucket_index)
 	}
 
 	hash_data = *ppBucket;
@@ -668,9 +1133,10 @@ int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 		{
 			hash_data->value_len = value_len;
 			hash_data->value = (char *)value;
+			hash_data->expires = _hash_cache_expires(pHash, ttl);
 			if (needLock)
 			{
-				HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+				HASH_UNLOCK(pHash, bucket_index)
 			}
 			return 0;
 		}
@@ -682,9 +1148,10 @@ int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 			{
 				hash_data->value_len = value_len;
 				memcpy(hash_data->value, value, value_len);
+				hash_data->expires = _hash_cache_expires(pHash, ttl);
 				if (needLock)
 				{
-					HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+					HASH_UNLOCK(pHash, bucket_index)
 				}
 				return 0;
 			}
@@ -694,7 +1161,7 @@ int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 	}
 	if (needLock)
 	{
-		HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+		HASH_UNLOCK(pHash, bucket_index)
 	}
 
 	if (!pHash->is_malloc_value)
@@ -709,7 +1176,10 @@ int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 	bytes = CALC_NODE_MALLOC_BYTES(key_len, malloc_value_size);
 	if (pHash->max_bytes > 0 && pHash->bytes_used+bytes > pHash->max_bytes)
 	{
-		return -ENOSPC;
+		if (!pHash->cache.enabled || _hash_cache_evict(pHash, bytes) != 0)
+		{
+			return -ENOSPC;
+		}
 	}
 
 	pBuff = (char *)fc_malloc(bytes);
@@ -722,6 +1192,8 @@ int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 
 	hash_data = (HashData *)pBuff;
 	hash_data->malloc_value_size = malloc_value_size;
+	hash_data->expires = _hash_cache_expires(pHash, ttl);
+	hash_data->referenced = 0;
 
 	hash_data->key_len = key_len;
 	memcpy(hash_data->key, key, key_len);
@@ -742,9 +1214,9 @@ int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 
 	if (needLock)
 	{
-		HASH_LOCK(pHash, ppBucket - pHash->buckets)
+		HASH_LOCK(pHash, bucket_index)
 		ADD_TO_BUCKET(pHash, ppBucket, hash_data)
-		HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+		HASH_UNLOCK(pHash, bucket_index)
 	}
 	else
 	{
@@ -754,7 +1226,14 @@ int fc_hash_insert_ex(HashArray *pHash, const void *key, const int key_len,
 	if (pHash->load_factor >= 0.10 && (double)pHash->item_count /
 		(double)*pHash->capacity >= pHash->load_factor)
 	{
-		_rehash(pHash);
+		if (pHash->rehash.step > 0)
+		{
+			_rehash_start(pHash);
+		}
+		else
+		{
+			_rehash(pHash);
+		}
 	}
 
 	return 1;
@@ -795,13 +1274,16 @@ int fc_hash_inc_ex(HashArray *pHash, const void *key, const int key_len,
 	unsigned int hash_code;
 	int result;
 	HashData **ppBucket;
+	unsigned int bucket_index;
 	HashData *hash_data;
 
+	HASH_REHASH_STEP(pHash)
 	hash_code = pHash->hash_func(key, key_len);
-	ppBucket = pHash->buckets + (hash_code % (*pHash->capacity));
+	ppBucket = _hash_get_bucket(pHash, hash_code, &bucket_index);
 
-	HASH_LOCK(pHash, ppBucket - pHash->buckets)
-	hash_data = _chain_find_entry(ppBucket, key, key_len, hash_code);
+	HASH_LOCK(pHash, bucket_index)
+	hash_data = _hash_cache_access(pHash, _chain_find_entry(
+				ppBucket, key, key_len, hash_code));
 	convert_func(hash_data, inc, value, value_len, arg);
 	if (hash_data != NULL)
 	{
@@ -809,7 +1291,7 @@ int fc_hash_inc_ex(HashArray *pHash, const void *key, const int key_len,
 		{
 			hash_data->value_len = *value_len;
 			hash_data->value = (char *)value;
-			HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+			HASH_UNLOCK(pHash, bucket_index)
 			return 0;
 		}
 		else
@@ -818,7 +1300,7 @@ int fc_hash_inc_ex(HashArray *pHash, const void *key, const int key_len,
 			{
 				hash_data->value_len = *value_len;
 				memcpy(hash_data->value, value, *value_len);
-				HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+				HASH_UNLOCK(pHash, bucket_index)
 				return 0;
 			}
 		}
@@ -834,7 +1316,7 @@ int fc_hash_inc_ex(HashArray *pHash, const void *key, const int key_len,
 	{
 		result = 0;
 	}
-	HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+	HASH_UNLOCK(pHash, bucket_index)
 
 	return result;
 }
@@ -845,14 +1327,17 @@ int fc_hash_partial_set(HashArray *pHash, const void *key, const int key_len,
 	unsigned int hash_code;
 	int result;
 	HashData **ppBucket;
+	unsigned int bucket_index;
 	HashData *hash_data;
 	char *pNewBuff;
 
+	HASH_REHASH_STEP(pHash)
 	hash_code = pHash->hash_func(key, key_len);
-	ppBucket = pHash->buckets + (hash_code % (*pHash->capacity));
+	ppBucket = _hash_get_bucket(pHash, hash_code, &bucket_index);
 
-	HASH_LOCK(pHash, ppBucket - pHash->buckets)
-	hash_data = _chain_find_entry(ppBucket, key, key_len, hash_code);
+	HASH_LOCK(pHash, bucket_index)
+	hash_data = _hash_cache_access(pHash, _chain_find_entry(
+				ppBucket, key, key_len, hash_code));
 	do
 	{
 		if (hash_data != NULL)
@@ -906,24 +1391,26 @@ int fc_hash_partial_set(HashArray *pHash, const void *key, const int key_len,
 		}
 	} while (0);
 
-	HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+	HASH_UNLOCK(pHash, bucket_index)
 	return result;
 }
 
 int fc_hash_delete(HashArray *pHash, const void *key, const int key_len)
 {
 	HashData **ppBucket;
+	unsigned int bucket_index;
 	HashData *hash_data;
 	HashData *previous;
 	unsigned int hash_code;
 	int result;
 
+	HASH_REHASH_STEP(pHash)
 	hash_code = pHash->hash_func(key, key_len);
-	ppBucket = pHash->buckets + (hash_code % (*pHash->capacity));
+	ppBucket = _hash_get_bucket(pHash, hash_code, &bucket_index);
 
 	result = ENOENT;
 	previous = NULL;
-	HASH_LOCK(pHash, ppBucket - pHash->buckets)
+	HASH_LOCK(pHash, bucket_index)
 	hash_data = *ppBucket;
 	while (hash_data != NULL)
 	{
@@ -938,33 +1425,30 @@ int fc_hash_delete(HashArray *pHash, const void *key, const int key_len)
 		previous = hash_data;
 		hash_data = hash_data->next;
 	}
-	HASH_UNLOCK(pHash, ppBucket - pHash->buckets)
+	HASH_UNLOCK(pHash, bucket_index)
 
 	return result;
 }
 
-int fc_hash_walk(HashArray *pHash, HashWalkFunc walkFunc, void *args)
+static int _hash_walk_buckets(HashData **buckets, HashData **bucket_end,
+		HashWalkFunc walkFunc, void *args, int *index)
 {
 	HashData **ppBucket;
-	HashData **bucket_end;
 	HashData *hash_data;
-	int index;
 	int result;
 
-	index = 0;
-	bucket_end = pHash->buckets + (*pHash->capacity);
-	for (ppBucket=pHash->buckets; ppBucket<bucket_end; ppBucket++)
+	for (ppBucket=buckets; ppBucket<bucket_end; ppBucket++)
 	{
 		hash_data = *ppBucket;
 		while (hash_data != NULL)
 		{
-			result = walkFunc(index, hash_data, args);
+			result = walkFunc(*index, hash_data, args);
 			if (result != 0)
 			{
 				return result;
 			}
 
-			index++;
+			(*index)++;
 			hash_data = hash_data->next;
 		}
 	}
@@ -972,6 +1456,28 @@ int fc_hash_walk(HashArray *pHash, HashWalkFunc walkFunc, void *args)
 	return 0;
 }
 
+int fc_hash_walk(HashArray *pHash, HashWalkFunc walkFunc, void *args)
+{
+	int index;
+	int result;
+
+	index = 0;
+	if ((result=_hash_walk_buckets(pHash->buckets, pHash->buckets +
+					(*pHash->capacity), walkFunc, args, &index)) != 0)
+	{
+		return result;
+	}
+
+	if (pHash->rehash.old_buckets != NULL)
+	{
+		return _hash_walk_buckets(pHash->rehash.old_buckets +
+				pHash->rehash.index, pHash->rehash.old_buckets +
+				pHash->rehash.old_capacity, walkFunc, args, &index);
+	}
+
+	return 0;
+}
+
 int fc_hash_count(HashArray *pHash)
 {
 	return pHash->item_count;
@@ -1326,96 +1832,491 @@ int fc_simple_hash_ex(const void* key, const int key_len, \
 	SIMPLE_HASH_FUNC(init_value)
 }
 
-static unsigned int crc_table[256] = {
-	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
-	0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-	0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
-	0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE,
-	0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,
-	0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-	0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-	0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940,
-	0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116,
-	0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-	0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
-	0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A,
-	0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818,
-	0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
-	0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-	0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C,
-	0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2,
-	0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-	0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-	0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086,
-	0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4,
-	0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
-	0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-	0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8,
-	0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE,
-	0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-	0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
-	0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252,
-	0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60,
-	0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-	0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-	0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04,
-	0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A,
-	0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-	0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
-	0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E,
-	0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C,
-	0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
-	0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-	0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0,
-	0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6,
-	0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-	0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-	0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
-};
+/* the tables for slicing-by-8, the first row is the byte-at-a-time table */
+typedef struct {
+	pthread_once_t once;
+	unsigned int crc32[8][256];
+	unsigned int crc32c[8][256];
+	unsigned int crc32_x2n[32];   //x^(2^n) mod P for the combine
+	unsigned int crc32c_x2n[32];
+	bool crc32c_hw;  //SSE 4.2 crc32 instruction available
+	volatile bool inited;
+} CRC32Tables;
+
+static CRC32Tables crc_tables = {PTHREAD_ONCE_INIT};
+
+#define CRC32_POLY   0xEDB88320  /* reversed 0x04C11DB7 */
+#define CRC32C_POLY  0x82F63B78  /* reversed 0x1EDC6F41, Castagnoli */
+
+/* multiply a(x) by b(x) modulo P(x), in the reflected representation */
+static unsigned int crc32_multmodp(unsigned int a, unsigned int b,
+		const unsigned int poly)
+{
+	unsigned int m;
+	unsigned int p;
 
-#define CRC32_BODY(init_value) \
-	unsigned char *pKey; \
-	unsigned char *pEnd; \
-	int64_t crc; \
- \
-	crc = init_value; \
-	pEnd = (unsigned char *)key + key_len; \
-	for (pKey = (unsigned char *)key; pKey != pEnd; pKey++) \
+	m = 1U << 31;
+	p = 0;
+	while (1)
+	{
+		if ((a & m) != 0)
+		{
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+			{
+				break;
+			}
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+	}
+
+	return p;
+}
+
+static void crc32_init_slice_tables(unsigned int tables[8][256],
+		unsigned int *x2n_table, const unsigned int poly)
+{
+	unsigned int crc;
+	unsigned int p;
+	int i;
+	int k;
+
+	for (i=0; i<256; i++)
+	{
+		crc = i;
+		for (k=0; k<8; k++)
+		{
+			crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+		}
+		tables[0][i] = crc;
+	}
+
+	for (i=0; i<256; i++)
+	{
+		crc = tables[0][i];
+		for (k=1; k<8; k++)
+		{
+			crc = tables[0][crc & 0xFF] ^ (crc >> 8);
+			tables[k][i] = crc;
+		}
+	}
+
+	p = 1U << 30;  //x^1
+	x2n_table[0] = p;
+	for (i=1; i<32; i++)
+	{
+		p = crc32_multmodp(p, p, poly);
+		x2n_table[i] = p;
+	}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32C_SSE42_ENABLED 1
+#include <nmmintrin.h>
+#endif
+
+static void crc32_init_tables()
+{
+	crc32_init_slice_tables(crc_tables.crc32,
+			crc_tables.crc32_x2n, CRC32_POLY);
+	crc32_init_slice_tables(crc_tables.crc32c,
+			crc_tables.crc32c_x2n, CRC32C_POLY);
+
+#ifdef CRC32C_SSE42_ENABLED
+	__builtin_cpu_init();
+	crc_tables.crc32c_hw = __builtin_cpu_supports("sse4.2");
+#else
+	crc_tables.crc32c_hw = false;
+#endif
+
+	__sync_synchronize();
+	crc_tables.inited = true;
+}
+
+#define CRC32_CHECK_INIT() \
+	if (!crc_tables.inited) \
 	{ \
-		crc = crc_table[(crc ^ *pKey) & 0xFF] ^ (crc >> 8); \
-	} \
+		pthread_once(&crc_tables.once, crc32_init_tables); \
+	}
 
-int CRC32(const void *key, const int key_len)
+static inline uint64_t hash_read64(const unsigned char *p)
 {
-	CRC32_BODY(CRC32_XINIT)
+	uint64_t v;
+	memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline uint32_t hash_read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+
+/* slicing-by-8: eight table lookups for every 8 bytes */
+static unsigned int crc32_slice8(unsigned int tables[8][256],
+		unsigned int crc, const void *key, const int key_len)
+{
+	const unsigned char *p;
+	const unsigned char *pEnd;
+	uint64_t word;
 
-	return (int)(crc ^ CRC32_XOROT);
+	p = (const unsigned char *)key;
+	pEnd = p + key_len;
+	while (p + 8 <= pEnd)
+	{
+		word = hash_read64(p) ^ crc;
+		crc = tables[7][word & 0xFF] ^
+			tables[6][(word >> 8) & 0xFF] ^
+			tables[5][(word >> 16) & 0xFF] ^
+			tables[4][(word >> 24) & 0xFF] ^
+			tables[3][(word >> 32) & 0xFF] ^
+			tables[2][(word >> 40) & 0xFF] ^
+			tables[1][(word >> 48) & 0xFF] ^
+			tables[0][word >> 56];
+		p += 8;
+	}
+
+	while (p < pEnd)
+	{
+		crc = tables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+int CRC32(const void *key, const int key_len)
+{
+	CRC32_CHECK_INIT();
+	return (int)(crc32_slice8(crc_tables.crc32, CRC32_XINIT,
+				key, key_len) ^ CRC32_XOROT);
 }
 
 int64_t CRC32_ex(const void *key, const int key_len, \
 	const int64_t init_value)
 {
-	CRC32_BODY(init_value)
+	CRC32_CHECK_INIT();
+	return crc32_slice8(crc_tables.crc32, (unsigned int)init_value,
+			key, key_len);
+}
+
+#ifdef CRC32C_SSE42_ENABLED
+__attribute__((target("sse4.2")))
+static unsigned int crc32c_sse42(unsigned int crc,
+		const void *key, const int key_len)
+{
+	const unsigned char *p;
+	const unsigned char *pEnd;
+
+	p = (const unsigned char *)key;
+	pEnd = p + key_len;
+#ifdef __x86_64__
+	{
+		uint64_t crc64;
+		uint64_t word;
+
+		crc64 = crc;
+		while (p + 8 <= pEnd)
+		{
+			memcpy(&word, p, 8);
+			crc64 = _mm_crc32_u64(crc64, word);
+			p += 8;
+		}
+		crc = (unsigned int)crc64;
+	}
+#endif
+
+	while (p + 4 <= pEnd)
+	{
+		crc = _mm_crc32_u32(crc, hash_read32(p));
+		p += 4;
+	}
+	while (p < pEnd)
+	{
+		crc = _mm_crc32_u8(crc, *p++);
+	}
 
 	return crc;
 }
+#endif
+
+static inline unsigned int crc32c_update(unsigned int crc,
+		const void *key, const int key_len)
+{
+	CRC32_CHECK_INIT();
+#ifdef CRC32C_SSE42_ENABLED
+	if (crc_tables.crc32c_hw)
+	{
+		return crc32c_sse42(crc, key, key_len);
+	}
+#endif
+	return crc32_slice8(crc_tables.crc32c, crc, key, key_len);
+}
+
+int CRC32C(const void *key, const int key_len)
+{
+	return (int)(crc32c_update(CRC32_XINIT, key, key_len) ^ CRC32_XOROT);
+}
+
+int64_t CRC32C_ex(const void *key, const int key_len, \
+	const int64_t init_value)
+{
+	return crc32c_update((unsigned int)init_value, key, key_len);
+}
+
+bool CRC32C_hardware_enabled()
+{
+	CRC32_CHECK_INIT();
+	return crc_tables.crc32c_hw;
+}
+
+/* x^(len2 * 8) mod P, then crc1 * x^(len2 * 8) + crc2 */
+static unsigned int crc32_combine_ex(const unsigned int *x2n_table,
+		const unsigned int poly, const unsigned int crc1,
+		const unsigned int crc2, int64_t len2)
+{
+	unsigned int p;
+	int k;
+
+	p = 1U << 31;  //x^0
+	k = 3;         //x^(2^3), one byte
+	while (len2 > 0)
+	{
+		if ((len2 & 1) != 0)
+		{
+			p = crc32_multmodp(x2n_table[k & 31], p, poly);
+		}
+		len2 >>= 1;
+		k++;
+	}
+
+	return crc32_multmodp(p, crc1, poly) ^ crc2;
+}
+
+int CRC32_combine(const int crc1, const int crc2, const int64_t len2)
+{
+	CRC32_CHECK_INIT();
+	return (int)crc32_combine_ex(crc_tables.crc32_x2n, CRC32_POLY,
+			crc1, crc2, len2);
+}
+
+int CRC32C_combine(const int crc1, const int crc2, const int64_t len2)
+{
+	CRC32_CHECK_INIT();
+	return (int)crc32_combine_ex(crc_tables.crc32c_x2n, CRC32C_POLY,
+			crc1, crc2, len2);
+}
+
+#define HASH_ROTL64(x, r)  (((x) << (r)) | ((x) >> (64 - (r))))
+
+#define XXH_PRIME64_1  0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2  0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3  0x165667B19E3779F9ULL
+#define XXH_PRIME64_4  0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5  0x27D4EB2F165667C5ULL
+
+static inline uint64_t xxh64_round(uint64_t acc, const uint64_t input)
+{
+	acc += input * XXH_PRIME64_2;
+	acc = HASH_ROTL64(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, const uint64_t val)
+{
+	acc ^= xxh64_round(0, val);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t fc_xxhash64_ex(const void *key, const int key_len,
+		const uint64_t seed)
+{
+	const unsigned char *p;
+	const unsigned char *pEnd;
+	uint64_t v1, v2, v3, v4;
+	uint64_t h;
+
+	p = (const unsigned char *)key;
+	pEnd = p + key_len;
+	if (key_len >= 32)
+	{
+		v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		v2 = seed + XXH_PRIME64_2;
+		v3 = seed;
+		v4 = seed - XXH_PRIME64_1;
+		do
+		{
+			v1 = xxh64_round(v1, hash_read64(p));
+			v2 = xxh64_round(v2, hash_read64(p + 8));
+			v3 = xxh64_round(v3, hash_read64(p + 16));
+			v4 = xxh64_round(v4, hash_read64(p + 24));
+			p += 32;
+		} while (p + 32 <= pEnd);
+
+		h = HASH_ROTL64(v1, 1) + HASH_ROTL64(v2, 7) +
+			HASH_ROTL64(v3, 12) + HASH_ROTL64(v4, 18);
+		h = xxh64_merge_round(h, v1);
+		h = xxh64_merge_round(h, v2);
+		h = xxh64_merge_round(h, v3);
+		h = xxh64_merge_round(h, v4);
+	}
+	else
+	{
+		h = seed + XXH_PRIME64_5;
+	}
+
+	h += (uint64_t)key_len;
+	while (p + 8 <= pEnd)
+	{
+		h ^= xxh64_round(0, hash_read64(p));
+		h = HASH_ROTL64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= pEnd)
+	{
+		h ^= (uint64_t)hash_read32(p) * XXH_PRIME64_1;
+		h = HASH_ROTL64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+	while (p < pEnd)
+	{
+		h ^= (*p++) * XXH_PRIME64_5;
+		h = HASH_ROTL64(h, 11) * XXH_PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+/* 64 x 64 -> 128 bits multiply, return the low and the high 64 bits */
+static inline void wy_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+	__uint128_t r;
+
+	r = *a;
+	r *= *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	uint64_t ha, hb, la, lb;
+	uint64_t rh, rm0, rm1, rl;
+	uint64_t t, lo, c;
+
+	ha = *a >> 32; hb = *b >> 32;
+	la = (uint32_t)*a; lb = (uint32_t)*b;
+	rh = ha * hb; rm0 = ha * lb; rm1 = hb * la; rl = la * lb;
+	t = rl + (rm0 << 32);
+	c = t < rl;
+	lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b)
+{
+	wy_mum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t wy_read3(const unsigned char *p, const int k)
+{
+	return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) |
+		p[k - 1];
+}
+
+static const uint64_t wy_secret[4] = {
+	0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+	0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+/* wyhash final version 4 */
+uint64_t fc_wyhash_ex(const void *key, const int key_len,
+		const uint64_t seed)
+{
+	const unsigned char *p;
+	uint64_t h;
+	uint64_t see1;
+	uint64_t see2;
+	uint64_t a;
+	uint64_t b;
+	int i;
+
+	p = (const unsigned char *)key;
+	h = seed ^ wy_mix(seed ^ wy_secret[0], wy_secret[1]);
+	if (key_len <= 16)
+	{
+		if (key_len >= 4)
+		{
+			a = ((uint64_t)hash_read32(p) << 32) |
+				hash_read32(p + ((key_len >> 3) << 2));
+			b = ((uint64_t)hash_read32(p + key_len - 4) << 32) |
+				hash_read32(p + key_len - 4 - ((key_len >> 3) << 2));
+		}
+		else if (key_len > 0)
+		{
+			a = wy_read3(p, key_len);
+			b = 0;
+		}
+		else
+		{
+			a = b = 0;
+		}
+	}
+	else
+	{
+		i = key_len;
+		if (i >= 48)
+		{
+			see1 = see2 = h;
+			do
+			{
+				h = wy_mix(hash_read64(p) ^ wy_secret[1],
+						hash_read64(p + 8) ^ h);
+				see1 = wy_mix(hash_read64(p + 16) ^ wy_secret[2],
+						hash_read64(p + 24) ^ see1);
+				see2 = wy_mix(hash_read64(p + 32) ^ wy_secret[3],
+						hash_read64(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i >= 48);
+			h ^= see1 ^ see2;
+		}
+
+		while (i > 16)
+		{
+			h = wy_mix(hash_read64(p) ^ wy_secret[1],
+					hash_read64(p + 8) ^ h);
+			i -= 16;
+			p += 16;
+		}
+		a = hash_read64(p + i - 16);
+		b = hash_read64(p + i - 8);
+	}
+
+	a ^= wy_secret[1];
+	b ^= h;
+	wy_mum(&a, &b);
+	return wy_mix(a ^ wy_secret[0] ^ (uint64_t)key_len, b ^ wy_secret[1]);
+}
+
+int fc_fast_hash(const void *key, const int key_len)
+{
+	uint64_t h;
+
+	h = fc_wyhash_ex(key, key_len, 0);
+	return (int)(h ^ (h >> 32));
+}
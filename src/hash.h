@@ -51,6 +51,8 @@ typedef struct tagHashData
 	int key_len;
 	int value_len;
 	int malloc_value_size;
+	unsigned int expires: 31;   //cache mode, relative to the base time, 0 for never
+	unsigned int referenced: 1; //cache mode, the reference bit of CLOCK
 
 #ifdef HASH_STORE_HASH_CODE
 	unsigned int hash_code;
@@ -61,6 +63,31 @@ typedef struct tagHashData
 	char key[0];
 } HashData;
 
+#define FC_HASH_EVICT_REASON_CAPACITY  1  //evicted for the max_bytes
+#define FC_HASH_EVICT_REASON_EXPIRED   2  //the TTL expired
+
+//the max expires of the 31 bits, relative to the base time
+#define FC_HASH_CACHE_MAX_EXPIRES      0x7FFFFFFF
+
+/**
+ * the callback before the cache item evicted
+ * parameters:
+ *         data: the hash data to evict
+ *         reason: FC_HASH_EVICT_REASON_CAPACITY or _EXPIRED
+ *         args: passed by fc_hash_set_cache_mode function
+ * return none
+*/
+typedef void (*HashEvictFunc)(const HashData *data,
+		const int reason, void *args);
+
+typedef struct tagHashCacheStat
+{
+	volatile int64_t hits;
+	volatile int64_t misses;
+	volatile int64_t evictions;   //for the max_bytes
+	volatile int64_t expirations; //the expired items freed
+} HashCacheStat;
+
 typedef int64_t (*ConvertValueFunc)(const HashData *old_data, const int inc,
 	char *new_value, int *new_value_len, void *arg);
 
@@ -77,6 +104,24 @@ typedef struct tagHashArray
 	bool is_malloc_value;
 	unsigned int lock_count;
 	pthread_mutex_t *locks;
+
+	struct {
+		int step;  //migrate buckets per operation, 0 for blocking rehash
+		unsigned int old_capacity;
+		unsigned int index;      //the next old bucket to migrate
+		HashData **old_buckets;  //NOT NULL when rehashing
+	} rehash;
+
+	struct {
+		bool enabled;
+		int default_ttl;  //in seconds, 0 for never expire
+		time_t base_time; //the base of the expires
+		unsigned int hand;  //the bucket index of the CLOCK hand
+		HashEvictFunc evict_func;
+		void *evict_args;
+		pthread_mutex_t lock;  //for the eviction
+		HashCacheStat stat;
+	} cache;
 } HashArray;
 
 typedef struct tagHashStat
@@ -86,6 +131,8 @@ typedef struct tagHashStat
 	int bucket_used;
 	double bucket_avg_length;
 	int bucket_max_length;
+	unsigned int rehash_old_capacity;  //0 for not rehashing
+	unsigned int rehash_migrated;  //the migrated bucket count of the old
 } HashStat;
 
 /**
@@ -127,6 +174,79 @@ int fc_hash_init_ex(HashArray *pHash, HashFunc hash_func, \
 */
 int fc_hash_set_locks(HashArray *pHash, const int lock_count);
 
+/**
+ * set incremental rehash mode. the old and the new buckets are kept side
+ * by side, every insert, find and delete migrates step buckets of the old
+ * to the new, so there is no stall of the whole rehash
+ * parameters:
+ *         pHash: the hash table
+ *         step: the bucket count to migrate per operation,
+ *               0 for blocking rehash (the default)
+ * return 0 for success, != 0 for error,
+ *        EOPNOTSUPP when step > 0 and the locks are set
+*/
+int fc_hash_set_incremental_rehash(HashArray *pHash, const int step);
+
+/**
+ * migrate the buckets of incremental rehash, such as in the idle time
+ * parameters:
+ *         pHash: the hash table
+ *         bucket_count: the max bucket count to migrate
+ * return true for rehashing yet, false for done
+*/
+bool fc_hash_rehash_step(HashArray *pHash, const int bucket_count);
+
+static inline bool fc_hash_rehashing(HashArray *pHash)
+{
+	return pHash->rehash.old_buckets != NULL;
+}
+
+/**
+ * set cache mode. when the max_bytes is reached, the insert evicts
+ * the items by CLOCK algorithm instead of failure: the lookup sets the
+ * reference bit of the item, the CLOCK hand walks the buckets, clears
+ * the reference bits and evicts the items not referenced or expired.
+ * the expired items are treated as not exist by the lookups.
+ * the TTL is based on g_current_time when the schedule thread running
+ * parameters:
+ *         pHash: the hash table, the max_bytes should be set
+ *         default_ttl: the default TTL in seconds, 0 for never expire
+ *         evict_func: the callback before eviction, can be NULL
+ *         evict_args: the args passed to evict_func
+ * return 0 for success, != 0 for error
+*/
+int fc_hash_set_cache_mode(HashArray *pHash, const int default_ttl,
+		HashEvictFunc evict_func, void *evict_args);
+
+/**
+ * hash insert key with TTL
+ * parameters:
+ *         pHash: the hash table
+ *         key: the key to insert
+ *         key_len: length of th key
+ *         value: the value
+ *         value_len: length of the value
+ *         needLock: if need lock
+ *         ttl: the TTL in seconds, 0 for never expire, the expire time
+ *              is clamped to FC_HASH_CACHE_MAX_EXPIRES (about 68 years)
+ * return >= 0 for success, 0 for key already exist (update),
+ *        1 for new key (insert), < 0 for error
+*/
+int fc_hash_insert_with_ttl(HashArray *pHash, const void *key,
+		const int key_len, void *value, const int value_len,
+		const bool needLock, const int ttl);
+
+static inline void fc_hash_get_cache_stat(HashArray *pHash,
+		HashCacheStat *stat)
+{
+	stat->hits = __sync_add_and_fetch(&pHash->cache.stat.hits, 0);
+	stat->misses = __sync_add_and_fetch(&pHash->cache.stat.misses, 0);
+	stat->evictions = __sync_add_and_fetch(
+			&pHash->cache.stat.evictions, 0);
+	stat->expirations = __sync_add_and_fetch(
+			&pHash->cache.stat.expirations, 0);
+}
+
 /**
  * convert the value
  * parameters:
@@ -393,6 +513,42 @@ int64_t CRC32_ex(const void *key, const int key_len, \
 
 #define CRC32_FINAL(crc)  (crc ^ CRC32_XOROT)
 
+/**
+ * combine the CRC32 of two adjacent chunks, such as the chunks
+ * computed in parallel
+ * parameters:
+ *         crc1: the CRC32 of the first chunk
+ *         crc2: the CRC32 of the second chunk
+ *         len2: the length of the second chunk
+ * return the CRC32 of the whole data
+*/
+int CRC32_combine(const int crc1, const int crc2, const int64_t len2);
+
+/* CRC32C (Castagnoli) with the SSE 4.2 crc32 instruction when the CPU
+   supports it, otherwise with slicing-by-8 tables.
+   use CRC32_XINIT and CRC32_FINAL for the CRC32C_ex too */
+int CRC32C(const void *key, const int key_len);
+int64_t CRC32C_ex(const void *key, const int key_len, \
+	const int64_t init_value);
+
+int CRC32C_combine(const int crc1, const int crc2, const int64_t len2);
+
+//if the SSE 4.2 crc32 instruction is used
+bool CRC32C_hardware_enabled();
+
+/* 64 bits hash functions, with good distribution and high throughput */
+uint64_t fc_xxhash64_ex(const void *key, const int key_len,
+		const uint64_t seed);
+
+uint64_t fc_wyhash_ex(const void *key, const int key_len,
+		const uint64_t seed);
+
+#define fc_xxhash64(key, key_len)  fc_xxhash64_ex(key, key_len, 0)
+#define fc_wyhash(key, key_len)    fc_wyhash_ex(key, key_len, 0)
+
+//the wyhash folded to 32 bits, can be used as the HashFunc
+int fc_fast_hash(const void *key, const int key_len);
+
 #define INIT_HASH_CODES4(hash_codes) \
 	hash_codes[0] = CRC32_XINIT; \
 	hash_codes[1] = 0; \
@@ -21,6 +21,604 @@
 #include "fc_memory.h"
 #include "ioevent.h"
 
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define URING_OP_POLL    1
+#define URING_OP_RECV    2
+#define URING_OP_SEND    3
+#define URING_OP_IGNORE  4   //poll remove and cancel
+
+#define URING_GENERATION_MASK  0x0FFFFFFF
+
+/* user_data: op (4 bits) | generation (28 bits) | fd (32 bits),
+   the CQE of a stale generation is ignored */
+#define URING_MAKE_USER_DATA(op, generation, fd) \
+    (((uint64_t)(op) << 60) | ((uint64_t)((generation) & \
+        URING_GENERATION_MASK) << 32) | (uint32_t)(fd))
+
+#define URING_POLL_EVENTS_MASK  0xFFFF
+
+typedef struct ioevent_uring_fd_entry {
+    void *data;
+    uint32_t events;  //the poll events without the epoll flags
+    uint32_t poll_generation;  //for the poll request
+    uint32_t io_generation;    //for the recv and send requests
+    int inflight;  //the recv and send requests in flight
+    bool armed;    //the poll request pending
+} IOEventUringFDEntry;
+
+struct ioevent_uring {
+    bool multishot;  //use multishot poll for edge trigger
+    struct {
+        unsigned *khead;
+        unsigned *ktail;
+        unsigned *array;
+        unsigned mask;
+        unsigned entries;
+        unsigned tail;
+        struct io_uring_sqe *sqes;
+        size_t sqes_bytes;
+    } sq;
+
+    struct {
+        unsigned *khead;
+        unsigned *ktail;
+        unsigned mask;
+        struct io_uring_cqe *cqes;
+    } cq;
+
+    void *ring;
+    size_t ring_bytes;
+
+    struct {
+        IOEventUringFDEntry *entries;
+        int alloc;
+    } fds;
+
+    struct {
+        int *fds;  //the fired single-shot polls to rearm
+        int count;
+        int alloc;
+    } rearm;
+};
+
+static inline int uring_setup(const unsigned entries,
+        struct io_uring_params *params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int uring_enter(const int ring_fd, const unsigned to_submit,
+        const unsigned min_complete, const unsigned flags,
+        void *arg, const size_t argsz)
+{
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit,
+            min_complete, flags, arg, argsz);
+}
+
+static int uring_init(IOEventPoller *ioevent)
+{
+    struct ioevent_uring *uring;
+    struct io_uring_params params;
+    unsigned entries;
+    size_t sq_bytes;
+    size_t cq_bytes;
+    int result;
+
+    entries = ioevent->size < 64 ? 64 : (ioevent->size > 4096 ?
+            4096 : ioevent->size);
+    memset(&params, 0, sizeof(params));
+    if ((ioevent->poll_fd=uring_setup(entries, &params)) < 0) {
+        result = errno != 0 ? errno : ENOSYS;
+        return (result == ENOSYS || result == EPERM) ?
+            EOPNOTSUPP : result;
+    }
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0 ||
+            (params.features & IORING_FEAT_NODROP) == 0 ||
+            (params.features & IORING_FEAT_EXT_ARG) == 0)
+    {
+        return EOPNOTSUPP;
+    }
+
+    uring = (struct ioevent_uring *)fc_calloc(1, sizeof(*uring));
+    if (uring == NULL) {
+        return ENOMEM;
+    }
+    ioevent->uring = uring;
+    uring->multishot = (ioevent->extra_events & EPOLLET) != 0;
+
+    sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_bytes = params.cq_off.cqes + params.cq_entries *
+        sizeof(struct io_uring_cqe);
+    uring->ring_bytes = sq_bytes > cq_bytes ? sq_bytes : cq_bytes;
+    uring->ring = mmap(NULL, uring->ring_bytes, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ioevent->poll_fd, IORING_OFF_SQ_RING);
+    if (uring->ring == MAP_FAILED) {
+        uring->ring = NULL;
+        return errno != 0 ? errno : ENOMEM;
+    }
+
+    uring->sq.sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sq.sqes = (struct io_uring_sqe *)mmap(NULL, uring->sq.sqes_bytes,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ioevent->poll_fd, IORING_OFF_SQES);
+    if (uring->sq.sqes == MAP_FAILED) {
+        uring->sq.sqes = NULL;
+        return errno != 0 ? errno : ENOMEM;
+    }
+
+    uring->sq.khead = (unsigned *)((char *)uring->ring + params.sq_off.head);
+    uring->sq.ktail = (unsigned *)((char *)uring->ring + params.sq_off.tail);
+    uring->sq.array = (unsigned *)((char *)uring->ring + params.sq_off.array);
+    uring->sq.mask = *(unsigned *)((char *)uring->ring +
+            params.sq_off.ring_mask);
+    uring->sq.entries = params.sq_entries;
+    uring->sq.tail = *uring->sq.ktail;
+
+    uring->cq.khead = (unsigned *)((char *)uring->ring + params.cq_off.head);
+    uring->cq.ktail = (unsigned *)((char *)uring->ring + params.cq_off.tail);
+    uring->cq.mask = *(unsigned *)((char *)uring->ring +
+            params.cq_off.ring_mask);
+    uring->cq.cqes = (struct io_uring_cqe *)((char *)uring->ring +
+            params.cq_off.cqes);
+
+    ioevent->results = (int *)fc_malloc(sizeof(int) * ioevent->size);
+    if (ioevent->results == NULL) {
+        return ENOMEM;
+    }
+
+    return 0;
+}
+
+static void uring_destroy(IOEventPoller *ioevent)
+{
+    struct ioevent_uring *uring;
+
+    if (ioevent->results != NULL) {
+        free(ioevent->results);
+        ioevent->results = NULL;
+    }
+
+    if ((uring=ioevent->uring) == NULL) {
+        return;
+    }
+
+    if (uring->sq.sqes != NULL) {
+        munmap(uring->sq.sqes, uring->sq.sqes_bytes);
+    }
+    if (uring->ring != NULL) {
+        munmap(uring->ring, uring->ring_bytes);
+    }
+    if (uring->fds.entries != NULL) {
+        free(uring->fds.entries);
+    }
+    if (uring->rearm.fds != NULL) {
+        free(uring->rearm.fds);
+    }
+    free(uring);
+    ioevent->uring = NULL;
+}
+
+static inline unsigned uring_pending_count(struct ioevent_uring *uring)
+{
+    return uring->sq.tail - __atomic_load_n(uring->sq.khead,
+            __ATOMIC_ACQUIRE);
+}
+
+static inline int uring_submit(IOEventPoller *ioevent)
+{
+    unsigned pending;
+
+    if ((pending=uring_pending_count(ioevent->uring)) == 0) {
+        return 0;
+    }
+    return uring_enter(ioevent->poll_fd, pending, 0, 0, NULL, 0);
+}
+
+static struct io_uring_sqe *uring_get_sqe(IOEventPoller *ioevent)
+{
+    struct ioevent_uring *uring;
+    struct io_uring_sqe *sqe;
+    unsigned index;
+
+    uring = ioevent->uring;
+    if (uring_pending_count(uring) >= uring->sq.entries) {
+        if (uring_submit(ioevent) < 0) {
+            return NULL;
+        }
+        if (uring_pending_count(uring) >= uring->sq.entries) {
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+
+    index = uring->sq.tail & uring->sq.mask;
+    sqe = uring->sq.sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    uring->sq.array[index] = index;
+    return sqe;
+}
+
+static inline void uring_commit_sqe(struct ioevent_uring *uring)
+{
+    uring->sq.tail++;
+    __atomic_store_n(uring->sq.ktail, uring->sq.tail, __ATOMIC_RELEASE);
+}
+
+static IOEventUringFDEntry *uring_get_fd_entry(
+        struct ioevent_uring *uring, const int fd)
+{
+    IOEventUringFDEntry *entries;
+    int alloc;
+
+    if (fd < 0) {
+        errno = EBADF;
+        return NULL;
+    }
+
+    if (fd >= uring->fds.alloc) {
+        alloc = uring->fds.alloc > 0 ? uring->fds.alloc : 256;
+        while (alloc <= fd) {
+            alloc *= 2;
+        }
+        entries = (IOEventUringFDEntry *)fc_realloc(uring->fds.entries,
+                sizeof(IOEventUringFDEntry) * alloc);
+        if (entries == NULL) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        memset(entries + uring->fds.alloc, 0, sizeof(IOEventUringFDEntry) *
+                (alloc - uring->fds.alloc));
+        uring->fds.entries = entries;
+        uring->fds.alloc = alloc;
+    }
+
+    return uring->fds.entries + fd;
+}
+
+static int uring_prep_poll_add(IOEventPoller *ioevent, const int fd,
+        IOEventUringFDEntry *entry)
+{
+    struct io_uring_sqe *sqe;
+
+    if ((sqe=uring_get_sqe(ioevent)) == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = entry->events;
+    if (ioevent->uring->multishot) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = URING_MAKE_USER_DATA(URING_OP_POLL,
+            entry->poll_generation, fd);
+    uring_commit_sqe(ioevent->uring);
+    entry->armed = true;
+    return 0;
+}
+
+static int uring_prep_poll_remove(IOEventPoller *ioevent, const int fd,
+        IOEventUringFDEntry *entry)
+{
+    struct io_uring_sqe *sqe;
+
+    if ((sqe=uring_get_sqe(ioevent)) == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = URING_MAKE_USER_DATA(URING_OP_POLL,
+            entry->poll_generation, fd);
+    sqe->user_data = URING_MAKE_USER_DATA(URING_OP_IGNORE, 0, fd);
+    uring_commit_sqe(ioevent->uring);
+    entry->armed = false;
+    return 0;
+}
+
+static int uring_prep_cancel_fd(IOEventPoller *ioevent, const int fd)
+{
+    struct io_uring_sqe *sqe;
+
+    if ((sqe=uring_get_sqe(ioevent)) == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = URING_MAKE_USER_DATA(URING_OP_IGNORE, 0, fd);
+    uring_commit_sqe(ioevent->uring);
+    return 0;
+}
+
+static int uring_attach(IOEventPoller *ioevent, const int fd,
+        const int e, void *data)
+{
+    IOEventUringFDEntry *entry;
+
+    if ((entry=uring_get_fd_entry(ioevent->uring, fd)) == NULL) {
+        return -1;
+    }
+    if (entry->events != 0) {
+        errno = EEXIST;
+        return -1;
+    }
+
+    entry->data = data;
+    entry->events = (e | ioevent->extra_events) & URING_POLL_EVENTS_MASK;
+    if (entry->events == 0) {
+        return 0;
+    }
+    return uring_prep_poll_add(ioevent, fd, entry);
+}
+
+static int uring_modify(IOEventPoller *ioevent, const int fd,
+        const int e, void *data)
+{
+    IOEventUringFDEntry *entry;
+
+    if (fd >= ioevent->uring->fds.alloc || (entry=ioevent->uring->
+                fds.entries + fd)->data == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (entry->armed) {
+        if (uring_prep_poll_remove(ioevent, fd, entry) != 0) {
+            return -1;
+        }
+    }
+
+    entry->poll_generation++;
+    entry->data = data;
+    entry->events = (e | ioevent->extra_events) & URING_POLL_EVENTS_MASK;
+    if (entry->events == 0) {
+        return 0;
+    }
+    return uring_prep_poll_add(ioevent, fd, entry);
+}
+
+static int uring_detach(IOEventPoller *ioevent, const int fd)
+{
+    IOEventUringFDEntry *entry;
+
+    if (fd < 0 || fd >= ioevent->uring->fds.alloc || (entry=ioevent->
+                uring->fds.entries + fd)->data == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (entry->armed) {
+        if (uring_prep_poll_remove(ioevent, fd, entry) != 0) {
+            return -1;
+        }
+    }
+    if (entry->inflight > 0) {
+        if (uring_prep_cancel_fd(ioevent, fd) != 0) {
+            return -1;
+        }
+    }
+
+    entry->data = NULL;
+    entry->events = 0;
+    entry->inflight = 0;
+    entry->poll_generation++;
+    entry->io_generation++;
+
+    /* submit at once so the kernel drops the requests
+       before the caller closes the fd or frees the buffer */
+    return uring_submit(ioevent) < 0 ? -1 : 0;
+}
+
+static int uring_prep_io(IOEventPoller *ioevent, const int op,
+        const int fd, void *buff, const int size, void *data)
+{
+    IOEventUringFDEntry *entry;
+    struct io_uring_sqe *sqe;
+
+    if (ioevent->uring == NULL) {
+        return EOPNOTSUPP;
+    }
+    if ((entry=uring_get_fd_entry(ioevent->uring, fd)) == NULL) {
+        return errno != 0 ? errno : ENOMEM;
+    }
+    if ((sqe=uring_get_sqe(ioevent)) == NULL) {
+        return errno != 0 ? errno : EBUSY;
+    }
+
+    if (entry->data == NULL) {
+        entry->data = data;
+    }
+    sqe->opcode = (op == URING_OP_RECV) ? IORING_OP_RECV : IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(unsigned long)buff;
+    sqe->len = size;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = URING_MAKE_USER_DATA(op, entry->io_generation, fd);
+    uring_commit_sqe(ioevent->uring);
+    entry->inflight++;
+    return 0;
+}
+
+static int uring_rearm(IOEventPoller *ioevent)
+{
+    struct ioevent_uring *uring;
+    IOEventUringFDEntry *entry;
+    int *fd;
+    int *end;
+
+    uring = ioevent->uring;
+    end = uring->rearm.fds + uring->rearm.count;
+    for (fd=uring->rearm.fds; fd<end; fd++) {
+        entry = uring->fds.entries + *fd;
+        if (entry->data != NULL && entry->events != 0 && !entry->armed) {
+            if (uring_prep_poll_add(ioevent, *fd, entry) != 0) {
+                return -1;
+            }
+        }
+    }
+    uring->rearm.count = 0;
+    return 0;
+}
+
+static int uring_add_rearm(struct ioevent_uring *uring, const int fd)
+{
+    int *fds;
+    int alloc;
+
+    if (uring->rearm.count == uring->rearm.alloc) {
+        alloc = uring->rearm.alloc > 0 ? 2 * uring->rearm.alloc : 256;
+        fds = (int *)fc_realloc(uring->rearm.fds, sizeof(int) * alloc);
+        if (fds == NULL) {
+            return ENOMEM;
+        }
+        uring->rearm.fds = fds;
+        uring->rearm.alloc = alloc;
+    }
+
+    uring->rearm.fds[uring->rearm.count++] = fd;
+    return 0;
+}
+
+static int uring_reap(IOEventPoller *ioevent)
+{
+    struct ioevent_uring *uring;
+    struct io_uring_cqe *cqe;
+    IOEventUringFDEntry *entry;
+    unsigned head;
+    unsigned tail;
+    uint32_t generation;
+    uint32_t events;
+    int op;
+    int fd;
+    int count;
+
+    uring = ioevent->uring;
+    head = *uring->cq.khead;
+    tail = __atomic_load_n(uring->cq.ktail, __ATOMIC_ACQUIRE);
+    count = 0;
+    while (head != tail && count < ioevent->size) {
+        cqe = uring->cq.cqes + (head++ & uring->cq.mask);
+        op = (int)(cqe->user_data >> 60);
+        fd = (int)(uint32_t)cqe->user_data;
+        generation = (uint32_t)(cqe->user_data >> 32) &
+            URING_GENERATION_MASK;
+        if (op == URING_OP_IGNORE || fd >= uring->fds.alloc) {
+            continue;
+        }
+
+        entry = uring->fds.entries + fd;
+        if (entry->data == NULL) {
+            continue;
+        }
+
+        if (op == URING_OP_POLL) {
+            if ((entry->poll_generation & URING_GENERATION_MASK) !=
+                    generation)
+            {
+                continue;
+            }
+            if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+                entry->armed = false;
+                uring_add_rearm(uring, fd);
+            }
+            if (cqe->res == -ECANCELED) {
+                continue;
+            }
+            events = cqe->res < 0 ? EPOLLERR : (uint32_t)cqe->res;
+        } else {
+            if ((entry->io_generation & URING_GENERATION_MASK) !=
+                    generation)
+            {
+                continue;
+            }
+            entry->inflight--;
+            events = (op == URING_OP_RECV) ?
+                IOEVENT_RECV_DONE : IOEVENT_SEND_DONE;
+        }
+
+        ioevent->events[count].events = events;
+        ioevent->events[count].data.ptr = entry->data;
+        ioevent->results[count] = cqe->res;
+        count++;
+    }
+
+    __atomic_store_n(uring->cq.khead, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+static inline int64_t uring_get_current_time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int uring_poll(IOEventPoller *ioevent)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    int64_t deadline_ms;
+    int64_t remain_ms;
+    int count;
+
+    if (uring_rearm(ioevent) != 0) {
+        return -1;
+    }
+
+    if ((count=uring_reap(ioevent)) > 0) {
+        if (uring_submit(ioevent) < 0 && errno != EBUSY) {
+            return -1;
+        }
+        return count;
+    }
+
+    memset(&arg, 0, sizeof(arg));
+    remain_ms = ioevent->timeout;
+    deadline_ms = remain_ms > 0 ? uring_get_current_time_ms() +
+        remain_ms : 0;
+    while (1) {
+        if (remain_ms >= 0) {
+            ts.tv_sec = remain_ms / 1000;
+            ts.tv_nsec = (remain_ms % 1000) * 1000000;
+            arg.ts = (uint64_t)(unsigned long)&ts;
+        }
+        if (uring_enter(ioevent->poll_fd, uring_pending_count(ioevent->
+                        uring), 1, IORING_ENTER_GETEVENTS |
+                    IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) < 0)
+        {
+            if (errno != ETIME && errno != EBUSY) {
+                return -1;
+            }
+        }
+
+        /* the CQEs of the stale requests are skipped,
+           so wait again until the deadline */
+        if ((count=uring_reap(ioevent)) > 0 || remain_ms == 0) {
+            return count;
+        }
+        if (remain_ms > 0 && (remain_ms=deadline_ms -
+                    uring_get_current_time_ms()) <= 0)
+        {
+            return 0;
+        }
+        if (uring_rearm(ioevent) != 0) {
+            return -1;
+        }
+    }
+}
+#endif
+
 #if IOEVENT_USE_KQUEUE
 /* we define these here as numbers, because for kqueue mapping them to a combination of
      * filters / flags is hard to do. */
@@ -45,16 +643,41 @@ int kqueue_ev_convert(int16_t event, uint16_t flags)
 }
 #endif
 
-int ioevent_init(IOEventPoller *ioevent, const int size,
-    const int timeout_ms, const int extra_events)
+int ioevent_init_ex(IOEventPoller *ioevent, const int size,
+    const int timeout_ms, const int extra_events, const int backend)
 {
   int bytes;
 
   ioevent->size = size;
   ioevent->extra_events = extra_events;
+  ioevent->backend = backend;
   ioevent->iterator.index = 0;
   ioevent->iterator.count = 0;
 
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  ioevent->uring = NULL;
+  ioevent->results = NULL;
+  if (backend == IOEVENT_BACKEND_IO_URING) {
+    int result;
+    bytes = sizeof(struct epoll_event) * size;
+    if ((ioevent->events=(struct epoll_event *)fc_malloc(bytes)) == NULL) {
+      ioevent->poll_fd = -1;
+      return ENOMEM;
+    }
+    if ((result=uring_init(ioevent)) != 0) {
+      ioevent_destroy(ioevent);
+      return result;
+    }
+    ioevent_set_timeout(ioevent, timeout_ms);
+    return 0;
+  }
+#endif
+  if (backend != IOEVENT_BACKEND_DEFAULT) {
+    ioevent->events = NULL;
+    ioevent->poll_fd = -1;
+    return EOPNOTSUPP;
+  }
+
 #if IOEVENT_USE_EPOLL
   ioevent->poll_fd = epoll_create(ioevent->size);
   if (ioevent->poll_fd < 0) {
@@ -88,8 +711,19 @@ int ioevent_init(IOEventPoller *ioevent, const int size,
   return 0;
 }
 
+int ioevent_init(IOEventPoller *ioevent, const int size,
+    const int timeout_ms, const int extra_events)
+{
+  return ioevent_init_ex(ioevent, size, timeout_ms, extra_events,
+      IOEVENT_BACKEND_DEFAULT);
+}
+
 void ioevent_destroy(IOEventPoller *ioevent)
 {
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  uring_destroy(ioevent);
+#endif
+
   if (ioevent->events != NULL) {
     free(ioevent->events);
     ioevent->events = NULL;
@@ -104,6 +738,11 @@ void ioevent_destroy(IOEventPoller *ioevent)
 int ioevent_attach(IOEventPoller *ioevent, const int fd, const int e,
     void *data)
 {
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  if (ioevent->uring != NULL) {
+    return uring_attach(ioevent, fd, e, data);
+  }
+#endif
 #if IOEVENT_USE_EPOLL
   struct epoll_event ev;
   memset(&ev, 0, sizeof(ev));
@@ -131,6 +770,11 @@ int ioevent_attach(IOEventPoller *ioevent, const int fd, const int e,
 int ioevent_modify(IOEventPoller *ioevent, const int fd, const int e,
     void *data)
 {
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  if (ioevent->uring != NULL) {
+    return uring_modify(ioevent, fd, e, data);
+  }
+#endif
 #if IOEVENT_USE_EPOLL
   struct epoll_event ev;
   memset(&ev, 0, sizeof(ev));
@@ -171,6 +815,11 @@ int ioevent_modify(IOEventPoller *ioevent, const int fd, const int e,
 
 int ioevent_detach(IOEventPoller *ioevent, const int fd)
 {
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  if (ioevent->uring != NULL) {
+    return uring_detach(ioevent, fd);
+  }
+#endif
 #if IOEVENT_USE_EPOLL
   return epoll_ctl(ioevent->poll_fd, EPOLL_CTL_DEL, fd, NULL);
 #elif IOEVENT_USE_KQUEUE
@@ -191,6 +840,11 @@ int ioevent_detach(IOEventPoller *ioevent, const int fd)
 
 int ioevent_poll(IOEventPoller *ioevent)
 {
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  if (ioevent->uring != NULL) {
+    return uring_poll(ioevent);
+  }
+#endif
 #if IOEVENT_USE_EPOLL
   return epoll_wait(ioevent->poll_fd, ioevent->events, ioevent->size, ioevent->timeout);
 #elif IOEVENT_USE_KQUEUE
@@ -226,3 +880,24 @@ int ioevent_poll(IOEventPoller *ioevent)
 #endif
 }
 
+
+int ioevent_uring_prep_recv(IOEventPoller *ioevent, const int fd,
+    void *buff, const int size, void *data)
+{
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  return uring_prep_io(ioevent, URING_OP_RECV, fd, buff, size, data);
+#else
+  return EOPNOTSUPP;
+#endif
+}
+
+int ioevent_uring_prep_send(IOEventPoller *ioevent, const int fd,
+    const void *buff, const int size, void *data)
+{
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  return uring_prep_io(ioevent, URING_OP_SEND, fd,
+      (void *)buff, size, data);
+#else
+  return EOPNOTSUPP;
+#endif
+}
@@ -17,12 +17,21 @@
 #define __IOEVENT_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <poll.h>
 #include <sys/time.h>
 #include "_os_define.h"
 
 #define IOEVENT_TIMEOUT  0x8000
 
+//the completion events of the io_uring backend in completion mode
+#define IOEVENT_RECV_DONE  0x4000
+#define IOEVENT_SEND_DONE  0x0800
+
+#define IOEVENT_BACKEND_DEFAULT   0  //epoll, kqueue or port
+#define IOEVENT_BACKEND_IO_URING  1  //Linux io_uring, the ioevent functions
+                                     //must be called by the loop thread
+
 #if IOEVENT_USE_EPOLL
 #include <sys/epoll.h>
 #define IOEVENT_EDGE_TRIGGER EPOLLET
@@ -64,10 +73,13 @@ int kqueue_ev_convert(int16_t event, uint16_t flags);
 #define IOEVENT_ERROR (POLLERR | POLLPRI | POLLHUP)
 #endif
 
+struct ioevent_uring;
+
 typedef struct ioevent_puller {
     int size;  //max events (fd)
     int extra_events;
     int poll_fd;
+    int backend;
 
     struct {
         int index;
@@ -77,6 +89,10 @@ typedef struct ioevent_puller {
 #if IOEVENT_USE_EPOLL
     struct epoll_event *events;
     int timeout;
+#if IOEVENT_HAVE_URING
+    struct ioevent_uring *uring;  //NULL for epoll backend
+    int *results;  //the results of the completion events
+#endif
 #elif IOEVENT_USE_KQUEUE
     struct kevent *events;
     struct timespec timeout;
@@ -129,8 +145,23 @@ typedef struct ioevent_puller {
 extern "C" {
 #endif
 
+/** init the ioevent poller
+ *  parameters:
+ *      ioevent: the poller
+ *      size: the max events per poll
+ *      timeout_ms: the poll timeout in milliseconds
+ *      extra_events: the extra events such as IOEVENT_EDGE_TRIGGER
+ *      backend: IOEVENT_BACKEND_DEFAULT or IOEVENT_BACKEND_IO_URING
+ *  return: error no, 0 success, != 0 fail
+ *          EOPNOTSUPP when the backend is not supported
+*/
+int ioevent_init_ex(IOEventPoller *ioevent, const int size,
+    const int timeout_ms, const int extra_events, const int backend);
+
+//init the ioevent poller with IOEVENT_BACKEND_DEFAULT
 int ioevent_init(IOEventPoller *ioevent, const int size,
     const int timeout_ms, const int extra_events);
+
 void ioevent_destroy(IOEventPoller *ioevent);
 
 int ioevent_attach(IOEventPoller *ioevent, const int fd, const int e,
@@ -140,6 +171,42 @@ int ioevent_modify(IOEventPoller *ioevent, const int fd, const int e,
 int ioevent_detach(IOEventPoller *ioevent, const int fd);
 int ioevent_poll(IOEventPoller *ioevent);
 
+/** submit a recv request in io_uring completion mode. the completion
+ *  is reported by ioevent_poll as event IOEVENT_RECV_DONE with the data,
+ *  and ioevent_get_result returns the received bytes or -errno
+ *  parameters:
+ *      ioevent: the poller
+ *      fd: the socket fd
+ *      buff: the buffer to receive, must be valid until the completion
+ *      size: the buffer size
+ *      data: the user data, usually the IOEventEntry
+ *  return: error no, 0 success, != 0 fail
+*/
+int ioevent_uring_prep_recv(IOEventPoller *ioevent, const int fd,
+    void *buff, const int size, void *data);
+
+/** submit a send request in io_uring completion mode. the completion
+ *  is reported as event IOEVENT_SEND_DONE, see ioevent_uring_prep_recv
+*/
+int ioevent_uring_prep_send(IOEventPoller *ioevent, const int fd,
+    const void *buff, const int size, void *data);
+
+static inline bool ioevent_is_uring(IOEventPoller *ioevent)
+{
+  return ioevent->backend == IOEVENT_BACKEND_IO_URING;
+}
+
+//the result of the current completion event, only for the event loop
+static inline int ioevent_get_result(IOEventPoller *ioevent)
+{
+#if IOEVENT_USE_EPOLL && IOEVENT_HAVE_URING
+  if (ioevent->results != NULL) {
+    return ioevent->results[ioevent->iterator.index];
+  }
+#endif
+  return 0;
+}
+
 static inline void ioevent_set_timeout(IOEventPoller *ioevent, const int timeout_ms)
 {
 #if IOEVENT_USE_EPOLL
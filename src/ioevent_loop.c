@@ -15,7 +15,11 @@
 
 #include "sched_thread.h"
 #include "logger.h"
+#include "shared_func.h"
 #include "ioevent_loop.h"
+#ifdef OS_LINUX
+#include <sys/eventfd.h>
+#endif
 
 static void deal_ioevents(IOEventPoller *ioevent)
 {
@@ -91,6 +95,76 @@ static void deal_timeouts(FastTimerEntry *head)
 	}
 }
 
+static void deal_notify_event(int sock, short event, void *arg)
+{
+    struct ioevent_notify_entry *notify_entry;
+    char buff[1024];
+
+    notify_entry = (struct ioevent_notify_entry *)arg;
+    if (notify_entry->thread_data->notify.enabled)
+    {
+        /* drain the notify fd first, then clear the pending flag before
+           the callback drains the waiting queue. the notify after the
+           clear writes the fd again, so no wakeup is lost */
+        while (read(sock, buff, sizeof(buff)) > 0)
+        {
+        }
+        __sync_lock_test_and_set(&notify_entry->thread_data->
+                notify.counter, 0);
+    }
+    notify_entry->callback(sock, event, arg);
+}
+
+int ioevent_notify_init(struct nio_thread_data *thread_data)
+{
+    int result;
+
+    fc_mpsc_queue_init(&thread_data->task_queue, (long)
+            (&((struct fast_task_info *)NULL)->next));
+#ifdef OS_LINUX
+    int efd;
+    if ((efd=eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) >= 0)
+    {
+        thread_data->pipe_fds[0] = thread_data->pipe_fds[1] = efd;
+        thread_data->notify.counter = 0;
+        thread_data->notify.enabled = true;
+        return 0;
+    }
+#endif
+
+    if (pipe(thread_data->pipe_fds) != 0)
+    {
+        result = errno != 0 ? errno : EMFILE;
+        logError("file: "__FILE__", line: %d, "
+                "create pipe fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    if ((result=set_nonblock(thread_data->pipe_fds[0])) != 0)
+    {
+        ioevent_notify_destroy(thread_data);
+        return result;
+    }
+    thread_data->notify.counter = 0;
+    thread_data->notify.enabled = true;
+    return 0;
+}
+
+void ioevent_notify_destroy(struct nio_thread_data *thread_data)
+{
+    if (thread_data->pipe_fds[0] >= 0)
+    {
+        close(thread_data->pipe_fds[0]);
+    }
+    if (thread_data->pipe_fds[1] >= 0 && thread_data->pipe_fds[1] !=
+            thread_data->pipe_fds[0])
+    {
+        close(thread_data->pipe_fds[1]);
+    }
+    thread_data->pipe_fds[0] = thread_data->pipe_fds[1] = -1;
+}
+
 int ioevent_loop(struct nio_thread_data *pThreadData,
 	IOEventCallback recv_notify_callback, TaskCleanUpCallback
 	clean_up_callback, volatile bool *continue_flag)
@@ -104,8 +178,9 @@ int ioevent_loop(struct nio_thread_data *pThreadData,
 
 	memset(&ev_notify, 0, sizeof(ev_notify));
 	ev_notify.event.fd = FC_NOTIFY_READ_FD(pThreadData);
-	ev_notify.event.callback = recv_notify_callback;
+	ev_notify.event.callback = deal_notify_event;
 	ev_notify.thread_data = pThreadData;
+	ev_notify.callback = recv_notify_callback;
 	if (ioevent_attach(&pThreadData->ev_puller,
 		pThreadData->pipe_fds[0], IOEVENT_READ,
 		&ev_notify) != 0)
@@ -118,6 +193,14 @@ int ioevent_loop(struct nio_thread_data *pThreadData,
 		return result;
 	}
 
+    if (fast_timer_is_hierarchy(&pThreadData->timer) &&
+            pThreadData->ev_puller.timeout > pThreadData->timer.tick)
+    {
+        //poll timeout no more than one tick for the millisecond timer
+        ioevent_set_timeout(&pThreadData->ev_puller,
+                pThreadData->timer.tick);
+    }
+
     pThreadData->deleted_list = NULL;
 	last_check_time = g_current_time;
 	while (*continue_flag)
@@ -155,7 +238,16 @@ int ioevent_loop(struct nio_thread_data *pThreadData,
 			//logInfo("cleanup task count: %d", count);
 		}
 
-		if (g_current_time - last_check_time > 0)
+		if (fast_timer_is_hierarchy(&pThreadData->timer))
+		{
+			count = fast_timer_timeouts_get(&pThreadData->timer,
+                    get_current_time_ms(), &head);
+			if (count > 0)
+			{
+				deal_timeouts(&head);
+			}
+		}
+		else if (g_current_time - last_check_time > 0)
 		{
 			last_check_time = g_current_time;
 			count = fast_timer_timeouts_get(
@@ -166,21 +258,6 @@ int ioevent_loop(struct nio_thread_data *pThreadData,
 			}
 		}
 
-        if (pThreadData->notify.enabled)
-        {
-            int64_t n;
-            if ((n=__sync_fetch_and_add(&pThreadData->notify.counter, 0)) != 0)
-            {
-                __sync_fetch_and_sub(&pThreadData->notify.counter, n);
-                /*
-                logInfo("file: "__FILE__", line: %d, "
-                        "n ==== %"PRId64", now: %"PRId64,
-                        __LINE__, n, __sync_fetch_and_add(
-                            &pThreadData->notify.counter, 0));
-                            */
-            }
-        }
-
         if (pThreadData->thread_loop_callback != NULL)
         {
             pThreadData->thread_loop_callback(pThreadData);
@@ -209,7 +286,8 @@ int ioevent_set(struct fast_task_info *task, struct nio_thread_data *pThread,
 		return result;
 	}
 
-	task->event.timer.expires = g_current_time + timeout;
+	task->event.timer.expires = ioevent_timer_current_time(pThread) +
+        (fast_timer_is_hierarchy(&pThread->timer) ? 1000 * timeout : timeout);
 	fast_timer_add(&pThread->timer, &task->event.timer);
 	return 0;
 }
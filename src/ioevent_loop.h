@@ -17,6 +17,8 @@
 #define _IOEVENT_LOOP_H
 
 #include "fast_task_queue.h"
+#include "shared_func.h"
+#include "sched_thread.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,6 +34,34 @@ int ioevent_remove(IOEventPoller *ioevent, void *data);
 int ioevent_set(struct fast_task_info *pTask, struct nio_thread_data *pThread,
 	int sock, short event, IOEventCallback callback, const int timeout);
 
+/* io_uring completion mode: receive to task->data + task->offset, the
+   callback of the task is called with event IOEVENT_RECV_DONE and
+   ioevent_get_result returns the received bytes or -errno */
+static inline int ioevent_async_recv(struct fast_task_info *task)
+{
+    return ioevent_uring_prep_recv(&task->thread_data->ev_puller,
+            task->event.fd, task->data + task->offset,
+            task->size - task->offset, task);
+}
+
+//io_uring completion mode: send task->data + task->offset to task->length
+static inline int ioevent_async_send(struct fast_task_info *task)
+{
+    return ioevent_uring_prep_send(&task->thread_data->ev_puller,
+            task->event.fd, task->data + task->offset,
+            task->length - task->offset, task);
+}
+
+/* the current time for the timer of the nio thread, in milliseconds for
+   the hierarchical wheel inited by fast_timer_init_hierarchy with the
+   current time of get_current_time_ms(), in seconds for others */
+static inline int64_t ioevent_timer_current_time(
+        struct nio_thread_data *thread_data)
+{
+    return fast_timer_is_hierarchy(&thread_data->timer) ?
+        get_current_time_ms() : g_current_time;
+}
+
 static inline bool ioevent_is_canceled(struct fast_task_info *task)
 {
     return __sync_fetch_and_add(&task->canceled, 0) != 0;
@@ -51,6 +81,21 @@ static inline void ioevent_add_to_deleted_list(struct fast_task_info *task)
     task->thread_data->deleted_list = task;
 }
 
+/** create the notify fds of the nio thread, one eventfd for both
+ *  pipe_fds[0] and pipe_fds[1] on Linux, the pipe for others.
+ *  the lock free task_queue is also inited
+ *  parameters:
+ *      thread_data: the nio thread data
+ *  return: error no, 0 success, != 0 fail
+*/
+int ioevent_notify_init(struct nio_thread_data *thread_data);
+
+void ioevent_notify_destroy(struct nio_thread_data *thread_data);
+
+/* wake up the nio thread, the wakeups are coalesced: the fd is written only
+   when no wakeup pending. the loop drains the fd and clears the pending
+   flag before calling the recv notify callback which should drain the
+   waiting queue and MUST NOT read the fd */
 static inline int ioevent_notify_thread(struct nio_thread_data *thread_data)
 {
     int64_t n;
@@ -73,6 +118,24 @@ static inline int ioevent_notify_thread(struct nio_thread_data *thread_data)
     return 0;
 }
 
+//push the task to the lock free task queue and notify the nio thread
+static inline int ioevent_push_task(struct nio_thread_data *thread_data,
+        struct fast_task_info *task)
+{
+    fc_mpsc_queue_push(&thread_data->task_queue, task);
+    return ioevent_notify_thread(thread_data);
+}
+
+/* pop all tasks of the lock free task queue in FIFO order linked by
+   fast_task_info.next, only called by the nio thread in the recv
+   notify callback */
+static inline struct fast_task_info *ioevent_pop_tasks(
+        struct nio_thread_data *thread_data)
+{
+    return (struct fast_task_info *)fc_mpsc_queue_pop_all(
+            &thread_data->task_queue);
+}
+
 #ifdef __cplusplus
 }
 #endif
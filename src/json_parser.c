@@ -404,7 +404,7 @@ int fc_encode_json_map_ex(fc_json_context_t *context,
     } while (0)
 
 
-const fc_json_array_t *fc_decode_json_array(fc_json_context_t
+static const fc_json_array_t *decode_json_array(fc_json_context_t
         *context, const string_t *input)
 {
     if ((context->error_no=prepare_json_parse(context,
@@ -470,7 +470,7 @@ const fc_json_array_t *fc_decode_json_array(fc_json_context_t
     return &context->jarray;
 }
 
-const fc_json_map_t *fc_decode_json_map(fc_json_context_t
+static const fc_json_map_t *decode_json_map(fc_json_context_t
         *context, const string_t *input)
 {
     key_value_pair_t kv_pair;
@@ -562,3 +562,38 @@ const fc_json_map_t *fc_decode_json_map(fc_json_context_t
 
     return &context->jmap;
 }
+
+/* the strings copied to the decode mpool are released when decode fail */
+#define JSON_DECODE_WITH_ROLLBACK(context, input, decode_func, result) \
+    do { \
+        struct fast_mpool_mark mark; \
+        if ((context->error_no=fc_mark_json_context(context, &mark)) != 0) \
+        { \
+            context->error_info.len = snprintf(context->error_info.str, \
+                    context->error_size, "mark decode mpool fail"); \
+            return NULL; \
+        } \
+        if ((result=decode_func(context, input)) == NULL && \
+                context->decode.use_mpool) \
+        { \
+            fc_rollback_json_context(context, &mark); \
+        } \
+    } while (0)
+
+const fc_json_array_t *fc_decode_json_array(fc_json_context_t
+        *context, const string_t *input)
+{
+    const fc_json_array_t *array;
+
+    JSON_DECODE_WITH_ROLLBACK(context, input, decode_json_array, array);
+    return array;
+}
+
+const fc_json_map_t *fc_decode_json_map(fc_json_context_t
+        *context, const string_t *input)
+{
+    const fc_json_map_t *map;
+
+    JSON_DECODE_WITH_ROLLBACK(context, input, decode_json_map, map);
+    return map;
+}
@@ -169,6 +169,28 @@ extern "C" {
         }
     }
 
+    /* mark the decode mpool before a nested decode */
+    static inline int fc_mark_json_context(fc_json_context_t *ctx,
+            struct fast_mpool_mark *mark)
+    {
+        if (ctx->decode.use_mpool) {
+            return fast_mpool_mark(&ctx->decode.mpool, mark);
+        } else {
+            return 0;
+        }
+    }
+
+    /* release the strings of the nested decode only */
+    static inline int fc_rollback_json_context(fc_json_context_t *ctx,
+            const struct fast_mpool_mark *mark)
+    {
+        if (ctx->decode.use_mpool) {
+            return fast_mpool_rollback_to(&ctx->decode.mpool, mark);
+        } else {
+            return 0;
+        }
+    }
+
     static inline void fc_destroy_json_context(fc_json_context_t *ctx)
     {
         fc_free_buffer(&ctx->output);
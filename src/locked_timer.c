@@ -351,3 +351,226 @@ int locked_timer_timeouts_get(LockedTimer *timer, const int64_t current_time,
     tail->next = NULL;
     return count;
 }
+
+int locked_sharded_timer_init(LockedShardedTimer *timer,
+        const int shard_count, const int slot_count,
+        const int64_t current_time)
+{
+    LockedShardedTimerShard *shard;
+    LockedShardedTimerShard *end;
+    int result;
+
+    if (shard_count <= 0 || shard_count > UINT16_MAX) {
+        return EINVAL;
+    }
+
+    timer->shards = (LockedShardedTimerShard *)fc_calloc(
+            shard_count, sizeof(LockedShardedTimerShard));
+    if (timer->shards == NULL) {
+        return ENOMEM;
+    }
+
+    timer->shard_count = shard_count;
+    end = timer->shards + shard_count;
+    for (shard=timer->shards; shard<end; shard++) {
+        if ((result=fast_timer_init(&shard->wheel, slot_count,
+                        current_time)) != 0)
+        {
+            locked_sharded_timer_destroy(timer);
+            return result;
+        }
+        fc_mpsc_queue_init(&shard->inbox, (long)(&((
+                            LockedShardedTimerEntry *)NULL)->inbox_next));
+    }
+
+    return 0;
+}
+
+void locked_sharded_timer_destroy(LockedShardedTimer *timer)
+{
+    LockedShardedTimerShard *shard;
+    LockedShardedTimerShard *end;
+
+    if (timer->shards == NULL) {
+        return;
+    }
+
+    end = timer->shards + timer->shard_count;
+    for (shard=timer->shards; shard<end; shard++) {
+        fast_timer_destroy(&shard->wheel);
+    }
+    free(timer->shards);
+    timer->shards = NULL;
+}
+
+void locked_sharded_timer_entry_init(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry, const int shard_index)
+{
+    memset(entry, 0, sizeof(*entry));
+    if (shard_index >= 0) {
+        entry->shard_index = shard_index % timer->shard_count;
+    } else {
+        entry->shard_index = (((unsigned long)entry) /
+                sizeof(*entry)) % timer->shard_count;
+    }
+}
+
+static inline void sharded_timer_post(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry)
+{
+    //the entry is in the inbox once, the shard reads the latest target
+    if (__sync_fetch_and_add(&entry->in_inbox, 1) == 0) {
+        fc_mpsc_queue_push(&timer->shards[entry->shard_index].inbox, entry);
+    }
+}
+
+int locked_sharded_timer_add(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry, const int64_t expires)
+{
+    int64_t old;
+
+    if (expires <= 0) {
+        return EINVAL;
+    }
+
+    do {
+        old = __sync_add_and_fetch(&entry->target, 0);
+    } while (!__sync_bool_compare_and_swap(&entry->target, old, expires));
+
+    sharded_timer_post(timer, entry);
+    return 0;
+}
+
+static inline int sharded_timer_set_target(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry, const int64_t new_target)
+{
+    int64_t old;
+
+    do {
+        old = __sync_add_and_fetch(&entry->target, 0);
+        if (old == LOCKED_SHARDED_TIMER_TARGET_EXPIRED) {
+            return ETIMEDOUT;
+        } else if (old == LOCKED_SHARDED_TIMER_TARGET_IDLE) {
+            return ENOENT;
+        }
+    } while (!__sync_bool_compare_and_swap(&entry->target, old, new_target));
+
+    sharded_timer_post(timer, entry);
+    return 0;
+}
+
+int locked_sharded_timer_modify(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry, const int64_t new_expires)
+{
+    if (new_expires <= 0) {
+        return EINVAL;
+    }
+    return sharded_timer_set_target(timer, entry, new_expires);
+}
+
+int locked_sharded_timer_remove(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry)
+{
+    return sharded_timer_set_target(timer, entry,
+            LOCKED_SHARDED_TIMER_TARGET_IDLE);
+}
+
+static void sharded_timer_deal_entry(LockedShardedTimerShard *shard,
+        LockedShardedTimerEntry *entry)
+{
+    int64_t target;
+    int requests;
+
+    /* the requests after the target read make the CAS fail, so deal
+       again. the entry is NOT accessed after in_inbox cleared because
+       the owner can free it once released */
+    do {
+        requests = __sync_add_and_fetch(&entry->in_inbox, 0);
+        target = __sync_add_and_fetch(&entry->target, 0);
+        if (target > 0) {
+            if (entry->in_wheel) {
+                fast_timer_modify(&shard->wheel, &entry->wheel, target);
+            } else {
+                fast_timer_add_ex(&shard->wheel, &entry->wheel, target, true);
+                __sync_bool_compare_and_swap(&entry->in_wheel, 0, 1);
+            }
+        } else if (entry->in_wheel) {
+            fast_timer_remove(&shard->wheel, &entry->wheel);
+            __sync_bool_compare_and_swap(&entry->in_wheel, 1, 0);
+        }
+    } while (!__sync_bool_compare_and_swap(&entry->in_inbox, requests, 0));
+}
+
+static void sharded_timer_deal_inbox(LockedShardedTimerShard *shard)
+{
+    LockedShardedTimerEntry *entry;
+    LockedShardedTimerEntry *next;
+
+    entry = (LockedShardedTimerEntry *)fc_mpsc_queue_pop_all(&shard->inbox);
+    while (entry != NULL) {
+        next = entry->inbox_next;  //read before the entry released
+        sharded_timer_deal_entry(shard, entry);
+        entry = next;
+    }
+}
+
+int locked_sharded_timer_timeouts_get(LockedShardedTimer *timer,
+        const int shard_index, const int64_t current_time,
+        LockedShardedTimerEntry *head)
+{
+    LockedShardedTimerShard *shard;
+    LockedShardedTimerEntry *entry;
+    LockedShardedTimerEntry *tail;
+    FastTimerEntry wheel_head;
+    FastTimerEntry *current;
+    FastTimerEntry *next;
+    int64_t target;
+    int count;
+
+    shard = timer->shards + shard_index;
+    sharded_timer_deal_inbox(shard);
+
+    tail = head;
+    count = 0;
+    if (fast_timer_timeouts_get(&shard->wheel, current_time,
+                &wheel_head) > 0)
+    {
+        current = wheel_head.next;
+        while (current != NULL) {
+            next = current->next;
+            current->prev = current->next = NULL;
+            entry = (LockedShardedTimerEntry *)current;
+
+            do {
+                target = __sync_add_and_fetch(&entry->target, 0);
+                if (target <= 0 || target >= current_time) {
+                    break;
+                }
+            } while (!__sync_bool_compare_and_swap(&entry->target, target,
+                        LOCKED_SHARDED_TIMER_TARGET_EXPIRED));
+
+            if (target > 0 && target >= current_time) {
+                //modified after the inbox dealt, the request is pending
+                fast_timer_add_ex(&shard->wheel, current, target, true);
+            } else if (target > 0) {
+                tail->next = entry;
+                tail = entry;
+                count++;
+            } else {  //removed, NOT accessed after released
+                __sync_bool_compare_and_swap(&entry->in_wheel, 1, 0);
+            }
+
+            current = next;
+        }
+    }
+    tail->next = NULL;
+
+    //release the expired entries after the chain is built
+    entry = head->next;
+    while (entry != NULL) {
+        tail = entry->next;
+        __sync_bool_compare_and_swap(&entry->in_wheel, 1, 0);
+        entry = tail;
+    }
+    return count;
+}
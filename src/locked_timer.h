@@ -20,6 +20,8 @@
 #include <pthread.h>
 #include "common_define.h"
 #include "fc_list.h"
+#include "fast_timer.h"
+#include "fc_mpsc_queue.h"
 
 #define FAST_TIMER_STATUS_NONE     0
 #define FAST_TIMER_STATUS_NORMAL   1
@@ -62,6 +64,33 @@ typedef struct locked_timer {
     LockedTimerSlot *slots;
 } LockedTimer;
 
+//the target of the sharded timer entry besides the expires
+#define LOCKED_SHARDED_TIMER_TARGET_IDLE     0
+#define LOCKED_SHARDED_TIMER_TARGET_EXPIRED -1
+
+typedef struct locked_sharded_timer_entry {
+    FastTimerEntry wheel;  //must first, owned by the shard thread
+    volatile int64_t target;  //the expires to reach, idle or expired
+    struct locked_sharded_timer_entry *inbox_next;  //for the shard inbox
+    struct locked_sharded_timer_entry *next;  //for timeout chain
+    volatile int in_inbox;  //the pending request count, 0 for released
+    volatile int8_t in_wheel;  //set by the shard thread
+    uint16_t shard_index;
+} LockedShardedTimerEntry;
+
+typedef struct locked_sharded_timer_shard {
+    FastTimer wheel;  //owned by the shard thread
+    struct fc_mpsc_queue inbox;  //the requests from the other threads
+} LockedShardedTimerShard;
+
+/* the sharded timer: each shard has its own wheel which is only accessed
+   by the shard thread, the other threads send add, modify and remove
+   requests to the shard through the lock free inbox */
+typedef struct locked_sharded_timer {
+    int shard_count;
+    LockedShardedTimerShard *shards;
+} LockedShardedTimer;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -95,6 +124,68 @@ int locked_timer_modify(LockedTimer *timer, LockedTimerEntry *entry,
 int locked_timer_timeouts_get(LockedTimer *timer, const int64_t current_time,
    LockedTimerEntry *head);
 
+
+/** init the sharded timer
+ *  parameters:
+ *      timer: the sharded timer
+ *      shard_count: the shard count, usually the count of the threads
+ *                   which deal the timeouts
+ *      slot_count: the wheel slot count of each shard
+ *      current_time: the current time
+ *  return: error no, 0 success, != 0 fail
+*/
+int locked_sharded_timer_init(LockedShardedTimer *timer,
+        const int shard_count, const int slot_count,
+        const int64_t current_time);
+
+void locked_sharded_timer_destroy(LockedShardedTimer *timer);
+
+/** init the entry before the first add
+ *  parameters:
+ *      timer: the sharded timer
+ *      entry: the entry
+ *      shard_index: the shard for the thread affinity, < 0 for hash
+ *  return: none
+*/
+void locked_sharded_timer_entry_init(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry, const int shard_index);
+
+/* the add, modify and remove are called by any thread, they take effect
+   at the next locked_sharded_timer_timeouts_get of the shard */
+int locked_sharded_timer_add(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry, const int64_t expires);
+
+//return ETIMEDOUT when expired, ENOENT when not added
+int locked_sharded_timer_modify(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry, const int64_t new_expires);
+
+//return ETIMEDOUT when expired, ENOENT when not added
+int locked_sharded_timer_remove(LockedShardedTimer *timer,
+        LockedShardedTimerEntry *entry);
+
+/** get the expired entries of the shard, only called by the shard thread
+ *  parameters:
+ *      timer: the sharded timer
+ *      shard_index: the shard index
+ *      current_time: the current time
+ *      head: return the chain of the expired entries linked by next
+ *  return: the expired entry count
+*/
+int locked_sharded_timer_timeouts_get(LockedShardedTimer *timer,
+        const int shard_index, const int64_t current_time,
+        LockedShardedTimerEntry *head);
+
+/* the removed or expired entry can be freed or inited again only when
+   the shard thread has released it. the expired entry is passed to the
+   caller of locked_sharded_timer_timeouts_get by the timeout chain, so
+   the other threads which get ETIMEDOUT should leave it to the caller */
+static inline bool locked_sharded_timer_entry_released(
+        LockedShardedTimerEntry *entry)
+{
+    return __sync_add_and_fetch(&entry->in_inbox, 0) == 0 &&
+        __sync_add_and_fetch(&entry->in_wheel, 0) == 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,8 +30,15 @@
 #include <pwd.h>
 #include "fc_memory.h"
 #include "logger.h"
+#include "system_info.h"
 #include "pthread_func.h"
 
+#ifdef OS_LINUX
+#include <sched.h>
+#endif
+
+#define CPU_SYS_BASE_PATH  "/sys/devices/system/cpu"
+
 int init_pthread_lock(pthread_mutex_t *pthread_lock)
 {
 	pthread_mutexattr_t mat;
@@ -187,8 +194,9 @@ int init_pthread_attr(pthread_attr_t *pattr, const int stack_size)
 	return 0;
 }
 
-int create_work_threads(int *count, void *(*start_func)(void *),
-		void **args, pthread_t *tids, const int stack_size)
+static int do_create_work_threads(int *count, void *(*start_func)(void *),
+		void **args, pthread_t *tids, const int stack_size,
+        const FCThreadAffinity *affinity)
 {
 #define FIXED_TID_COUNT   256
 
@@ -225,6 +233,13 @@ int create_work_threads(int *count, void *(*start_func)(void *),
 	for (ptid=the_tids,current_arg=args; ptid<ptid_end;
             ptid++,current_arg++)
     {
+        if ((result=fc_thread_affinity_set_attr(affinity, &thread_attr,
+                        ptid - the_tids)) != 0)
+        {
+			*count = ptid - the_tids;
+            break;
+        }
+
 		if ((result=pthread_create(ptid, &thread_attr,
 			start_func, *current_arg)) != 0)
 		{
@@ -246,9 +261,24 @@ int create_work_threads(int *count, void *(*start_func)(void *),
 	return result;
 }
 
+int create_work_threads(int *count, void *(*start_func)(void *),
+		void **args, pthread_t *tids, const int stack_size)
+{
+    return do_create_work_threads(count, start_func,
+            args, tids, stack_size, NULL);
+}
+
 int create_work_threads_ex(int *count, void *(*start_func)(void *),
 		void *args, const int elment_size, pthread_t *tids,
         const int stack_size)
+{
+    return create_work_threads_ex1(count, start_func, args,
+            elment_size, tids, stack_size, NULL);
+}
+
+int create_work_threads_ex1(int *count, void *(*start_func)(void *),
+		void *args, const int elment_size, pthread_t *tids,
+        const int stack_size, const FCThreadAffinity *affinity)
 {
 #define FIXED_ARG_COUNT   256
 
@@ -274,8 +304,8 @@ int create_work_threads_ex(int *count, void *(*start_func)(void *),
         pp_args[i] = p;
         p += elment_size;
     }
-    result = create_work_threads(count, start_func,
-           pp_args, tids, stack_size);
+    result = do_create_work_threads(count, start_func,
+           pp_args, tids, stack_size, affinity);
     if (pp_args != fixed_args) {
         free(pp_args);
     }
@@ -303,6 +333,13 @@ int kill_work_threads(pthread_t *tids, const int count)
 
 int fc_create_thread(pthread_t *tid, void *(*start_func)(void *),
         void *args, const int stack_size)
+{
+    return fc_create_thread_ex(tid, start_func, args, stack_size, NULL, 0);
+}
+
+int fc_create_thread_ex(pthread_t *tid, void *(*start_func)(void *),
+        void *args, const int stack_size, const FCThreadAffinity *affinity,
+        const int index)
 {
 	int result;
 	pthread_attr_t thread_attr;
@@ -311,6 +348,13 @@ int fc_create_thread(pthread_t *tid, void *(*start_func)(void *),
 		return result;
 	}
 
+    if ((result=fc_thread_affinity_set_attr(affinity,
+                    &thread_attr, index)) != 0)
+    {
+        pthread_attr_destroy(&thread_attr);
+        return result;
+    }
+
     if ((result=pthread_create(tid, &thread_attr, start_func, args)) != 0) {
         logError("file: "__FILE__", line: %d, "
                 "create thread fail, "
@@ -351,3 +395,418 @@ void destroy_pthread_lock_cond_pair(pthread_lock_cond_pair_t *lcp)
     pthread_cond_destroy(&lcp->cond);
     pthread_mutex_destroy(&lcp->lock);
 }
+
+static const char *thread_affinity_policy_names[] = {
+    "none", "cpu_list", "per_core", "no_smt", "numa"
+};
+
+const char *fc_thread_affinity_policy_caption(const int policy)
+{
+    if (policy >= FC_THREAD_AFFINITY_NONE &&
+            policy <= FC_THREAD_AFFINITY_NUMA_NODE)
+    {
+        return thread_affinity_policy_names[policy];
+    }
+    return "unknown";
+}
+
+static int thread_affinity_parse_policy(const char *policy_name)
+{
+    int policy;
+
+    for (policy=FC_THREAD_AFFINITY_NONE;
+            policy<=FC_THREAD_AFFINITY_NUMA_NODE; policy++)
+    {
+        if (strcasecmp(policy_name,
+                    thread_affinity_policy_names[policy]) == 0)
+        {
+            return policy;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef OS_LINUX
+static int thread_affinity_get_online_cpus(int *cpus,
+        const int size, int *count)
+{
+    char buff[1024];
+    int64_t file_size;
+    int i;
+
+    file_size = sizeof(buff) - 1;
+    if (access(CPU_SYS_BASE_PATH"/online", F_OK) == 0 && getFileContentEx(
+                CPU_SYS_BASE_PATH"/online", buff, 0, &file_size) == 0)
+    {
+        buff[file_size] = '\0';
+        return fc_parse_cpu_list(buff, cpus, size, count);
+    }
+
+    *count = FC_MIN(get_sys_cpu_count(), size);
+    for (i=0; i<*count; i++) {
+        cpus[i] = i;
+    }
+    return 0;
+}
+
+//the index of the CPU in its SMT siblings, 0 for the first one
+static int thread_affinity_get_smt_rank(const int cpu)
+{
+    char filename[PATH_MAX];
+    char buff[256];
+    int siblings[256];
+    int64_t file_size;
+    int count;
+    int rank;
+    int i;
+
+    snprintf(filename, sizeof(filename), "%s/cpu%d/topology/"
+            "thread_siblings_list", CPU_SYS_BASE_PATH, cpu);
+    file_size = sizeof(buff) - 1;
+    if (access(filename, F_OK) != 0 || getFileContentEx(filename,
+                buff, 0, &file_size) != 0)
+    {
+        return 0;
+    }
+    buff[file_size] = '\0';
+    if (fc_parse_cpu_list(buff, siblings, 256, &count) != 0) {
+        return 0;
+    }
+
+    rank = 0;
+    for (i=0; i<count; i++) {
+        if (siblings[i] < cpu) {
+            rank++;
+        }
+    }
+    return rank;
+}
+
+static int *thread_affinity_alloc(FCThreadAffinity *affinity,
+        const int slot_count, const int cpu_count)
+{
+    affinity->slots = (FCCPUSet *)fc_malloc(sizeof(FCCPUSet) *
+            slot_count + sizeof(int) * cpu_count);
+    if (affinity->slots == NULL) {
+        return NULL;
+    }
+
+    affinity->slot_count = 0;
+    return (int *)(affinity->slots + slot_count);
+}
+
+//one CPU per slot
+static int thread_affinity_init_cpu_slots(FCThreadAffinity *affinity,
+        const int *cpus, const int count)
+{
+    int *buff;
+    int i;
+
+    if ((buff=thread_affinity_alloc(affinity, count, count)) == NULL) {
+        return ENOMEM;
+    }
+
+    for (i=0; i<count; i++) {
+        buff[i] = cpus[i];
+        affinity->slots[i].cpus = buff + i;
+        affinity->slots[i].count = 1;
+    }
+    affinity->slot_count = count;
+    return 0;
+}
+
+/* order the CPUs by the SMT rank, so the threads spread over the
+   physical cores first */
+static int thread_affinity_init_core_slots(FCThreadAffinity *affinity,
+        const int *cpus, const int count, const bool avoid_smt)
+{
+    int *ranks;
+    int *ordered;
+    int max_rank;
+    int ordered_count;
+    int rank;
+    int result;
+    int i;
+
+    ranks = (int *)fc_malloc(sizeof(int) * count * 2);
+    if (ranks == NULL) {
+        return ENOMEM;
+    }
+    ordered = ranks + count;
+
+    max_rank = 0;
+    for (i=0; i<count; i++) {
+        ranks[i] = thread_affinity_get_smt_rank(cpus[i]);
+        if (ranks[i] > max_rank) {
+            max_rank = ranks[i];
+        }
+    }
+    if (avoid_smt) {
+        max_rank = 0;
+    }
+
+    ordered_count = 0;
+    for (rank=0; rank<=max_rank; rank++) {
+        for (i=0; i<count; i++) {
+            if (ranks[i] == rank) {
+                ordered[ordered_count++] = cpus[i];
+            }
+        }
+    }
+
+    if (ordered_count == 0) {
+        logError("file: "__FILE__", line: %d, "
+                "no CPU available for policy: %s", __LINE__,
+                fc_thread_affinity_policy_caption(affinity->policy));
+        result = ENOENT;
+    } else {
+        result = thread_affinity_init_cpu_slots(affinity,
+                ordered, ordered_count);
+    }
+
+    free(ranks);
+    return result;
+}
+
+//the CPUs of one NUMA node per slot
+static int thread_affinity_init_numa_slots(FCThreadAffinity *affinity,
+        const int *cpus, const int count)
+{
+    int *cpu_nodes;
+    int *buff;
+    int node_count;
+    int node;
+    int result;
+    int i;
+
+    cpu_nodes = (int *)fc_malloc(sizeof(int) * CPU_SETSIZE);
+    if (cpu_nodes == NULL) {
+        return ENOMEM;
+    }
+    if ((result=get_cpu_numa_nodes(cpu_nodes, CPU_SETSIZE)) != 0) {
+        free(cpu_nodes);
+        return result;
+    }
+
+    node_count = get_numa_node_count();
+    if ((buff=thread_affinity_alloc(affinity, node_count, count)) == NULL) {
+        free(cpu_nodes);
+        return ENOMEM;
+    }
+
+    for (node=0; node<node_count; node++) {
+        affinity->slots[affinity->slot_count].cpus = buff;
+        affinity->slots[affinity->slot_count].count = 0;
+        for (i=0; i<count; i++) {
+            if (cpu_nodes[cpus[i]] == node) {
+                *buff++ = cpus[i];
+                affinity->slots[affinity->slot_count].count++;
+            }
+        }
+
+        if (affinity->slots[affinity->slot_count].count > 0) {
+            affinity->slot_count++;
+        }
+    }
+
+    free(cpu_nodes);
+    return 0;
+}
+
+static void thread_affinity_fill_cpu_set(const FCThreadAffinity *affinity,
+        const int index, cpu_set_t *cpu_set)
+{
+    const FCCPUSet *slot;
+    int i;
+
+    slot = affinity->slots + (index % affinity->slot_count);
+    CPU_ZERO(cpu_set);
+    for (i=0; i<slot->count; i++) {
+        CPU_SET(slot->cpus[i], cpu_set);
+    }
+}
+#endif
+
+int fc_thread_affinity_init(FCThreadAffinity *affinity,
+        const int policy, const char *cpu_list)
+{
+#ifdef OS_LINUX
+    int *cpus;
+    int count;
+    int result;
+#endif
+
+    affinity->policy = policy;
+    affinity->slot_count = 0;
+    affinity->slots = NULL;
+    if (policy == FC_THREAD_AFFINITY_NONE) {
+        return 0;
+    }
+
+    if (policy < FC_THREAD_AFFINITY_NONE ||
+            policy > FC_THREAD_AFFINITY_NUMA_NODE)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "invalid thread affinity policy: %d", __LINE__, policy);
+        return EINVAL;
+    }
+
+    if (policy == FC_THREAD_AFFINITY_CPU_LIST &&
+            (cpu_list == NULL || *cpu_list == '\0'))
+    {
+        logError("file: "__FILE__", line: %d, "
+                "the CPU list is required for policy: %s",
+                __LINE__, fc_thread_affinity_policy_caption(policy));
+        return EINVAL;
+    }
+
+#ifdef OS_LINUX
+    cpus = (int *)fc_malloc(sizeof(int) * CPU_SETSIZE);
+    if (cpus == NULL) {
+        return ENOMEM;
+    }
+
+    if (cpu_list != NULL && *cpu_list != '\0') {
+        result = fc_parse_cpu_list(cpu_list, cpus, CPU_SETSIZE, &count);
+    } else {
+        result = thread_affinity_get_online_cpus(cpus, CPU_SETSIZE, &count);
+    }
+
+    if (result == 0 && count == 0) {
+        logError("file: "__FILE__", line: %d, "
+                "empty CPU list", __LINE__);
+        result = EINVAL;
+    }
+
+    if (result == 0) {
+        switch (policy) {
+            case FC_THREAD_AFFINITY_CPU_LIST:
+                result = thread_affinity_init_cpu_slots(
+                        affinity, cpus, count);
+                break;
+            case FC_THREAD_AFFINITY_PER_CORE:
+            case FC_THREAD_AFFINITY_NO_SMT:
+                result = thread_affinity_init_core_slots(affinity, cpus,
+                        count, policy == FC_THREAD_AFFINITY_NO_SMT);
+                break;
+            default:
+                result = thread_affinity_init_numa_slots(
+                        affinity, cpus, count);
+                break;
+        }
+    }
+
+    free(cpus);
+    if (result != 0) {
+        fc_thread_affinity_destroy(affinity);
+    }
+    return result;
+#else
+    logWarning("file: "__FILE__", line: %d, "
+            "thread affinity NOT supported, policy %s is ignored",
+            __LINE__, fc_thread_affinity_policy_caption(policy));
+    affinity->policy = FC_THREAD_AFFINITY_NONE;
+    return 0;
+#endif
+}
+
+int fc_thread_affinity_load_from_ini(IniFullContext *ini_ctx,
+        const char *prefix, FCThreadAffinity *affinity)
+{
+    char policy_item[64];
+    char cpu_list_item[64];
+    char *policy_name;
+    char *cpu_list;
+    int policy;
+
+    if (prefix == NULL || *prefix == '\0') {
+        snprintf(policy_item, sizeof(policy_item), "%s",
+                FC_THREAD_AFFINITY_ITEM_POLICY);
+        snprintf(cpu_list_item, sizeof(cpu_list_item), "%s",
+                FC_THREAD_AFFINITY_ITEM_CPU_LIST);
+    } else {
+        snprintf(policy_item, sizeof(policy_item), "%s_%s",
+                prefix, FC_THREAD_AFFINITY_ITEM_POLICY);
+        snprintf(cpu_list_item, sizeof(cpu_list_item), "%s_%s",
+                prefix, FC_THREAD_AFFINITY_ITEM_CPU_LIST);
+    }
+
+    policy_name = iniGetStrValue(ini_ctx->section_name,
+            policy_item, ini_ctx->context);
+    cpu_list = iniGetStrValue(ini_ctx->section_name,
+            cpu_list_item, ini_ctx->context);
+    if (policy_name == NULL || *policy_name == '\0') {
+        policy = (cpu_list != NULL && *cpu_list != '\0') ?
+            FC_THREAD_AFFINITY_CPU_LIST : FC_THREAD_AFFINITY_NONE;
+    } else if ((policy=thread_affinity_parse_policy(policy_name)) < 0) {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s, item \"%s\" 's value: %s is invalid, "
+                "expect: none, cpu_list, per_core, no_smt or numa",
+                __LINE__, ini_ctx->filename, policy_item, policy_name);
+        return EINVAL;
+    }
+
+    return fc_thread_affinity_init(affinity, policy, cpu_list);
+}
+
+void fc_thread_affinity_destroy(FCThreadAffinity *affinity)
+{
+    if (affinity->slots != NULL) {
+        free(affinity->slots);
+        affinity->slots = NULL;
+    }
+    affinity->slot_count = 0;
+}
+
+int fc_thread_affinity_set_attr(const FCThreadAffinity *affinity,
+        pthread_attr_t *attr, const int index)
+{
+#ifdef OS_LINUX
+    cpu_set_t cpu_set;
+    int result;
+
+    if (affinity == NULL || affinity->slot_count == 0) {
+        return 0;
+    }
+
+    thread_affinity_fill_cpu_set(affinity, index, &cpu_set);
+    if ((result=pthread_attr_setaffinity_np(attr,
+                    sizeof(cpu_set), &cpu_set)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "pthread_attr_setaffinity_np fail, "
+                "errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+    }
+    return result;
+#else
+    return 0;
+#endif
+}
+
+int fc_thread_affinity_bind(const FCThreadAffinity *affinity,
+        pthread_t tid, const int index)
+{
+#ifdef OS_LINUX
+    cpu_set_t cpu_set;
+    int result;
+
+    if (affinity == NULL || affinity->slot_count == 0) {
+        return 0;
+    }
+
+    thread_affinity_fill_cpu_set(affinity, index, &cpu_set);
+    if ((result=pthread_setaffinity_np(tid,
+                    sizeof(cpu_set), &cpu_set)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "pthread_setaffinity_np fail, "
+                "errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+    }
+    return result;
+#else
+    return 0;
+#endif
+}
@@ -27,6 +27,30 @@
 #include "sched_thread.h"
 #include "logger.h"
 
+#define FC_THREAD_AFFINITY_NONE      0
+#define FC_THREAD_AFFINITY_CPU_LIST  1  //pin to the CPUs in the list one by one
+#define FC_THREAD_AFFINITY_PER_CORE  2  //one thread per CPU, spread over cores
+#define FC_THREAD_AFFINITY_NO_SMT    3  //avoid the SMT siblings
+#define FC_THREAD_AFFINITY_NUMA_NODE 4  //bind to the CPUs of a NUMA node
+
+#define FC_THREAD_AFFINITY_ITEM_POLICY    "thread_affinity"
+#define FC_THREAD_AFFINITY_ITEM_CPU_LIST  "cpu_list"
+
+typedef struct fc_cpu_set
+{
+    int *cpus;
+    int count;
+} FCCPUSet;
+
+/* the thread with index i is bound to slots[i % slot_count],
+   the slot is one CPU except the NUMA policy */
+typedef struct fc_thread_affinity
+{
+    int policy;
+    int slot_count;
+    FCCPUSet *slots;
+} FCThreadAffinity;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -201,6 +225,69 @@ int kill_work_threads(pthread_t *tids, const int count);
 int fc_create_thread(pthread_t *tid, void *(*start_func)(void *),
         void *args, const int stack_size);
 
+/** create thread with the placement of the affinity
+ *  parameters:
+ *      tid: return the thread id
+ *      start_func: the thread entrance function
+ *      args: the argument pass to start_func
+ *      stack_size: the thread stack size
+ *      affinity: the thread affinity, NULL for no placement
+ *      index: the thread index for the affinity
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_create_thread_ex(pthread_t *tid, void *(*start_func)(void *),
+        void *args, const int stack_size, const FCThreadAffinity *affinity,
+        const int index);
+
+//the thread with the index i of args is bound by the affinity slot i
+int create_work_threads_ex1(int *count, void *(*start_func)(void *),
+		void *args, const int elment_size, pthread_t *tids,
+        const int stack_size, const FCThreadAffinity *affinity);
+
+/** init the thread affinity
+ *  parameters:
+ *      affinity: the thread affinity to init
+ *      policy: the policy such as FC_THREAD_AFFINITY_PER_CORE
+ *      cpu_list: the candidate CPUs such as 0-3,8, NULL or empty for
+ *                all online CPUs, required for FC_THREAD_AFFINITY_CPU_LIST
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_thread_affinity_init(FCThreadAffinity *affinity,
+        const int policy, const char *cpu_list);
+
+/** load the thread affinity from the config, the items are
+ *  [prefix_]thread_affinity: none, cpu_list, per_core, no_smt or numa
+ *  [prefix_]cpu_list: the candidate CPUs such as 0-3,8
+ *  parameters:
+ *      ini_ctx: the full ini context
+ *      prefix: the item name prefix such as nio, NULL or empty for none
+ *      affinity: the thread affinity to init
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_thread_affinity_load_from_ini(IniFullContext *ini_ctx,
+        const char *prefix, FCThreadAffinity *affinity);
+
+void fc_thread_affinity_destroy(FCThreadAffinity *affinity);
+
+const char *fc_thread_affinity_policy_caption(const int policy);
+
+/** set the affinity of the thread attribute before the thread created
+ *  parameters:
+ *      affinity: the thread affinity, NULL for none
+ *      attr: the thread attribute
+ *      index: the thread index
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_thread_affinity_set_attr(const FCThreadAffinity *affinity,
+        pthread_attr_t *attr, const int index);
+
+//bind the running thread
+int fc_thread_affinity_bind(const FCThreadAffinity *affinity,
+        pthread_t tid, const int index);
+
+#define fc_thread_affinity_bind_self(affinity, index) \
+    fc_thread_affinity_bind(affinity, pthread_self(), index)
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "logger.h"
+#include "fc_memory.h"
+#include "pthread_func.h"
+#include "sched_thread.h"
+#include "rcu_hash.h"
+
+#define RCU_HASH_MIN_CAPACITY  16
+
+#define RCU_HASH_ENTRY_VALUE(entry)  ((entry)->key + (entry)->key_len)
+
+#define RCU_HASH_LOCK(map, hash_code) \
+    PTHREAD_MUTEX_LOCK(map->locks + ((hash_code) & (map->lock_count - 1)))
+
+#define RCU_HASH_UNLOCK(map, hash_code) \
+    PTHREAD_MUTEX_UNLOCK(map->locks + ((hash_code) & (map->lock_count - 1)))
+
+static inline unsigned int rcu_hash_ceil_power2(const int64_t n)
+{
+    int64_t capacity;
+
+    capacity = RCU_HASH_MIN_CAPACITY;
+    while (capacity < n && capacity < (1LL << 31)) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+static FCRcuHashTable *rcu_hash_alloc_table(const unsigned int capacity)
+{
+    FCRcuHashTable *table;
+
+    table = (FCRcuHashTable *)fc_calloc(1, sizeof(FCRcuHashTable) +
+            sizeof(FCRcuHashEntry *) * capacity);
+    if (table == NULL) {
+        return NULL;
+    }
+
+    table->capacity = capacity;
+    table->mask = capacity - 1;
+    return table;
+}
+
+int fc_rcu_hash_init(FCRcuHashMap *map, HashFunc hash_func,
+        const int key_size, const int value_size, const int64_t capacity,
+        const int lock_count, const int delay_free_seconds)
+{
+    const int64_t alloc_elements_limit = 0;
+    const bool need_lock = true;
+    unsigned int init_capacity;
+    int element_size;
+    int result;
+    int i;
+
+    if (key_size <= 0 || value_size < 0 || lock_count <= 0 ||
+            delay_free_seconds <= 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "invalid key size: %d, value size: %d, lock count: %d "
+                "or delay free seconds: %d", __LINE__, key_size,
+                value_size, lock_count, delay_free_seconds);
+        return EINVAL;
+    }
+
+    memset(map, 0, sizeof(FCRcuHashMap));
+    map->hash_func = hash_func;
+    map->key_size = key_size;
+    map->value_size = value_size;
+    /* the delay free of the mblock is in the granularity of second,
+       one more second for the whole delay_free_seconds */
+    map->delay_free_seconds = delay_free_seconds + 1;
+
+    //the buckets of the same lock have the same low bits of the hash code
+    map->lock_count = rcu_hash_ceil_power2(lock_count);
+    init_capacity = rcu_hash_ceil_power2(capacity);
+    if (init_capacity < map->lock_count) {
+        init_capacity = map->lock_count;
+    }
+
+    element_size = sizeof(FCRcuHashEntry) + key_size + value_size;
+    if ((result=fast_mblock_init_ex1(&map->entry_allocator,
+                    "rcu-hash-entry", element_size, 4096,
+                    alloc_elements_limit, NULL, NULL, need_lock)) != 0)
+    {
+        return result;
+    }
+
+    map->locks = (pthread_mutex_t *)fc_malloc(
+            sizeof(pthread_mutex_t) * map->lock_count);
+    if (map->locks == NULL) {
+        fast_mblock_destroy(&map->entry_allocator);
+        return ENOMEM;
+    }
+    for (i=0; i<map->lock_count; i++) {
+        if ((result=init_pthread_lock(map->locks + i)) != 0) {
+            while (--i >= 0) {
+                pthread_mutex_destroy(map->locks + i);
+            }
+            free(map->locks);
+            map->locks = NULL;
+            fast_mblock_destroy(&map->entry_allocator);
+            return result;
+        }
+    }
+
+    if ((map->table=rcu_hash_alloc_table(init_capacity)) == NULL) {
+        for (i=0; i<map->lock_count; i++) {
+            pthread_mutex_destroy(map->locks + i);
+        }
+        free(map->locks);
+        map->locks = NULL;
+        fast_mblock_destroy(&map->entry_allocator);
+        return ENOMEM;
+    }
+
+    return 0;
+}
+
+void fc_rcu_hash_destroy(FCRcuHashMap *map)
+{
+    FCRcuHashTable *table;
+    int i;
+
+    if (map->table == NULL) {
+        return;
+    }
+
+    //the entries are freed by the mblock
+    free(map->table);
+    map->table = NULL;
+    while (map->retired_tables != NULL) {
+        table = map->retired_tables;
+        map->retired_tables = table->next;
+        free(table);
+    }
+
+    for (i=0; i<map->lock_count; i++) {
+        pthread_mutex_destroy(map->locks + i);
+    }
+    free(map->locks);
+    map->locks = NULL;
+    fast_mblock_destroy(&map->entry_allocator);
+}
+
+static inline FCRcuHashEntry *rcu_hash_chain_find(FCRcuHashEntry *entry,
+        const unsigned int hash_code, const void *key, const int key_len)
+{
+    while (entry != NULL) {
+        if (entry->hash_code == hash_code && entry->key_len == key_len &&
+                memcmp(entry->key, key, key_len) == 0)
+        {
+            return entry;
+        }
+        entry = entry->next;
+    }
+
+    return NULL;
+}
+
+const FCRcuHashEntry *fc_rcu_hash_find_entry(FCRcuHashMap *map,
+        const void *key, const int key_len)
+{
+    FCRcuHashTable *table;
+    unsigned int hash_code;
+
+    hash_code = map->hash_func(key, key_len);
+    table = map->table;
+    return rcu_hash_chain_find(table->buckets[hash_code & table->mask],
+            hash_code, key, key_len);
+}
+
+int fc_rcu_hash_get(FCRcuHashMap *map, const void *key,
+        const int key_len, void *value, int *value_len)
+{
+    const FCRcuHashEntry *entry;
+
+    if ((entry=fc_rcu_hash_find_entry(map, key, key_len)) == NULL) {
+        return ENOENT;
+    }
+
+    if (entry->value_len > *value_len) {
+        return ENOSPC;
+    }
+    *value_len = entry->value_len;
+    memcpy(value, RCU_HASH_ENTRY_VALUE(entry), entry->value_len);
+    return 0;
+}
+
+static inline void rcu_hash_delay_free(FCRcuHashMap *map,
+        FCRcuHashEntry *entry)
+{
+    fast_mblock_delay_free_object(&map->entry_allocator,
+            entry, map->delay_free_seconds);
+}
+
+static void rcu_hash_retire_table(FCRcuHashMap *map,
+        FCRcuHashTable *table)
+{
+    FCRcuHashEntry * volatile *bucket;
+    FCRcuHashEntry * volatile *end;
+    FCRcuHashEntry *entry;
+    FCRcuHashEntry *deleted;
+
+    //the chains keep unchanged for the readers of the old table
+    end = table->buckets + table->capacity;
+    for (bucket=table->buckets; bucket<end; bucket++) {
+        entry = *bucket;
+        while (entry != NULL) {
+            deleted = entry;
+            entry = entry->next;
+            rcu_hash_delay_free(map, deleted);
+        }
+    }
+
+    if (!(sched_delay_task_enabled() && sched_delay_free_ptr(
+                    table, map->delay_free_seconds) == 0))
+    {
+        table->next = map->retired_tables;
+        map->retired_tables = table;
+    }
+}
+
+//clone the entries to the new table, called with all locks held
+static int rcu_hash_clone_table(FCRcuHashMap *map,
+        FCRcuHashTable *old_table, FCRcuHashTable *new_table)
+{
+    FCRcuHashEntry * volatile *bucket;
+    FCRcuHashEntry * volatile *end;
+    FCRcuHashEntry * volatile *new_bucket;
+    FCRcuHashEntry *entry;
+    FCRcuHashEntry *clone;
+    int bytes;
+
+    end = old_table->buckets + old_table->capacity;
+    for (bucket=old_table->buckets; bucket<end; bucket++) {
+        entry = *bucket;
+        while (entry != NULL) {
+            clone = (FCRcuHashEntry *)fast_mblock_alloc_object(
+                    &map->entry_allocator);
+            if (clone == NULL) {
+                return ENOMEM;
+            }
+
+            bytes = sizeof(FCRcuHashEntry) + entry->key_len +
+                entry->value_len;
+            memcpy(clone, entry, bytes);
+            new_bucket = new_table->buckets + (entry->hash_code &
+                    new_table->mask);
+            clone->next = *new_bucket;
+            *new_bucket = clone;
+            entry = entry->next;
+        }
+    }
+
+    return 0;
+}
+
+static void rcu_hash_free_entries(FCRcuHashMap *map, FCRcuHashTable *table)
+{
+    FCRcuHashEntry * volatile *bucket;
+    FCRcuHashEntry * volatile *end;
+    FCRcuHashEntry *entry;
+    FCRcuHashEntry *deleted;
+
+    end = table->buckets + table->capacity;
+    for (bucket=table->buckets; bucket<end; bucket++) {
+        entry = *bucket;
+        while (entry != NULL) {
+            deleted = entry;
+            entry = entry->next;
+            fast_mblock_free_object(&map->entry_allocator, deleted);
+        }
+    }
+}
+
+/* double the capacity. the writers are blocked by all locks,
+   the readers continue to use the old table until the new one published */
+static int rcu_hash_resize(FCRcuHashMap *map)
+{
+    FCRcuHashTable *old_table;
+    FCRcuHashTable *new_table;
+    int result;
+    int i;
+
+    //only one resizer, the others go on with the current table
+    if (!__sync_bool_compare_and_swap(&map->resizing, 0, 1)) {
+        return EINPROGRESS;
+    }
+
+    for (i=0; i<map->lock_count; i++) {
+        PTHREAD_MUTEX_LOCK(map->locks + i);
+    }
+
+    old_table = map->table;
+    do {
+        if (fc_rcu_hash_count(map) <= old_table->capacity ||
+                old_table->capacity >= (1U << 31))
+        {
+            new_table = NULL;
+            result = 0;
+            break;
+        }
+
+        if ((new_table=rcu_hash_alloc_table(
+                        old_table->capacity * 2)) == NULL)
+        {
+            result = ENOMEM;
+            break;
+        }
+
+        if ((result=rcu_hash_clone_table(map, old_table,
+                        new_table)) != 0)
+        {
+            rcu_hash_free_entries(map, new_table);
+            free(new_table);
+            new_table = NULL;
+            break;
+        }
+
+        __sync_synchronize();
+        map->table = new_table;
+    } while (0);
+
+    for (i=map->lock_count-1; i>=0; i--) {
+        PTHREAD_MUTEX_UNLOCK(map->locks + i);
+    }
+
+    if (new_table != NULL) {
+        rcu_hash_retire_table(map, old_table);
+    }
+    __sync_bool_compare_and_swap(&map->resizing, 1, 0);
+    return result;
+}
+
+int fc_rcu_hash_insert(FCRcuHashMap *map, const void *key,
+        const int key_len, const void *value, const int value_len)
+{
+    FCRcuHashTable *table;
+    FCRcuHashEntry * volatile *pp;
+    FCRcuHashEntry *entry;
+    FCRcuHashEntry *old_entry;
+    unsigned int hash_code;
+    int result;
+
+    if (key_len < 0 || value_len < 0) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid key length: %d or value length: %d",
+                __LINE__, key_len, value_len);
+        return -EINVAL;
+    }
+    if (key_len > map->key_size || value_len > map->value_size) {
+        logError("file: "__FILE__", line: %d, "
+                "key length: %d > %d or value length: %d > %d",
+                __LINE__, key_len, map->key_size,
+                value_len, map->value_size);
+        return -EOVERFLOW;
+    }
+
+    entry = (FCRcuHashEntry *)fast_mblock_alloc_object(
+            &map->entry_allocator);
+    if (entry == NULL) {
+        return -ENOMEM;
+    }
+
+    hash_code = map->hash_func(key, key_len);
+    entry->hash_code = hash_code;
+    entry->key_len = key_len;
+    entry->value_len = value_len;
+    memcpy(entry->key, key, key_len);
+    memcpy(entry->key + key_len, value, value_len);
+
+    RCU_HASH_LOCK(map, hash_code);
+    table = map->table;
+    pp = table->buckets + (hash_code & table->mask);
+    while ((old_entry=*pp) != NULL) {
+        if (old_entry->hash_code == hash_code &&
+                old_entry->key_len == key_len &&
+                memcmp(old_entry->key, key, key_len) == 0)
+        {
+            break;
+        }
+        pp = &old_entry->next;
+    }
+
+    if (old_entry != NULL) {
+        //replace the old entry, it is freed after the readers leave
+        entry->next = old_entry->next;
+        result = 0;
+    } else {
+        entry->next = table->buckets[hash_code & table->mask];
+        pp = table->buckets + (hash_code & table->mask);
+        result = 1;
+    }
+
+    //publish the entry after its fields are written
+    __sync_synchronize();
+    *pp = entry;
+    RCU_HASH_UNLOCK(map, hash_code);
+
+    if (old_entry != NULL) {
+        rcu_hash_delay_free(map, old_entry);
+    } else if (__sync_add_and_fetch(&map->item_count, 1) >
+            table->capacity)
+    {
+        rcu_hash_resize(map);
+    }
+
+    return result;
+}
+
+int fc_rcu_hash_delete(FCRcuHashMap *map,
+        const void *key, const int key_len)
+{
+    FCRcuHashTable *table;
+    FCRcuHashEntry * volatile *pp;
+    FCRcuHashEntry *entry;
+    unsigned int hash_code;
+
+    hash_code = map->hash_func(key, key_len);
+    RCU_HASH_LOCK(map, hash_code);
+    table = map->table;
+    pp = table->buckets + (hash_code & table->mask);
+    while ((entry=*pp) != NULL) {
+        if (entry->hash_code == hash_code && entry->key_len == key_len &&
+                memcmp(entry->key, key, key_len) == 0)
+        {
+            break;
+        }
+        pp = &entry->next;
+    }
+
+    if (entry == NULL) {
+        RCU_HASH_UNLOCK(map, hash_code);
+        return ENOENT;
+    }
+
+    //the next of the deleted entry keeps unchanged for the readers
+    *pp = entry->next;
+    RCU_HASH_UNLOCK(map, hash_code);
+
+    __sync_sub_and_fetch(&map->item_count, 1);
+    rcu_hash_delay_free(map, entry);
+    return 0;
+}
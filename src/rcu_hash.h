@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//rcu_hash.h
+
+/* concurrent hash map for read mostly, RCU style.
+   the readers never lock, the writers lock the bucket by the lock striping.
+   the entries are immutable after published, the update replaces the entry,
+   the deleted and replaced entries are freed by fast_mblock_delay_free
+   after delay_free_seconds + 1 seconds because the delay free is in the
+   granularity of second, so the entry is valid for delay_free_seconds
+   at least and the reader MUST NOT hold the value longer than that.
+   the resize builds a new bucket table with the cloned entries and
+   publishes it, the readers of the old table are not blocked */
+
+#ifndef _RCU_HASH_H_
+#define _RCU_HASH_H_
+
+#include "common_define.h"
+#include "fast_mblock.h"
+#include "hash.h"
+
+typedef struct fc_rcu_hash_entry
+{
+    struct fc_rcu_hash_entry * volatile next;
+    unsigned int hash_code;
+    int key_len;
+    int value_len;
+    char key[0];  //the value follows the key
+} FCRcuHashEntry;
+
+typedef struct fc_rcu_hash_table
+{
+    unsigned int capacity;  //power of 2
+    unsigned int mask;
+    struct fc_rcu_hash_table *next;  //for the retired tables
+    FCRcuHashEntry * volatile buckets[0];
+} FCRcuHashTable;
+
+typedef struct fc_rcu_hash_map
+{
+    FCRcuHashTable * volatile table;
+    HashFunc hash_func;
+    int key_size;     //the max key length
+    int value_size;   //the max value length
+    int delay_free_seconds;   //delay_free_seconds + 1 for the granularity
+    unsigned int lock_count;  //power of 2, <= the table capacity
+    pthread_mutex_t *locks;
+    volatile int64_t item_count;
+    volatile int resizing;    //only one resizer at the same time
+    FCRcuHashTable *retired_tables;  //free when destroy
+    struct fast_mblock_man entry_allocator;
+} FCRcuHashMap;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * rcu hash init function
+ * parameters:
+ *         map: the hash map
+ *         hash_func: hash function
+ *         key_size: the max key length
+ *         value_size: the max value length
+ *         capacity: init capacity
+ *         lock_count: the lock count for the writers
+ *         delay_free_seconds: the max time the readers hold the value,
+ *                             should be >= 1
+ * return 0 for success, != 0 for error
+*/
+int fc_rcu_hash_init(FCRcuHashMap *map, HashFunc hash_func,
+        const int key_size, const int value_size, const int64_t capacity,
+        const int lock_count, const int delay_free_seconds);
+
+/**
+ * rcu hash destroy function, MUST be called without readers and writers
+ * parameters:
+ *         map: the hash map
+ * return none
+*/
+void fc_rcu_hash_destroy(FCRcuHashMap *map);
+
+/**
+ * rcu hash insert or update the key, the value is copied
+ * parameters:
+ *         map: the hash map
+ *         key: the key to insert
+ *         key_len: length of th key, <= key_size
+ *         value: the value
+ *         value_len: length of the value, >= 0 and <= value_size
+ * return >= 0 for success, 0 for key already exist (update),
+ *        1 for new key (insert), < 0 for error
+*/
+int fc_rcu_hash_insert(FCRcuHashMap *map, const void *key,
+        const int key_len, const void *value, const int value_len);
+
+/**
+ * rcu hash find the key without lock
+ * parameters:
+ *         map: the hash map
+ *         key: the key to find
+ *         key_len: length of th key
+ * return the entry, NULL for not exist. the entry is valid for
+ *        delay_free_seconds
+*/
+const FCRcuHashEntry *fc_rcu_hash_find_entry(FCRcuHashMap *map,
+        const void *key, const int key_len);
+
+static inline const void *fc_rcu_hash_find(FCRcuHashMap *map,
+        const void *key, const int key_len)
+{
+    const FCRcuHashEntry *entry;
+
+    entry = fc_rcu_hash_find_entry(map, key, key_len);
+    return (entry != NULL ? entry->key + entry->key_len : NULL);
+}
+
+/**
+ * rcu hash get the value of the key without lock
+ * parameters:
+ *         map: the hash map
+ *         key: the key to find
+ *         key_len: length of th key
+ *         value: store the value
+ *         value_len: input for the max size of the value
+ *                    output for the length fo the value
+ * return 0 for success, != 0 fail (errno)
+*/
+int fc_rcu_hash_get(FCRcuHashMap *map, const void *key,
+        const int key_len, void *value, int *value_len);
+
+/**
+ * rcu hash delete the key
+ * parameters:
+ *         map: the hash map
+ *         key: the key to delete
+ *         key_len: length of th key
+ * return 0 for success, != 0 fail (errno)
+*/
+int fc_rcu_hash_delete(FCRcuHashMap *map,
+        const void *key, const int key_len);
+
+static inline int64_t fc_rcu_hash_count(FCRcuHashMap *map)
+{
+    return __sync_add_and_fetch(&map->item_count, 0);
+}
+
+static inline unsigned int fc_rcu_hash_capacity(FCRcuHashMap *map)
+{
+    return map->table->capacity;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
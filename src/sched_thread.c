@@ -21,10 +21,12 @@
 #include "pthread_func.h"
 #include "logger.h"
 #include "fc_memory.h"
+#include "thread_pool.h"
 #include "sched_thread.h"
 
 volatile int g_schedule_flag = false;
 volatile time_t g_current_time = 0;
+volatile int64_t g_current_time_ms = 0;
 
 static ScheduleArray waiting_schedule_array = {NULL, 0};
 static int waiting_del_id = -1;
@@ -32,6 +34,8 @@ static int waiting_del_id = -1;
 static ScheduleContext *schedule_context = NULL;
 static int timer_slot_count = 0;
 static int mblock_alloc_once = 0;
+static FCThreadPool *sched_thread_pool = NULL;
+static const FCThreadAffinity *sched_affinity = NULL;
 static uint32_t next_id = 0;
 static bool print_all_entries = false;
 
@@ -39,12 +43,26 @@ static void sched_deal_delay_tasks(ScheduleContext *pContext);
 static int sched_dup_array(const ScheduleArray *pSrcArray,
 		ScheduleArray *pDestArray);
 
+typedef struct sched_pool_task {
+    TaskFunc task_func;
+    void *func_args;
+    ScheduleContext *pContext;
+} SchedPoolTask;
+
 static int sched_cmp_by_next_call_time(const void *p1, const void *p2)
 {
 	return ((ScheduleEntry *)p1)->next_call_time -
 			((ScheduleEntry *)p2)->next_call_time;
 }
 
+int64_t sched_monotonic_time_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 time_t sched_make_first_call_time(struct tm *tm_current,
         const TimeInfo *time_base, const int interval)
 {
@@ -102,6 +120,7 @@ static int sched_init_entries(ScheduleEntry *entries, const int count)
 	ScheduleEntry *pEntry;
 	ScheduleEntry *pEnd;
 	struct tm tm_current;
+	int64_t current_time_ms;
 
 	if (count < 0)
 	{
@@ -117,6 +136,7 @@ static int sched_init_entries(ScheduleEntry *entries, const int count)
 
 	g_current_time = time(NULL);
 	localtime_r((time_t *)&g_current_time, &tm_current);
+	current_time_ms = sched_monotonic_time_ms();
 	pEnd = entries + count;
 	for (pEntry=entries; pEntry<pEnd; pEntry++)
 	{
@@ -125,6 +145,13 @@ static int sched_init_entries(ScheduleEntry *entries, const int count)
             next_id = pEntry->id;
         }
 
+		if (pEntry->interval_ms > 0)
+		{
+			pEntry->next_call_time_ms = current_time_ms +
+				pEntry->interval_ms;
+			continue;
+		}
+
 		if (pEntry->interval <= 0)
 		{
 			logError("file: "__FILE__", line: %d, "
@@ -156,25 +183,45 @@ static void sched_make_chain(ScheduleContext *pContext)
 {
 	ScheduleArray *pScheduleArray;
 	ScheduleEntry *pEntry;
+	ScheduleEntry *pEnd;
 
 	pScheduleArray = &(pContext->scheduleArray);
+	pContext->head = NULL;
+	pContext->tail = NULL;
+	pContext->ms_entry_count = 0;
 	if (pScheduleArray->count == 0)
 	{
-		pContext->head = NULL;
-		pContext->tail = NULL;
 		return;
 	}
 
 	qsort(pScheduleArray->entries, pScheduleArray->count,
 		sizeof(ScheduleEntry), sched_cmp_by_next_call_time);
 
-	pContext->head = pScheduleArray->entries;
-	pContext->tail = pScheduleArray->entries + (pScheduleArray->count - 1);
-	for (pEntry=pScheduleArray->entries; pEntry<pContext->tail; pEntry++)
+	//the entries with interval_ms are dealt by sched_sleep_ms
+	pEnd = pScheduleArray->entries + pScheduleArray->count;
+	for (pEntry=pScheduleArray->entries; pEntry<pEnd; pEntry++)
 	{
-		pEntry->next = pEntry + 1;
+		if (pEntry->interval_ms > 0)
+		{
+			pContext->ms_entry_count++;
+			continue;
+		}
+
+		if (pContext->tail == NULL)
+		{
+			pContext->head = pEntry;
+		}
+		else
+		{
+			pContext->tail->next = pEntry;
+		}
+		pContext->tail = pEntry;
+	}
+
+	if (pContext->tail != NULL)
+	{
+		pContext->tail->next = NULL;
 	}
-	pContext->tail->next = NULL;
 }
 
 void sched_print_all_entries()
@@ -221,10 +268,11 @@ static int print_all_sched_entries(ScheduleArray *pScheduleArray)
             sprintf(timebase, "%02d:%02d:%02d", pEntry->time_base.hour,
                 pEntry->time_base.minute, pEntry->time_base.second);
         }
-        logInfo("id: %u, time_base: %s, interval: %d, "
+        logInfo("id: %u, time_base: %s, interval: %d, interval_ms: %d, "
                 "new_thread: %s, task_func: %p, args: %p, "
                 "next_call_time: %d", pEntry->id, timebase,
-                pEntry->interval, pEntry->new_thread ? "true" : "false",
+                pEntry->interval, pEntry->interval_ms,
+                pEntry->new_thread ? "true" : "false",
                 pEntry->task_func, pEntry->func_args,
                 (int)pEntry->next_call_time);
     }
@@ -401,6 +449,184 @@ static void *sched_call_func(void *args)
 	return NULL;
 }
 
+static void sched_pool_call_func(void *arg, void *thread_data)
+{
+    SchedPoolTask *task;
+    ScheduleContext *pContext;
+
+    task = (SchedPoolTask *)arg;
+    pContext = task->pContext;
+    task->task_func(task->func_args);
+    fast_mblock_free_object(&pContext->pool_task_allocator, task);
+
+    //the last access of the context, it may be freed after then
+    __sync_sub_and_fetch(&pContext->pool_task_count, 1);
+}
+
+/* wait for the running pool tasks which free into the allocator,
+   then destroy the allocator */
+static void sched_destroy_pool_allocator(ScheduleContext *pContext)
+{
+    if (pContext->thread_pool == NULL)
+    {
+        return;
+    }
+
+    while (__sync_add_and_fetch(&pContext->pool_task_count, 0) > 0)
+    {
+        fc_sleep_ms(1);
+    }
+    fast_mblock_destroy(&pContext->pool_task_allocator);
+    pContext->thread_pool = NULL;
+}
+
+static int sched_pool_run_task(ScheduleContext *pContext,
+        TaskFunc task_func, void *func_args)
+{
+    SchedPoolTask *task;
+    int result;
+
+    task = (SchedPoolTask *)fast_mblock_alloc_object(
+            &pContext->pool_task_allocator);
+    if (task == NULL)
+    {
+        return ENOMEM;
+    }
+
+    task->task_func = task_func;
+    task->func_args = func_args;
+    task->pContext = pContext;
+    __sync_add_and_fetch(&pContext->pool_task_count, 1);
+    if ((result=fc_thread_pool_run(pContext->thread_pool,
+                    sched_pool_call_func, task)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "run task in thread pool %s fail, "
+                "errno: %d, error info: %s", __LINE__,
+                pContext->thread_pool->name, result, STRERROR(result));
+        fast_mblock_free_object(&pContext->pool_task_allocator, task);
+        __sync_sub_and_fetch(&pContext->pool_task_count, 1);
+    }
+    return result;
+}
+
+static void sched_call_entry(ScheduleContext *pContext, ScheduleEntry *pEntry)
+{
+    pthread_t tid;
+    int result;
+    int i;
+
+    if (!pEntry->new_thread)
+    {
+        pEntry->task_func(pEntry->func_args);
+        return;
+    }
+
+    if (pContext->thread_pool != NULL)
+    {
+        if (sched_pool_run_task(pContext, pEntry->task_func,
+                    pEntry->func_args) != 0)
+        {
+            pEntry->task_func(pEntry->func_args);
+        }
+        return;
+    }
+
+    pEntry->thread_running = false;
+    if ((result=pthread_create(&tid, NULL,
+                    sched_call_func, pEntry)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, " \
+                "create thread failed, " \
+                "errno: %d, error info: %s", \
+                __LINE__, result, STRERROR(result));
+    }
+    else
+    {
+        fc_sleep_ms(1);
+        for (i=1; !pEntry->thread_running && i<100; i++)
+        {
+            logDebug("file: "__FILE__", line: %d, "
+                    "task_id: %d, waiting thread ready, count %d",
+                    __LINE__, pEntry->id, i);
+            fc_sleep_ms(1);
+        }
+    }
+}
+
+/* call the due entries with interval_ms,
+ * return the earliest next call time in ms */
+static int64_t sched_deal_ms_entries(ScheduleContext *pContext)
+{
+	ScheduleEntry *pEntry;
+	ScheduleEntry *pEnd;
+	int64_t next_call_time_ms;
+
+	next_call_time_ms = INT64_MAX;
+	pEnd = pContext->scheduleArray.entries + pContext->scheduleArray.count;
+	for (pEntry=pContext->scheduleArray.entries; pEntry<pEnd; pEntry++)
+	{
+		if (pEntry->interval_ms <= 0)
+		{
+			continue;
+		}
+
+		if (pEntry->next_call_time_ms <= g_current_time_ms)
+		{
+			sched_call_entry(pContext, pEntry);
+			do
+			{
+				pEntry->next_call_time_ms += pEntry->interval_ms;
+			} while (pEntry->next_call_time_ms <= g_current_time_ms);
+		}
+
+		if (pEntry->next_call_time_ms < next_call_time_ms)
+		{
+			next_call_time_ms = pEntry->next_call_time_ms;
+		}
+	}
+
+	return next_call_time_ms;
+}
+
+/* sleep for the specified milliseconds, the entries with interval_ms
+ * are called during sleeping */
+static void sched_sleep_ms(ScheduleContext *pContext, const int milliseconds)
+{
+	int64_t end_time_ms;
+	int64_t next_call_time_ms;
+
+	if (pContext->ms_entry_count == 0)
+	{
+		//not maintained, computed on read
+		g_current_time_ms = 0;
+		fc_sleep_ms(milliseconds);
+		return;
+	}
+
+	g_current_time_ms = sched_monotonic_time_ms();
+	end_time_ms = g_current_time_ms + milliseconds;
+	while (*(pContext->pcontinue_flag))
+	{
+		next_call_time_ms = sched_deal_ms_entries(pContext);
+		if (g_current_time_ms >= end_time_ms)
+		{
+			break;
+		}
+
+		if (next_call_time_ms > end_time_ms)
+		{
+			next_call_time_ms = end_time_ms;
+		}
+		if (next_call_time_ms > g_current_time_ms)
+		{
+			fc_sleep_ms(next_call_time_ms - g_current_time_ms);
+		}
+		g_current_time_ms = sched_monotonic_time_ms();
+		g_current_time = time(NULL);
+	}
+}
+
 static void *sched_thread_entrance(void *args)
 {
 	ScheduleContext *pContext;
@@ -420,11 +646,14 @@ static void *sched_thread_entrance(void *args)
 	if (sched_init_entries(pContext->scheduleArray.entries,
                 pContext->scheduleArray.count) != 0)
 	{
+        sched_destroy_pool_allocator(pContext);
 		free(pContext);
 		return NULL;
 	}
 	sched_make_chain(pContext);
 
+	g_current_time_ms = (pContext->ms_entry_count > 0 ?
+			sched_monotonic_time_ms() : 0);
     __sync_bool_compare_and_swap(&g_schedule_flag, 0, 1);
 	while (*(pContext->pcontinue_flag))
 	{
@@ -432,9 +661,9 @@ static void *sched_thread_entrance(void *args)
         sched_deal_delay_tasks(pContext);
 
 		sched_check_waiting_more(pContext);
-		if (pContext->scheduleArray.count == 0)  //no schedule entry
+		if (pContext->head == NULL)  //no schedule entry in seconds
 		{
-			sleep(1);
+			sched_sleep_ms(pContext, 1000);
 			continue;
 		}
 
@@ -446,7 +675,7 @@ static void *sched_thread_entrance(void *args)
         while (pContext->head->next_call_time > g_current_time &&
                 *(pContext->pcontinue_flag))
         {
-            sleep(1);
+            sched_sleep_ms(pContext, 1000);
             g_current_time = time(NULL);
 
             sched_deal_delay_tasks(pContext);
@@ -467,36 +696,7 @@ static void *sched_thread_entrance(void *args)
 			&& pCurrent->next_call_time <= g_current_time))
 		{
 			//logInfo("exec task id: %d", pCurrent->id);
-            if (!pCurrent->new_thread)
-            {
-			    pCurrent->task_func(pCurrent->func_args);
-            }
-            else
-            {
-                pthread_t tid;
-                int result;
-
-                pCurrent->thread_running = false;
-                if ((result=pthread_create(&tid, NULL,
-                                sched_call_func, pCurrent)) != 0)
-                {
-                    logError("file: "__FILE__", line: %d, " \
-                            "create thread failed, " \
-                            "errno: %d, error info: %s", \
-                            __LINE__, result, STRERROR(result));
-                }
-                else
-                {
-                    fc_sleep_ms(1);
-                    for (i=1; !pCurrent->thread_running && i<100; i++)
-                    {
-                        logDebug("file: "__FILE__", line: %d, "
-                                "task_id: %d, waiting thread ready, count %d",
-                                __LINE__, pCurrent->id, i);
-                        fc_sleep_ms(1);
-                    }
-                }
-            }
+            sched_call_entry(pContext, pCurrent);
 
             do
             {
@@ -506,12 +706,13 @@ static void *sched_thread_entrance(void *args)
 			exec_count++;
 		}
 
-		if (exec_count == 0 || pContext->scheduleArray.count == 1)
+		if (exec_count == 0 || pContext->head == pContext->tail)
 		{
 			continue;
 		}
 
-		if (exec_count > pContext->scheduleArray.count / 2)
+		if (exec_count > (pContext->scheduleArray.count -
+                    pContext->ms_entry_count) / 2)
 		{
 			sched_make_chain(pContext);
 			continue;
@@ -559,6 +760,7 @@ static void *sched_thread_entrance(void *args)
 	logDebug("file: "__FILE__", line: %d, " \
 		"schedule thread exit", __LINE__);
 
+    sched_destroy_pool_allocator(pContext);
 	free(pContext);
 	return NULL;
 }
@@ -709,6 +911,14 @@ int sched_start_ex(ScheduleArray *pScheduleArray, pthread_t *ptid,
 		return result;
 	}
 
+	if ((result=fc_thread_affinity_set_attr(sched_affinity,
+                    &thread_attr, 0)) != 0)
+	{
+		pthread_attr_destroy(&thread_attr);
+		free(pContext);
+		return result;
+	}
+
 	if ((result=sched_dup_array(pScheduleArray,
 			&(pContext->scheduleArray))) != 0)
 	{
@@ -743,10 +953,23 @@ int sched_start_ex(ScheduleArray *pScheduleArray, pthread_t *ptid,
         pContext->timer_init = true;
     }
 
+    if (sched_thread_pool != NULL)
+    {
+        if ((result=fast_mblock_init_ex1(&pContext->pool_task_allocator,
+                        "sched-pool-task", sizeof(SchedPoolTask),
+                        1024, 0, NULL, NULL, true)) != 0)
+        {
+	    	free(pContext);
+		    return result;
+        }
+        pContext->thread_pool = sched_thread_pool;
+    }
+
 	pContext->pcontinue_flag = pcontinue_flag;
 	if ((result=pthread_create(ptid, &thread_attr, \
 		sched_thread_entrance, pContext)) != 0)
 	{
+        sched_destroy_pool_allocator(pContext);
 		free(pContext);
 		logError("file: "__FILE__", line: %d, " \
 			"create thread failed, " \
@@ -794,6 +1017,16 @@ void sched_set_delay_params(const int slot_count, const int alloc_once)
     }
 }
 
+void sched_set_thread_pool(struct fc_thread_pool *pool)
+{
+    sched_thread_pool = pool;
+}
+
+void sched_set_thread_affinity(const struct fc_thread_affinity *affinity)
+{
+    sched_affinity = affinity;
+}
+
 int sched_add_delay_task_ex(ScheduleContext *pContext, TaskFunc task_func,
         void *func_args, const int delay_seconds, const bool new_thread)
 {
@@ -906,6 +1139,15 @@ static void deal_timeout_tasks(ScheduleContext *pContext, FastTimerEntry *head)
             task->task_func(task->func_args);
             fast_mblock_free_object(&pContext->delay_task_allocator, task);
         }
+        else if (pContext->thread_pool != NULL)
+        {
+            if (sched_pool_run_task(pContext, task->task_func,
+                        task->func_args) != 0)
+            {
+                task->task_func(task->func_args);
+            }
+            fast_mblock_free_object(&pContext->delay_task_allocator, task);
+        }
         else
         {
             struct delay_thread_context delay_context;
@@ -970,6 +1212,11 @@ static int sched_free_ptr_func(void *ptr)
     return 0;
 }
 
+bool sched_delay_task_enabled()
+{
+    return (schedule_context != NULL && schedule_context->timer_init);
+}
+
 int sched_delay_free_ptr(void *ptr, const int delay_seconds)
 {
     const bool new_thread = false;
@@ -46,6 +46,11 @@ typedef struct tagScheduleEntry
 	/* following are internal fields, do not set manually! */
 	time_t next_call_time;  
 	struct tagScheduleEntry *next;
+
+    /* the interval in milliseconds, 0 for the interval in seconds.
+       time_base and interval are ignored when interval_ms > 0 */
+    int interval_ms;
+    int64_t next_call_time_ms;  //internal, the monotonic time for interval_ms
 } ScheduleEntry;
 
 typedef struct
@@ -78,9 +83,17 @@ typedef struct
     struct fc_queue delay_queue;
     pthread_mutex_t lock;
 
+    struct fc_thread_pool *thread_pool;  //run new_thread tasks in the pool
+    struct fast_mblock_man pool_task_allocator;  //for the pool tasks
+    volatile int pool_task_count;  //the running pool tasks
+    int ms_entry_count;  //the count of the entries with interval_ms
+
 	bool *pcontinue_flag;
 } ScheduleContext;
 
+struct fc_thread_pool;
+struct fc_thread_affinity;
+
 #define INIT_SCHEDULE_ENTRY1(schedule_entry, _id, _hour, _minute, _second, \
 	_interval,  _task_func, _func_args, _new_thread) \
 	(schedule_entry).id = _id; \
@@ -88,6 +101,7 @@ typedef struct
 	(schedule_entry).time_base.minute = _minute; \
 	(schedule_entry).time_base.second = _second; \
 	(schedule_entry).interval = _interval;   \
+	(schedule_entry).interval_ms = 0;   \
 	(schedule_entry).task_func = _task_func; \
 	(schedule_entry).func_args = _func_args; \
 	(schedule_entry).new_thread = _new_thread
@@ -97,6 +111,7 @@ typedef struct
 	(schedule_entry).id = _id; \
 	(schedule_entry).time_base = _time_base; \
 	(schedule_entry).interval = _interval;   \
+	(schedule_entry).interval_ms = 0;   \
 	(schedule_entry).task_func = _task_func; \
 	(schedule_entry).func_args = _func_args; \
 	(schedule_entry).new_thread = _new_thread
@@ -111,6 +126,18 @@ typedef struct
         INIT_SCHEDULE_ENTRY_EX1(schedule_entry, _id, _time_base, \
                 _interval,  _task_func, _func_args, false)
 
+#define INIT_SCHEDULE_ENTRY_MS(schedule_entry, _id, _interval_ms, \
+	_task_func, _func_args, _new_thread) \
+	(schedule_entry).id = _id; \
+	(schedule_entry).time_base.hour = TIME_NONE; \
+	(schedule_entry).time_base.minute = 0; \
+	(schedule_entry).time_base.second = 0; \
+	(schedule_entry).interval = 0;   \
+	(schedule_entry).interval_ms = _interval_ms;   \
+	(schedule_entry).task_func = _task_func; \
+	(schedule_entry).func_args = _func_args; \
+	(schedule_entry).new_thread = _new_thread
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -119,8 +146,33 @@ extern "C" {
 extern volatile int g_schedule_flag; //schedule continue running flag
 extern volatile time_t g_current_time;  //the current time
 
+/* the current monotonic time in ms, updated by the schedule thread when
+   it wakes up for the entries with interval_ms, so the resolution is the
+   smallest interval_ms. 0 when no such entries (not maintained) */
+extern volatile int64_t g_current_time_ms;
+
 #define get_current_time() (g_schedule_flag ? g_current_time: time(NULL))
 
+/** get the monotonic time in ms without the cache
+ * return: the monotonic time in ms
+*/
+int64_t sched_monotonic_time_ms();
+
+/** get the monotonic time in ms, the cached time of the schedule thread
+ *  when it is maintained (see g_current_time_ms), otherwise computed on read
+ * return: the monotonic time in ms
+*/
+static inline int64_t get_current_monotonic_ms()
+{
+    int64_t current_time_ms;
+
+    if (g_schedule_flag && (current_time_ms=g_current_time_ms) > 0)
+    {
+        return current_time_ms;
+    }
+    return sched_monotonic_time_ms();
+}
+
 /** generate next id
  * return: next id
 */
@@ -152,6 +204,23 @@ int sched_del_entry(const int id);
 */
 void sched_set_delay_params(const int slot_count, const int alloc_once);
 
+/** run the tasks with new_thread (including delay tasks) in the thread
+ *  pool instead of creating a thread for each call
+ *  parameters:
+ *  	     pool: the thread pool, NULL for creating threads
+ * return: none
+ * Note: you should call this function before sched_start
+*/
+void sched_set_thread_pool(struct fc_thread_pool *pool);
+
+/** set the placement of the schedule thread (as the thread index 0)
+ *  parameters:
+ *  	     affinity: the thread affinity, NULL for no placement
+ * return: none
+ * Note: you should call this function before sched_start
+*/
+void sched_set_thread_affinity(const struct fc_thread_affinity *affinity);
+
 /** add a delay task
  *  parameters:
  *  	     pContext: the ScheduleContext pointer
@@ -176,6 +245,12 @@ int sched_add_delay_task(TaskFunc task_func, void *func_args,
 */
 int sched_delay_free_ptr(void *ptr, const int delay_seconds);
 
+/** check if the delay tasks are supported, the sched_set_delay_params
+ *  is called and the schedule thread started
+ * return: true for enabled
+*/
+bool sched_delay_task_enabled();
+
 
 /** init the schedule context
  *  parameters:
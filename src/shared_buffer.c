@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <errno.h>
+#include "sockopt.h"
 #include "shared_buffer.h"
 
 static int shared_buffer_alloc_init(void *element, void *args)
@@ -50,10 +51,361 @@ int shared_buffer_init_ex(SharedBufferContext *context,
         return result;
     }
 
+    if ((result=fast_mblock_init_ex1(&context->slice_allocator,
+                    "shared-buffer-slice", sizeof(SharedBufferSlice),
+                    alloc_elements_once, alloc_elements_limit,
+                    NULL, NULL, need_lock)) != 0)
+    {
+        fast_mblock_destroy(&context->allocator);
+        return result;
+    }
+
     return 0;
 }
 
 void shared_buffer_destroy(SharedBufferContext *context)
 {
+    fast_mblock_destroy(&context->slice_allocator);
     fast_mblock_destroy(&context->allocator);
 }
+
+static inline SharedBufferSlice *shared_buffer_slice_new(
+        SharedBufferChain *chain, SharedBuffer *buffer,
+        char *data, const int length)
+{
+    SharedBufferSlice *slice;
+
+    if ((slice=(SharedBufferSlice *)fast_mblock_alloc_object(
+                    &chain->ctx->slice_allocator)) == NULL)
+    {
+        return NULL;
+    }
+
+    shared_buffer_hold(buffer);
+    slice->buffer = buffer;
+    slice->data = data;
+    slice->length = length;
+    slice->next = NULL;
+    return slice;
+}
+
+static inline void shared_buffer_slice_free(SharedBufferChain *chain,
+        SharedBufferSlice *slice)
+{
+    shared_buffer_release(slice->buffer);
+    fast_mblock_free_object(&chain->ctx->slice_allocator, slice);
+}
+
+static inline void shared_buffer_chain_add_tail(SharedBufferChain *chain,
+        SharedBufferSlice *slice)
+{
+    if (chain->tail == NULL) {
+        chain->head = slice;
+    } else {
+        chain->tail->next = slice;
+    }
+    chain->tail = slice;
+    chain->count++;
+    chain->length += slice->length;
+}
+
+static inline void shared_buffer_chain_add_head(SharedBufferChain *chain,
+        SharedBufferSlice *slice)
+{
+    slice->next = chain->head;
+    chain->head = slice;
+    if (chain->tail == NULL) {
+        chain->tail = slice;
+    }
+    chain->count++;
+    chain->length += slice->length;
+}
+
+void shared_buffer_chain_release(SharedBufferChain *chain)
+{
+    SharedBufferSlice *slice;
+    SharedBufferSlice *deleted;
+
+    slice = chain->head;
+    while (slice != NULL) {
+        deleted = slice;
+        slice = slice->next;
+        shared_buffer_slice_free(chain, deleted);
+    }
+
+    chain->head = chain->tail = NULL;
+    chain->count = 0;
+    chain->length = 0;
+}
+
+static int shared_buffer_check_slice(SharedBuffer *buffer,
+        const int offset, const int length)
+{
+    if (offset < 0 || length < 0 || offset + length > buffer->length) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid slice, offset: %d, length: %d, "
+                "buffer length: %d", __LINE__, offset,
+                length, buffer->length);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+int shared_buffer_chain_append_slice(SharedBufferChain *chain,
+        SharedBuffer *buffer, const int offset, const int length)
+{
+    SharedBufferSlice *slice;
+    int result;
+
+    if ((result=shared_buffer_check_slice(buffer, offset, length)) != 0) {
+        return result;
+    }
+
+    if ((slice=shared_buffer_slice_new(chain, buffer,
+                    buffer->buff + offset, length)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    shared_buffer_chain_add_tail(chain, slice);
+    return 0;
+}
+
+int shared_buffer_chain_prepend_slice(SharedBufferChain *chain,
+        SharedBuffer *buffer, const int offset, const int length)
+{
+    SharedBufferSlice *slice;
+    int result;
+
+    if ((result=shared_buffer_check_slice(buffer, offset, length)) != 0) {
+        return result;
+    }
+
+    if ((slice=shared_buffer_slice_new(chain, buffer,
+                    buffer->buff + offset, length)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    shared_buffer_chain_add_head(chain, slice);
+    return 0;
+}
+
+int shared_buffer_chain_prepend_header(SharedBufferChain *chain,
+        const char *header, const int length)
+{
+    SharedBuffer *buffer;
+    int result;
+
+    if ((buffer=shared_buffer_alloc(chain->ctx)) == NULL) {
+        return ENOMEM;
+    }
+
+    shared_buffer_hold(buffer);
+    if ((result=shared_buffer_check_capacity(buffer, length)) == 0) {
+        memcpy(buffer->buff, header, length);
+        buffer->length = length;
+        result = shared_buffer_chain_prepend_slice(
+                chain, buffer, 0, length);
+    }
+    shared_buffer_release(buffer);
+    return result;
+}
+
+int shared_buffer_chain_append_chain(SharedBufferChain *dest,
+        const SharedBufferChain *src)
+{
+    SharedBufferSlice *current;
+    SharedBufferSlice *slice;
+    SharedBufferSlice *old_tail;
+    int old_count;
+    int64_t old_length;
+
+    old_tail = dest->tail;
+    old_count = dest->count;
+    old_length = dest->length;
+    for (current=src->head; current!=NULL; current=current->next) {
+        if ((slice=shared_buffer_slice_new(dest, current->buffer,
+                        current->data, current->length)) == NULL)
+        {
+            break;
+        }
+        shared_buffer_chain_add_tail(dest, slice);
+    }
+
+    if (current == NULL) {
+        return 0;
+    }
+
+    //release the slices appended so far, the dest chain is unchanged
+    slice = (old_tail != NULL ? old_tail->next : dest->head);
+    while (slice != NULL) {
+        current = slice;
+        slice = slice->next;
+        shared_buffer_slice_free(dest, current);
+    }
+
+    if (old_tail != NULL) {
+        old_tail->next = NULL;
+    } else {
+        dest->head = NULL;
+    }
+    dest->tail = old_tail;
+    dest->count = old_count;
+    dest->length = old_length;
+    return ENOMEM;
+}
+
+int shared_buffer_chain_split(SharedBufferChain *chain,
+        const int64_t offset, SharedBufferChain *tail)
+{
+    SharedBufferSlice *slice;
+    SharedBufferSlice *second;
+    int64_t length;
+    int count;
+    int split_len;
+
+    if (offset < 0 || offset > chain->length) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid split offset: %"PRId64", chain length: "
+                "%"PRId64, __LINE__, offset, chain->length);
+        return EINVAL;
+    }
+
+    if (offset == chain->length) {
+        return 0;
+    }
+
+    if (offset == 0) {
+        tail->head = chain->head;
+        tail->tail = chain->tail;
+        tail->count = chain->count;
+        tail->length = chain->length;
+        chain->head = chain->tail = NULL;
+        chain->count = 0;
+        chain->length = 0;
+        return 0;
+    }
+
+    //find the slice which contains the offset
+    length = 0;
+    count = 0;
+    slice = chain->head;
+    while (length + slice->length < offset) {
+        length += slice->length;
+        count++;
+        slice = slice->next;
+    }
+    count++;
+
+    split_len = offset - length;
+    if (split_len < slice->length) {
+        if ((second=shared_buffer_slice_new(chain, slice->buffer,
+                        slice->data + split_len, slice->length -
+                        split_len)) == NULL)
+        {
+            return ENOMEM;
+        }
+
+        second->next = slice->next;
+        slice->next = second;
+        slice->length = split_len;
+        if (chain->tail == slice) {
+            chain->tail = second;
+        }
+        chain->count++;
+    }
+
+    tail->head = slice->next;
+    tail->tail = chain->tail;
+    tail->count = chain->count - count;
+    tail->length = chain->length - offset;
+
+    slice->next = NULL;
+    chain->tail = slice;
+    chain->count = count;
+    chain->length = offset;
+    return 0;
+}
+
+void shared_buffer_chain_consume(SharedBufferChain *chain,
+        const int64_t bytes)
+{
+    SharedBufferSlice *slice;
+    int64_t remain;
+
+    remain = bytes;
+    while (remain > 0 && (slice=chain->head) != NULL) {
+        if (remain < slice->length) {
+            slice->data += remain;
+            slice->length -= remain;
+            chain->length -= remain;
+            break;
+        }
+
+        remain -= slice->length;
+        chain->length -= slice->length;
+        chain->count--;
+        chain->head = slice->next;
+        shared_buffer_slice_free(chain, slice);
+    }
+
+    if (chain->head == NULL) {
+        chain->tail = NULL;
+    }
+}
+
+int shared_buffer_chain_to_iovec(const SharedBufferChain *chain,
+        struct iovec *iov, const int size)
+{
+    SharedBufferSlice *slice;
+    struct iovec *current;
+    struct iovec *end;
+
+    current = iov;
+    end = iov + size;
+    for (slice=chain->head; slice!=NULL && current<end;
+            slice=slice->next)
+    {
+        if (slice->length > 0) {
+            current->iov_base = slice->data;
+            current->iov_len = slice->length;
+            current++;
+        }
+    }
+
+    return current - iov;
+}
+
+int shared_buffer_chain_writev_nb(int sock, const SharedBufferChain *chain,
+        const int timeout)
+{
+#define SHARED_BUFFER_IOV_BATCH  64
+    struct iovec iov[SHARED_BUFFER_IOV_BATCH];
+    SharedBufferSlice *slice;
+    int count;
+    int result;
+
+    slice = chain->head;
+    while (slice != NULL) {
+        count = 0;
+        for (; slice!=NULL && count<SHARED_BUFFER_IOV_BATCH;
+                slice=slice->next)
+        {
+            if (slice->length > 0) {
+                iov[count].iov_base = slice->data;
+                iov[count].iov_len = slice->length;
+                count++;
+            }
+        }
+
+        if (count > 0 && (result=tcpwritev_nb(sock,
+                        iov, count, timeout)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
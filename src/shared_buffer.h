@@ -17,12 +17,14 @@
 #define __SHARED_BUFFER_H__
 
 #include <stdint.h>
+#include <sys/uio.h>
 #include "common_define.h"
 #include "fast_mblock.h"
 #include "logger.h"
 
 typedef struct shared_buffer_context {
     struct fast_mblock_man allocator;
+    struct fast_mblock_man slice_allocator;  //for buffer chain
     int buffer_init_capacity;
 } SharedBufferContext;
 
@@ -34,6 +36,24 @@ typedef struct shared_buffer {
     SharedBufferContext *ctx;
 } SharedBuffer;
 
+/* the slice references a segment of the shared buffer (hold one reffer) */
+typedef struct shared_buffer_slice {
+    SharedBuffer *buffer;
+    char *data;
+    int length;
+    struct shared_buffer_slice *next;
+} SharedBufferSlice;
+
+/* the buffer chain (rope) of the slices for zero copy,
+   the referenced buffers should NOT be resized */
+typedef struct shared_buffer_chain {
+    SharedBufferContext *ctx;
+    SharedBufferSlice *head;
+    SharedBufferSlice *tail;
+    int count;       //slice count
+    int64_t length;  //total bytes of the slices
+} SharedBufferChain;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -104,6 +124,112 @@ static inline int shared_buffer_check_capacity(SharedBuffer *buffer,
     return 0;
 }
 
+static inline void shared_buffer_chain_init(SharedBufferChain *chain,
+        SharedBufferContext *ctx)
+{
+    chain->ctx = ctx;
+    chain->head = chain->tail = NULL;
+    chain->count = 0;
+    chain->length = 0;
+}
+
+/** release all slices of the chain
+ *  parameters:
+ *          chain: the buffer chain
+ *  return: none
+*/
+void shared_buffer_chain_release(SharedBufferChain *chain);
+
+/** append a segment of the buffer to the chain
+ *  parameters:
+ *          chain: the buffer chain
+ *          buffer: the shared buffer to reference
+ *          offset: the offset of the segment
+ *          length: the length of the segment
+ *  return: error no, 0 success, != 0 fail
+*/
+int shared_buffer_chain_append_slice(SharedBufferChain *chain,
+        SharedBuffer *buffer, const int offset, const int length);
+
+static inline int shared_buffer_chain_append(SharedBufferChain *chain,
+        SharedBuffer *buffer)
+{
+    return shared_buffer_chain_append_slice(chain,
+            buffer, 0, buffer->length);
+}
+
+/** prepend a segment of the buffer to the chain
+ *  parameters:
+ *          chain: the buffer chain
+ *          buffer: the shared buffer to reference
+ *          offset: the offset of the segment
+ *          length: the length of the segment
+ *  return: error no, 0 success, != 0 fail
+*/
+int shared_buffer_chain_prepend_slice(SharedBufferChain *chain,
+        SharedBuffer *buffer, const int offset, const int length);
+
+/** prepend a header, the header is copied to a new shared buffer
+ *  parameters:
+ *          chain: the buffer chain
+ *          header: the header to copy
+ *          length: the length of the header
+ *  return: error no, 0 success, != 0 fail
+*/
+int shared_buffer_chain_prepend_header(SharedBufferChain *chain,
+        const char *header, const int length);
+
+/** append the slices of the src chain to the dest chain by reference,
+ *  such as the same payload for multi peers
+ *  parameters:
+ *          dest: the dest buffer chain
+ *          src: the src buffer chain
+ *  return: error no, 0 success, != 0 fail and the dest chain is unchanged
+*/
+int shared_buffer_chain_append_chain(SharedBufferChain *dest,
+        const SharedBufferChain *src);
+
+/** split the chain at the offset, the bytes after the offset are
+ *  moved to the tail chain
+ *  parameters:
+ *          chain: the buffer chain
+ *          offset: the split offset
+ *          tail: the chain to store the tail bytes, should be empty
+ *  return: error no, 0 success, != 0 fail
+*/
+int shared_buffer_chain_split(SharedBufferChain *chain,
+        const int64_t offset, SharedBufferChain *tail);
+
+/** consume the bytes from the front of the chain, such as the bytes sent
+ *  parameters:
+ *          chain: the buffer chain
+ *          bytes: the bytes to consume
+ *  return: none
+*/
+void shared_buffer_chain_consume(SharedBufferChain *chain,
+        const int64_t bytes);
+
+/** export the slices to the iovec array
+ *  parameters:
+ *          chain: the buffer chain
+ *          iov: the iovec array
+ *          size: the size of the iovec array
+ *  return: the iovec count
+*/
+int shared_buffer_chain_to_iovec(const SharedBufferChain *chain,
+        struct iovec *iov, const int size);
+
+/** send the chain by writev (non-block mode), the chain is NOT changed
+ *  so it can be sent to multi peers
+ *  parameters:
+ *          sock: the socket
+ *          chain: the buffer chain
+ *          timeout: write timeout
+ *  return: error no, 0 success, != 0 fail
+*/
+int shared_buffer_chain_writev_nb(int sock, const SharedBufferChain *chain,
+        const int timeout);
+
 #ifdef __cplusplus
 }
 #endif
@@ -957,4 +957,139 @@ int get_path_block_size(const char *path, int *block_size)
 
     return get_block_size_by_write(path, block_size);
 }
+
+#define NUMA_NODE_BASE_PATH  "/sys/devices/system/node"
+
+int get_numa_node_count()
+{
+    DIR *dir;
+    struct dirent *ent;
+    int node;
+    int max_node;
+
+    if ((dir=opendir(NUMA_NODE_BASE_PATH)) == NULL) {
+        return 1;
+    }
+
+    max_node = 0;
+    while ((ent=readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "node", 4) != 0 ||
+                !FC_IS_DIGITAL(ent->d_name[4]))
+        {
+            continue;
+        }
+
+        node = strtol(ent->d_name + 4, NULL, 10);
+        if (node > max_node) {
+            max_node = node;
+        }
+    }
+    closedir(dir);
+
+    return max_node + 1;
+}
+
+int get_cpu_numa_nodes(int *cpu_nodes, const int size)
+{
+    char filename[PATH_MAX];
+    char buff[1024];
+    int64_t file_size;
+    int *cpus;
+    int node_count;
+    int cpu_count;
+    int node;
+    int result;
+    int i;
+
+    memset(cpu_nodes, 0, sizeof(int) * size);
+    if ((node_count=get_numa_node_count()) <= 1) {
+        return 0;
+    }
+
+    cpus = (int *)fc_malloc(sizeof(int) * size);
+    if (cpus == NULL) {
+        return ENOMEM;
+    }
+
+    result = 0;
+    for (node=0; node<node_count; node++) {
+        snprintf(filename, sizeof(filename), "%s/node%d/cpulist",
+                NUMA_NODE_BASE_PATH, node);
+        if (access(filename, F_OK) != 0) {
+            continue;
+        }
+
+        file_size = sizeof(buff) - 1;
+        if ((result=getFileContentEx(filename, buff, 0, &file_size)) != 0) {
+            break;
+        }
+        buff[file_size] = '\0';
+        if ((result=fc_parse_cpu_list(buff, cpus, size, &cpu_count)) != 0) {
+            break;
+        }
+
+        for (i=0; i<cpu_count; i++) {
+            cpu_nodes[cpus[i]] = node;
+        }
+    }
+
+    free(cpus);
+    return result;
+}
 #endif
+
+int fc_parse_cpu_list(const char *cpu_list, int *cpus,
+        const int size, int *count)
+{
+    const char *p;
+    char *endptr;
+    int start;
+    int end;
+    int cpu;
+
+    *count = 0;
+    p = cpu_list;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',' ||
+                *p == '\n' || *p == '\r')
+        {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+
+        start = strtol(p, &endptr, 10);
+        if (endptr == p || start < 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "invalid CPU list: %s", __LINE__, cpu_list);
+            return EINVAL;
+        }
+        p = endptr;
+
+        if (*p == '-') {
+            p++;
+            end = strtol(p, &endptr, 10);
+            if (endptr == p || end < start) {
+                logError("file: "__FILE__", line: %d, "
+                        "invalid CPU list: %s", __LINE__, cpu_list);
+                return EINVAL;
+            }
+            p = endptr;
+        } else {
+            end = start;
+        }
+
+        for (cpu=start; cpu<=end; cpu++) {
+            if (cpu >= size || *count >= size) {
+                logError("file: "__FILE__", line: %d, "
+                        "CPU id: %d or count: %d exceeds %d",
+                        __LINE__, cpu, *count, size);
+                return EOVERFLOW;
+            }
+            cpus[(*count)++] = cpu;
+        }
+    }
+
+    return 0;
+}
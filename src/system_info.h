@@ -167,10 +167,35 @@ int get_kernel_version(Version *version);
 #ifdef OS_LINUX
 int get_device_block_size(const char *device, int *block_size);
 int get_path_block_size(const char *path, int *block_size);
+
+/** get NUMA node count
+ *  parameters:
+ *  return: the NUMA node count, 1 for NUMA not available
+*/
+int get_numa_node_count();
+
+/** get the NUMA node of each CPU
+ *  parameters:
+ *      cpu_nodes: return the node of each CPU, indexed by CPU id
+ *      size: max size of the array
+ *  return: error no, 0 success, != 0 fail
+*/
+int get_cpu_numa_nodes(int *cpu_nodes, const int size);
 #endif
 
 #endif
 
+/** parse CPU list such as 0-3,8,10-11
+ *  parameters:
+ *      cpu_list: the CPU list string
+ *      cpus: return the CPU ids
+ *      size: max size of the cpus array
+ *      count: return the CPU count
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_parse_cpu_list(const char *cpu_list, int *cpus,
+        const int size, int *count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,17 +20,22 @@
 #include <time.h>
 #include <inttypes.h>
 #include <sys/time.h>
+#include <assert.h>
 #include "fastcommon/logger.h"
 #include "fastcommon/shared_func.h"
 #include "fastcommon/sched_thread.h"
 #include "fastcommon/ini_file_reader.h"
 #include "fastcommon/fast_allocator.h"
+#include "fastcommon/array_allocator.h"
 
 #define OUTER_LOOP_COUNT 128
 #define INNER_LOOP_COUNT 1024 * 64
 
 #define USE_ALLOCATOR 1
 
+#define THREAD_CACHE_CONTEXT_COUNT  16
+#define THREAD_CACHE_ALLOC_COUNT    4096
+
 #if USE_ALLOCATOR == 1
 #define MALLOC(bytes) fast_allocator_alloc(&acontext, bytes)
 #define FREE(ptr) fast_allocator_free(&acontext, ptr)
@@ -39,6 +44,143 @@
 #define FREE(ptr) free(ptr)
 #endif
 
+//the contexts are used one by one for the shared malloc allocator
+static void test_realloc()
+{
+	struct fast_allocator_context context;
+	struct fast_allocator_context *acontext;
+	ArrayAllocatorContext array_ctx;
+	I64Array *array;
+	char *ptr;
+	char *new_ptr;
+	int i;
+
+	acontext = &context;
+	assert(fast_allocator_init(acontext, NULL, 0, 0.00, 0, true) == 0);
+
+	//grow within the same slot class keeps the pointer
+	ptr = (char *)fast_allocator_alloc(acontext, 2000);
+	assert(ptr != NULL);
+	memset(ptr, 'a', 2000);
+	new_ptr = (char *)fast_allocator_realloc(acontext, ptr, 2010);
+	assert(new_ptr == ptr);
+
+	//the class changes, the content is copied
+	new_ptr = (char *)fast_allocator_realloc(acontext, ptr, 3000);
+	assert(new_ptr != NULL && new_ptr != ptr);
+	for (i=0; i<2000; i++) {
+		assert(new_ptr[i] == 'a');
+	}
+
+	//beyond the pooled regions
+	ptr = (char *)fast_allocator_realloc(acontext, new_ptr, 100 * 1024);
+	assert(ptr != NULL && ptr[1999] == 'a');
+	ptr = (char *)fast_allocator_realloc(acontext, ptr, 200 * 1024);
+	assert(ptr != NULL && ptr[0] == 'a');
+	fast_allocator_free(acontext, ptr);
+	fast_allocator_destroy(acontext);
+
+	//the array keeps the used elements
+	assert(i64_array_allocator_init(&array_ctx, 2, 10) == 0);
+	array = i64_array_allocator_alloc(&array_ctx, 4);
+	assert(array != NULL);
+	array->count = 0;
+	for (i=0; i<1000; i++) {
+		if (array->count == array->alloc) {
+			array = i64_array_allocator_realloc(&array_ctx,
+					array, array->count + 1);
+			assert(array != NULL && array->alloc > array->count);
+		}
+		array->elts[array->count++] = i;
+	}
+	for (i=0; i<1000; i++) {
+		assert(array->elts[i] == i);
+	}
+	i64_array_allocator_free(&array_ctx, array);
+	fast_allocator_destroy(&array_ctx.allocator);
+	printf("realloc test OK\n");
+}
+
+static void *thread_cache_func(void *arg)
+{
+	struct fast_allocator_context *contexts;
+	void *ptrs[THREAD_CACHE_ALLOC_COUNT];
+	int i;
+	int k;
+
+	contexts = (struct fast_allocator_context *)arg;
+	for (k=0; k<THREAD_CACHE_CONTEXT_COUNT; k++) {
+		for (i=0; i<THREAD_CACHE_ALLOC_COUNT; i++) {
+			ptrs[i] = fast_allocator_alloc(contexts + k, 1 + i % 1000);
+			assert(ptrs[i] != NULL);
+		}
+		for (i=0; i<THREAD_CACHE_ALLOC_COUNT; i++) {
+			fast_allocator_free(contexts + k, ptrs[i]);
+		}
+	}
+	return NULL;
+}
+
+static void test_thread_cache()
+{
+	const int64_t alloc_bytes_limit = 1024 * 1024;
+	struct fast_allocator_context contexts[THREAD_CACHE_CONTEXT_COUNT];
+	struct fast_allocator_context *acontext;
+	pthread_t tids[4];
+	void **ptrs;
+	int count;
+	int i;
+	int k;
+
+	//one thread key per context, many contexts with thread cache
+	for (k=0; k<THREAD_CACHE_CONTEXT_COUNT; k++) {
+		assert(fast_allocator_init(contexts + k, NULL,
+					0, 0.00, 0, true) == 0);
+		assert(fast_allocator_set_thread_cache(contexts + k,
+					64 * 1024) == 0);
+	}
+	for (i=0; i<4; i++) {
+		assert(pthread_create(tids + i, NULL,
+					thread_cache_func, contexts) == 0);
+	}
+	for (i=0; i<4; i++) {
+		pthread_join(tids[i], NULL);
+	}
+	for (k=0; k<THREAD_CACHE_CONTEXT_COUNT; k++) {
+		//the magazines are returned when the threads exit
+		for (i=0; i<contexts[k].allocator_array.count; i++) {
+			assert(fast_mblock_thread_cached_count(&contexts[k].
+						allocator_array.allocators[i]->mblock) == 0);
+		}
+		assert(contexts[k].alloc_bytes == 0);
+		fast_allocator_destroy(contexts + k);
+	}
+
+	//the accounting is exact with the limit
+	acontext = contexts + 0;
+	assert(fast_allocator_init(acontext, NULL, alloc_bytes_limit,
+				0.00, 0, true) == 0);
+	assert(fast_allocator_set_thread_cache(acontext, 64 * 1024) == 0);
+	ptrs = (void **)malloc(sizeof(void *) * alloc_bytes_limit / 100);
+	assert(ptrs != NULL);
+	count = 0;
+	while (count < alloc_bytes_limit / 100 && (ptrs[count]=
+				fast_allocator_alloc(acontext, 100)) != NULL)
+	{
+		count++;
+		assert(acontext->alloc_bytes ==
+				fast_allocator_alloc_bytes(acontext));
+	}
+	assert(count > 0 && count < alloc_bytes_limit / 100);
+	assert(acontext->alloc_bytes <= alloc_bytes_limit);
+	for (i=0; i<count; i++) {
+		fast_allocator_free(acontext, ptrs[i]);
+	}
+	assert(acontext->alloc_bytes == 0);
+	free(ptrs);
+	fast_allocator_destroy(acontext);
+	printf("thread cache test OK\n");
+}
 
 int main(int argc, char *argv[])
 {
@@ -83,6 +225,9 @@ int main(int argc, char *argv[])
 	printf("time used: %"PRId64" ms\n", get_current_time_ms() - start_time);
 
 	fast_allocator_destroy(&acontext);
+
+	test_realloc();
+	test_thread_cache();
 	return 0;
 }
 
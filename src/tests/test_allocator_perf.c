@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <sys/time.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_allocator.h"
+
+#define ALLOC_MODE_MALLOC        0
+#define ALLOC_MODE_ALLOCATOR     1
+#define ALLOC_MODE_THREAD_CACHE  2
+
+#define BATCH_SIZE   64
+#define MAX_THREADS  64
+#define STRING_COUNT 1024
+
+static int loop_count = 1000 * 1000;
+static int max_threads = MAX_THREADS;
+static int alloc_mode;
+static struct fast_allocator_context acontext;
+
+/* the strings of random length from 8 to 128 bytes */
+static char *strings[STRING_COUNT];
+
+static void *thread_func(void *arg)
+{
+    char *ptrs[BATCH_SIZE];
+    const char *src;
+    int i;
+    int k;
+
+    for (i=0; i<loop_count; i+=BATCH_SIZE) {
+        for (k=0; k<BATCH_SIZE; k++) {
+            src = strings[(i + k) % STRING_COUNT];
+            if (alloc_mode == ALLOC_MODE_MALLOC) {
+                ptrs[k] = strdup(src);
+            } else {
+                ptrs[k] = fast_allocator_strdup(&acontext, src);
+            }
+            if (ptrs[k] == NULL) {
+                return NULL;
+            }
+        }
+
+        for (k=0; k<BATCH_SIZE; k++) {
+            if (alloc_mode == ALLOC_MODE_MALLOC) {
+                free(ptrs[k]);
+            } else {
+                fast_allocator_free(&acontext, ptrs[k]);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int test_mode(const int mode, const int thread_count)
+{
+    pthread_t tids[MAX_THREADS];
+    int64_t start_time;
+    int64_t time_used;
+    int result;
+    int i;
+
+    alloc_mode = mode;
+    if (mode != ALLOC_MODE_MALLOC) {
+        if ((result=fast_allocator_init(&acontext, "perf",
+                        0, 0.00, -1, true)) != 0)
+        {
+            return result;
+        }
+        if (mode == ALLOC_MODE_THREAD_CACHE && (result=
+                    fast_allocator_set_thread_cache(&acontext,
+                        64 * 1024)) != 0)
+        {
+            fast_allocator_destroy(&acontext);
+            return result;
+        }
+    }
+
+    start_time = get_current_time_us();
+    for (i=0; i<thread_count; i++) {
+        if ((result=pthread_create(tids + i, NULL,
+                        thread_func, NULL)) != 0)
+        {
+            return result;
+        }
+    }
+    for (i=0; i<thread_count; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    time_used = get_current_time_us() - start_time;
+
+    if (mode != ALLOC_MODE_MALLOC) {
+        if (fast_allocator_alloc_bytes(&acontext) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "alloc bytes: %"PRId64" != 0", __LINE__,
+                    fast_allocator_alloc_bytes(&acontext));
+        }
+        fast_allocator_destroy(&acontext);
+    }
+
+    printf("%12s %8d %10"PRId64" %14.2f\n", mode == ALLOC_MODE_MALLOC ?
+            "malloc" : (mode == ALLOC_MODE_ALLOCATOR ? "allocator" :
+                "thread_cache"), thread_count, time_used / 1000,
+            (double)loop_count * thread_count / (double)time_used);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int thread_count;
+    int mode;
+    int len;
+    int i;
+
+    log_init();
+    srand(time(NULL));
+    if (argc > 1) {
+        loop_count = strtol(argv[1], NULL, 10);
+        if (argc > 2) {
+            max_threads = strtol(argv[2], NULL, 10);
+            if (max_threads > MAX_THREADS) {
+                max_threads = MAX_THREADS;
+            }
+        }
+    }
+
+    for (i=0; i<STRING_COUNT; i++) {
+        len = 8 + rand() % 121;
+        strings[i] = (char *)malloc(len + 1);
+        memset(strings[i], 'a' + i % 26, len);
+        strings[i][len] = '\0';
+    }
+
+    fast_mblock_manager_init();
+    printf("strdup / free loop count per thread: %d\n", loop_count);
+    printf("%12s %8s %10s %14s\n", "mode", "threads", "time(ms)", "ops/us");
+    for (thread_count=1; thread_count<=max_threads; thread_count*=2) {
+        for (mode=ALLOC_MODE_MALLOC; mode<=ALLOC_MODE_THREAD_CACHE; mode++) {
+            test_mode(mode, thread_count);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -22,6 +22,7 @@
 #include <sys/time.h>
 #include "fastcommon/logger.h"
 #include "fastcommon/shared_func.h"
+#include "fastcommon/hash.h"
 
 static void usage(const char *program)
 {
@@ -38,6 +39,7 @@ int main(int argc, char *argv[])
     int64_t offset;
     int64_t file_size;
     int64_t crc32;
+    int crc1, crc2;
     int byte1, byte2;
 
     if (argc < 2) {
@@ -104,5 +106,18 @@ int main(int argc, char *argv[])
     crc32 = CRC32_FINAL(crc32);
     printf("crc32 by 2 parts: %x\n", (int)crc32);
 
+    crc1 = CRC32(content, byte1);
+    crc2 = CRC32(content + byte1, byte2);
+    printf("crc32 combine 2 parts: %x\n",
+            CRC32_combine(crc1, crc2, byte2));
+
+    printf("crc32c whole: %x, hardware: %d\n",
+            CRC32C(content, (int)file_size),
+            CRC32C_hardware_enabled());
+    crc1 = CRC32C(content, byte1);
+    crc2 = CRC32C(content + byte1, byte2);
+    printf("crc32c combine 2 parts: %x\n",
+            CRC32C_combine(crc1, crc2, byte2));
+
     return 0;
 }
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/hash.h"
+#include "fastcommon/flat_hash.h"
+
+#define KEY_SIZE    8
+#define VALUE_SIZE  8
+
+#define OP_INSERT    0
+#define OP_FIND_HIT  1
+#define OP_FIND_MISS 2
+#define OP_DELETE    3
+#define OP_COUNT     4
+
+static const char *op_captions[OP_COUNT] = {
+    "insert", "find_hit", "find_miss", "delete"
+};
+
+//scramble the sequence number, the miss keys are odd
+static inline uint64_t make_key(const int64_t n, const bool miss)
+{
+    return ((uint64_t)n * 2 + (miss ? 1 : 0)) * 0x9E3779B97F4A7C15ULL;
+}
+
+//visit the keys in a pseudo random order
+static inline int64_t shuffle_index(const int64_t i, const int64_t count)
+{
+    return (i * 2654435761LL) % count;
+}
+
+static int test_hash_array(const int64_t count, double *ops)
+{
+    HashArray hash;
+    uint64_t key;
+    int64_t value;
+    int64_t start_time;
+    int64_t found;
+    int64_t i;
+    int value_len;
+    int result;
+
+    if ((result=fc_hash_init_ex(&hash, fc_simple_hash, count,
+                    0.75, 0, true)) != 0)
+    {
+        return result;
+    }
+
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(i, false);
+        if (fc_hash_insert_ex(&hash, &key, KEY_SIZE,
+                    &i, VALUE_SIZE, false) < 0)
+        {
+            return ENOMEM;
+        }
+    }
+    ops[OP_INSERT] = (double)count / (get_current_time_us() - start_time);
+
+    found = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(shuffle_index(i, count), false);
+        value_len = sizeof(value);
+        if (fc_hash_get(&hash, &key, KEY_SIZE, &value, &value_len) == 0) {
+            found++;
+        }
+    }
+    ops[OP_FIND_HIT] = (double)count / (get_current_time_us() - start_time);
+
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(i, true);
+        if (fc_hash_find_ex(&hash, &key, KEY_SIZE) != NULL) {
+            found++;
+        }
+    }
+    ops[OP_FIND_MISS] = (double)count / (get_current_time_us() - start_time);
+
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(shuffle_index(i, count), false);
+        fc_hash_delete(&hash, &key, KEY_SIZE);
+    }
+    ops[OP_DELETE] = (double)count / (get_current_time_us() - start_time);
+
+    if (found != count || fc_hash_count(&hash) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "HashArray found: %"PRId64" != %"PRId64", remain: %d",
+                __LINE__, found, count, fc_hash_count(&hash));
+    }
+    fc_hash_destroy(&hash);
+    return 0;
+}
+
+static int test_flat_hash(const int64_t count, double *ops)
+{
+    FCFlatHashTable table;
+    uint64_t key;
+    int64_t value;
+    int64_t start_time;
+    int64_t found;
+    int64_t i;
+    int value_len;
+    int result;
+
+    if ((result=fc_flat_hash_init(&table, fc_simple_hash,
+                    KEY_SIZE, VALUE_SIZE, count)) != 0)
+    {
+        return result;
+    }
+
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(i, false);
+        if (fc_flat_hash_insert_ex(&table, &key, KEY_SIZE,
+                    &i, VALUE_SIZE) < 0)
+        {
+            return ENOMEM;
+        }
+    }
+    ops[OP_INSERT] = (double)count / (get_current_time_us() - start_time);
+
+    found = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(shuffle_index(i, count), false);
+        value_len = sizeof(value);
+        if (fc_flat_hash_get(&table, &key, KEY_SIZE,
+                    &value, &value_len) == 0)
+        {
+            found++;
+        }
+    }
+    ops[OP_FIND_HIT] = (double)count / (get_current_time_us() - start_time);
+
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(i, true);
+        if (fc_flat_hash_find(&table, &key, KEY_SIZE) != NULL) {
+            found++;
+        }
+    }
+    ops[OP_FIND_MISS] = (double)count / (get_current_time_us() - start_time);
+
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        key = make_key(shuffle_index(i, count), false);
+        fc_flat_hash_delete(&table, &key, KEY_SIZE);
+    }
+    ops[OP_DELETE] = (double)count / (get_current_time_us() - start_time);
+
+    if (found != count || fc_flat_hash_count(&table) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "flat hash found: %"PRId64" != %"PRId64", remain: %"PRId64,
+                __LINE__, found, count, fc_flat_hash_count(&table));
+    }
+    fc_flat_hash_destroy(&table);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    double hash_ops[OP_COUNT];
+    double flat_ops[OP_COUNT];
+    int64_t max_count;
+    int64_t count;
+    int op;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    max_count = 10 * 1000 * 1000;
+    if (argc > 1) {
+        max_count = strtoll(argv[1], NULL, 10);
+    }
+
+    printf("usage: %s [max_count], such as 100000000\n", argv[0]);
+    printf("key size: %d, value size: %d, unit: Mops/s\n\n",
+            KEY_SIZE, VALUE_SIZE);
+    printf("%12s %10s %12s %12s %8s\n", "count", "op",
+            "HashArray", "flat_hash", "ratio");
+    for (count=1000 * 1000; count<=max_count; count*=10) {
+        if (test_hash_array(count, hash_ops) != 0 ||
+                test_flat_hash(count, flat_ops) != 0)
+        {
+            break;
+        }
+
+        for (op=0; op<OP_COUNT; op++) {
+            printf("%12"PRId64" %10s %12.2f %12.2f %8.2f\n", count,
+                    op_captions[op], hash_ops[op], flat_ops[op],
+                    flat_ops[op] / hash_ops[op]);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/hash.h"
+
+#define THREAD_COUNT  4
+#define KEY_COUNT     (64 * 1024)
+#define CACHE_ITEMS   64
+#define TTL_KEY       (KEY_COUNT + 1)
+
+static HashArray hash_array;
+static pthread_mutex_t hash_lock;  //for the incremental rehash
+static pthread_barrier_t barrier;
+static int evict_counts[3];  //indexed by the evict reason
+static int64_t evicted_keys[16];  //the watched keys
+static int evicted_reasons[16];
+static int watched_count;
+
+static inline void check_key(const int64_t key, const bool expect_exist)
+{
+    int64_t value;
+    int value_len;
+    int result;
+
+    value_len = sizeof(value);
+    result = fc_hash_get(&hash_array, &key, sizeof(key), &value, &value_len);
+    if (expect_exist) {
+        if (result != 0 || value != key) {
+            fprintf(stderr, "key: %"PRId64", result: %d, value: %"PRId64"\n",
+                    key, result, value);
+            assert(result == 0 && value == key);
+        }
+    } else {
+        assert(result == ENOENT);
+    }
+}
+
+//the threads insert and delete the own keys and read all keys
+static void *lock_thread_func(void *arg)
+{
+    long index;
+    int64_t key;
+
+    index = (long)arg;
+    for (key=index; key<KEY_COUNT; key+=THREAD_COUNT) {
+        assert(fc_hash_insert_ex(&hash_array, &key, sizeof(key),
+                    &key, sizeof(key), true) == 1);
+        check_key(key, true);
+    }
+
+    pthread_barrier_wait(&barrier);
+    for (key=0; key<KEY_COUNT; key++) {
+        check_key(key, true);
+    }
+
+    pthread_barrier_wait(&barrier);
+    for (key=index; key<KEY_COUNT; key+=THREAD_COUNT) {
+        assert(fc_hash_delete(&hash_array, &key, sizeof(key)) == 0);
+        check_key(key, false);
+    }
+    return NULL;
+}
+
+static void test_locks()
+{
+    pthread_t tids[THREAD_COUNT];
+    int64_t key;
+    long i;
+
+    assert(fc_hash_init_ex(&hash_array, fc_fast_hash, 1021,
+                0.00, 0, true) == 0);
+    assert(fc_hash_set_locks(&hash_array, 16) == 0);
+
+    //the migration can't run under the bucket locks
+    assert(fc_hash_set_incremental_rehash(&hash_array, 1) == EOPNOTSUPP);
+    assert(!fc_hash_rehashing(&hash_array));
+
+    pthread_barrier_init(&barrier, NULL, THREAD_COUNT);
+    for (i=0; i<THREAD_COUNT; i++) {
+        assert(pthread_create(tids + i, NULL, lock_thread_func,
+                    (void *)i) == 0);
+    }
+    for (i=0; i<THREAD_COUNT; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    for (key=0; key<KEY_COUNT; key++) {
+        check_key(key, false);
+    }
+    fc_hash_destroy(&hash_array);
+
+    //the locks can't be set in the incremental rehash mode
+    assert(fc_hash_init_ex(&hash_array, fc_fast_hash, 1021,
+                0.00, 0, true) == 0);
+    assert(fc_hash_set_incremental_rehash(&hash_array, 1) == 0);
+    assert(fc_hash_set_locks(&hash_array, 16) == EINVAL);
+    fc_hash_destroy(&hash_array);
+}
+
+//the threads share the table by an outer lock while rehashing
+static void *rehash_thread_func(void *arg)
+{
+    long index;
+    int64_t key;
+    int64_t k;
+
+    index = (long)arg;
+    for (key=index; key<KEY_COUNT; key+=THREAD_COUNT) {
+        PTHREAD_MUTEX_LOCK(&hash_lock);
+        assert(fc_hash_insert_ex(&hash_array, &key, sizeof(key),
+                    &key, sizeof(key), false) == 1);
+
+        //the inserted keys of this thread are visible during the migration
+        for (k=key; k>=0 && k>key-16*THREAD_COUNT; k-=THREAD_COUNT) {
+            check_key(k, true);
+        }
+        PTHREAD_MUTEX_UNLOCK(&hash_lock);
+    }
+    return NULL;
+}
+
+static void test_incremental_rehash()
+{
+    pthread_t tids[THREAD_COUNT];
+    int64_t key;
+    int rehash_count;
+    long i;
+
+    assert(fc_hash_init_ex(&hash_array, fc_fast_hash, 17,
+                0.75, 0, true) == 0);
+    assert(fc_hash_set_incremental_rehash(&hash_array, 1) == 0);
+    assert(init_pthread_lock(&hash_lock) == 0);
+
+    for (i=0; i<THREAD_COUNT; i++) {
+        assert(pthread_create(tids + i, NULL, rehash_thread_func,
+                    (void *)i) == 0);
+    }
+    for (i=0; i<THREAD_COUNT; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    assert(fc_hash_count(&hash_array) == KEY_COUNT);
+
+    rehash_count = 0;
+    while (fc_hash_rehash_step(&hash_array, 16)) {
+        rehash_count++;
+    }
+    assert(!fc_hash_rehashing(&hash_array));
+
+    for (key=0; key<KEY_COUNT; key++) {
+        check_key(key, true);
+    }
+    for (key=0; key<KEY_COUNT; key+=2) {
+        assert(fc_hash_delete(&hash_array, &key, sizeof(key)) == 0);
+    }
+    for (key=0; key<KEY_COUNT; key++) {
+        check_key(key, key % 2 == 1);
+    }
+    assert(fc_hash_count(&hash_array) == KEY_COUNT / 2);
+
+    printf("incremental rehash OK, capacity: %u, final rehash steps: %d\n",
+            *hash_array.capacity, rehash_count);
+    fc_hash_destroy(&hash_array);
+    pthread_mutex_destroy(&hash_lock);
+}
+
+static void evict_callback(const HashData *data,
+        const int reason, void *args)
+{
+    int64_t key;
+    int i;
+
+    assert(reason == FC_HASH_EVICT_REASON_CAPACITY ||
+            reason == FC_HASH_EVICT_REASON_EXPIRED);
+    evict_counts[reason]++;
+
+    memcpy(&key, data->key, sizeof(key));
+    for (i=0; i<watched_count; i++) {
+        if (evicted_keys[i] == key) {
+            evicted_reasons[i] = reason;
+        }
+    }
+}
+
+static int watch_key(const int64_t key)
+{
+    evicted_keys[watched_count] = key;
+    evicted_reasons[watched_count] = 0;
+    return watched_count++;
+}
+
+static void insert_keys(const int64_t start, const int64_t end)
+{
+    int64_t key;
+
+    for (key=start; key<end; key++) {
+        assert(fc_hash_insert_ex(&hash_array, &key, sizeof(key),
+                    &key, sizeof(key), false) == 1);
+    }
+}
+
+static void test_cache_mode()
+{
+    HashCacheStat stat;
+    int64_t key;
+    int64_t bytes_used;
+    int item_bytes;
+    int referenced_index;
+    int ttl_index;
+    int max_ttl_index;
+
+    //the TTL base on g_current_time which is advanced by this test
+    g_current_time = time(NULL);
+    g_schedule_flag = true;
+
+    assert(fc_hash_init_ex(&hash_array, fc_fast_hash, 1021,
+                0.00, 1024 * 1024, true) == 0);
+    assert(fc_hash_set_cache_mode(&hash_array, 0,
+                evict_callback, NULL) == 0);
+
+    //the max bytes for CACHE_ITEMS items
+    bytes_used = hash_array.bytes_used;
+    key = -1;
+    insert_keys(key, key + 1);
+    item_bytes = hash_array.bytes_used - bytes_used;
+    assert(fc_hash_delete(&hash_array, &key, sizeof(key)) == 0);
+    hash_array.max_bytes = hash_array.bytes_used +
+        CACHE_ITEMS * item_bytes;
+
+    //capacity eviction, the referenced item survives one sweep
+    insert_keys(0, CACHE_ITEMS);
+    assert(evict_counts[FC_HASH_EVICT_REASON_CAPACITY] == 0);
+    referenced_index = watch_key(0);
+    check_key(0, true);
+    insert_keys(CACHE_ITEMS, CACHE_ITEMS + 1);
+    assert(evict_counts[FC_HASH_EVICT_REASON_CAPACITY] >= 1);
+    assert(evicted_reasons[referenced_index] == 0);
+    assert(fc_hash_count(&hash_array) <= CACHE_ITEMS);
+
+    //the reference bit is cleared, evicted by the next sweeps
+    insert_keys(CACHE_ITEMS + 1, 5 * CACHE_ITEMS);
+    assert(evicted_reasons[referenced_index] ==
+            FC_HASH_EVICT_REASON_CAPACITY);
+    assert(fc_hash_count(&hash_array) <= CACHE_ITEMS);
+
+    //TTL expiry, the huge TTL is clamped
+    key = TTL_KEY;
+    ttl_index = watch_key(key);
+    assert(fc_hash_insert_with_ttl(&hash_array, &key, sizeof(key),
+                &key, sizeof(key), false, 10) == 1);
+    key = TTL_KEY + 1;
+    max_ttl_index = watch_key(key);
+    assert(fc_hash_insert_with_ttl(&hash_array, &key, sizeof(key),
+                &key, sizeof(key), false, 0x7FFFFFFF) == 1);
+    assert(fc_hash_insert_with_ttl(&hash_array, &key, sizeof(key),
+                &key, sizeof(key), false, -1) == -EINVAL);
+    check_key(TTL_KEY, true);
+    g_current_time += 11;
+    check_key(TTL_KEY, false);
+    check_key(TTL_KEY + 1, true);
+
+    //the expired item is freed by the sweep even if referenced
+    insert_keys(5 * CACHE_ITEMS, 9 * CACHE_ITEMS);
+    assert(evicted_reasons[ttl_index] == FC_HASH_EVICT_REASON_EXPIRED);
+    assert(evict_counts[FC_HASH_EVICT_REASON_EXPIRED] == 1);
+    assert(evicted_reasons[max_ttl_index] !=
+            FC_HASH_EVICT_REASON_EXPIRED);
+
+    //the counters
+    fc_hash_get_cache_stat(&hash_array, &stat);
+    assert(stat.hits == 3);
+    assert(stat.misses == 1);
+    assert(stat.evictions == evict_counts[FC_HASH_EVICT_REASON_CAPACITY]);
+    assert(stat.expirations == evict_counts[FC_HASH_EVICT_REASON_EXPIRED]);
+    assert(stat.evictions + stat.expirations + fc_hash_count(
+                &hash_array) == 9 * CACHE_ITEMS + 2);
+
+    printf("cache mode OK, hits: %"PRId64", misses: %"PRId64", "
+            "evictions: %"PRId64", expirations: %"PRId64"\n", stat.hits,
+            stat.misses, stat.evictions, stat.expirations);
+    fc_hash_destroy(&hash_array);
+    g_schedule_flag = false;
+}
+
+int main(int argc, char *argv[])
+{
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+
+    test_locks();
+    printf("bucket locks OK\n");
+
+    test_incremental_rehash();
+    test_cache_mode();
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <inttypes.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/hash.h"
+
+#define BUCKET_BITS   16
+#define BUCKET_COUNT  (1 << BUCKET_BITS)
+#define AVALANCHE_KEY_SIZE  16
+
+typedef uint64_t (*TestHashFunc)(const void *key, const int key_len);
+
+typedef struct {
+    const char *caption;
+    TestHashFunc func;
+} HashEntry;
+
+static uint64_t test_time33(const void *key, const int key_len)
+{
+    return (unsigned int)Time33Hash(key, key_len);
+}
+
+static uint64_t test_elf(const void *key, const int key_len)
+{
+    return (unsigned int)ELFHash(key, key_len);
+}
+
+static uint64_t test_simple(const void *key, const int key_len)
+{
+    return (unsigned int)fc_simple_hash(key, key_len);
+}
+
+static uint64_t test_crc32(const void *key, const int key_len)
+{
+    return (unsigned int)CRC32(key, key_len);
+}
+
+static uint64_t test_crc32c(const void *key, const int key_len)
+{
+    return (unsigned int)CRC32C(key, key_len);
+}
+
+static uint64_t test_xxhash64(const void *key, const int key_len)
+{
+    return fc_xxhash64(key, key_len);
+}
+
+static uint64_t test_wyhash(const void *key, const int key_len)
+{
+    return fc_wyhash(key, key_len);
+}
+
+static HashEntry hash_entries[] = {
+    {"Time33Hash", test_time33},
+    {"ELFHash", test_elf},
+    {"simple_hash", test_simple},
+    {"CRC32", test_crc32},
+    {"CRC32C", test_crc32c},
+    {"xxhash64", test_xxhash64},
+    {"wyhash", test_wyhash}
+};
+
+#define HASH_ENTRY_COUNT  (sizeof(hash_entries) / sizeof(hash_entries[0]))
+
+static uint64_t rand_state = 88172645463325252ULL;
+
+static inline uint64_t rand64()
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return rand_state;
+}
+
+/* flip every input bit, the low 32 bits of the output should flip
+   with probability 0.5, return the worst bias */
+static double test_avalanche(TestHashFunc func, const int key_count)
+{
+    static int flips[AVALANCHE_KEY_SIZE * 8][32];
+    unsigned char key[AVALANCHE_KEY_SIZE];
+    uint64_t h0;
+    uint64_t diff;
+    double bias;
+    double max_bias;
+    int i, k, in_bit, out_bit;
+
+    memset(flips, 0, sizeof(flips));
+    for (i=0; i<key_count; i++) {
+        for (k=0; k<AVALANCHE_KEY_SIZE; k+=8) {
+            *((uint64_t *)(key + k)) = rand64();
+        }
+        h0 = func(key, AVALANCHE_KEY_SIZE);
+        for (in_bit=0; in_bit<AVALANCHE_KEY_SIZE * 8; in_bit++) {
+            key[in_bit / 8] ^= 1 << (in_bit % 8);
+            diff = h0 ^ func(key, AVALANCHE_KEY_SIZE);
+            key[in_bit / 8] ^= 1 << (in_bit % 8);
+            for (out_bit=0; out_bit<32; out_bit++) {
+                flips[in_bit][out_bit] += (diff >> out_bit) & 1;
+            }
+        }
+    }
+
+    max_bias = 0.00;
+    for (in_bit=0; in_bit<AVALANCHE_KEY_SIZE * 8; in_bit++) {
+        for (out_bit=0; out_bit<32; out_bit++) {
+            bias = fabs((double)flips[in_bit][out_bit] / key_count - 0.5);
+            if (bias > max_bias) {
+                max_bias = bias;
+            }
+        }
+    }
+    return max_bias * 2;
+}
+
+/* the sequential string keys to the power of 2 buckets by the low bits,
+   return chi-square / bucket count, about 1.0 for the uniform distribution */
+static double test_distribution(TestHashFunc func,
+        const int key_count, int *max_bucket_len)
+{
+    static int buckets[BUCKET_COUNT];
+    char key[32];
+    double expected;
+    double chi_square;
+    int key_len;
+    int i;
+
+    memset(buckets, 0, sizeof(buckets));
+    for (i=0; i<key_count; i++) {
+        key_len = sprintf(key, "key-%d", i);
+        buckets[func(key, key_len) & (BUCKET_COUNT - 1)]++;
+    }
+
+    expected = (double)key_count / BUCKET_COUNT;
+    chi_square = 0.00;
+    *max_bucket_len = 0;
+    for (i=0; i<BUCKET_COUNT; i++) {
+        chi_square += (buckets[i] - expected) * (buckets[i] - expected);
+        if (buckets[i] > *max_bucket_len) {
+            *max_bucket_len = buckets[i];
+        }
+    }
+    return chi_square / expected / BUCKET_COUNT;
+}
+
+//return MB/s
+static double test_throughput(TestHashFunc func, const char *buff,
+        const int key_len, const int64_t total_bytes)
+{
+    int64_t start_time;
+    int64_t time_used;
+    int64_t loop_count;
+    int64_t i;
+    volatile uint64_t sum;
+
+    loop_count = total_bytes / key_len;
+    sum = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<loop_count; i++) {
+        sum += func(buff + (i & 7), key_len);
+    }
+    time_used = get_current_time_us() - start_time;
+    if (time_used == 0) {
+        time_used = 1;
+    }
+    return (double)(loop_count * key_len) / time_used;
+}
+
+int main(int argc, char *argv[])
+{
+    const int key_lens[] = {8, 16, 64, 1024, 64 * 1024};
+    const int key_len_count = sizeof(key_lens) / sizeof(key_lens[0]);
+    int64_t total_bytes;
+    char *buff;
+    double bias;
+    double chi;
+    int max_bucket_len;
+    int i, k;
+
+    log_init();
+    total_bytes = 256 * 1024 * 1024;
+    if (argc > 1) {
+        total_bytes = strtoll(argv[1], NULL, 10) * 1024 * 1024;
+    }
+
+    printf("usage: %s [total_mb=256]\n", argv[0]);
+    printf("CRC32C hardware: %d\n\n", CRC32C_hardware_enabled());
+
+    printf("quality: avalanche bias (0 best), chi-square of %d "
+            "buckets (1.0 best), max bucket length\n", BUCKET_COUNT);
+    printf("%12s %10s %10s %8s\n", "hash", "avalanche", "chi2", "max_len");
+    for (i=0; i<HASH_ENTRY_COUNT; i++) {
+        bias = test_avalanche(hash_entries[i].func, 10000);
+        chi = test_distribution(hash_entries[i].func,
+                BUCKET_COUNT * 8, &max_bucket_len);
+        printf("%12s %10.4f %10.2f %8d\n", hash_entries[i].caption,
+                bias, chi, max_bucket_len);
+    }
+
+    buff = (char *)malloc(key_lens[key_len_count - 1] + 8);
+    if (buff == NULL) {
+        return ENOMEM;
+    }
+    for (i=0; i<key_lens[key_len_count - 1] + 8; i++) {
+        buff[i] = rand64();
+    }
+
+    printf("\nthroughput (MB/s) by key length\n");
+    printf("%12s", "hash");
+    for (k=0; k<key_len_count; k++) {
+        printf(" %10d", key_lens[k]);
+    }
+    printf("\n");
+    for (i=0; i<HASH_ENTRY_COUNT; i++) {
+        printf("%12s", hash_entries[i].caption);
+        for (k=0; k<key_len_count; k++) {
+            printf(" %10.1f", test_throughput(hash_entries[i].func,
+                        buff, key_lens[k], total_bytes / 4));
+        }
+        printf("\n");
+    }
+
+    free(buff);
+    return 0;
+}
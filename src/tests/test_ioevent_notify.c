@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/ioevent_loop.h"
+
+/* the producer notifies while the loop is inside the notify callback,
+   every notify must be consumed and no wakeup lost */
+
+static int loop_count = 10000;
+static struct nio_thread_data thread_data;
+static volatile bool continue_flag;
+static volatile int64_t produced_count;
+static volatile int64_t consumed_count;
+static volatile int in_callback;
+
+//the loop drained the notify fd already, the callback MUST NOT read it
+static void recv_notify_callback(int sock, short event, void *arg)
+{
+    __sync_lock_test_and_set(&in_callback, 1);
+    //widen the window for the notifies during the callback
+    usleep(rand() % 50);
+    __sync_lock_test_and_set(&consumed_count,
+            __sync_add_and_fetch(&produced_count, 0));
+    __sync_lock_test_and_set(&in_callback, 0);
+}
+
+static void clean_up_callback(struct fast_task_info *task)
+{
+}
+
+static void *loop_thread_func(void *arg)
+{
+    ioevent_loop(&thread_data, recv_notify_callback,
+            clean_up_callback, &continue_flag);
+    return NULL;
+}
+
+//wait the consumer to catch up the producer
+static int wait_consumed(const int64_t count)
+{
+    int64_t start_time;
+
+    start_time = get_current_time_ms();
+    while (__sync_add_and_fetch(&consumed_count, 0) < count) {
+        if (get_current_time_ms() - start_time > 2000) {
+            return ETIMEDOUT;
+        }
+        usleep(100);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t loop_tid;
+    int64_t during_callback;
+    int result;
+    int i;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    g_current_time = time(NULL);
+    if (argc > 1) {
+        loop_count = strtol(argv[1], NULL, 10);
+    }
+
+    memset(&thread_data, 0, sizeof(thread_data));
+    if ((result=ioevent_init(&thread_data.ev_puller, 64, 100, 0)) != 0) {
+        return result;
+    }
+    if ((result=fast_timer_init(&thread_data.timer, 64,
+                    g_current_time)) != 0)
+    {
+        return result;
+    }
+    if ((result=ioevent_notify_init(&thread_data)) != 0) {
+        return result;
+    }
+
+    continue_flag = true;
+    pthread_create(&loop_tid, NULL, loop_thread_func, NULL);
+
+    result = 0;
+    during_callback = 0;
+    for (i=1; i<=loop_count; i++) {
+        __sync_add_and_fetch(&produced_count, 1);
+        if (__sync_add_and_fetch(&in_callback, 0)) {
+            during_callback++;
+        }
+        ioevent_notify_thread(&thread_data);
+        if (i % 2 == 0) {
+            usleep(rand() % 20);
+        }
+
+        if (i % 100 == 0 && (result=wait_consumed(i)) != 0) {
+            break;
+        }
+    }
+
+    if (result == 0) {
+        result = wait_consumed(loop_count);
+    }
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "wakeup lost, produced: %"PRId64", consumed: %"PRId64
+                ", pending counter: %"PRId64, __LINE__, produced_count,
+                consumed_count, thread_data.notify.counter);
+    } else {
+        printf("notify count: %d, during callback: %"PRId64", "
+                "all consumed\n", loop_count, during_callback);
+    }
+
+    continue_flag = false;
+    ioevent_notify_thread(&thread_data);
+    pthread_join(loop_tid, NULL);
+    ioevent_notify_destroy(&thread_data);
+    fast_timer_destroy(&thread_data.timer);
+    ioevent_destroy(&thread_data.ev_puller);
+    return result;
+}
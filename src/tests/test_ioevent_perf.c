@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/ioevent.h"
+
+#define MODE_EPOLL        0
+#define MODE_URING_POLL   1
+#define MODE_URING_COMPLETION  2
+
+#define MSG_SIZE     64
+#define MAX_CONNECTIONS 256
+
+typedef struct echo_connection {
+    int fd;
+    char buff[MSG_SIZE];
+} EchoConnection;
+
+static int round_count = 20000;
+static int server_mode;
+static int listen_fd;
+static struct sockaddr_in server_addr;
+static IOEventPoller poller;
+static volatile bool continue_flag;
+static EchoConnection listener;
+static EchoConnection connections[MAX_CONNECTIONS];
+
+static const char *mode_caption(const int mode)
+{
+    switch (mode) {
+        case MODE_EPOLL:
+            return "epoll";
+        case MODE_URING_POLL:
+            return "uring_poll";
+        default:
+            return "uring_completion";
+    }
+}
+
+static void close_connection(EchoConnection *conn)
+{
+    ioevent_detach(&poller, conn->fd);
+    close(conn->fd);
+    conn->fd = -1;
+}
+
+static void accept_connections()
+{
+    EchoConnection *conn;
+    int fd;
+    int result;
+
+    while ((fd=accept(listen_fd, NULL, NULL)) >= 0) {
+        if (fd >= MAX_CONNECTIONS) {
+            close(fd);
+            continue;
+        }
+
+        conn = connections + fd;
+        conn->fd = fd;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        if (server_mode == MODE_URING_COMPLETION) {
+            result = ioevent_uring_prep_recv(&poller, fd,
+                    conn->buff, MSG_SIZE, conn);
+        } else {
+            result = ioevent_attach(&poller, fd, IOEVENT_READ, conn) == 0 ?
+                0 : errno;
+        }
+
+        if (result != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "register fd %d fail, errno: %d, error info: %s",
+                    __LINE__, fd, result, STRERROR(result));
+            close(fd);
+            conn->fd = -1;
+        }
+    }
+}
+
+static void deal_poll_event(EchoConnection *conn, const int event)
+{
+    int bytes;
+
+    if ((bytes=recv(conn->fd, conn->buff, MSG_SIZE, 0)) <= 0) {
+        if (bytes < 0 && errno == EAGAIN) {
+            return;
+        }
+        close_connection(conn);
+        return;
+    }
+
+    if (send(conn->fd, conn->buff, bytes, MSG_NOSIGNAL) != bytes) {
+        close_connection(conn);
+    }
+}
+
+static void deal_completion_event(EchoConnection *conn, const int event)
+{
+    int bytes;
+    int result;
+
+    bytes = ioevent_get_result(&poller);
+    if (bytes <= 0) {
+        close_connection(conn);
+        return;
+    }
+
+    if ((event & IOEVENT_RECV_DONE) != 0) {
+        result = ioevent_uring_prep_send(&poller, conn->fd,
+                conn->buff, bytes, conn);
+    } else {
+        result = ioevent_uring_prep_recv(&poller, conn->fd,
+                conn->buff, MSG_SIZE, conn);
+    }
+    if (result != 0) {
+        close_connection(conn);
+    }
+}
+
+static void *server_thread_func(void *arg)
+{
+    EchoConnection *conn;
+    int event;
+    int count;
+
+    while (continue_flag) {
+        if ((count=ioevent_poll(&poller)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logError("file: "__FILE__", line: %d, "
+                    "ioevent_poll fail, errno: %d, error info: %s",
+                    __LINE__, errno, STRERROR(errno));
+            break;
+        }
+
+        for (poller.iterator.index=0; poller.iterator.index<count;
+                poller.iterator.index++)
+        {
+            event = IOEVENT_GET_EVENTS(&poller, poller.iterator.index);
+            conn = (EchoConnection *)IOEVENT_GET_DATA(
+                    &poller, poller.iterator.index);
+            if (conn == NULL || conn->fd < 0) {
+                continue;
+            }
+
+            if (conn == &listener) {
+                accept_connections();
+            } else if ((event & (IOEVENT_RECV_DONE |
+                            IOEVENT_SEND_DONE)) != 0)
+            {
+                deal_completion_event(conn, event);
+            } else {
+                deal_poll_event(conn, event);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void *client_thread_func(void *arg)
+{
+    char buff[MSG_SIZE];
+    int fd;
+    int flag;
+    int bytes;
+    int i;
+
+    if ((fd=socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        return NULL;
+    }
+    if (connect(fd, (struct sockaddr *)&server_addr,
+                sizeof(server_addr)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "connect fail, errno: %d, error info: %s",
+                __LINE__, errno, STRERROR(errno));
+        close(fd);
+        return NULL;
+    }
+
+    flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    memset(buff, 'a', sizeof(buff));
+    for (i=0; i<round_count; i++) {
+        if (send(fd, buff, MSG_SIZE, 0) != MSG_SIZE) {
+            break;
+        }
+        for (bytes=0; bytes<MSG_SIZE; ) {
+            int n;
+            if ((n=recv(fd, buff + bytes, MSG_SIZE - bytes, 0)) <= 0) {
+                close(fd);
+                return NULL;
+            }
+            bytes += n;
+        }
+    }
+
+    close(fd);
+    return NULL;
+}
+
+static int start_listen()
+{
+    socklen_t len;
+    int flag;
+
+    if ((listen_fd=socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        return errno;
+    }
+
+    flag = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (bind(listen_fd, (struct sockaddr *)&server_addr,
+                sizeof(server_addr)) != 0 || listen(listen_fd, 1024) != 0)
+    {
+        close(listen_fd);
+        return errno;
+    }
+
+    len = sizeof(server_addr);
+    getsockname(listen_fd, (struct sockaddr *)&server_addr, &len);
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+static int test_mode(const int mode, const int conn_count)
+{
+    pthread_t server_tid;
+    pthread_t client_tids[MAX_CONNECTIONS];
+    int64_t start_time;
+    int64_t time_used;
+    int result;
+    int i;
+
+    if ((result=ioevent_init_ex(&poller, 256, 100, 0, mode == MODE_EPOLL ?
+                    IOEVENT_BACKEND_DEFAULT : IOEVENT_BACKEND_IO_URING)) != 0)
+    {
+        printf("%18s %8d %s\n", mode_caption(mode),
+                conn_count, STRERROR(result));
+        return result;
+    }
+
+    if ((result=start_listen()) != 0) {
+        ioevent_destroy(&poller);
+        return result;
+    }
+
+    server_mode = mode;
+    for (i=0; i<MAX_CONNECTIONS; i++) {
+        connections[i].fd = -1;
+    }
+    listener.fd = listen_fd;
+    ioevent_attach(&poller, listen_fd, IOEVENT_READ, &listener);
+
+    continue_flag = true;
+    pthread_create(&server_tid, NULL, server_thread_func, NULL);
+
+    start_time = get_current_time_us();
+    for (i=0; i<conn_count; i++) {
+        pthread_create(client_tids + i, NULL, client_thread_func, NULL);
+    }
+    for (i=0; i<conn_count; i++) {
+        pthread_join(client_tids[i], NULL);
+    }
+    time_used = get_current_time_us() - start_time;
+
+    continue_flag = false;
+    pthread_join(server_tid, NULL);
+
+    for (i=0; i<MAX_CONNECTIONS; i++) {
+        if (connections[i].fd >= 0) {
+            close_connection(connections + i);
+        }
+    }
+    ioevent_detach(&poller, listen_fd);
+    close(listen_fd);
+    ioevent_destroy(&poller);
+
+    printf("%18s %8d %10"PRId64" %10.2f %12.2f\n", mode_caption(mode),
+            conn_count, time_used / 1000, (double)time_used / round_count,
+            (double)round_count * conn_count * 1000.00 / time_used);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_connections;
+    int conn_count;
+    int mode;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    max_connections = 16;
+    if (argc > 1) {
+        round_count = strtol(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        max_connections = strtol(argv[2], NULL, 10);
+        if (max_connections > MAX_CONNECTIONS / 2) {
+            max_connections = MAX_CONNECTIONS / 2;
+        }
+    }
+
+    printf("usage: %s [round_count] [max_connections]\n", argv[0]);
+    printf("message size: %d, round count per connection: %d\n\n",
+            MSG_SIZE, round_count);
+    printf("%18s %8s %10s %10s %12s\n", "mode", "conns",
+            "time(ms)", "rtt(us)", "krounds/s");
+    for (conn_count=1; conn_count<=max_connections; conn_count*=4) {
+        for (mode=MODE_EPOLL; mode<=MODE_URING_COMPLETION; mode++) {
+            test_mode(mode, conn_count);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
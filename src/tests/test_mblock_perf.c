@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <sys/time.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_mblock.h"
+
+#define MBLOCK_MODE_MUTEX         0
+#define MBLOCK_MODE_THREAD_CACHE  1
+#define MBLOCK_MODE_LOCK_FREE     2
+
+#define SLOT_COUNT  (64 * 1024)
+#define MAX_THREADS 64
+
+typedef struct my_record {
+    int64_t id;
+    char buff[56];
+} MyRecord;
+
+static int loop_count = 1000 * 1000;
+static struct fast_mblock_man record_allocator;
+
+/* the objects swapped out of the slots are freed by the current thread,
+   so most of them are allocated by the other threads */
+static MyRecord * volatile slots[SLOT_COUNT];
+
+static void *local_thread_func(void *arg)
+{
+    const int BATCH_SIZE = 32;
+    MyRecord *records[BATCH_SIZE];
+    int i;
+    int k;
+
+    for (i=0; i<loop_count; i+=BATCH_SIZE) {
+        for (k=0; k<BATCH_SIZE; k++) {
+            if ((records[k]=fast_mblock_alloc_object(
+                            &record_allocator)) == NULL)
+            {
+                return NULL;
+            }
+            records[k]->id = i + k;
+        }
+
+        for (k=0; k<BATCH_SIZE; k++) {
+            fast_mblock_free_object(&record_allocator, records[k]);
+        }
+    }
+
+    return NULL;
+}
+
+static void *cross_thread_func(void *arg)
+{
+    unsigned int seed;
+    int i;
+    MyRecord *record;
+    MyRecord *old;
+
+    seed = (unsigned int)(long)arg;
+    for (i=0; i<loop_count; i++) {
+        if ((record=fast_mblock_alloc_object(&record_allocator)) == NULL) {
+            return NULL;
+        }
+        record->id = i;
+
+        old = __sync_lock_test_and_set(slots + rand_r(&seed) %
+                SLOT_COUNT, record);
+        if (old != NULL) {
+            fast_mblock_free_object(&record_allocator, old);
+        }
+    }
+
+    return NULL;
+}
+
+static int test_mode(const int mode, const int thread_count,
+        void *(*thread_func)(void *))
+{
+    pthread_t tids[MAX_THREADS];
+    int64_t start_time;
+    int64_t time_used;
+    int64_t used_count;
+    int result;
+    int i;
+
+    if ((result=fast_mblock_init_ex1(&record_allocator, "my_record",
+                    sizeof(MyRecord), 8 * 1024, 0, NULL, NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    if (mode == MBLOCK_MODE_THREAD_CACHE) {
+        result = fast_mblock_set_thread_cache(&record_allocator, 256);
+    } else if (mode == MBLOCK_MODE_LOCK_FREE) {
+        result = fast_mblock_set_lock_free(&record_allocator);
+    }
+    if (result != 0) {
+        fast_mblock_destroy(&record_allocator);
+        return result;
+    }
+
+    memset((void *)slots, 0, sizeof(slots));
+    start_time = get_current_time_us();
+    for (i=0; i<thread_count; i++) {
+        if ((result=pthread_create(tids + i, NULL, thread_func,
+                        (void *)(long)(i + 1))) != 0)
+        {
+            return result;
+        }
+    }
+    for (i=0; i<thread_count; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    time_used = get_current_time_us() - start_time;
+
+    for (i=0; i<SLOT_COUNT; i++) {
+        if (slots[i] != NULL) {
+            fast_mblock_free_object(&record_allocator, slots[i]);
+        }
+    }
+
+    //the cached count is exact only when the threads are quiescent
+    used_count = record_allocator.info.element_used_count -
+        fast_mblock_thread_cached_count(&record_allocator);
+    if (used_count != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "used element count: %"PRId64" != 0",
+                __LINE__, used_count);
+    }
+
+    printf("%8s %12s %8d %10"PRId64" %14.2f\n",
+            thread_func == local_thread_func ? "local" : "cross",
+            mode == MBLOCK_MODE_MUTEX ? "mutex" :
+            (mode == MBLOCK_MODE_THREAD_CACHE ? "thread_cache" :
+             "lock_free"), thread_count, time_used / 1000,
+            (double)loop_count * thread_count / (double)time_used);
+
+    fast_mblock_destroy(&record_allocator);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int thread_count;
+    int mode;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    if (argc > 1) {
+        loop_count = strtol(argv[1], NULL, 10);
+    }
+
+    printf("loop count per thread: %d\n", loop_count);
+    printf("%8s %12s %8s %10s %14s\n", "pattern", "mode",
+            "threads", "time(ms)", "ops/us");
+    for (thread_count=1; thread_count<=MAX_THREADS; thread_count*=2) {
+        for (mode=MBLOCK_MODE_MUTEX; mode<=MBLOCK_MODE_LOCK_FREE; mode++) {
+            test_mode(mode, thread_count, local_thread_func);
+        }
+        for (mode=MBLOCK_MODE_MUTEX; mode<=MBLOCK_MODE_LOCK_FREE; mode++) {
+            test_mode(mode, thread_count, cross_thread_func);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_mblock.h"
+
+#define OBJECTS_PER_TRUNK  64
+#define TRUNK_COUNT        8
+#define OBJECT_COUNT       (OBJECTS_PER_TRUNK * TRUNK_COUNT)
+#define LIVE_INTERVAL      16  //keep one of 16 objects
+
+struct test_object {
+    int id;
+    char padding[60];
+};
+
+static struct fast_mblock_man mblock;
+static struct test_object *refs[OBJECT_COUNT];
+static int moved_count;
+static int skipped_count;
+
+static int move_object(void *dest, void *src, void *args)
+{
+    struct test_object *obj;
+
+    //called with the mblock lock held
+    assert(pthread_mutex_trylock(&mblock.lcp.lock) != 0);
+
+    obj = (struct test_object *)src;
+    assert(refs[obj->id] == obj);
+
+    //the objects of the first trunk are in use, skip them
+    if (obj->id < OBJECTS_PER_TRUNK) {
+        skipped_count++;
+        return EBUSY;
+    }
+
+    memcpy(dest, src, sizeof(struct test_object));
+    refs[obj->id] = (struct test_object *)dest;
+    moved_count++;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct fast_mblock_reclaim_options options;
+    int64_t returned_bytes;
+    int64_t trunk_count;
+    int moved;
+    int result;
+    int i;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    fast_mblock_manager_init();
+
+    if ((result=fast_mblock_init_ex1(&mblock, "test-shrink",
+                    sizeof(struct test_object), OBJECTS_PER_TRUNK,
+                    0, NULL, NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    memset(&options, 0, sizeof(options));
+    options.keep_free_trunks = 0;
+    options.trigger_free_ratio = 0.50;
+    options.sparse_used_ratio = 0.25;
+    options.move_func = move_object;
+    if ((result=fast_mblock_set_reclaim(&mblock, &options)) != 0) {
+        return result;
+    }
+
+    for (i=0; i<OBJECT_COUNT; i++) {
+        refs[i] = (struct test_object *)fast_mblock_alloc_object(&mblock);
+        assert(refs[i] != NULL);
+        refs[i]->id = i;
+    }
+
+    //the trunks become sparse
+    for (i=0; i<OBJECT_COUNT; i++) {
+        if (i % LIVE_INTERVAL != 0) {
+            fast_mblock_free_object(&mblock, refs[i]);
+            refs[i] = NULL;
+        }
+    }
+
+    trunk_count = mblock.info.trunk_total_count;
+    if ((result=fast_mblock_shrink(&mblock, &moved,
+                    &returned_bytes)) != 0)
+    {
+        return result;
+    }
+
+    assert(moved == moved_count);
+    assert(moved > 0 && skipped_count > 0);
+    assert(mblock.info.trunk_total_count < trunk_count);
+    for (i=0; i<OBJECT_COUNT; i+=LIVE_INTERVAL) {
+        assert(refs[i]->id == i);
+    }
+
+    printf("moved: %d, skipped: %d, trunk count: %"PRId64" => %"PRId64", "
+            "returned bytes: %"PRId64"\n", moved, skipped_count, trunk_count,
+            mblock.info.trunk_total_count, returned_bytes);
+
+    for (i=0; i<OBJECT_COUNT; i+=LIVE_INTERVAL) {
+        fast_mblock_free_object(&mblock, refs[i]);
+    }
+    assert(mblock.info.element_used_count == 0);
+    fast_mblock_destroy(&mblock);
+    return 0;
+}
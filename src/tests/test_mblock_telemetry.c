@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_buffer.h"
+#include "fastcommon/fast_mblock.h"
+
+#define LOOP_COUNT   (100 * 1000)
+#define SPARSE_RATE  1000
+#define DENSE_RATE      2
+
+static int64_t get_sample_count(struct fast_mblock_man *mblock)
+{
+    FastBuffer buffer;
+    const char *p;
+    int64_t sample_count;
+
+    assert(fast_buffer_init(&buffer) == 0);
+    assert(fast_mblock_telemetry_dump(mblock, &buffer) == 0);
+    p = strstr(buffer.data, "\"sample_count\": ");
+    assert(p != NULL);
+    sample_count = strtoll(p + strlen("\"sample_count\": "), NULL, 10);
+    fast_buffer_destroy(&buffer);
+    return sample_count;
+}
+
+static void init_mblock(struct fast_mblock_man *mblock,
+        const char *name, const int sample_rate)
+{
+    struct fast_mblock_telemetry_options options;
+
+    memset(&options, 0, sizeof(options));
+    options.sample_rate = sample_rate;
+    assert(fast_mblock_init_ex1(mblock, name, 64, 1024,
+                0, NULL, NULL, true) == 0);
+    assert(fast_mblock_set_telemetry(mblock, &options) == 0);
+}
+
+/* the allocations of the mblocks with different sample rates interleave
+   in one thread, the sample rate of each mblock should be kept */
+int main(int argc, char *argv[])
+{
+    struct fast_mblock_man sparse;
+    struct fast_mblock_man dense;
+    void *obj;
+    int64_t sparse_count;
+    int64_t dense_count;
+    int i;
+
+    log_init();
+    fast_mblock_manager_init();
+    init_mblock(&sparse, "sparse", SPARSE_RATE);
+    init_mblock(&dense, "dense", DENSE_RATE);
+
+    for (i=0; i<LOOP_COUNT; i++) {
+        obj = fast_mblock_alloc_object(&sparse);
+        assert(obj != NULL);
+        fast_mblock_free_object(&sparse, obj);
+
+        obj = fast_mblock_alloc_object(&dense);
+        assert(obj != NULL);
+        fast_mblock_free_object(&dense, obj);
+    }
+
+    sparse_count = get_sample_count(&sparse);
+    dense_count = get_sample_count(&dense);
+    printf("sparse sample count: %"PRId64", expect: %d, "
+            "dense sample count: %"PRId64", expect: %d\n",
+            sparse_count, LOOP_COUNT / SPARSE_RATE,
+            dense_count, LOOP_COUNT / DENSE_RATE);
+    assert(sparse_count >= LOOP_COUNT / SPARSE_RATE / 2 &&
+            sparse_count <= LOOP_COUNT / SPARSE_RATE * 2);
+    assert(dense_count >= LOOP_COUNT / DENSE_RATE / 2 &&
+            dense_count <= LOOP_COUNT / DENSE_RATE * 2);
+
+    fast_mblock_destroy(&sparse);
+    fast_mblock_destroy(&dense);
+    printf("test mblock telemetry OK\n");
+    return 0;
+}
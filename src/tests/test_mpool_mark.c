@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_mpool.h"
+#include "fastcommon/json_parser.h"
+
+#define ALLOC_SIZE_ONCE  4096
+#define OBJECT_SIZE      100
+#define OBJECT_COUNT     200  //more than one block
+
+static struct fast_mpool_man mpool;
+
+static void check_counters(const int64_t alloc_count,
+        const int64_t alloc_bytes)
+{
+    if (mpool.alloc_count != alloc_count ||
+            mpool.alloc_bytes != alloc_bytes)
+    {
+        fprintf(stderr, "alloc count: %"PRId64" != %"PRId64", "
+                "alloc bytes: %"PRId64" != %"PRId64"\n",
+                mpool.alloc_count, alloc_count,
+                mpool.alloc_bytes, alloc_bytes);
+        assert(mpool.alloc_count == alloc_count &&
+                mpool.alloc_bytes == alloc_bytes);
+    }
+}
+
+static int64_t get_total_bytes()
+{
+    struct fast_mpool_stats stats;
+
+    fast_mpool_stats(&mpool, &stats);
+    return stats.total_bytes;
+}
+
+static void test_mark_rollback()
+{
+    struct fast_mpool_mark outer;
+    struct fast_mpool_mark inner;
+    char *kept;
+    char *ptrs[OBJECT_COUNT];
+    int64_t alloc_count;
+    int64_t alloc_bytes;
+    int64_t total_bytes;
+    int round;
+    int i;
+
+    assert(fast_mpool_init(&mpool, ALLOC_SIZE_ONCE, 0) == 0);
+
+    //the memory alloced before the mark is kept
+    kept = (char *)fast_mpool_alloc(&mpool, OBJECT_SIZE);
+    assert(kept != NULL);
+    memset(kept, 'K', OBJECT_SIZE);
+
+    assert(fast_mpool_mark(&mpool, &outer) == 0);
+    alloc_count = mpool.alloc_count;
+    alloc_bytes = mpool.alloc_bytes;
+    total_bytes = 0;
+
+    //rollback to the same mark many times, the mark self is kept
+    for (round=0; round<3; round++) {
+        for (i=0; i<OBJECT_COUNT; i++) {
+            ptrs[i] = (char *)fast_mpool_alloc(&mpool, OBJECT_SIZE);
+            assert(ptrs[i] != NULL);
+            memset(ptrs[i], 'A' + round, OBJECT_SIZE);
+        }
+        check_counters(alloc_count + OBJECT_COUNT,
+                alloc_bytes + OBJECT_COUNT * OBJECT_SIZE);
+
+        //the released memory is reused without the new block
+        if (round == 0) {
+            total_bytes = get_total_bytes();
+            assert(total_bytes > ALLOC_SIZE_ONCE);
+        } else {
+            assert(get_total_bytes() == total_bytes);
+        }
+
+        assert(fast_mpool_rollback_to(&mpool, &outer) == 0);
+        check_counters(alloc_count, alloc_bytes);
+    }
+
+    //the nested marks
+    for (i=0; i<OBJECT_COUNT / 2; i++) {
+        assert(fast_mpool_alloc(&mpool, OBJECT_SIZE) != NULL);
+    }
+    assert(fast_mpool_mark(&mpool, &inner) == 0);
+    for (i=0; i<OBJECT_COUNT; i++) {
+        assert(fast_mpool_alloc(&mpool, OBJECT_SIZE) != NULL);
+    }
+    assert(fast_mpool_rollback_to(&mpool, &inner) == 0);
+    assert(fast_mpool_rollback_to(&mpool, &outer) == 0);
+    check_counters(alloc_count, alloc_bytes);
+
+    for (i=0; i<OBJECT_SIZE; i++) {
+        assert(kept[i] == 'K');
+    }
+    fast_mpool_destroy(&mpool);
+}
+
+static void test_keep_blocks()
+{
+    const int big_sizes[] = {3 * ALLOC_SIZE_ONCE,
+        5 * ALLOC_SIZE_ONCE, 2 * ALLOC_SIZE_ONCE};
+    struct fast_mpool_stats stats;
+    int i;
+
+    assert(fast_mpool_init(&mpool, ALLOC_SIZE_ONCE, 0) == 0);
+    fast_mpool_set_keep_blocks(&mpool, 2);
+
+    //the big ones alloced in their own blocks
+    for (i=0; i<OBJECT_COUNT; i++) {
+        assert(fast_mpool_alloc(&mpool, OBJECT_SIZE) != NULL);
+    }
+    for (i=0; i<3; i++) {
+        assert(fast_mpool_alloc(&mpool, big_sizes[i]) != NULL);
+    }
+    fast_mpool_stats(&mpool, &stats);
+    assert(stats.total_trunk_count > 3);
+
+    //the largest 2 blocks are kept and free
+    fast_mpool_reset(&mpool);
+    fast_mpool_stats(&mpool, &stats);
+    assert(stats.total_trunk_count == 2);
+    assert(stats.total_bytes == 8 * ALLOC_SIZE_ONCE);
+    assert(stats.free_bytes == stats.total_bytes);
+
+    //reuse the kept blocks
+    assert(fast_mpool_alloc(&mpool, 5 * ALLOC_SIZE_ONCE) != NULL);
+    assert(fast_mpool_alloc(&mpool, 3 * ALLOC_SIZE_ONCE) != NULL);
+    fast_mpool_stats(&mpool, &stats);
+    assert(stats.total_trunk_count == 2 && stats.free_bytes == 0);
+    fast_mpool_destroy(&mpool);
+
+    //keep all blocks by default
+    assert(fast_mpool_init(&mpool, ALLOC_SIZE_ONCE, 0) == 0);
+    for (i=0; i<3; i++) {
+        assert(fast_mpool_alloc(&mpool, big_sizes[i]) != NULL);
+    }
+    fast_mpool_reset(&mpool);
+    fast_mpool_stats(&mpool, &stats);
+    assert(stats.total_trunk_count == 3);
+    fast_mpool_destroy(&mpool);
+}
+
+//the strings copied by the failed decode are released
+static void test_json_decode_rollback()
+{
+    const char *bad_array = "[\"aaaa\",\"bbbb\" \"cccc\"]";
+    const char *bad_map = "{\"k1\":\"v1\",\"k2\" \"v2\"}";
+    const char *good_array = "[\"aaaa\",\"bbbb\"]";
+    fc_json_context_t json_ctx;
+    struct fast_mpool_man *decode_mpool;
+    const fc_json_array_t *array;
+    char error_info[256];
+    string_t input;
+    int64_t alloc_count;
+    int i;
+
+    assert(fc_init_json_context_ex(&json_ctx, true, 1024, 1024,
+                error_info, sizeof(error_info)) == 0);
+    decode_mpool = &json_ctx.decode.mpool;
+    for (i=0; i<2; i++) {
+        alloc_count = decode_mpool->alloc_count;
+        FC_SET_STRING(input, (char *)bad_array);
+        assert(fc_decode_json_array(&json_ctx, &input) == NULL);
+        assert(fc_json_parser_get_error_no(&json_ctx) == EINVAL);
+        assert(decode_mpool->alloc_count == alloc_count + 1);  //the mark
+
+        alloc_count = decode_mpool->alloc_count;
+        FC_SET_STRING(input, (char *)bad_map);
+        assert(fc_decode_json_map(&json_ctx, &input) == NULL);
+        assert(decode_mpool->alloc_count == alloc_count + 1);
+    }
+
+    FC_SET_STRING(input, (char *)good_array);
+    array = fc_decode_json_array(&json_ctx, &input);
+    assert(array != NULL && array->count == 2);
+    assert(array->elements[1].len == 4 && memcmp(
+                array->elements[1].str, "bbbb", 4) == 0);
+    fc_destroy_json_context(&json_ctx);
+}
+
+int main(int argc, char *argv[])
+{
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+
+    test_mark_rollback();
+    test_keep_blocks();
+    test_json_decode_rollback();
+    printf("test mpool mark, rollback and keep blocks OK\n");
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fc_mpsc_queue.h"
+
+#define PRODUCER_COUNT  4
+#define CHAIN_LENGTH    8  //push a chain per 8 elements
+
+struct test_node {
+    int producer;
+    int seq;
+    struct test_node *next;
+};
+
+static int element_count = 100 * 1000;
+static struct fc_mpsc_queue queue;
+static struct test_node *nodes[PRODUCER_COUNT];
+static volatile int running_count;
+
+//the producers with odd index push the elements in chains
+static void *producer_func(void *arg)
+{
+    struct fc_queue_info qinfo;
+    struct test_node *node;
+    long index;
+    int i;
+
+    index = (long)arg;
+    qinfo.head = qinfo.tail = NULL;
+    for (i=0; i<element_count; i++) {
+        node = nodes[index] + i;
+        node->producer = index;
+        node->seq = i;
+        if (i % 64 == 0) {  //interleave the producers
+            sched_yield();
+        }
+        if (index % 2 == 0) {
+            fc_mpsc_queue_push(&queue, node);
+            continue;
+        }
+
+        node->next = NULL;
+        if (qinfo.head == NULL) {
+            qinfo.head = node;
+        } else {
+            ((struct test_node *)qinfo.tail)->next = node;
+        }
+        qinfo.tail = node;
+        if ((i + 1) % CHAIN_LENGTH == 0 || i == element_count - 1) {
+            fc_mpsc_queue_push_queue(&queue, &qinfo);
+            qinfo.head = qinfo.tail = NULL;
+        }
+    }
+
+    __sync_sub_and_fetch(&running_count, 1);
+    return NULL;
+}
+
+//the elements of each producer MUST be in the push order
+static int64_t consume(int *next_seqs)
+{
+    struct test_node *node;
+    int64_t count;
+
+    count = 0;
+    node = (struct test_node *)fc_mpsc_queue_pop_all(&queue);
+    while (node != NULL) {
+        if (node->seq != next_seqs[node->producer]) {
+            fprintf(stderr, "producer: %d, seq: %d != expect: %d\n",
+                    node->producer, node->seq,
+                    next_seqs[node->producer]);
+            assert(node->seq == next_seqs[node->producer]);
+        }
+        next_seqs[node->producer]++;
+        count++;
+        node = node->next;
+    }
+    return count;
+}
+
+static void test_single_thread()
+{
+    struct test_node chain[3];
+    struct fc_queue_info qinfo;
+    struct test_node *node;
+    int i;
+
+    fc_mpsc_queue_init(&queue, (long)(&((struct test_node *)NULL)->next));
+    assert(fc_mpsc_queue_empty(&queue));
+    assert(fc_mpsc_queue_pop_all(&queue) == NULL);
+
+    //true for the first push to notify the consumer
+    chain[0].seq = 0;
+    assert(fc_mpsc_queue_push(&queue, chain + 0));
+    chain[1].seq = 1;
+    chain[2].seq = 2;
+    chain[1].next = chain + 2;
+    chain[2].next = NULL;
+    qinfo.head = chain + 1;
+    qinfo.tail = chain + 2;
+    assert(!fc_mpsc_queue_push_queue(&queue, &qinfo));
+
+    fc_mpsc_queue_pop_to_queue(&queue, &qinfo);
+    assert(fc_mpsc_queue_empty(&queue));
+    assert(qinfo.tail == chain + 2);
+    node = (struct test_node *)qinfo.head;
+    for (i=0; i<3; i++) {
+        assert(node == chain + i);
+        node = node->next;
+    }
+    assert(node == NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t tids[PRODUCER_COUNT];
+    int next_seqs[PRODUCER_COUNT];
+    int64_t total_count;
+    int64_t start_time;
+    long i;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    if (argc > 1) {
+        element_count = strtol(argv[1], NULL, 10);
+    }
+
+    test_single_thread();
+
+    fc_mpsc_queue_init(&queue, (long)(&((struct test_node *)NULL)->next));
+    for (i=0; i<PRODUCER_COUNT; i++) {
+        nodes[i] = (struct test_node *)malloc(sizeof(struct test_node)
+                * element_count);
+        assert(nodes[i] != NULL);
+        next_seqs[i] = 0;
+    }
+
+    start_time = get_current_time_ms();
+    running_count = PRODUCER_COUNT;
+    for (i=0; i<PRODUCER_COUNT; i++) {
+        assert(pthread_create(tids + i, NULL, producer_func,
+                    (void *)i) == 0);
+    }
+
+    total_count = 0;
+    while (__sync_add_and_fetch(&running_count, 0) > 0) {
+        total_count += consume(next_seqs);
+        sched_yield();
+    }
+    total_count += consume(next_seqs);
+
+    for (i=0; i<PRODUCER_COUNT; i++) {
+        pthread_join(tids[i], NULL);
+        assert(next_seqs[i] == element_count);
+        free(nodes[i]);
+    }
+    assert(total_count == (int64_t)PRODUCER_COUNT * element_count);
+    assert(fc_mpsc_queue_empty(&queue));
+
+    printf("producers: %d, element count: %"PRId64", time used: %"PRId64
+            " ms\n", PRODUCER_COUNT, total_count,
+            get_current_time_ms() - start_time);
+    return 0;
+}
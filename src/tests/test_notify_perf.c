@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/ioevent_loop.h"
+
+#define MODE_PIPE_RAW   0  //write the pipe for every notify
+#define MODE_PIPE       1  //coalesced wakeups with pipe
+#define MODE_EVENTFD    2  //coalesced wakeups with eventfd
+
+#define MAX_THREADS 16
+
+static int loop_count = 100000;
+static int notify_mode;
+static struct nio_thread_data thread_data;
+static volatile bool continue_flag;
+static volatile int64_t produced_count;
+static volatile int64_t consumed_count;
+static volatile int64_t wakeup_count;
+
+static const char *mode_caption(const int mode)
+{
+    switch (mode) {
+        case MODE_PIPE_RAW:
+            return "pipe_raw";
+        case MODE_PIPE:
+            return "pipe";
+        default:
+            return "eventfd";
+    }
+}
+
+//the loop drained the notify fd already
+static void recv_notify_callback(int sock, short event, void *arg)
+{
+    wakeup_count++;
+    __sync_lock_test_and_set(&consumed_count,
+            __sync_add_and_fetch(&produced_count, 0));
+}
+
+static void clean_up_callback(struct fast_task_info *task)
+{
+}
+
+static inline void notify_loop()
+{
+    int64_t n;
+
+    __sync_add_and_fetch(&produced_count, 1);
+    if (notify_mode == MODE_PIPE_RAW) {
+        n = 1;
+        //EAGAIN when the pipe is full, the wakeup is pending yet
+        if (write(FC_NOTIFY_WRITE_FD(&thread_data), &n,
+                    sizeof(n)) != sizeof(n) && errno != EAGAIN)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "write fail, errno: %d", __LINE__, errno);
+        }
+    } else {
+        ioevent_notify_thread(&thread_data);
+    }
+}
+
+static void *loop_thread_func(void *arg)
+{
+    ioevent_loop(&thread_data, recv_notify_callback,
+            clean_up_callback, &continue_flag);
+    return NULL;
+}
+
+static void *producer_thread_func(void *arg)
+{
+    int i;
+
+    for (i=0; i<loop_count; i++) {
+        notify_loop();
+    }
+    return NULL;
+}
+
+static int init_thread_data(const int mode)
+{
+    int result;
+
+    memset(&thread_data, 0, sizeof(thread_data));
+    if ((result=ioevent_init(&thread_data.ev_puller, 64, 100, 0)) != 0) {
+        return result;
+    }
+    if ((result=fast_timer_init(&thread_data.timer, 64,
+                    g_current_time)) != 0)
+    {
+        return result;
+    }
+
+    if (mode == MODE_EVENTFD) {
+        return ioevent_notify_init(&thread_data);
+    }
+
+    if (pipe(thread_data.pipe_fds) != 0) {
+        return errno;
+    }
+    set_nonblock(thread_data.pipe_fds[0]);
+    set_nonblock(thread_data.pipe_fds[1]);
+    thread_data.notify.enabled = true;
+    return 0;
+}
+
+static int test_mode(const int mode, const int thread_count)
+{
+    pthread_t loop_tid;
+    pthread_t tids[MAX_THREADS];
+    int64_t start_time;
+    int64_t pingpong_time;
+    int64_t burst_time;
+    int64_t total;
+    int result;
+    int i;
+
+    if ((result=init_thread_data(mode)) != 0) {
+        printf("%10s %8d %s\n", mode_caption(mode),
+                thread_count, STRERROR(result));
+        return result;
+    }
+
+    notify_mode = mode;
+    produced_count = consumed_count = wakeup_count = 0;
+    continue_flag = true;
+    pthread_create(&loop_tid, NULL, loop_thread_func, NULL);
+
+    //ping-pong: wait the loop to consume before the next notify
+    start_time = get_current_time_us();
+    for (i=0; i<loop_count; i++) {
+        notify_loop();
+        while (__sync_add_and_fetch(&consumed_count, 0) <= i) {
+        }
+    }
+    pingpong_time = get_current_time_us() - start_time;
+
+    //burst: the producer threads notify without waiting
+    produced_count = consumed_count = wakeup_count = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<thread_count; i++) {
+        pthread_create(tids + i, NULL, producer_thread_func, NULL);
+    }
+    for (i=0; i<thread_count; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    total = (int64_t)loop_count * thread_count;
+    while (__sync_add_and_fetch(&consumed_count, 0) < total) {
+    }
+    burst_time = get_current_time_us() - start_time;
+
+    continue_flag = false;
+    ioevent_notify_thread(&thread_data);
+    pthread_join(loop_tid, NULL);
+
+    printf("%10s %8d %14.2f %14.2f %12"PRId64"\n", mode_caption(mode),
+            thread_count, (double)pingpong_time / loop_count,
+            (double)total / burst_time, wakeup_count);
+
+    ioevent_notify_destroy(&thread_data);
+    fast_timer_destroy(&thread_data.timer);
+    ioevent_destroy(&thread_data.ev_puller);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads;
+    int thread_count;
+    int mode;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    g_current_time = time(NULL);
+    max_threads = 8;
+    if (argc > 1) {
+        loop_count = strtol(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        max_threads = strtol(argv[2], NULL, 10);
+        if (max_threads > MAX_THREADS) {
+            max_threads = MAX_THREADS;
+        }
+    }
+
+    printf("usage: %s [loop_count] [max_threads]\n", argv[0]);
+    printf("loop count: %d\n\n", loop_count);
+    printf("%10s %8s %14s %14s %12s\n", "mode", "threads",
+            "pingpong(us)", "burst(ops/us)", "wakeups");
+    for (thread_count=1; thread_count<=max_threads; thread_count*=2) {
+        for (mode=MODE_PIPE_RAW; mode<=MODE_EVENTFD; mode++) {
+            test_mode(mode, thread_count);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
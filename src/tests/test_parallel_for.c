@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/thread_pool.h"
+
+#define THREAD_COUNT     4
+#define RANGE_BEGIN   1000
+#define RANGE_SIZE   100003
+#define TASK_COUNT      64
+
+typedef struct {
+    int64_t begin;  //the begin of the whole range
+    int64_t grain;  //the expected chunk size, 0 for any
+    volatile int *hit_counts;
+    volatile int chunk_count;
+    volatile int running_count;
+    pthread_t caller_tid;
+    volatile int caller_chunk_count;
+} ParallelForArgs;
+
+static void chunk_func(const int64_t begin, const int64_t end, void *arg)
+{
+    ParallelForArgs *args;
+    int64_t i;
+
+    args = (ParallelForArgs *)arg;
+    __sync_add_and_fetch(&args->running_count, 1);
+    assert(begin < end);
+    if (args->grain > 0) {
+        assert((begin - args->begin) % args->grain == 0);
+        assert(end - begin <= args->grain);
+    }
+    for (i=begin; i<end; i++) {
+        __sync_add_and_fetch(args->hit_counts + (i - args->begin), 1);
+    }
+    if (pthread_equal(pthread_self(), args->caller_tid)) {
+        __sync_add_and_fetch(&args->caller_chunk_count, 1);
+    }
+
+    //make the wait meaningful
+    if (__sync_add_and_fetch(&args->chunk_count, 1) % 16 == 0) {
+        fc_sleep_ms(1);
+    }
+    __sync_sub_and_fetch(&args->running_count, 1);
+}
+
+static void init_args(ParallelForArgs *args, volatile int *hit_counts,
+        const int64_t begin, const int64_t grain)
+{
+    args->begin = begin;
+    args->grain = grain;
+    args->hit_counts = hit_counts;
+    args->chunk_count = 0;
+    args->running_count = 0;
+    args->caller_tid = pthread_self();
+    args->caller_chunk_count = 0;
+}
+
+//the range is covered without gap or overlap
+static void test_coverage(FCThreadPool *pool, const int64_t grain)
+{
+    ParallelForArgs args;
+    volatile int *hit_counts;
+    int64_t chunk_count;
+    int i;
+
+    hit_counts = (volatile int *)calloc(RANGE_SIZE, sizeof(int));
+    assert(hit_counts != NULL);
+    init_args(&args, hit_counts, RANGE_BEGIN, grain);
+    assert(fc_parallel_for(pool, RANGE_BEGIN, RANGE_BEGIN + RANGE_SIZE,
+                grain, chunk_func, &args) == 0);
+
+    //all chunks finish before return
+    assert(args.running_count == 0);
+    if (grain > 0) {
+        chunk_count = (RANGE_SIZE + grain - 1) / grain;
+        assert(args.chunk_count == chunk_count);
+    }
+    for (i=0; i<RANGE_SIZE; i++) {
+        assert(hit_counts[i] == 1);
+    }
+
+    free((void *)hit_counts);
+}
+
+static void test_edge_cases(FCThreadPool *pool)
+{
+    ParallelForArgs args;
+    volatile int hit_counts[16];
+
+    //zero length range and reverse range
+    memset((void *)hit_counts, 0, sizeof(hit_counts));
+    init_args(&args, hit_counts, 10, 0);
+    assert(fc_parallel_for(pool, 10, 10, 0, chunk_func, &args) == 0);
+    assert(fc_parallel_for(pool, 10, 5, 1, chunk_func, &args) == 0);
+    assert(args.chunk_count == 0);
+
+    //the grain larger than the range, one chunk run by the caller
+    init_args(&args, hit_counts, 0, 0);
+    assert(fc_parallel_for(pool, 0, 16, 100, chunk_func, &args) == 0);
+    assert(args.chunk_count == 1 && args.caller_chunk_count == 1);
+    assert(hit_counts[0] == 1 && hit_counts[15] == 1);
+}
+
+static volatile int finished_count = 0;
+
+static void completion_task_func(void *arg, void *thread_data)
+{
+    FCThreadPoolCompletion *completion;
+
+    completion = (FCThreadPoolCompletion *)arg;
+    fc_sleep_ms(1);
+    __sync_add_and_fetch(&finished_count, 1);
+    fc_thread_pool_completion_done(completion);
+}
+
+//the wait returns after all tasks done
+static void test_completion(FCThreadPool *pool)
+{
+    FCThreadPoolCompletion completion;
+    int i;
+
+    assert(fc_thread_pool_completion_init(&completion) == 0);
+    fc_thread_pool_completion_add(&completion, TASK_COUNT);
+    for (i=0; i<TASK_COUNT; i++) {
+        assert(fc_thread_pool_run(pool, completion_task_func,
+                    &completion) == 0);
+    }
+    fc_thread_pool_completion_wait(&completion);
+    assert(completion.count == 0);
+    assert(finished_count == TASK_COUNT);
+    finished_count = 0;
+    fc_thread_pool_completion_destroy(&completion);
+}
+
+typedef struct {
+    FCThreadPool *pool;
+    FCThreadPoolCompletion completion;
+} NestedTaskArgs;
+
+//parallel for in the worker thread runs the queued tasks instead of block
+static void nested_task_func(void *arg, void *thread_data)
+{
+    NestedTaskArgs *args;
+
+    args = (NestedTaskArgs *)arg;
+    test_coverage(args->pool, 0);
+    test_coverage(args->pool, 7);
+    fc_thread_pool_completion_done(&args->completion);
+}
+
+static void test_pool(FCThreadPool *pool, const char *caption)
+{
+    NestedTaskArgs nested_args;
+
+    test_coverage(pool, 0);
+    test_coverage(pool, 1);
+    test_coverage(pool, 7);
+    test_coverage(pool, RANGE_SIZE - 1);
+    test_edge_cases(pool);
+    test_completion(pool);
+
+    if (pool->work_stealing) {
+        nested_args.pool = pool;
+        assert(fc_thread_pool_completion_init(
+                    &nested_args.completion) == 0);
+        fc_thread_pool_completion_add(&nested_args.completion, 1);
+        assert(fc_thread_pool_run(pool, nested_task_func,
+                    &nested_args) == 0);
+        fc_thread_pool_completion_wait(&nested_args.completion);
+        fc_thread_pool_completion_destroy(&nested_args.completion);
+    }
+    printf("%s OK\n", caption);
+}
+
+int main(int argc, char *argv[])
+{
+    FCThreadPool pool;
+    FCThreadPool ws_pool;
+    volatile bool continue_flag = true;
+
+    log_init();
+    assert(fc_thread_pool_init(&pool, "normal", THREAD_COUNT, 128 * 1024,
+                60, THREAD_COUNT, (bool * volatile)&continue_flag) == 0);
+    test_pool(&pool, "normal pool");
+
+    assert(fc_thread_pool_init_work_stealing(&ws_pool, "ws", THREAD_COUNT,
+                128 * 1024, 0, (bool * volatile)&continue_flag, NULL) == 0);
+    test_pool(&ws_pool, "work stealing pool");
+
+    continue_flag = false;
+    fc_thread_pool_destroy(&ws_pool);
+    printf("test parallel for OK\n");
+    return 0;
+}
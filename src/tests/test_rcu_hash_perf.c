@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/hash.h"
+#include "fastcommon/rcu_hash.h"
+
+#define MODE_HASH_ARRAY  0  //HashArray with the striped locks
+#define MODE_RCU_HASH    1
+
+#define MAX_THREADS      64
+#define LOCK_COUNT       64
+#define UPDATE_INTERVAL  1000  //one update per 1000 lookups
+
+static int64_t key_count = 1000 * 1000;
+static int64_t loop_count = 10 * 1000 * 1000;
+static int test_mode;
+static HashArray hash_array;
+static FCRcuHashMap rcu_hash;
+static volatile int64_t miss_count;
+
+static const char *mode_caption(const int mode)
+{
+    return (mode == MODE_HASH_ARRAY ? "HashArray" : "rcu_hash");
+}
+
+static inline int do_insert(const int64_t key, const int64_t value)
+{
+    if (test_mode == MODE_HASH_ARRAY) {
+        return fc_hash_insert_ex(&hash_array, &key, sizeof(key),
+                (void *)&value, sizeof(value), true);
+    } else {
+        return fc_rcu_hash_insert(&rcu_hash, &key, sizeof(key),
+                &value, sizeof(value));
+    }
+}
+
+static inline int do_get(const int64_t key, int64_t *value)
+{
+    int value_len;
+
+    value_len = sizeof(*value);
+    if (test_mode == MODE_HASH_ARRAY) {
+        return fc_hash_get(&hash_array, &key, sizeof(key),
+                value, &value_len);
+    } else {
+        return fc_rcu_hash_get(&rcu_hash, &key, sizeof(key),
+                value, &value_len);
+    }
+}
+
+static void *reader_thread_func(void *arg)
+{
+    int64_t i;
+    int64_t key;
+    int64_t value;
+    int64_t misses;
+    uint64_t seed;
+
+    misses = 0;
+    seed = (long)arg + 1;
+    for (i=0; i<loop_count; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        key = (seed >> 16) % key_count;
+        if (i % UPDATE_INTERVAL == 0) {
+            do_insert(key, key);
+        } else if (do_get(key, &value) != 0 || value != key) {
+            misses++;
+        }
+    }
+
+    if (misses > 0) {
+        __sync_add_and_fetch(&miss_count, misses);
+    }
+    return NULL;
+}
+
+//insert the new keys to resize the table while reading
+static void *writer_thread_func(void *arg)
+{
+    int64_t key;
+
+    for (key=key_count; key<2 * key_count; key++) {
+        do_insert(key, key);
+    }
+    return NULL;
+}
+
+static int test_threads(const int mode, const int thread_count,
+        const bool with_writer)
+{
+    pthread_t tids[MAX_THREADS];
+    pthread_t writer_tid;
+    int64_t start_time;
+    int64_t time_used;
+    int64_t key;
+    int result;
+    long i;
+
+    test_mode = mode;
+    if (mode == MODE_HASH_ARRAY) {
+        //the HashArray with locks can not rehash
+        if ((result=fc_hash_init_ex(&hash_array, fc_fast_hash,
+                        2 * key_count, 0.00, 0, true)) != 0)
+        {
+            return result;
+        }
+        if ((result=fc_hash_set_locks(&hash_array, LOCK_COUNT)) != 0) {
+            return result;
+        }
+    } else {
+        if ((result=fc_rcu_hash_init(&rcu_hash, fc_fast_hash,
+                        sizeof(int64_t), sizeof(int64_t), 1024,
+                        LOCK_COUNT, 1)) != 0)
+        {
+            return result;
+        }
+    }
+
+    for (key=0; key<key_count; key++) {
+        if (do_insert(key, key) < 0) {
+            return ENOMEM;
+        }
+    }
+
+    miss_count = 0;
+    start_time = get_current_time_us();
+    if (with_writer) {
+        pthread_create(&writer_tid, NULL, writer_thread_func, NULL);
+    }
+    for (i=0; i<thread_count; i++) {
+        pthread_create(tids + i, NULL, reader_thread_func, (void *)i);
+    }
+    for (i=0; i<thread_count; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    time_used = get_current_time_us() - start_time;
+    if (with_writer) {
+        pthread_join(writer_tid, NULL);
+    }
+
+    printf("%10s %8d %8s %14.2f %10"PRId64"\n", mode_caption(mode),
+            thread_count, with_writer ? "yes" : "no",
+            (double)loop_count * thread_count / time_used, miss_count);
+
+    if (mode == MODE_HASH_ARRAY) {
+        fc_hash_destroy(&hash_array);
+    } else {
+        fc_rcu_hash_destroy(&rcu_hash);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads;
+    int thread_count;
+    int mode;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    max_threads = 8;
+    if (argc > 1) {
+        key_count = strtoll(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        loop_count = strtoll(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        max_threads = strtol(argv[3], NULL, 10);
+        if (max_threads > MAX_THREADS) {
+            max_threads = MAX_THREADS;
+        }
+    }
+
+    printf("usage: %s [key_count] [loop_count] [max_threads]\n", argv[0]);
+    printf("key count: %"PRId64", loop count per thread: %"PRId64", "
+            "one update per %d lookups\n", key_count, loop_count,
+            UPDATE_INTERVAL);
+    printf("the writer inserts %"PRId64" new keys while reading\n\n",
+            key_count);
+    printf("%10s %8s %8s %14s %10s\n", "mode", "threads",
+            "writer", "Mops/s", "misses");
+    for (thread_count=1; thread_count<=max_threads; thread_count*=2) {
+        for (mode=MODE_HASH_ARRAY; mode<=MODE_RCU_HASH; mode++) {
+            test_threads(mode, thread_count, false);
+            test_threads(mode, thread_count, true);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
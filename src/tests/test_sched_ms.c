@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/thread_pool.h"
+
+#define FAST_INTERVAL_MS   20
+#define POOL_INTERVAL_MS   50
+#define RUN_TIME_MS      1000
+
+//the slack for the thread wakeup delay
+#define MAX_DELAY_MS      100
+
+static volatile int fast_count = 0;
+static volatile int pool_count = 0;
+static volatile int pool_in_sched_thread = 0;
+static pthread_t sched_tid;
+
+static int fast_task_func(void *args)
+{
+    sched_tid = pthread_self();
+    __sync_add_and_fetch(&fast_count, 1);
+    return 0;
+}
+
+static int pool_task_func(void *args)
+{
+    if (pthread_equal(pthread_self(), sched_tid))
+    {
+        __sync_add_and_fetch(&pool_in_sched_thread, 1);
+    }
+    __sync_add_and_fetch(&pool_count, 1);
+    return 0;
+}
+
+/* check the cached clock every ms, return the max staleness */
+static int64_t check_clock(const int run_time_ms)
+{
+    int64_t start_time;
+    int64_t current_time;
+    int64_t cached_time;
+    int64_t max_stale;
+
+    max_stale = 0;
+    start_time = sched_monotonic_time_ms();
+    do {
+        cached_time = get_current_monotonic_ms();
+        current_time = sched_monotonic_time_ms();
+        assert(cached_time <= current_time);
+        if (current_time - cached_time > max_stale)
+        {
+            max_stale = current_time - cached_time;
+        }
+        fc_sleep_ms(1);
+    } while (current_time - start_time < run_time_ms);
+
+    return max_stale;
+}
+
+static void wait_count(volatile int *count, const int expect)
+{
+    int i;
+
+    for (i=0; i<2000 && *count < expect; i++)
+    {
+        fc_sleep_ms(1);
+    }
+    assert(*count >= expect);
+}
+
+int main(int argc, char *argv[])
+{
+    FCThreadPool pool;
+    ScheduleArray schedule_array;
+    ScheduleEntry entries[2];
+    pthread_t tid;
+    bool continue_flag = true;
+    bool pool_continue_flag = true;
+    int64_t max_stale;
+    int start_fast_count;
+    int start_pool_count;
+    int count;
+
+    log_init();
+    fast_mblock_manager_init();
+    assert(fc_thread_pool_init(&pool, "sched", 4, 64 * 1024, 60, 1,
+                (bool * volatile)&pool_continue_flag) == 0);
+    sched_set_thread_pool(&pool);
+
+    //no entry with interval_ms, the clock is computed on read
+    schedule_array.entries = NULL;
+    schedule_array.count = 0;
+    assert(sched_start(&schedule_array, &tid, 64 * 1024,
+                (bool * volatile)&continue_flag) == 0);
+    while (!g_schedule_flag)
+    {
+        fc_sleep_ms(1);
+    }
+    max_stale = check_clock(RUN_TIME_MS / 2);
+    assert(g_current_time_ms == 0);
+    assert(max_stale <= 1);
+
+    //the entries with interval_ms, one runs in the thread pool
+    memset(entries, 0, sizeof(entries));
+    INIT_SCHEDULE_ENTRY_MS(entries[0], sched_generate_next_id(),
+            FAST_INTERVAL_MS, fast_task_func, NULL, false);
+    INIT_SCHEDULE_ENTRY_MS(entries[1], sched_generate_next_id(),
+            POOL_INTERVAL_MS, pool_task_func, NULL, true);
+    schedule_array.entries = entries;
+    schedule_array.count = 2;
+    assert(sched_add_entries(&schedule_array) == 0);
+    wait_count(&fast_count, 1);
+    wait_count(&pool_count, 1);
+
+    start_fast_count = fast_count;
+    start_pool_count = pool_count;
+    max_stale = check_clock(RUN_TIME_MS);
+    assert(g_current_time_ms > 0);
+    count = fast_count - start_fast_count;
+    printf("interval %d ms count: %d, ", FAST_INTERVAL_MS, count);
+    assert(count >= RUN_TIME_MS / FAST_INTERVAL_MS / 2 &&
+            count <= RUN_TIME_MS / FAST_INTERVAL_MS + 2);
+    count = pool_count - start_pool_count;
+    printf("interval %d ms (in pool) count: %d, max stale: %"PRId64" ms\n",
+            POOL_INTERVAL_MS, count, max_stale);
+    assert(count >= RUN_TIME_MS / POOL_INTERVAL_MS / 2 &&
+            count <= RUN_TIME_MS / POOL_INTERVAL_MS + 2);
+    assert(pool_in_sched_thread == 0);
+    assert(max_stale <= FAST_INTERVAL_MS + MAX_DELAY_MS);
+
+    //the schedule thread exits after the running pool tasks
+    continue_flag = false;
+    while (g_schedule_flag)
+    {
+        fc_sleep_ms(10);
+    }
+    printf("test sched ms OK\n");
+    return 0;
+}
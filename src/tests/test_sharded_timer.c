@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/locked_timer.h"
+
+#define SHARD_COUNT     2
+#define PRODUCER_COUNT  2
+#define ENTRY_COUNT     1000  //per producer
+#define ROUND_COUNT     5
+#define MAX_TIMEOUT_MS  20
+
+struct test_sharded_entry {
+    LockedShardedTimerEntry timer;  //must be the first
+    int64_t expires;  //the last expires set by the producer
+    volatile int64_t fire_time;
+    volatile int fired_count;
+    bool removed;  //removed by the producer successfully
+};
+
+static LockedShardedTimer timer;
+static struct test_sharded_entry entries[PRODUCER_COUNT][ENTRY_COUNT];
+static volatile bool continue_flag;
+static volatile int timedout_count;  //the requests after expired
+
+//the shard threads deal the timeouts only
+static void *shard_thread_func(void *arg)
+{
+    LockedShardedTimerEntry head;
+    LockedShardedTimerEntry *current;
+    struct test_sharded_entry *entry;
+    int64_t current_time;
+    long index;
+
+    index = (long)arg;
+    while (continue_flag) {
+        current_time = get_current_time_ms();
+        locked_sharded_timer_timeouts_get(&timer, index,
+                current_time, &head);
+        current = head.next;
+        while (current != NULL) {
+            entry = (struct test_sharded_entry *)current;
+            assert(current->shard_index == index);
+
+            //the producer reuses the entry after the fired count set
+            current = current->next;
+            __sync_lock_test_and_set(&entry->fire_time, current_time);
+            __sync_add_and_fetch(&entry->fired_count, 1);
+        }
+        usleep(500);
+    }
+    return NULL;
+}
+
+//the removed entries are freed once released, run with ASan to check
+static void free_after_released()
+{
+    LockedShardedTimerEntry *entry;
+    int64_t expires;
+    int i;
+
+    for (i=0; i<ENTRY_COUNT; i++) {
+        entry = (LockedShardedTimerEntry *)malloc(sizeof(*entry));
+        assert(entry != NULL);
+        locked_sharded_timer_entry_init(&timer, entry, -1);
+        expires = get_current_time_ms() + 1000 * MAX_TIMEOUT_MS;
+        assert(locked_sharded_timer_add(&timer, entry, expires) == 0);
+        if (i % 2 == 0) {
+            assert(locked_sharded_timer_modify(&timer,
+                        entry, expires + 1) == 0);
+        }
+        if (i % 4 == 0) {
+            usleep(rand() % 1000);
+        }
+        assert(locked_sharded_timer_remove(&timer, entry) == 0);
+
+        while (!locked_sharded_timer_entry_released(entry)) {
+            sched_yield();
+        }
+        memset(entry, 0xFF, sizeof(*entry));
+        free(entry);
+    }
+}
+
+//the entries are added, modified and removed by the non-shard threads
+static void *producer_thread_func(void *arg)
+{
+    struct test_sharded_entry *entry;
+    int64_t expires;
+    long index;
+    int result;
+    int round;
+    int i;
+
+    index = (long)arg;
+    for (round=0; round<ROUND_COUNT; round++) {
+        for (i=0; i<ENTRY_COUNT; i++) {
+            entry = entries[index] + i;
+            locked_sharded_timer_entry_init(&timer, &entry->timer,
+                    (i % 3 == 0) ? -1 : i % SHARD_COUNT);
+            entry->fire_time = 0;
+            entry->fired_count = 0;
+            entry->removed = false;
+            entry->expires = get_current_time_ms() + rand() % MAX_TIMEOUT_MS;
+            assert(locked_sharded_timer_add(&timer, &entry->timer,
+                        entry->expires) == 0);
+
+            switch (rand() % 4) {
+                case 1:  //race with the expiry
+                    usleep(rand() % 1000);
+                    result = locked_sharded_timer_remove(
+                            &timer, &entry->timer);
+                    entry->removed = (result == 0);
+                    break;
+                case 2:
+                    expires = entry->expires + rand() % MAX_TIMEOUT_MS;
+                    if ((result=locked_sharded_timer_modify(&timer,
+                                    &entry->timer, expires)) == 0)
+                    {
+                        entry->expires = expires;
+                    }
+                    break;
+                case 3:
+                    if (locked_sharded_timer_modify(&timer, &entry->timer,
+                                entry->expires + MAX_TIMEOUT_MS) == 0)
+                    {
+                        entry->expires += MAX_TIMEOUT_MS;
+                    }
+                    usleep(rand() % 100);
+                    result = locked_sharded_timer_remove(
+                            &timer, &entry->timer);
+                    entry->removed = (result == 0);
+                    break;
+                default:
+                    result = 0;
+                    break;
+            }
+
+            if (result != 0) {
+                assert(result == ETIMEDOUT);
+                __sync_add_and_fetch(&timedout_count, 1);
+            }
+        }
+
+        //each entry is removed or fired once, then released
+        for (i=0; i<ENTRY_COUNT; i++) {
+            entry = entries[index] + i;
+            while (!(entry->removed || __sync_add_and_fetch(
+                            &entry->fired_count, 0) > 0) ||
+                    !locked_sharded_timer_entry_released(&entry->timer))
+            {
+                usleep(1000);
+            }
+        }
+        usleep(10 * 1000);  //the fired twice is detected
+
+        for (i=0; i<ENTRY_COUNT; i++) {
+            entry = entries[index] + i;
+            if (entry->removed) {
+                assert(entry->fired_count == 0);
+            } else {
+                assert(entry->fired_count == 1);
+                assert(entry->fire_time > entry->expires);
+            }
+        }
+    }
+
+    free_after_released();
+    return NULL;
+}
+
+static void test_single_thread()
+{
+    LockedShardedTimerEntry head;
+    LockedShardedTimerEntry entry;
+    int64_t current_time;
+
+    current_time = get_current_time_ms();
+    assert(locked_sharded_timer_init(&timer, 0, 64,
+                current_time) == EINVAL);
+    assert(locked_sharded_timer_init(&timer, 1, 64, current_time) == 0);
+
+    locked_sharded_timer_entry_init(&timer, &entry, -1);
+    assert(locked_sharded_timer_remove(&timer, &entry) == ENOENT);
+    assert(locked_sharded_timer_modify(&timer, &entry, 100) == ENOENT);
+    assert(locked_sharded_timer_add(&timer, &entry, 0) == EINVAL);
+
+    //the later request wins
+    assert(locked_sharded_timer_add(&timer, &entry, current_time + 10) == 0);
+    assert(locked_sharded_timer_modify(&timer, &entry,
+                current_time + 20) == 0);
+    assert(locked_sharded_timer_timeouts_get(&timer, 0,
+                current_time + 15, &head) == 0);
+    assert(locked_sharded_timer_timeouts_get(&timer, 0,
+                current_time + 21, &head) == 1);
+    assert(head.next == &entry && entry.next == NULL);
+    assert(locked_sharded_timer_entry_released(&entry));
+    assert(locked_sharded_timer_remove(&timer, &entry) == ETIMEDOUT);
+
+    //added again after expired, then removed
+    assert(locked_sharded_timer_add(&timer, &entry, current_time + 30) == 0);
+    assert(locked_sharded_timer_timeouts_get(&timer, 0,
+                current_time + 22, &head) == 0);
+    assert(!locked_sharded_timer_entry_released(&entry));
+    assert(locked_sharded_timer_remove(&timer, &entry) == 0);
+    assert(locked_sharded_timer_timeouts_get(&timer, 0,
+                current_time + 40, &head) == 0);
+    assert(locked_sharded_timer_entry_released(&entry));
+
+    locked_sharded_timer_destroy(&timer);
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t shard_tids[SHARD_COUNT];
+    pthread_t producer_tids[PRODUCER_COUNT];
+    int64_t start_time;
+    int result;
+    long i;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    srand(time(NULL));
+
+    test_single_thread();
+
+    start_time = get_current_time_ms();
+    if ((result=locked_sharded_timer_init(&timer, SHARD_COUNT,
+                    1024, start_time)) != 0)
+    {
+        return result;
+    }
+
+    continue_flag = true;
+    for (i=0; i<SHARD_COUNT; i++) {
+        assert(pthread_create(shard_tids + i, NULL,
+                    shard_thread_func, (void *)i) == 0);
+    }
+    for (i=0; i<PRODUCER_COUNT; i++) {
+        assert(pthread_create(producer_tids + i, NULL,
+                    producer_thread_func, (void *)i) == 0);
+    }
+
+    for (i=0; i<PRODUCER_COUNT; i++) {
+        pthread_join(producer_tids[i], NULL);
+    }
+    continue_flag = false;
+    for (i=0; i<SHARD_COUNT; i++) {
+        pthread_join(shard_tids[i], NULL);
+    }
+
+    locked_sharded_timer_destroy(&timer);
+    printf("sharded timer OK, shards: %d, producers: %d, entries: %d, "
+            "requests after expired: %d, time used: %"PRId64" ms\n",
+            SHARD_COUNT, PRODUCER_COUNT, PRODUCER_COUNT * ENTRY_COUNT *
+            ROUND_COUNT, timedout_count, get_current_time_ms() - start_time);
+    return 0;
+}
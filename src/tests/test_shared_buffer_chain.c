@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/shared_buffer.h"
+
+#define BUFFER_COUNT        3
+#define SLICE_ALLOC_ONCE    4
+
+static SharedBufferContext ctx;
+static SharedBuffer *buffers[BUFFER_COUNT];
+static const int buffer_lengths[BUFFER_COUNT] = {10, 20, 30};
+
+#define PATTERN_CHAR(offset)  ((char)('a' + (offset) % 26))
+
+//the byte at offset of the whole payload is PATTERN_CHAR(offset)
+static void init_buffers()
+{
+    int offset;
+    int i;
+    int k;
+
+    offset = 0;
+    for (i=0; i<BUFFER_COUNT; i++) {
+        buffers[i] = shared_buffer_alloc_ex(&ctx, 1);
+        assert(buffers[i] != NULL);
+        for (k=0; k<buffer_lengths[i]; k++) {
+            buffers[i]->buff[k] = PATTERN_CHAR(offset++);
+        }
+        buffers[i]->length = buffer_lengths[i];
+    }
+}
+
+static void make_chain(SharedBufferChain *chain)
+{
+    int i;
+
+    shared_buffer_chain_init(chain, &ctx);
+    for (i=0; i<BUFFER_COUNT; i++) {
+        assert(shared_buffer_chain_append(chain, buffers[i]) == 0);
+    }
+    assert(chain->count == BUFFER_COUNT && chain->length == 60);
+}
+
+/* check the count and lengths of the iovec, and the bytes
+   from the offset of the whole payload */
+static void check_chain(const SharedBufferChain *chain,
+        const int64_t offset, const int *lengths, const int count)
+{
+    struct iovec iov[8];
+    int64_t length;
+    int iov_count;
+    int i;
+    int k;
+
+    iov_count = shared_buffer_chain_to_iovec(chain, iov, 8);
+    assert(iov_count == count && chain->count == count);
+    length = 0;
+    for (i=0; i<iov_count; i++) {
+        assert(iov[i].iov_len == lengths[i]);
+        for (k=0; k<lengths[i]; k++) {
+            assert(((char *)iov[i].iov_base)[k] ==
+                    PATTERN_CHAR(offset + length + k));
+        }
+        length += lengths[i];
+    }
+    assert(chain->length == length);
+    if (count == 0) {
+        assert(chain->head == NULL && chain->tail == NULL);
+    } else {
+        assert(chain->tail->next == NULL);
+    }
+}
+
+static void test_to_iovec()
+{
+    SharedBufferChain chain;
+    struct iovec iov[2];
+    const int lengths[] = {10, 20, 30};
+
+    make_chain(&chain);
+    check_chain(&chain, 0, lengths, 3);
+
+    //the iovec array is smaller than the chain
+    assert(shared_buffer_chain_to_iovec(&chain, iov, 2) == 2);
+    assert(iov[0].iov_len == 10 && iov[1].iov_len == 20);
+
+    shared_buffer_chain_release(&chain);
+    check_chain(&chain, 0, NULL, 0);
+}
+
+static void test_split()
+{
+    SharedBufferChain chain;
+    SharedBufferChain tail;
+    SharedBufferChain tail2;
+    const int head_lengths[] = {10, 15};
+    const int tail_lengths[] = {5, 30};
+    const int tail2_lengths[] = {30};
+
+    make_chain(&chain);
+
+    //split in the middle of the second segment
+    shared_buffer_chain_init(&tail, &ctx);
+    assert(shared_buffer_chain_split(&chain, 25, &tail) == 0);
+    check_chain(&chain, 0, head_lengths, 2);
+    check_chain(&tail, 25, tail_lengths, 2);
+    assert(buffers[1]->reffer_count == 3);  //2 slices + owner
+
+    //split at the segment boundary, no slice is created
+    shared_buffer_chain_init(&tail2, &ctx);
+    assert(shared_buffer_chain_split(&tail, 5, &tail2) == 0);
+    check_chain(&tail, 25, tail_lengths, 1);
+    check_chain(&tail2, 30, tail2_lengths, 1);
+
+    //split at the end and the begin
+    assert(shared_buffer_chain_split(&tail2, 30, &tail) == 0);
+    check_chain(&tail2, 30, tail2_lengths, 1);
+    shared_buffer_chain_release(&tail);
+    assert(shared_buffer_chain_split(&tail2, 0, &tail) == 0);
+    check_chain(&tail2, 0, NULL, 0);
+    check_chain(&tail, 30, tail2_lengths, 1);
+    assert(shared_buffer_chain_split(&tail, 31, &tail2) == EINVAL);
+
+    shared_buffer_chain_release(&chain);
+    shared_buffer_chain_release(&tail);
+    assert(buffers[1]->reffer_count == 1);
+}
+
+static void test_consume()
+{
+    SharedBufferChain chain;
+    const int lengths1[] = {8, 20, 30};
+    const int lengths2[] = {18, 30};
+    const int lengths3[] = {1};
+
+    make_chain(&chain);
+
+    //partial consume within the first slice
+    shared_buffer_chain_consume(&chain, 2);
+    check_chain(&chain, 2, lengths1, 3);
+
+    //across the slice boundary, the first slice is freed
+    shared_buffer_chain_consume(&chain, 10);
+    check_chain(&chain, 12, lengths2, 2);
+    assert(buffers[0]->reffer_count == 1);
+
+    shared_buffer_chain_consume(&chain, 47);
+    check_chain(&chain, 59, lengths3, 1);
+    shared_buffer_chain_consume(&chain, 100);
+    check_chain(&chain, 60, NULL, 0);
+}
+
+static void check_lengths(const SharedBufferChain *chain,
+        const int *lengths, const int count)
+{
+    struct iovec iov[8];
+    int i;
+
+    assert(shared_buffer_chain_to_iovec(chain, iov, 8) == count);
+    for (i=0; i<count; i++) {
+        assert(iov[i].iov_len == lengths[i]);
+    }
+    assert(chain->count == count && chain->tail->next == NULL);
+}
+
+static void test_append_chain()
+{
+    SharedBufferChain src;
+    SharedBufferChain dest;
+    SharedBufferChain filler;
+    SharedBufferChain saved;
+    struct fast_mblock_man *slice_allocator;
+    const int lengths[] = {10, 20, 30, 10, 20, 30};
+    int64_t used_count;
+
+    make_chain(&src);
+    make_chain(&dest);
+    assert(shared_buffer_chain_append_chain(&dest, &src) == 0);
+    check_lengths(&dest, lengths, 6);
+    assert(dest.length == 120);
+    assert(buffers[2]->reffer_count == 4);  //3 chains + owner
+    shared_buffer_chain_release(&dest);
+
+    /* no more trunk for the slices and only one free slice left,
+       the allocation fails in the middle of the append */
+    slice_allocator = &ctx.slice_allocator;
+    slice_allocator->alloc_elements.limit =
+        slice_allocator->info.element_total_count;
+    slice_allocator->alloc_elements.exceed_log_level = LOG_NOTHING;
+    make_chain(&dest);
+    shared_buffer_chain_init(&filler, &ctx);
+    while (slice_allocator->info.element_total_count -
+            slice_allocator->info.element_used_count > 1)
+    {
+        assert(shared_buffer_chain_append(&filler, buffers[0]) == 0);
+    }
+
+    saved = dest;
+    used_count = slice_allocator->info.element_used_count;
+    assert(shared_buffer_chain_append_chain(&dest, &src) == ENOMEM);
+    assert(dest.head == saved.head && dest.tail == saved.tail &&
+            dest.count == saved.count && dest.length == saved.length);
+    check_lengths(&dest, lengths, 3);
+    assert(slice_allocator->info.element_used_count == used_count);
+    assert(buffers[2]->reffer_count == 3);
+
+    //the append succeeds after the slices freed
+    shared_buffer_chain_release(&filler);
+    assert(shared_buffer_chain_append_chain(&dest, &src) == 0);
+    check_lengths(&dest, lengths, 6);
+    slice_allocator->alloc_elements.limit = 0;
+
+    shared_buffer_chain_release(&dest);
+    shared_buffer_chain_release(&src);
+    assert(buffers[2]->reffer_count == 1);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    log_init();
+    assert(shared_buffer_init_ex(&ctx, SLICE_ALLOC_ONCE, 256, true) == 0);
+    init_buffers();
+
+    test_to_iovec();
+    test_split();
+    test_consume();
+    test_append_chain();
+
+    for (i=0; i<BUFFER_COUNT; i++) {
+        assert(buffers[i]->reffer_count == 1);
+        shared_buffer_release(buffers[i]);
+    }
+    assert(ctx.allocator.info.element_used_count == 0);
+    assert(ctx.slice_allocator.info.element_used_count == 0);
+    shared_buffer_destroy(&ctx);
+    printf("test shared buffer chain OK\n");
+    return 0;
+}
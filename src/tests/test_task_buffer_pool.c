@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_task_queue.h"
+
+#define MIN_BUFF_SIZE  (8 * 1024)
+#define MAX_BUFF_SIZE  (100 * 1024)  //NOT the power of 2
+
+static void check_leased_bytes(const int64_t expect_bytes)
+{
+    struct fast_task_buffer_stat stat;
+
+    free_queue_buffer_stat(&stat);
+    if (stat.leased_bytes != expect_bytes) {
+        fprintf(stderr, "leased bytes: %"PRId64" != expect: %"PRId64"\n",
+                stat.leased_bytes, expect_bytes);
+        assert(stat.leased_bytes == expect_bytes);
+    }
+}
+
+static void check_buffer_size(struct fast_task_info *task,
+        const int expect_size, const int class_size)
+{
+    assert(free_queue_realloc_buffer(task, expect_size) == 0);
+    if (task->size != class_size) {
+        fprintf(stderr, "expect size: %d, buffer size: %d != %d\n",
+                expect_size, task->size, class_size);
+        assert(task->size == class_size);
+    }
+
+    //the whole buffer is writable
+    memset(task->data, 0, task->size);
+    check_leased_bytes(class_size > MIN_BUFF_SIZE ? class_size : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    struct fast_task_info *task;
+    int result;
+    int i;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+
+    if ((result=free_queue_init_ex(4, 4, 4, MIN_BUFF_SIZE,
+                    MAX_BUFF_SIZE, 0)) != 0)
+    {
+        return result;
+    }
+    if ((result=free_queue_set_buffer_pool()) != 0) {
+        return result;
+    }
+
+    for (i=0; i<3; i++) {
+        task = free_queue_pop();
+        assert(task != NULL);
+        assert(task->size == MIN_BUFF_SIZE);
+        check_leased_bytes(0);
+
+        check_buffer_size(task, 20 * 1024, 32 * 1024);
+        check_buffer_size(task, 64 * 1024, 64 * 1024);
+
+        //between the last power of 2 class and the max buffer size
+        check_buffer_size(task, 90 * 1024, MAX_BUFF_SIZE);
+        assert(free_queue_set_buffer_size(task, 70 * 1024) == 0);
+        assert(task->size == MAX_BUFF_SIZE);
+        check_leased_bytes(MAX_BUFF_SIZE);
+
+        //shrink to the own buffer when pushed back
+        assert(free_queue_push(task) == 0);
+        check_leased_bytes(0);
+    }
+
+    free_queue_destroy();
+    printf("test task buffer pool OK\n");
+    return 0;
+}
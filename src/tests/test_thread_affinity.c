@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  //for the CPU set macros and sched_getaffinity
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/thread_pool.h"
+
+#define THREAD_COUNT  8
+
+#ifdef OS_LINUX
+
+struct test_thread_arg {
+    int index;
+};
+
+static FCThreadAffinity affinity;
+static FCThreadPool pools[2];  //the normal pool and the work stealing pool
+static FCThreadPool *pool;
+static volatile bool continue_flag;
+static volatile int done_count;
+
+//check the CPUs of the running thread in the worker
+static void check_affinity(const int index)
+{
+    cpu_set_t expect_set;
+    cpu_set_t cpu_set;
+    const FCCPUSet *slot;
+    int i;
+
+    CPU_ZERO(&expect_set);
+    slot = affinity.slots + (index % affinity.slot_count);
+    for (i=0; i<slot->count; i++) {
+        CPU_SET(slot->cpus[i], &expect_set);
+    }
+
+    CPU_ZERO(&cpu_set);
+    assert(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0);
+    if (!CPU_EQUAL(&cpu_set, &expect_set)) {
+        fprintf(stderr, "policy: %s, thread index: %d, CPU count: %d, "
+                "expect count: %d\n", fc_thread_affinity_policy_caption(
+                    affinity.policy), index, CPU_COUNT(&cpu_set),
+                CPU_COUNT(&expect_set));
+        assert(CPU_EQUAL(&cpu_set, &expect_set));
+    }
+}
+
+static void *thread_func(void *arg)
+{
+    check_affinity(((struct test_thread_arg *)arg)->index);
+    __sync_add_and_fetch(&done_count, 1);
+    return NULL;
+}
+
+static void pool_task_func(void *arg, void *thread_data)
+{
+    FCThreadInfo *thread;
+    FCThreadInfo *end;
+
+    //find the index of this worker
+    end = pool->threads + pool->thread_counts.limit;
+    for (thread=pool->threads; thread<end; thread++) {
+        if (pthread_equal(thread->tid, pthread_self())) {
+            break;
+        }
+    }
+    assert(thread < end);
+
+    check_affinity(thread->index);
+    __sync_add_and_fetch(&done_count, 1);
+}
+
+static void wait_done(const int count)
+{
+    while (__sync_add_and_fetch(&done_count, 0) < count) {
+        usleep(1000);
+    }
+    done_count = 0;
+}
+
+//the threads are created detached
+static void test_create_threads()
+{
+    struct test_thread_arg args[THREAD_COUNT];
+    pthread_t tids[THREAD_COUNT];
+    int count;
+    int i;
+
+    for (i=0; i<THREAD_COUNT; i++) {
+        args[i].index = i;
+        assert(fc_create_thread_ex(tids + i, thread_func, args + i,
+                    0, &affinity, i) == 0);
+    }
+    wait_done(THREAD_COUNT);
+
+    count = THREAD_COUNT;
+    assert(create_work_threads_ex1(&count, thread_func, args,
+                sizeof(struct test_thread_arg), tids, 0, &affinity) == 0);
+    assert(count == THREAD_COUNT);
+    wait_done(THREAD_COUNT);
+}
+
+static void test_thread_pool(const bool work_stealing)
+{
+    int i;
+
+    continue_flag = true;
+    pool = pools + (work_stealing ? 1 : 0);
+    if (work_stealing) {
+        assert(fc_thread_pool_init_work_stealing(pool, "affinity",
+                    THREAD_COUNT, 0, 0, (bool * volatile)
+                    &continue_flag, NULL) == 0);
+    } else {
+        assert(fc_thread_pool_init(pool, "affinity", THREAD_COUNT, 0,
+                    1, 0, (bool * volatile)&continue_flag) == 0);
+    }
+
+    //the running threads are rebound in the work stealing mode
+    assert(fc_thread_pool_set_affinity(pool, &affinity) == 0);
+    for (i=0; i<4 * THREAD_COUNT; i++) {
+        assert(fc_thread_pool_run(pool, pool_task_func, NULL) == 0);
+    }
+    wait_done(4 * THREAD_COUNT);
+
+    continue_flag = false;
+    while (__sync_add_and_fetch(&pool->thread_counts.running, 0) > 0) {
+        usleep(10 * 1000);
+    }
+    fc_thread_pool_destroy(pool);
+}
+
+static void test_policy(const int policy, const char *cpu_list)
+{
+    int result;
+
+    if ((result=fc_thread_affinity_init(&affinity, policy, cpu_list)) != 0) {
+        fprintf(stderr, "init affinity fail, policy: %s, result: %d\n",
+                fc_thread_affinity_policy_caption(policy), result);
+        assert(result == 0);
+    }
+    assert(affinity.slot_count > 0);
+
+    test_create_threads();
+    test_thread_pool(false);
+    test_thread_pool(true);
+    printf("policy: %s, slot count: %d OK\n",
+            fc_thread_affinity_policy_caption(policy), affinity.slot_count);
+    fc_thread_affinity_destroy(&affinity);
+}
+
+int main(int argc, char *argv[])
+{
+    cpu_set_t cpu_set;
+    char cpu_list[32];
+    int cpu;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+
+    assert(fc_thread_affinity_init(&affinity, 100, NULL) == EINVAL);
+    assert(fc_thread_affinity_init(&affinity,
+                FC_THREAD_AFFINITY_CPU_LIST, NULL) == EINVAL);
+    assert(fc_thread_affinity_init(&affinity,
+                FC_THREAD_AFFINITY_NONE, NULL) == 0);
+    assert(affinity.slot_count == 0);
+
+    //the CPU allowed for this process
+    assert(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0);
+    for (cpu=0; cpu<CPU_SETSIZE && !CPU_ISSET(cpu, &cpu_set); cpu++) {
+    }
+    assert(cpu < CPU_SETSIZE);
+    sprintf(cpu_list, "%d", cpu);
+
+    test_policy(FC_THREAD_AFFINITY_CPU_LIST, cpu_list);
+    test_policy(FC_THREAD_AFFINITY_PER_CORE, NULL);
+    test_policy(FC_THREAD_AFFINITY_NO_SMT, NULL);
+    test_policy(FC_THREAD_AFFINITY_NUMA_NODE, NULL);
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+    printf("thread affinity NOT supported\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fast_timer.h"
+
+#define TICK        10
+#define BASE_TIME   1000000
+#define MAX_TICKS   (((int64_t)1 << 32) - 1)
+#define END_TICKS   (((int64_t)1 << 26) + 1000)  //reach the top level
+
+struct test_timer_entry {
+    FastTimerEntry timer;  //must be the first
+    int64_t expire_tick;   //the tick of the expires
+    bool removed;
+    bool fired;
+};
+
+static FastTimer timer;
+static struct test_timer_entry *entries;
+static int entry_count;
+
+//the ticks of each level and its boundary
+static const int64_t fixed_ticks[] = {0, 1, 2, 255, 256, 257, 1000,
+    16383, 16384, 16385, 100 * 1000, (1 << 20) + 3, (1 << 20) * 5 + 7,
+    ((int64_t)1 << 26) - 1, ((int64_t)1 << 26), ((int64_t)1 << 26) + 3};
+
+static void add_entry(struct test_timer_entry *entry,
+        const int64_t expire_tick)
+{
+    entry->expire_tick = expire_tick;
+    entry->removed = entry->fired = false;
+    fast_timer_add_ex(&timer, &entry->timer, BASE_TIME +
+            expire_tick * TICK, true);
+}
+
+//the entry is expired when the end time of its tick <= current time
+static inline bool is_expired(struct test_timer_entry *entry,
+        const int64_t current_time)
+{
+    return (current_time - BASE_TIME) / TICK > entry->expire_tick;
+}
+
+static int check_timeouts(const int64_t current_time)
+{
+    FastTimerEntry head;
+    FastTimerEntry *current;
+    struct test_timer_entry *entry;
+    int count;
+    int i;
+
+    count = fast_timer_timeouts_get(&timer, current_time, &head);
+    current = head.next;
+    for (i=0; i<count; i++) {
+        entry = (struct test_timer_entry *)current;
+        if (entry->removed || entry->fired || !is_expired(
+                    entry, current_time))
+        {
+            fprintf(stderr, "entry: %d, expire tick: %"PRId64", current "
+                    "tick: %"PRId64", removed: %d, fired: %d\n",
+                    (int)(entry - entries), entry->expire_tick,
+                    (current_time - BASE_TIME) / TICK,
+                    entry->removed, entry->fired);
+            assert(!entry->removed && !entry->fired);
+            assert(is_expired(entry, current_time));
+        }
+        entry->fired = true;
+        current = current->next;
+    }
+    assert(current == NULL);
+
+    //the expired entries fired in time
+    for (i=0; i<entry_count; i++) {
+        if (!(entries[i].removed || entries[i].fired) &&
+                is_expired(entries + i, current_time))
+        {
+            fprintf(stderr, "entry: %d, expire tick: %"PRId64" not fired, "
+                    "current tick: %"PRId64"\n", i, entries[i].expire_tick,
+                    (current_time - BASE_TIME) / TICK);
+            assert(entries[i].fired);
+        }
+    }
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    struct test_timer_entry far_entry;
+    int64_t current_time;
+    int64_t step;
+    int64_t fired_count;
+    int fixed_count;
+    int removed_count;
+    int i;
+
+    log_init();
+    g_log_context.log_level = LOG_DEBUG;
+    srand(time(NULL));
+
+    assert(fast_timer_init_hierarchy(&timer, 0, BASE_TIME) == EINVAL);
+    assert(fast_timer_init_hierarchy(&timer, TICK, BASE_TIME) == 0);
+    assert(fast_timer_is_hierarchy(&timer));
+
+    fixed_count = sizeof(fixed_ticks) / sizeof(fixed_ticks[0]);
+    entry_count = fixed_count + 10000;
+    entries = (struct test_timer_entry *)calloc(entry_count,
+            sizeof(struct test_timer_entry));
+    assert(entries != NULL);
+    for (i=0; i<fixed_count; i++) {
+        add_entry(entries + i, fixed_ticks[i]);
+    }
+    for (; i<entry_count; i++) {
+        add_entry(entries + i, ((int64_t)rand() * rand()) % END_TICKS);
+    }
+
+    //beyond the max ticks, clamped to the top level and cascaded again
+    add_entry(&far_entry, MAX_TICKS * 4);
+
+    //remove and modify the entries of the upper levels
+    removed_count = 0;
+    for (i=fixed_count; i<entry_count; i+=7) {
+        assert(fast_timer_remove(&timer, &entries[i].timer) == 0);
+        assert(fast_timer_remove(&timer, &entries[i].timer) == ENOENT);
+        entries[i].removed = true;
+        removed_count++;
+    }
+    for (i=fixed_count + 1; i<entry_count; i+=7) {
+        entries[i].expire_tick = entries[i].expire_tick / 2;
+        assert(fast_timer_modify(&timer, &entries[i].timer, BASE_TIME +
+                    entries[i].expire_tick * TICK) == 0);
+    }
+
+    //the steps within one tick, several ticks and across the levels
+    fired_count = 0;
+    current_time = BASE_TIME;
+    while ((current_time - BASE_TIME) / TICK <= END_TICKS) {
+        switch (rand() % 4) {
+            case 0:
+                step = 1 + rand() % TICK;
+                break;
+            case 1:
+                step = (1 + rand() % 300) * TICK;
+                break;
+            case 2:
+                step = (1 + rand() % 20000) * TICK;
+                break;
+            default:
+                step = (1 + rand() % 200000) * TICK + rand() % TICK;
+                break;
+        }
+        current_time += step;
+        fired_count += check_timeouts(current_time);
+    }
+
+    assert(fired_count == entry_count - removed_count);
+    assert(!far_entry.fired && far_entry.timer.prev != NULL);
+    assert(fast_timer_remove(&timer, &far_entry.timer) == 0);
+
+    //the entry expired already is fired by the next tick
+    add_entry(entries, (current_time - BASE_TIME) / TICK - 100);
+    entries[0].expire_tick = (current_time - BASE_TIME) / TICK;
+    assert(check_timeouts(current_time) == 0);
+    assert(check_timeouts(current_time + TICK) == 1);
+    assert(entries[0].fired);
+
+    printf("timer wheel OK, entry count: %d, fired: %"PRId64", "
+            "removed: %d\n", entry_count, fired_count, removed_count);
+    free(entries);
+    fast_timer_destroy(&timer);
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <assert.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/thread_pool.h"
+
+#define THREAD_COUNT      4
+#define DEQUE_CAPACITY    4     //small for the overflow tasks
+#define TREE_TASK_COUNT   (256 * 1024)
+#define BATCH_TASK_COUNT  (16 * 1024)
+#define BATCH_ROUNDS      8
+
+static FCThreadPool pool;
+static volatile int *run_counts;
+static volatile int done_count = 0;
+static volatile int thread_mask = 0;
+static __thread int thread_bit = 0;
+static volatile int next_thread_bit = 1;
+
+static void mark_task_done(const int index)
+{
+    if (thread_bit == 0) {
+        thread_bit = __sync_fetch_and_add(&next_thread_bit, 1);
+    }
+    __sync_fetch_and_or(&thread_mask, 1 << thread_bit);
+    __sync_add_and_fetch(run_counts + index, 1);
+    __sync_add_and_fetch(&done_count, 1);
+}
+
+static void wait_tasks_done(const int count)
+{
+    while (__sync_add_and_fetch(&done_count, 0) < count) {
+        fc_sleep_ms(1);
+    }
+}
+
+static void check_run_counts(const int count, const char *caption)
+{
+    int i;
+
+    wait_tasks_done(count);
+    for (i=0; i<count; i++) {
+        if (run_counts[i] != 1) {
+            logError("file: "__FILE__", line: %d, "
+                    "%s, task: %d, run count: %d != 1",
+                    __LINE__, caption, i, run_counts[i]);
+            exit(1);
+        }
+    }
+    assert(done_count == count);
+    printf("%s, task count: %d, thread mask: 0x%x OK\n",
+            caption, count, thread_mask);
+
+    memset((void *)run_counts, 0, sizeof(int) * count);
+    done_count = 0;
+    thread_mask = 0;
+}
+
+/* the task tree: the task i submits the tasks 2i + 1 and 2i + 2, so the
+   owners push and pop their deques while the other threads steal */
+static void tree_task_func(void *arg, void *thread_data)
+{
+    int index;
+    int child;
+    int i;
+
+    index = (long)arg;
+    for (i=1; i<=2; i++) {
+        child = 2 * index + i;
+        if (child < TREE_TASK_COUNT) {
+            assert(fc_thread_pool_run(&pool, tree_task_func,
+                        (void *)(long)child) == 0);
+        }
+    }
+    mark_task_done(index);
+}
+
+static void batch_task_func(void *arg, void *thread_data)
+{
+    mark_task_done((long)arg);
+}
+
+static void make_batch(FCThreadPoolTask *tasks, const int count)
+{
+    int i;
+
+    for (i=0; i<count; i++) {
+        tasks[i].func = batch_task_func;
+        tasks[i].arg = (void *)(long)i;
+    }
+}
+
+/* submit the batch from the worker thread, the tasks overflow the
+   deque of the thread go to the injection queue */
+static void spawn_batch_task_func(void *arg, void *thread_data)
+{
+    FCThreadPoolTask *tasks;
+
+    tasks = (FCThreadPoolTask *)arg;
+    assert(fc_thread_pool_run_batch(&pool, tasks, BATCH_TASK_COUNT) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    FCThreadPoolTask *tasks;
+    volatile bool continue_flag = true;
+    int i;
+
+    log_init();
+    run_counts = (volatile int *)calloc(TREE_TASK_COUNT, sizeof(int));
+    tasks = (FCThreadPoolTask *)malloc(sizeof(FCThreadPoolTask) *
+            BATCH_TASK_COUNT);
+    assert(run_counts != NULL && tasks != NULL);
+
+    assert(fc_thread_pool_init_work_stealing(&pool, "ws", THREAD_COUNT,
+                128 * 1024, DEQUE_CAPACITY, (bool * volatile)
+                &continue_flag, NULL) == 0);
+    assert(pool.ws.deque_mask + 1 == DEQUE_CAPACITY);
+
+    //owner push / pop against the concurrent steals
+    assert(fc_thread_pool_run(&pool, tree_task_func, (void *)0) == 0);
+    check_run_counts(TREE_TASK_COUNT, "task tree");
+
+    //the injection queue grows beyond its initial capacity
+    make_batch(tasks, BATCH_TASK_COUNT);
+    for (i=0; i<BATCH_ROUNDS; i++) {
+        assert(fc_thread_pool_run_batch(&pool, tasks,
+                    BATCH_TASK_COUNT) == 0);
+        check_run_counts(BATCH_TASK_COUNT, "batch from main thread");
+    }
+    assert(pool.ws.injection.capacity >= BATCH_TASK_COUNT);
+
+    //the batch overflows the deque of the worker thread
+    for (i=0; i<BATCH_ROUNDS; i++) {
+        assert(fc_thread_pool_run(&pool, spawn_batch_task_func,
+                    tasks) == 0);
+        check_run_counts(BATCH_TASK_COUNT, "batch from worker thread");
+    }
+
+    continue_flag = false;
+    fc_thread_pool_destroy(&pool);
+    free(tasks);
+    free((void *)run_counts);
+    printf("test work stealing OK\n");
+    return 0;
+}
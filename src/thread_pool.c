@@ -22,6 +22,27 @@
 #include "fc_memory.h"
 #include "thread_pool.h"
 
+#ifdef OS_LINUX
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#define FC_THREAD_POOL_DEFAULT_DEQUE_CAPACITY  4096
+#define FC_THREAD_POOL_INIT_INJECTION_CAPACITY 1024
+
+//the current worker thread in work stealing mode
+static __thread FCThreadInfo *ws_current_thread = NULL;
+
+typedef struct fc_parallel_for_context {
+    volatile int64_t next;  //the begin of the next chunk
+    int64_t end;
+    int64_t grain;
+    fc_parallel_for_callback func;
+    void *arg;
+    FCThreadPoolCompletion completion;
+} FCParallelForContext;
+
 static void *thread_entrance(void *arg)
 {
     FCThreadInfo *thread;
@@ -188,8 +209,9 @@ static int thread_pool_alloc_init(FCThreadPool *pool)
         end = pool->threads + pool->min_idle_count;
         for (thread=pool->threads; thread<end; thread++) {
             thread->inited = true;
-            if ((result=fc_create_thread(&thread->tid, thread_entrance,
-                            thread, pool->stack_size)) != 0)
+            if ((result=fc_create_thread_ex(&thread->tid, thread_entrance,
+                            thread, pool->stack_size, pool->affinity,
+                            thread->index)) != 0)
             {
                 return result;
             }
@@ -199,7 +221,7 @@ static int thread_pool_alloc_init(FCThreadPool *pool)
     return 0;
 }
 
-int fc_thread_pool_init_ex(FCThreadPool *pool, const char *name,
+static int thread_pool_init_params(FCThreadPool *pool, const char *name,
         const int limit, const int stack_size, const int max_idle_time,
         const int min_idle_count, bool * volatile pcontinue_flag,
         FCThreadExtraDataCallbacks *extra_data_callbacks)
@@ -228,13 +250,527 @@ int fc_thread_pool_init_ex(FCThreadPool *pool, const char *name,
         pool->extra_data_callbacks.alloc = NULL;
         pool->extra_data_callbacks.free = NULL;
     }
+    pool->affinity = NULL;
+    pool->work_stealing = false;
+
+    return 0;
+}
+
+int fc_thread_pool_init_ex(FCThreadPool *pool, const char *name,
+        const int limit, const int stack_size, const int max_idle_time,
+        const int min_idle_count, bool * volatile pcontinue_flag,
+        FCThreadExtraDataCallbacks *extra_data_callbacks)
+{
+    int result;
+
+    if ((result=thread_pool_init_params(pool, name, limit, stack_size,
+                    max_idle_time, min_idle_count, pcontinue_flag,
+                    extra_data_callbacks)) != 0)
+    {
+        return result;
+    }
 
     return thread_pool_alloc_init(pool);
 }
 
+static inline bool ws_deque_push(FCThreadPool *pool,
+        FCThreadInfo *thread, const FCThreadPoolTask *task)
+{
+    int64_t bottom;
+    int64_t top;
+
+    bottom = __atomic_load_n(&thread->deque.bottom, __ATOMIC_RELAXED);
+    top = __atomic_load_n(&thread->deque.top, __ATOMIC_ACQUIRE);
+    if (bottom - top > pool->ws.deque_mask) {  //full
+        return false;
+    }
+
+    thread->deque.tasks[bottom & pool->ws.deque_mask] = *task;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&thread->deque.bottom, bottom + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static inline bool ws_deque_pop(FCThreadPool *pool,
+        FCThreadInfo *thread, FCThreadPoolTask *task)
+{
+    int64_t bottom;
+    int64_t top;
+    bool found;
+
+    bottom = __atomic_load_n(&thread->deque.bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&thread->deque.bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    top = __atomic_load_n(&thread->deque.top, __ATOMIC_RELAXED);
+    if (top > bottom) {  //empty
+        __atomic_store_n(&thread->deque.bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *task = thread->deque.tasks[bottom & pool->ws.deque_mask];
+    if (top < bottom) {
+        return true;
+    }
+
+    //the last task, race with the stealers
+    found = __atomic_compare_exchange_n(&thread->deque.top, &top, top + 1,
+            false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&thread->deque.bottom, bottom + 1, __ATOMIC_RELAXED);
+    return found;
+}
+
+static inline bool ws_deque_steal(FCThreadPool *pool,
+        FCThreadInfo *victim, FCThreadPoolTask *task)
+{
+    int64_t bottom;
+    int64_t top;
+
+    top = __atomic_load_n(&victim->deque.top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    bottom = __atomic_load_n(&victim->deque.bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) {
+        return false;
+    }
+
+    /* the task is discarded when CAS fail, so the slot overwritten
+       by the owner does not matter */
+    *task = victim->deque.tasks[top & pool->ws.deque_mask];
+    return __atomic_compare_exchange_n(&victim->deque.top, &top, top + 1,
+            false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static bool ws_has_task(FCThreadPool *pool)
+{
+    FCThreadInfo *thread;
+    FCThreadInfo *end;
+
+    if (pool->ws.injection.count > 0) {
+        return true;
+    }
+
+    end = pool->threads + pool->thread_counts.limit;
+    for (thread=pool->threads; thread<end; thread++) {
+        if (__atomic_load_n(&thread->deque.bottom, __ATOMIC_ACQUIRE) >
+                __atomic_load_n(&thread->deque.top, __ATOMIC_ACQUIRE))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline void ws_notify_waiting_threads(FCThreadPool *pool,
+        const int count)
+{
+    if (count > 1) {
+        pthread_cond_broadcast(&pool->cond);
+    } else {
+        pthread_cond_signal(&pool->cond);
+    }
+}
+
+//notify the waiting threads without the pool lock
+static inline void ws_notify(FCThreadPool *pool, const int count)
+{
+    //pairs with the increment of the sleeping count by the waiting thread
+    __sync_synchronize();
+    if (pool->ws.sleeping > 0) {
+        PTHREAD_MUTEX_LOCK(&pool->lock);
+        ws_notify_waiting_threads(pool, count);
+        PTHREAD_MUTEX_UNLOCK(&pool->lock);
+    }
+}
+
+//call with the pool lock
+static int ws_injection_push(FCThreadPool *pool,
+        const FCThreadPoolTask *tasks, const int count)
+{
+    FCThreadPoolTask *new_tasks;
+    int new_capacity;
+    int index;
+    int i;
+
+    if (pool->ws.injection.count + count > pool->ws.injection.capacity) {
+        new_capacity = pool->ws.injection.capacity * 2;
+        while (new_capacity < pool->ws.injection.count + count) {
+            new_capacity *= 2;
+        }
+        new_tasks = (FCThreadPoolTask *)fc_malloc(
+                sizeof(FCThreadPoolTask) * new_capacity);
+        if (new_tasks == NULL) {
+            return ENOMEM;
+        }
+
+        for (i=0; i<pool->ws.injection.count; i++) {
+            index = (pool->ws.injection.head + i) &
+                (pool->ws.injection.capacity - 1);
+            new_tasks[i] = pool->ws.injection.tasks[index];
+        }
+        free(pool->ws.injection.tasks);
+        pool->ws.injection.tasks = new_tasks;
+        pool->ws.injection.capacity = new_capacity;
+        pool->ws.injection.head = 0;
+    }
+
+    for (i=0; i<count; i++) {
+        index = (pool->ws.injection.head + pool->ws.injection.count) &
+            (pool->ws.injection.capacity - 1);
+        pool->ws.injection.tasks[index] = tasks[i];
+        pool->ws.injection.count++;
+    }
+
+    return 0;
+}
+
+/* take a batch of tasks from the injection queue, return the first one
+   and push the others to the deque of the current thread for stealing */
+static bool ws_injection_pop(FCThreadPool *pool,
+        FCThreadInfo *thread, FCThreadPoolTask *task)
+{
+    FCThreadPoolTask *current;
+    int count;
+    int i;
+
+    if (pool->ws.injection.count == 0) {
+        return false;
+    }
+
+    PTHREAD_MUTEX_LOCK(&pool->lock);
+    count = pool->ws.injection.count / pool->thread_counts.limit + 1;
+    if (count > pool->ws.injection.count) {
+        count = pool->ws.injection.count;
+    }
+    if (count > (pool->ws.deque_mask + 1) / 2) {
+        count = (pool->ws.deque_mask + 1) / 2;
+    }
+
+    for (i=0; i<count; i++) {
+        current = pool->ws.injection.tasks + pool->ws.injection.head;
+        if (i == 0) {
+            *task = *current;
+        } else if (!ws_deque_push(pool, thread, current)) {
+            break;
+        }
+
+        pool->ws.injection.head = (pool->ws.injection.head + 1) &
+            (pool->ws.injection.capacity - 1);
+        pool->ws.injection.count--;
+    }
+
+    if (i > 1 && pool->ws.sleeping > 0) {
+        ws_notify_waiting_threads(pool, i - 1);
+    }
+    PTHREAD_MUTEX_UNLOCK(&pool->lock);
+
+    return (i > 0);
+}
+
+static bool ws_steal_task(FCThreadPool *pool, FCThreadInfo *thread,
+        unsigned int *seed, FCThreadPoolTask *task)
+{
+    FCThreadInfo *victim;
+    int start;
+    int i;
+
+    start = rand_r(seed) % pool->thread_counts.limit;
+    for (i=0; i<pool->thread_counts.limit; i++) {
+        victim = pool->threads + (start + i) % pool->thread_counts.limit;
+        if (victim != thread && ws_deque_steal(pool, victim, task)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void *ws_thread_entrance(void *arg)
+{
+    FCThreadInfo *thread;
+    FCThreadPool *pool;
+    FCThreadPoolTask task;
+    struct timespec ts;
+    unsigned int seed;
+    bool busy;
+
+    thread = (FCThreadInfo *)arg;
+    pool = thread->pool;
+
+#ifdef OS_LINUX
+    {
+        char thread_name[64];
+        snprintf(thread_name, sizeof(thread_name), "%s[%d]",
+                pool->name, thread->index);
+        prctl(PR_SET_NAME, thread_name);
+    }
+#endif
+
+    if (pool->extra_data_callbacks.alloc != NULL) {
+        thread->tdata = pool->extra_data_callbacks.alloc();
+    }
+    ws_current_thread = thread;
+
+    PTHREAD_MUTEX_LOCK(&pool->lock);
+    pool->thread_counts.running++;
+    logDebug("thread pool: %s, index: %d start, running count: %d",
+            pool->name, thread->index, pool->thread_counts.running);
+    PTHREAD_MUTEX_UNLOCK(&pool->lock);
+
+    seed = thread->index;
+    busy = false;
+    ts.tv_nsec = 0;
+    while (*pool->pcontinue_flag) {
+        if (ws_deque_pop(pool, thread, &task) ||
+                ws_injection_pop(pool, thread, &task) ||
+                ws_steal_task(pool, thread, &seed, &task))
+        {
+            if (!busy) {
+                busy = true;
+                __sync_add_and_fetch(&pool->thread_counts.dealing, 1);
+            }
+            task.func(task.arg, thread->tdata);
+            continue;
+        }
+
+        if (busy) {
+            busy = false;
+            __sync_sub_and_fetch(&pool->thread_counts.dealing, 1);
+        }
+
+        PTHREAD_MUTEX_LOCK(&pool->lock);
+        __sync_add_and_fetch(&pool->ws.sleeping, 1);
+        if (!ws_has_task(pool) && *pool->pcontinue_flag) {
+            ts.tv_sec = get_current_time() + 2;
+            pthread_cond_timedwait(&pool->cond, &pool->lock, &ts);
+        }
+        __sync_sub_and_fetch(&pool->ws.sleeping, 1);
+        PTHREAD_MUTEX_UNLOCK(&pool->lock);
+    }
+
+    if (busy) {
+        __sync_sub_and_fetch(&pool->thread_counts.dealing, 1);
+    }
+    ws_current_thread = NULL;
+
+    if (pool->extra_data_callbacks.free != NULL && thread->tdata != NULL) {
+        pool->extra_data_callbacks.free(thread->tdata);
+        thread->tdata = NULL;
+    }
+
+    PTHREAD_MUTEX_LOCK(&pool->lock);
+    thread->inited = false;
+    pool->thread_counts.running--;
+    logDebug("thread pool: %s, index: %d exit, running count: %d",
+            pool->name, thread->index, pool->thread_counts.running);
+    PTHREAD_MUTEX_UNLOCK(&pool->lock);
+
+    return NULL;
+}
+
+static int ws_run_batch(FCThreadPool *pool,
+        const FCThreadPoolTask *tasks, const int count)
+{
+    FCThreadInfo *thread;
+    int result;
+    int i;
+
+    if (count <= 0) {
+        return 0;
+    }
+
+    //called by the worker thread, push to its own deque without lock
+    thread = ws_current_thread;
+    if (thread != NULL && thread->pool == pool) {
+        for (i=0; i<count; i++) {
+            if (!ws_deque_push(pool, thread, tasks + i)) {
+                break;
+            }
+        }
+
+        if (i > 0) {
+            ws_notify(pool, i);
+        }
+        if (i == count) {
+            return 0;
+        }
+    } else {
+        i = 0;
+    }
+
+    //the overflow tasks of the full deque go to the injection queue
+    PTHREAD_MUTEX_LOCK(&pool->lock);
+    if ((result=ws_injection_push(pool, tasks + i, count - i)) == 0) {
+        if (pool->ws.sleeping > 0) {
+            ws_notify_waiting_threads(pool, count - i);
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&pool->lock);
+
+    return result;
+}
+
+int fc_thread_pool_init_work_stealing(FCThreadPool *pool, const char *name,
+        const int thread_count, const int stack_size, const int deque_capacity,
+        bool * volatile pcontinue_flag,
+        FCThreadExtraDataCallbacks *extra_data_callbacks)
+{
+    FCThreadInfo *thread;
+    FCThreadInfo *end;
+    int capacity;
+    int bytes;
+    int result;
+
+    if (thread_count <= 0) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid thread count: %d", __LINE__, thread_count);
+        return EINVAL;
+    }
+
+    if ((result=thread_pool_init_params(pool, name, thread_count,
+                    stack_size, 0, thread_count, pcontinue_flag,
+                    extra_data_callbacks)) != 0)
+    {
+        return result;
+    }
+
+    if (deque_capacity <= 0) {
+        capacity = FC_THREAD_POOL_DEFAULT_DEQUE_CAPACITY;
+    } else {
+        capacity = 2;
+        while (capacity < deque_capacity) {
+            capacity *= 2;
+        }
+    }
+    pool->work_stealing = true;
+    pool->ws.deque_mask = capacity - 1;
+    pool->ws.sleeping = 0;
+    pool->ws.injection.head = 0;
+    pool->ws.injection.count = 0;
+    pool->ws.injection.capacity = FC_THREAD_POOL_INIT_INJECTION_CAPACITY;
+    pool->ws.injection.tasks = (FCThreadPoolTask *)fc_malloc(
+            sizeof(FCThreadPoolTask) * pool->ws.injection.capacity);
+    if (pool->ws.injection.tasks == NULL) {
+        return ENOMEM;
+    }
+
+    bytes = sizeof(FCThreadInfo) * thread_count;
+    pool->threads = (FCThreadInfo *)fc_malloc(bytes);
+    if (pool->threads == NULL) {
+        return ENOMEM;
+    }
+    memset(pool->threads, 0, bytes);
+    pool->freelist = NULL;
+
+    end = pool->threads + thread_count;
+    for (thread=pool->threads; thread<end; thread++) {
+        thread->pool = pool;
+        thread->index = thread - pool->threads;
+        thread->deque.tasks = (FCThreadPoolTask *)fc_malloc(
+                sizeof(FCThreadPoolTask) * capacity);
+        if (thread->deque.tasks == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    //start the threads after all deques ready for stealing
+    for (thread=pool->threads; thread<end; thread++) {
+        thread->inited = true;
+        if ((result=fc_create_thread_ex(&thread->tid, ws_thread_entrance,
+                        thread, pool->stack_size, pool->affinity,
+                        thread->index)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static bool ws_threads_exited(FCThreadPool *pool)
+{
+    FCThreadInfo *thread;
+    FCThreadInfo *end;
+    bool exited;
+
+    exited = true;
+    PTHREAD_MUTEX_LOCK(&pool->lock);
+    end = pool->threads + pool->thread_counts.limit;
+    for (thread=pool->threads; thread<end; thread++) {
+        if (thread->inited) {
+            exited = false;
+            break;
+        }
+    }
+    if (!exited) {
+        pthread_cond_broadcast(&pool->cond);
+    }
+    PTHREAD_MUTEX_UNLOCK(&pool->lock);
+    return exited;
+}
+
 void fc_thread_pool_destroy(FCThreadPool *pool)
 {
+    FCThreadInfo *thread;
+    FCThreadInfo *end;
 
+    if (!pool->work_stealing) {
+        return;
+    }
+
+    if (pool->threads != NULL) {
+        //the worker threads access the task queues until they exit
+        if (*pool->pcontinue_flag) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "thread pool: %s, the continue flag is true, "
+                    "can't free the task queues", __LINE__, pool->name);
+            return;
+        }
+        while (!ws_threads_exited(pool)) {
+            fc_sleep_ms(1);
+        }
+
+        end = pool->threads + pool->thread_counts.limit;
+        for (thread=pool->threads; thread<end; thread++) {
+            if (thread->deque.tasks != NULL) {
+                free(thread->deque.tasks);
+            }
+        }
+        free(pool->threads);
+        pool->threads = NULL;
+    }
+
+    if (pool->ws.injection.tasks != NULL) {
+        free(pool->ws.injection.tasks);
+        pool->ws.injection.tasks = NULL;
+    }
+}
+
+int fc_thread_pool_set_affinity(FCThreadPool *pool,
+        const FCThreadAffinity *affinity)
+{
+    FCThreadInfo *thread;
+    FCThreadInfo *end;
+    int result;
+
+    pool->affinity = affinity;
+    result = 0;
+    end = pool->threads + pool->thread_counts.limit;
+    for (thread=pool->threads; thread<end && result == 0; thread++) {
+        if (pool->work_stealing) {  //the threads never exit
+            result = fc_thread_affinity_bind(affinity,
+                    thread->tid, thread->index);
+            continue;
+        }
+
+        PTHREAD_MUTEX_LOCK(&thread->lock);
+        if (thread->inited) {
+            result = fc_thread_affinity_bind(affinity,
+                    thread->tid, thread->index);
+        }
+        PTHREAD_MUTEX_UNLOCK(&thread->lock);
+    }
+
+    return result;
 }
 
 int fc_thread_pool_run(FCThreadPool *pool, fc_thread_pool_callback func,
@@ -244,6 +780,13 @@ int fc_thread_pool_run(FCThreadPool *pool, fc_thread_pool_callback func,
     struct timespec ts;
     int result;
 
+    if (pool->work_stealing) {
+        FCThreadPoolTask task;
+        task.func = func;
+        task.arg = arg;
+        return ws_run_batch(pool, &task, 1);
+    }
+
     thread = NULL;
     ts.tv_nsec = 0;
     PTHREAD_MUTEX_LOCK(&pool->lock);
@@ -267,8 +810,8 @@ int fc_thread_pool_run(FCThreadPool *pool, fc_thread_pool_callback func,
     thread->callback.func = func;
     thread->callback.arg = arg;
     if (!thread->inited) {
-        result = fc_create_thread(&thread->tid, thread_entrance,
-                thread, pool->stack_size);
+        result = fc_create_thread_ex(&thread->tid, thread_entrance,
+                thread, pool->stack_size, pool->affinity, thread->index);
     } else {
         pthread_cond_signal(&thread->cond);
         result = 0;
@@ -277,3 +820,187 @@ int fc_thread_pool_run(FCThreadPool *pool, fc_thread_pool_callback func,
 
     return result;
 }
+
+int fc_thread_pool_run_batch(FCThreadPool *pool,
+        const FCThreadPoolTask *tasks, const int count)
+{
+    const FCThreadPoolTask *task;
+    const FCThreadPoolTask *end;
+    int result;
+
+    if (pool->work_stealing) {
+        return ws_run_batch(pool, tasks, count);
+    }
+
+    end = tasks + count;
+    for (task=tasks; task<end; task++) {
+        if ((result=fc_thread_pool_run(pool, task->func, task->arg)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+int fc_thread_pool_completion_init(FCThreadPoolCompletion *completion)
+{
+    completion->count = 0;
+#ifdef OS_LINUX
+    return 0;
+#else
+    return init_pthread_lock_cond(&completion->lock, &completion->cond);
+#endif
+}
+
+void fc_thread_pool_completion_destroy(FCThreadPoolCompletion *completion)
+{
+#ifndef OS_LINUX
+    pthread_cond_destroy(&completion->cond);
+    pthread_mutex_destroy(&completion->lock);
+#endif
+}
+
+void fc_thread_pool_completion_done(FCThreadPoolCompletion *completion)
+{
+#ifdef OS_LINUX
+    if (__sync_sub_and_fetch(&completion->count, 1) == 0) {
+        syscall(SYS_futex, &completion->count, FUTEX_WAKE_PRIVATE,
+                INT_MAX, NULL, NULL, 0);
+    }
+#else
+    PTHREAD_MUTEX_LOCK(&completion->lock);
+    if (__sync_sub_and_fetch(&completion->count, 1) == 0) {
+        pthread_cond_broadcast(&completion->cond);
+    }
+    PTHREAD_MUTEX_UNLOCK(&completion->lock);
+#endif
+}
+
+void fc_thread_pool_completion_wait(FCThreadPoolCompletion *completion)
+{
+    int count;
+
+#ifdef OS_LINUX
+    while ((count=__sync_add_and_fetch(&completion->count, 0)) > 0) {
+        //return immediately when the count changed
+        syscall(SYS_futex, &completion->count, FUTEX_WAIT_PRIVATE,
+                count, NULL, NULL, 0);
+    }
+#else
+    PTHREAD_MUTEX_LOCK(&completion->lock);
+    while ((count=__sync_add_and_fetch(&completion->count, 0)) > 0) {
+        pthread_cond_wait(&completion->cond, &completion->lock);
+    }
+    PTHREAD_MUTEX_UNLOCK(&completion->lock);
+#endif
+}
+
+static void parallel_for_run_chunks(FCParallelForContext *context)
+{
+    int64_t begin;
+    int64_t end;
+
+    while ((begin=__sync_fetch_and_add(&context->next,
+                    context->grain)) < context->end)
+    {
+        end = begin + context->grain;
+        if (end > context->end) {
+            end = context->end;
+        }
+        context->func(begin, end, context->arg);
+    }
+}
+
+static void parallel_for_helper(void *arg, void *thread_data)
+{
+    FCParallelForContext *context;
+
+    context = (FCParallelForContext *)arg;
+    parallel_for_run_chunks(context);
+    fc_thread_pool_completion_done(&context->completion);
+}
+
+static void parallel_for_wait(FCThreadPool *pool,
+        FCParallelForContext *context)
+{
+    FCThreadInfo *thread;
+    FCThreadPoolTask task;
+
+    /* the worker thread runs the queued tasks (including the helpers
+       of this call) instead of blocking to avoid deadlock */
+    thread = ws_current_thread;
+    if (pool->work_stealing && thread != NULL && thread->pool == pool) {
+        while (__sync_add_and_fetch(&context->completion.count, 0) > 0 &&
+                (ws_deque_pop(pool, thread, &task) ||
+                 ws_injection_pop(pool, thread, &task)))
+        {
+            task.func(task.arg, thread->tdata);
+        }
+    }
+
+    fc_thread_pool_completion_wait(&context->completion);
+}
+
+int fc_parallel_for(FCThreadPool *pool, const int64_t begin,
+        const int64_t end, const int64_t grain,
+        fc_parallel_for_callback func, void *arg)
+{
+    FCParallelForContext context;
+    int64_t chunk_count;
+    int helper_count;
+    int result;
+
+    if (end <= begin) {
+        return 0;
+    }
+
+    context.next = begin;
+    context.end = end;
+    context.func = func;
+    context.arg = arg;
+    if (grain > 0) {
+        context.grain = grain;
+    } else {
+        context.grain = (end - begin) / (4 * pool->thread_counts.limit);
+        if (context.grain == 0) {
+            context.grain = 1;
+        }
+    }
+
+    chunk_count = (end - begin + context.grain - 1) / context.grain;
+    if (pool->work_stealing) {
+        helper_count = pool->thread_counts.limit;
+    } else {  //avoid blocking in fc_thread_pool_run
+        helper_count = fc_thread_pool_avail_count(pool);
+    }
+    if (helper_count > chunk_count - 1) {
+        helper_count = chunk_count - 1;
+    }
+    if (helper_count <= 0) {
+        func(begin, end, arg);
+        return 0;
+    }
+
+    if ((result=fc_thread_pool_completion_init(&context.completion)) != 0) {
+        return result;
+    }
+
+    /* submit the helpers one by one, so the count to rollback
+       is exact when fail */
+    fc_thread_pool_completion_add(&context.completion, helper_count);
+    while (helper_count > 0) {
+        if (fc_thread_pool_run(pool, parallel_for_helper, &context) != 0) {
+            break;
+        }
+        helper_count--;
+    }
+
+    if (helper_count > 0) {  //rollback the tasks not submitted
+        __sync_sub_and_fetch(&context.completion.count, helper_count);
+    }
+
+    parallel_for_run_chunks(&context);
+    parallel_for_wait(pool, &context);
+    fc_thread_pool_completion_destroy(&context.completion);
+    return 0;
+}
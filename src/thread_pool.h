@@ -25,6 +25,26 @@ typedef void (*fc_thread_pool_callback)(void *arg, void *thread_data);
 typedef void* (*fc_alloc_thread_extra_data_callback)();
 typedef void  (*fc_free_thread_extra_data_callback)(void *ptr);
 
+typedef struct fc_thread_pool_task
+{
+    fc_thread_pool_callback func;
+    void *arg;
+} FCThreadPoolTask;
+
+typedef void (*fc_parallel_for_callback)(const int64_t begin,
+        const int64_t end, void *arg);
+
+/* the completion handle to wait for a batch of tasks, the task callback
+   should call fc_thread_pool_completion_done when finish */
+typedef struct fc_thread_pool_completion
+{
+    volatile int count;  //the pending task count, also the futex word
+#ifndef OS_LINUX
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+} FCThreadPoolCompletion;
+
 typedef struct fc_thread_extra_data_callbacks
 {
     fc_alloc_thread_extra_data_callback alloc;
@@ -46,6 +66,14 @@ typedef struct fc_thread_info
     } callback;
     struct fc_thread_pool *pool;
     struct fc_thread_info *next;
+
+    /* Chase-Lev deque for work stealing mode, the owner thread pushes
+       and pops at the bottom, the other threads steal from the top */
+    struct {
+        volatile int64_t top;
+        volatile int64_t bottom;
+        FCThreadPoolTask *tasks;
+    } deque;
 } FCThreadInfo;
 
 typedef struct fc_thread_pool
@@ -66,6 +94,22 @@ typedef struct fc_thread_pool
     } thread_counts;
     bool * volatile pcontinue_flag;
     FCThreadExtraDataCallbacks extra_data_callbacks;
+    const FCThreadAffinity *affinity;  //the placement of the threads
+
+    bool work_stealing;
+    struct {
+        int deque_mask;  //the capacity of the deque - 1
+        volatile int sleeping;  //the count of the waiting threads
+
+        /* the global injection queue for the tasks submitted by
+           the non worker threads, protected by the pool lock */
+        struct {
+            FCThreadPoolTask *tasks;
+            int capacity;
+            int head;
+            volatile int count;
+        } injection;
+    } ws;
 } FCThreadPool;
 
 #ifdef __cplusplus
@@ -82,11 +126,58 @@ int fc_thread_pool_init_ex(FCThreadPool *pool, const char *name,
         const int min_idle_count, bool * volatile pcontinue_flag,
         FCThreadExtraDataCallbacks *extra_data_callbacks);
 
+/** init the thread pool in work stealing mode, all threads are
+ *  created at startup and every thread has its own task deque.
+ *  fc_thread_pool_run never blocks in this mode, and it is safe to
+ *  submit tasks from the task callback
+ *  parameters:
+ *      pool: the thread pool
+ *      name: the pool name
+ *      thread_count: the count of the worker threads
+ *      stack_size: the thread stack size
+ *      deque_capacity: the capacity of the task deque per thread,
+ *                      round up to power of 2, 0 for default 4096
+ *      pcontinue_flag: the continue flag pointer
+ *      extra_data_callbacks: the thread extra data callbacks, can be NULL
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_thread_pool_init_work_stealing(FCThreadPool *pool, const char *name,
+        const int thread_count, const int stack_size, const int deque_capacity,
+        bool * volatile pcontinue_flag,
+        FCThreadExtraDataCallbacks *extra_data_callbacks);
+
+/** destroy the thread pool, the work stealing pool frees the task queues
+ *  after the threads exit, so it should be called after the continue
+ *  flag set to false
+ *  parameters:
+ *      pool: the thread pool
+ *  return: none
+*/
 void fc_thread_pool_destroy(FCThreadPool *pool);
 
+/** set the placement of the threads, the thread with index i is bound
+ *  to the slot i of the affinity, include the running threads
+ *  parameters:
+ *      pool: the thread pool
+ *      affinity: the thread affinity, NULL for no placement
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_thread_pool_set_affinity(FCThreadPool *pool,
+        const FCThreadAffinity *affinity);
+
 int fc_thread_pool_run(FCThreadPool *pool, fc_thread_pool_callback func,
         void *arg);
 
+/** run the tasks in batch
+ *  parameters:
+ *      pool: the thread pool
+ *      tasks: the tasks to run
+ *      count: the count of the tasks
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_thread_pool_run_batch(FCThreadPool *pool,
+        const FCThreadPoolTask *tasks, const int count);
+
 static inline int fc_thread_pool_dealing_count(FCThreadPool *pool)
 {
     return __sync_add_and_fetch(&pool->thread_counts.dealing, 0);
@@ -109,6 +200,39 @@ static inline int fc_thread_pool_running_count(FCThreadPool *pool)
     return running_count;
 }
 
+int fc_thread_pool_completion_init(FCThreadPoolCompletion *completion);
+
+void fc_thread_pool_completion_destroy(FCThreadPoolCompletion *completion);
+
+//add the pending task count before submit the tasks
+static inline void fc_thread_pool_completion_add(
+        FCThreadPoolCompletion *completion, const int count)
+{
+    __sync_add_and_fetch(&completion->count, count);
+}
+
+//called by the task callback when the task finish
+void fc_thread_pool_completion_done(FCThreadPoolCompletion *completion);
+
+//wait until all pending tasks finish
+void fc_thread_pool_completion_wait(FCThreadPoolCompletion *completion);
+
+/** split the range [begin, end) into chunks of grain size and call
+ *  func for each chunk in parallel, the calling thread takes part in
+ *  and this function returns after all chunks done
+ *  parameters:
+ *      pool: the thread pool
+ *      begin: the begin of the range
+ *      end: the end of the range (exclusive)
+ *      grain: the chunk size, <= 0 for auto
+ *      func: the callback for each chunk
+ *      arg: the argument pass to the callback
+ *  return: error no, 0 success, != 0 fail
+*/
+int fc_parallel_for(FCThreadPool *pool, const int64_t begin,
+        const int64_t end, const int64_t grain,
+        fc_parallel_for_callback func, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -141,6 +141,22 @@ int uniq_skiplist_init_ex2(UniqSkiplistFactory *factory,
     return 0;
 }
 
+int uniq_skiplist_set_numa_aware(UniqSkiplistFactory *factory)
+{
+    int result;
+    int i;
+
+    for (i=0; i<factory->max_level_count; i++) {
+        if ((result=fast_mblock_set_numa_aware(
+                        factory->node_allocators + i)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return fast_mblock_set_numa_aware(&factory->skiplist_allocator);
+}
+
 void uniq_skiplist_destroy(UniqSkiplistFactory *factory)
 {
     int i;
@@ -106,6 +106,18 @@ int uniq_skiplist_init_ex2(UniqSkiplistFactory *factory,
 
 void uniq_skiplist_destroy(UniqSkiplistFactory *factory);
 
+/** enable NUMA aware mode of the node and skiplist allocators,
+ *  should be called after init and before the skiplists creation.
+ *  it is NOT enabled by init because the allocators can't be set
+ *  (such as the thread cache and the telemetry) after NUMA aware,
+ *  and the nodes are placed on the NUMA node of the inserting thread,
+ *  so only the caller knows if it helps
+ *  parameters:
+ *      factory: the skiplist factory
+ *  return: error no, 0 success, != 0 fail
+*/
+int uniq_skiplist_set_numa_aware(UniqSkiplistFactory *factory);
+
 UniqSkiplist *uniq_skiplist_new(UniqSkiplistFactory *factory,
         const int level_count);
 